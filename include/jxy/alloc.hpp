@@ -8,14 +8,68 @@
 // Default new/delete is intentionally unimplemented! This forces specifying
 // the pool type and tags for all allocations.
 //
+// The sized delete enables returning memory to the per-CPU magazine cache
+// (see jxy/magazine.hpp) when it is initialized. Only the sized deletes
+// return the freed bytes to the pool statistics (see jxy/pool_stats.hpp),
+// the unsized deletes count the free but the bytes stay outstanding. The
+// jxy deleters and allocators always free sized.
+//
+// The std::align_val_t overloads are used by new expressions for types with
+// an alignment larger than __STDCPP_DEFAULT_NEW_ALIGNMENT__. The pool only
+// guarantees MEMORY_ALLOCATION_ALIGNMENT, larger alignments over-allocate
+// and store the pool block just before the aligned memory. Memory from the
+// aligned new must be given to the aligned delete with the same alignment.
+//
 #pragma once
 #include <fltKernel.h>
 #include <cstddef>
+#include <new>
 
 void* __cdecl operator new(size_t Size, POOL_TYPE PoolType, ULONG PoolTag) noexcept(false);
 
 void __cdecl operator delete(void* Memory, POOL_TYPE PoolType, ULONG PoolTag) noexcept;
 
+void __cdecl operator delete(void* Memory, size_t Size, POOL_TYPE PoolType, ULONG PoolTag) noexcept;
+
 void* __cdecl operator new[](size_t Size, POOL_TYPE PoolType, ULONG PoolTag) noexcept(false);
 
 void __cdecl operator delete[](void* Memory, POOL_TYPE PoolType, ULONG PoolTag) noexcept;
+
+void __cdecl operator delete[](void* Memory, size_t Size, POOL_TYPE PoolType, ULONG PoolTag) noexcept;
+
+void* __cdecl operator new(size_t Size, std::align_val_t Alignment, POOL_TYPE PoolType, ULONG PoolTag) noexcept(false);
+
+void __cdecl operator delete(void* Memory, std::align_val_t Alignment, POOL_TYPE PoolType, ULONG PoolTag) noexcept;
+
+void __cdecl operator delete(void* Memory, size_t Size, std::align_val_t Alignment, POOL_TYPE PoolType, ULONG PoolTag) noexcept;
+
+void* __cdecl operator new[](size_t Size, std::align_val_t Alignment, POOL_TYPE PoolType, ULONG PoolTag) noexcept(false);
+
+void __cdecl operator delete[](void* Memory, std::align_val_t Alignment, POOL_TYPE PoolType, ULONG PoolTag) noexcept;
+
+void __cdecl operator delete[](void* Memory, size_t Size, std::align_val_t Alignment, POOL_TYPE PoolType, ULONG PoolTag) noexcept;
+
+namespace jxy::details
+{
+
+//
+// Pool allocation honoring an alignment beyond MEMORY_ALLOCATION_ALIGNMENT.
+// Returns null on failure. The alignment must be a power of two and the same
+// alignment must be given to pool_free_aligned.
+//
+void* pool_allocate_aligned(
+    POOL_TYPE PoolType,
+    size_t Size,
+    size_t Alignment,
+    ULONG PoolTag) noexcept;
+
+void pool_free_aligned(void* Memory, size_t Alignment, ULONG PoolTag) noexcept;
+
+//
+// Translates a POOL_TYPE to the equivalent POOL_FLAGS for ExAllocatePool2
+// and ExAllocatePool3. The memory is left uninitialized, matching
+// ExAllocatePoolWithTag.
+//
+POOL_FLAGS pool_type_to_flags(POOL_TYPE PoolType) noexcept;
+
+}
@@ -0,0 +1,354 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/arena.hpp
+// Author:   Johnny Shaw
+// Abstract: Monotonic arena and arena allocator
+//
+// The jxy::arena is a bump allocator for short-lived (transient) work. It
+// allocates large chunks from the pool and hands out pieces of them.
+// Individual deallocations are no-ops, the memory is reclaimed all at once
+// by reset (which keeps the first chunk for reuse) or release (which frees
+// every chunk). The arena is not synchronized, it is meant to be used by one
+// thread for a batch of work.
+//
+// The jxy::arena_allocator is a stateful allocator that refers to an arena.
+// It carries the same pool type and tag as the arena and may be provided to
+// any of the jxy container aliases. Containers using it must not outlive
+// the arena, or a reset of it.
+//
+// jxylib                   STL equivalent
+// ---------------------------------------------------------------------------
+// jxy::arena               std::pmr::monotonic_buffer_resource
+// jxy::arena_allocator     std::pmr::polymorphic_allocator
+//
+#pragma once
+#include <fltKernel.h>
+#include <jxy/memory.hpp>
+
+namespace jxy
+{
+
+namespace details
+{
+
+template <POOL_TYPE t_PoolType, ULONG t_PoolTag>
+class arena
+{
+public:
+
+    static constexpr POOL_TYPE pool_type = t_PoolType;
+    static constexpr ULONG pool_tag = t_PoolTag;
+    static constexpr size_t default_chunk_size = (PAGE_SIZE * 4);
+
+    explicit arena(size_t ChunkSize = default_chunk_size) noexcept
+        : m_ChunkSize(ChunkSize)
+    {
+    }
+
+    ~arena() noexcept
+    {
+        release();
+    }
+
+    arena(const arena&) = delete;
+    arena& operator=(const arena&) = delete;
+
+    _NODISCARD
+    void* allocate(size_t Size, size_t Alignment = MEMORY_ALLOCATION_ALIGNMENT) noexcept(false)
+    {
+        NT_ASSERT((Alignment & (Alignment - 1)) == 0);
+
+        if (Size == 0)
+        {
+            Size = 1;
+        }
+
+        if (m_Current)
+        {
+            auto memory = bump(Size, Alignment);
+            if (memory)
+            {
+                return memory;
+            }
+        }
+
+        //
+        // Out of space in the current chunk. Requests that wouldn't leave
+        // much room in a normal chunk get a dedicated chunk which is linked
+        // behind the current one, so the current chunk keeps serving small
+        // requests.
+        //
+        auto required = (Size + Alignment);
+        if (required > (m_ChunkSize / 2))
+        {
+            auto dedicated = allocate_chunk(required);
+            if (m_Current)
+            {
+                dedicated->Next = m_Current->Next;
+                m_Current->Next = dedicated;
+            }
+            else
+            {
+                m_Current = dedicated;
+                m_Offset = dedicated->Size;
+            }
+
+            m_BytesAllocated += Size;
+            return align(dedicated->data(), Alignment);
+        }
+
+        auto chunk = allocate_chunk(m_ChunkSize);
+        chunk->Next = m_Current;
+        m_Current = chunk;
+        m_Offset = 0;
+
+        auto memory = bump(Size, Alignment);
+        NT_ASSERT(memory != nullptr);
+        return memory;
+    }
+
+    void deallocate(void*, size_t) noexcept
+    {
+        //
+        // Monotonic, memory is reclaimed by reset or release.
+        //
+    }
+
+    //
+    // Rewinds the arena and frees all but one standard sized chunk, which is
+    // kept for reuse. Everything allocated from the arena is invalidated.
+    //
+    void reset() noexcept
+    {
+        chunk* retained = nullptr;
+
+        auto chunk = m_Current;
+        while (chunk)
+        {
+            auto next = chunk->Next;
+            if (!retained && (chunk->Size == m_ChunkSize))
+            {
+                retained = chunk;
+                retained->Next = nullptr;
+            }
+            else
+            {
+                free_chunk(chunk);
+            }
+            chunk = next;
+        }
+
+        m_Current = retained;
+        m_Offset = 0;
+        m_BytesAllocated = 0;
+    }
+
+    //
+    // Frees every chunk back to the pool.
+    //
+    void release() noexcept
+    {
+        auto chunk = m_Current;
+        while (chunk)
+        {
+            auto next = chunk->Next;
+            free_chunk(chunk);
+            chunk = next;
+        }
+
+        m_Current = nullptr;
+        m_Offset = 0;
+        m_BytesAllocated = 0;
+    }
+
+    size_t bytes_allocated() const noexcept
+    {
+        return m_BytesAllocated;
+    }
+
+    size_t chunk_size() const noexcept
+    {
+        return m_ChunkSize;
+    }
+
+private:
+
+    struct DECLSPEC_ALIGN(MEMORY_ALLOCATION_ALIGNMENT) chunk
+    {
+        chunk* Next;
+        size_t Size;
+
+        uint8_t* data() noexcept
+        {
+            return reinterpret_cast<uint8_t*>(this + 1);
+        }
+    };
+
+    static uint8_t* align(uint8_t* Pointer, size_t Alignment) noexcept
+    {
+        auto value = reinterpret_cast<uintptr_t>(Pointer);
+        return reinterpret_cast<uint8_t*>((value + (Alignment - 1)) & ~(Alignment - 1));
+    }
+
+    void* bump(size_t Size, size_t Alignment) noexcept
+    {
+        auto start = m_Current->data();
+        auto memory = align(start + m_Offset, Alignment);
+        auto end = (static_cast<size_t>(memory - start) + Size);
+        if ((end < Size) || (end > m_Current->Size))
+        {
+            return nullptr;
+        }
+
+        m_Offset = end;
+        m_BytesAllocated += Size;
+        return memory;
+    }
+
+    chunk* allocate_chunk(size_t Size) noexcept(false)
+    {
+        if (Size > (static_cast<size_t>(-1) - sizeof(chunk)))
+        {
+            throw std::bad_alloc();
+        }
+
+        auto result = static_cast<chunk*>(
+            pool_allocate(t_PoolType,
+                          (sizeof(chunk) + Size),
+                          t_PoolTag));
+        if (!result)
+        {
+            throw std::bad_alloc();
+        }
+
+        details::pool_stats_allocate(t_PoolTag, (sizeof(chunk) + Size));
+
+        result->Next = nullptr;
+        result->Size = Size;
+        return result;
+    }
+
+    static void free_chunk(chunk* Chunk) noexcept
+    {
+        details::pool_stats_free(t_PoolTag, (sizeof(chunk) + Chunk->Size));
+        ExFreePoolWithTag(Chunk, t_PoolTag);
+    }
+
+    const size_t m_ChunkSize;
+    chunk* m_Current = nullptr;
+    size_t m_Offset = 0;
+    size_t m_BytesAllocated = 0;
+
+};
+
+template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag>
+class arena_allocator
+{
+public:
+
+    static_assert(!std::is_const_v<T>,
+                  "The C++ Standard forbids containers of const elements "
+                  "because allocator<const T> is ill-formed.");
+
+    static constexpr POOL_TYPE pool_type = t_PoolType;
+    static constexpr ULONG pool_tag = t_PoolTag;
+
+    using arena_type = arena<t_PoolType, t_PoolTag>;
+
+    using value_type = T;
+
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+    arena_allocator(arena_type& Arena) noexcept : m_Arena(&Arena)
+    {
+    }
+
+    arena_allocator(const arena_allocator&) noexcept = default;
+
+    template <typename Other>
+    arena_allocator(const arena_allocator<Other, t_PoolType, t_PoolTag>& Right) noexcept
+        : m_Arena(Right.get_arena())
+    {
+    }
+
+    ~arena_allocator() = default;
+    arena_allocator& operator=(const arena_allocator&) = default;
+
+    void deallocate(
+        value_type* const Memory,
+        const size_type Count) noexcept
+    {
+        m_Arena->deallocate(Memory, (sizeof(value_type) * Count));
+    }
+
+    _NODISCARD
+    __declspec(allocator)
+    value_type* allocate(_CRT_GUARDOVERFLOW const size_type Count)
+    {
+        if (Count > (static_cast<size_type>(-1) / sizeof(value_type)))
+        {
+            throw std::bad_alloc();
+        }
+
+        constexpr size_t alignment = (alignof(value_type) > MEMORY_ALLOCATION_ALIGNMENT ?
+                                      alignof(value_type) : MEMORY_ALLOCATION_ALIGNMENT);
+
+        return static_cast<value_type*>(
+            m_Arena->allocate((sizeof(value_type) * Count), alignment));
+    }
+
+    arena_type* get_arena() const noexcept
+    {
+        return m_Arena;
+    }
+
+    template <typename Other>
+    struct rebind
+    {
+        using other = arena_allocator<Other, t_PoolType, t_PoolTag>;
+    };
+
+private:
+
+    arena_type* m_Arena;
+
+};
+
+template <typename T, typename U, POOL_TYPE t_PoolType, ULONG t_PoolTag>
+bool operator==(
+    const arena_allocator<T, t_PoolType, t_PoolTag>& Left,
+    const arena_allocator<U, t_PoolType, t_PoolTag>& Right) noexcept
+{
+    return (Left.get_arena() == Right.get_arena());
+}
+
+template <typename T, typename U, POOL_TYPE t_PoolType, ULONG t_PoolTag>
+bool operator!=(
+    const arena_allocator<T, t_PoolType, t_PoolTag>& Left,
+    const arena_allocator<U, t_PoolType, t_PoolTag>& Right) noexcept
+{
+    return !(Left == Right);
+}
+
+}
+
+template <POOL_TYPE t_PoolType, ULONG t_PoolTag>
+using arena = details::arena<t_PoolType, t_PoolTag>;
+
+template <ULONG t_PoolTag>
+using paged_arena = details::arena<PagedPool, t_PoolTag>;
+
+template <ULONG t_PoolTag>
+using non_paged_arena = details::arena<NonPagedPoolNx, t_PoolTag>;
+
+template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag>
+using arena_allocator = details::arena_allocator<T, t_PoolType, t_PoolTag>;
+
+}
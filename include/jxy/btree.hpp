@@ -0,0 +1,1186 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/btree.hpp
+// Author:   Johnny Shaw
+// Abstract: B-tree implementation for jxy::btree_map and jxy::btree_set
+//
+// A red-black tree (jxy::map) allocates a node for every element and a
+// lookup follows a pointer, and likely misses the cache, at every level. A
+// B-tree keeps many elements in each node, a node is t_NodeBytes (four cache
+// lines by default) and a lookup searches the elements of a node before
+// following one pointer to the next. There is one allocation per node
+// rather than per element and the tree is a few levels deep.
+//
+// The elements are ordered and iteration is in order, as with jxy::map.
+// Unlike jxy::map, inserting or erasing moves elements between and within
+// nodes, so it invalidates iterators, pointers, and references to the
+// elements. erase(iterator) returns an iterator found by looking the next
+// key up again.
+//
+// Elements are moved as nodes fill and empty, moving value_type must not
+// throw. Inserting and erasing have the strong guarantee.
+//
+#pragma once
+#include <fltKernel.h>
+#include <jxy/memory.hpp>
+#include <iterator>
+#include <new>
+
+namespace jxy::details
+{
+
+//
+// Gets the key of a btree_set element.
+//
+struct btree_identity_key
+{
+    template <typename T>
+    static const T& get(const T& Value) noexcept
+    {
+        return Value;
+    }
+};
+
+//
+// Gets the key of a btree_map element.
+//
+struct btree_pair_key
+{
+    template <typename T>
+    static const typename T::first_type& get(const T& Value) noexcept
+    {
+        return Value.first;
+    }
+};
+
+template <typename TKey,
+          typename TValue,
+          typename TKeyOfValue,
+          typename TCompare,
+          POOL_TYPE t_PoolType,
+          ULONG t_PoolTag,
+          size_t t_NodeBytes>
+class btree
+{
+public:
+
+    using key_type = TKey;
+    using value_type = TValue;
+    using key_compare = TCompare;
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using pointer = value_type*;
+    using const_pointer = const value_type*;
+
+    static_assert(std::is_nothrow_move_constructible_v<value_type>,
+                  "btree elements must be nothrow move constructible");
+
+private:
+
+    struct internal_node;
+
+    //
+    // The slots beyond the header, at least 3 so that a split leaves
+    // elements on both sides.
+    //
+    static constexpr size_t header_bytes = (sizeof(void*) + (2 * sizeof(uint16_t)) + sizeof(bool));
+    static constexpr size_t fitting_slots = ((t_NodeBytes > header_bytes) ?
+                                             ((t_NodeBytes - header_bytes) / sizeof(value_type)) : 0);
+    static constexpr size_t node_slots = ((fitting_slots < 3) ? 3 : ((fitting_slots > 255) ? 255 : fitting_slots));
+    static constexpr size_t min_slots = (node_slots / 2);
+
+    struct leaf_node
+    {
+        internal_node* Parent;
+        uint16_t Position;
+        uint16_t Count;
+        bool Leaf;
+        alignas(value_type) unsigned char Slots[sizeof(value_type) * node_slots];
+
+        value_type* slot(size_t Index) noexcept
+        {
+            return std::launder(reinterpret_cast<value_type*>(Slots) + Index);
+        }
+
+        const value_type* slot(size_t Index) const noexcept
+        {
+            return std::launder(reinterpret_cast<const value_type*>(Slots) + Index);
+        }
+    };
+
+    struct internal_node : leaf_node
+    {
+        leaf_node* Children[node_slots + 1];
+    };
+
+    using leaf_allocator = allocator<leaf_node, t_PoolType, t_PoolTag>;
+    using internal_allocator = allocator<internal_node, t_PoolType, t_PoolTag>;
+
+    template <bool t_Const>
+    class btree_iterator
+    {
+    public:
+
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = typename btree::value_type;
+        using difference_type = ptrdiff_t;
+        using reference = std::conditional_t<t_Const, const value_type&, value_type&>;
+        using pointer = std::conditional_t<t_Const, const value_type*, value_type*>;
+
+        btree_iterator() noexcept = default;
+
+        template <bool t_OtherConst, typename = std::enable_if_t<t_Const && !t_OtherConst>>
+        btree_iterator(const btree_iterator<t_OtherConst>& Other) noexcept
+            : m_Node(Other.m_Node),
+              m_Position(Other.m_Position)
+        {
+        }
+
+        reference operator*() const noexcept
+        {
+            return *m_Node->slot(m_Position);
+        }
+
+        pointer operator->() const noexcept
+        {
+            return m_Node->slot(m_Position);
+        }
+
+        btree_iterator& operator++() noexcept
+        {
+            increment();
+            return *this;
+        }
+
+        btree_iterator operator++(int) noexcept
+        {
+            auto copy = *this;
+            increment();
+            return copy;
+        }
+
+        btree_iterator& operator--() noexcept
+        {
+            decrement();
+            return *this;
+        }
+
+        btree_iterator operator--(int) noexcept
+        {
+            auto copy = *this;
+            decrement();
+            return copy;
+        }
+
+        friend bool operator==(const btree_iterator& Left, const btree_iterator& Right) noexcept
+        {
+            return ((Left.m_Node == Right.m_Node) && (Left.m_Position == Right.m_Position));
+        }
+
+        friend bool operator!=(const btree_iterator& Left, const btree_iterator& Right) noexcept
+        {
+            return !(Left == Right);
+        }
+
+    private:
+
+        friend class btree;
+        friend class btree_iterator<!t_Const>;
+
+        btree_iterator(leaf_node* Node, size_t Position) noexcept
+            : m_Node(Node),
+              m_Position(Position)
+        {
+        }
+
+        void increment() noexcept
+        {
+            if (!m_Node->Leaf)
+            {
+                m_Node = child(m_Node, m_Position + 1);
+                while (!m_Node->Leaf)
+                {
+                    m_Node = child(m_Node, 0);
+                }
+                m_Position = 0;
+                return;
+            }
+
+            if (++m_Position < m_Node->Count)
+            {
+                return;
+            }
+
+            //
+            // Past the last element of a leaf, the next is the separator
+            // after it in the first ancestor it isn't the last child of. The
+            // end iterator is past the last element of the rightmost leaf.
+            //
+            auto end = *this;
+            while ((m_Position == m_Node->Count) && m_Node->Parent)
+            {
+                m_Position = m_Node->Position;
+                m_Node = m_Node->Parent;
+            }
+            if (m_Position == m_Node->Count)
+            {
+                *this = end;
+            }
+        }
+
+        void decrement() noexcept
+        {
+            if (!m_Node->Leaf)
+            {
+                m_Node = child(m_Node, m_Position);
+                while (!m_Node->Leaf)
+                {
+                    m_Node = child(m_Node, m_Node->Count);
+                }
+                m_Position = (m_Node->Count - 1);
+                return;
+            }
+
+            while ((m_Position == 0) && m_Node->Parent)
+            {
+                m_Position = m_Node->Position;
+                m_Node = m_Node->Parent;
+            }
+            NT_ASSERT(m_Position > 0);
+            m_Position--;
+        }
+
+        leaf_node* m_Node = nullptr;
+        size_t m_Position = 0;
+
+    };
+
+public:
+
+    using iterator = btree_iterator<false>;
+    using const_iterator = btree_iterator<true>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    static constexpr size_t node_capacity = node_slots;
+
+    btree() = default;
+
+    explicit btree(const key_compare& Compare) noexcept(std::is_nothrow_copy_constructible_v<key_compare>)
+        : m_Compare(Compare)
+    {
+    }
+
+    btree(const btree& Other) noexcept(false)
+        : m_Compare(Other.m_Compare)
+    {
+        copy_from(Other);
+    }
+
+    btree(btree&& Other) noexcept
+        : m_Compare(Other.m_Compare)
+    {
+        take(Other);
+    }
+
+    ~btree() noexcept
+    {
+        clear();
+    }
+
+    btree& operator=(const btree& Other) noexcept(false)
+    {
+        if (this != &Other)
+        {
+            btree copy(Other);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    btree& operator=(btree&& Other) noexcept
+    {
+        if (this != &Other)
+        {
+            clear();
+            m_Compare = Other.m_Compare;
+            take(Other);
+        }
+        return *this;
+    }
+
+    iterator begin() noexcept
+    {
+        return iterator(m_Leftmost, 0);
+    }
+
+    const_iterator begin() const noexcept
+    {
+        return const_iterator(m_Leftmost, 0);
+    }
+
+    iterator end() noexcept
+    {
+        return iterator(m_Rightmost, (m_Rightmost ? m_Rightmost->Count : 0));
+    }
+
+    const_iterator end() const noexcept
+    {
+        return const_iterator(m_Rightmost, (m_Rightmost ? m_Rightmost->Count : 0));
+    }
+
+    const_iterator cbegin() const noexcept
+    {
+        return begin();
+    }
+
+    const_iterator cend() const noexcept
+    {
+        return end();
+    }
+
+    reverse_iterator rbegin() noexcept
+    {
+        return reverse_iterator(end());
+    }
+
+    const_reverse_iterator rbegin() const noexcept
+    {
+        return const_reverse_iterator(end());
+    }
+
+    reverse_iterator rend() noexcept
+    {
+        return reverse_iterator(begin());
+    }
+
+    const_reverse_iterator rend() const noexcept
+    {
+        return const_reverse_iterator(begin());
+    }
+
+    const_reverse_iterator crbegin() const noexcept
+    {
+        return rbegin();
+    }
+
+    const_reverse_iterator crend() const noexcept
+    {
+        return rend();
+    }
+
+    _NODISCARD
+    bool empty() const noexcept
+    {
+        return (m_Size == 0);
+    }
+
+    size_type size() const noexcept
+    {
+        return m_Size;
+    }
+
+    size_type max_size() const noexcept
+    {
+        return (static_cast<size_type>(-1) / sizeof(value_type));
+    }
+
+    key_compare key_comp() const
+    {
+        return m_Compare;
+    }
+
+    void clear() noexcept
+    {
+        destroy_subtree(m_Root);
+        m_Root = nullptr;
+        m_Leftmost = nullptr;
+        m_Rightmost = nullptr;
+        m_Size = 0;
+    }
+
+    void swap(btree& Other) noexcept
+    {
+        std::swap(m_Compare, Other.m_Compare);
+        std::swap(m_Root, Other.m_Root);
+        std::swap(m_Leftmost, Other.m_Leftmost);
+        std::swap(m_Rightmost, Other.m_Rightmost);
+        std::swap(m_Size, Other.m_Size);
+    }
+
+    template <typename TKeyArg>
+    iterator find(const TKeyArg& Key)
+    {
+        auto it = lower_bound(Key);
+        return (((it != end()) && !m_Compare(Key, key_of(*it))) ? it : end());
+    }
+
+    template <typename TKeyArg>
+    const_iterator find(const TKeyArg& Key) const
+    {
+        return const_cast<btree*>(this)->find(Key);
+    }
+
+    template <typename TKeyArg>
+    bool contains(const TKeyArg& Key) const
+    {
+        return (find(Key) != end());
+    }
+
+    template <typename TKeyArg>
+    size_type count(const TKeyArg& Key) const
+    {
+        return (contains(Key) ? 1 : 0);
+    }
+
+    //
+    // The first element not less than Key. Equal keys are unique, a match
+    // in an internal node is the answer.
+    //
+    template <typename TKeyArg>
+    iterator lower_bound(const TKeyArg& Key)
+    {
+        auto node = m_Root;
+        iterator result = end();
+        while (node)
+        {
+            auto position = lower_bound_in(node, Key);
+            if (position < node->Count)
+            {
+                result = iterator(node, position);
+                if (!m_Compare(Key, key_of(*node->slot(position))))
+                {
+                    break;
+                }
+            }
+            node = (node->Leaf ? nullptr : child(node, position));
+        }
+        return result;
+    }
+
+    template <typename TKeyArg>
+    const_iterator lower_bound(const TKeyArg& Key) const
+    {
+        return const_cast<btree*>(this)->lower_bound(Key);
+    }
+
+    template <typename TKeyArg>
+    iterator upper_bound(const TKeyArg& Key)
+    {
+        auto it = lower_bound(Key);
+        if ((it != end()) && !m_Compare(Key, key_of(*it)))
+        {
+            ++it;
+        }
+        return it;
+    }
+
+    template <typename TKeyArg>
+    const_iterator upper_bound(const TKeyArg& Key) const
+    {
+        return const_cast<btree*>(this)->upper_bound(Key);
+    }
+
+    template <typename TKeyArg>
+    std::pair<iterator, iterator> equal_range(const TKeyArg& Key)
+    {
+        auto it = lower_bound(Key);
+        if ((it == end()) || m_Compare(Key, key_of(*it)))
+        {
+            return { it, it };
+        }
+        auto next = it;
+        return { it, ++next };
+    }
+
+    template <typename TKeyArg>
+    std::pair<const_iterator, const_iterator> equal_range(const TKeyArg& Key) const
+    {
+        auto range = const_cast<btree*>(this)->equal_range(Key);
+        return { range.first, range.second };
+    }
+
+    //
+    // Constructs the element from Args if Key isn't found. Key must be the
+    // key of the element Args construct.
+    //
+    template <typename... TArgs>
+    std::pair<iterator, bool> emplace_unique_key(const key_type& Key, TArgs&&... Args)
+    {
+        if (!m_Root)
+        {
+            m_Root = new_node<leaf_node, leaf_allocator>(true);
+            m_Leftmost = m_Root;
+            m_Rightmost = m_Root;
+        }
+
+        auto node = m_Root;
+        size_t position;
+        for (;;)
+        {
+            position = lower_bound_in(node, Key);
+            if ((position < node->Count) && !m_Compare(Key, key_of(*node->slot(position))))
+            {
+                return { iterator(node, position), false };
+            }
+            if (node->Leaf)
+            {
+                break;
+            }
+            node = child(node, position);
+        }
+
+        return { insert_in_leaf(node, position, std::forward<TArgs>(Args)...), true };
+    }
+
+    //
+    // Constructs the element before looking its key up, for emplace.
+    //
+    template <typename... TArgs>
+    std::pair<iterator, bool> emplace_unique(TArgs&&... Args)
+    {
+        value_type value(std::forward<TArgs>(Args)...);
+        return emplace_unique_key(key_of(value), std::move(value));
+    }
+
+    iterator erase(const_iterator Where)
+    {
+        NT_ASSERT(Where != end());
+
+        auto next = Where;
+        ++next;
+        if (next == end())
+        {
+            erase_at(Where.m_Node, Where.m_Position);
+            return end();
+        }
+
+        //
+        // Erasing may move the next element to another node.
+        //
+        key_type nextKey(key_of(*next));
+        erase_at(Where.m_Node, Where.m_Position);
+        return lower_bound(nextKey);
+    }
+
+    iterator erase(const_iterator First, const_iterator Last)
+    {
+        if ((First == begin()) && (Last == end()))
+        {
+            clear();
+            return end();
+        }
+
+        auto count = std::distance(First, Last);
+        auto it = iterator(First.m_Node, First.m_Position);
+        for (; count > 0; count--)
+        {
+            it = erase(it);
+        }
+        return it;
+    }
+
+    template <typename TKeyArg>
+    size_type erase_key(const TKeyArg& Key)
+    {
+        auto it = find(Key);
+        if (it == end())
+        {
+            return 0;
+        }
+        erase_at(it.m_Node, it.m_Position);
+        return 1;
+    }
+
+    //
+    // The height of the tree and the number of nodes, for tests and
+    // diagnostics.
+    //
+    size_type height() const noexcept
+    {
+        size_type levels = 0;
+        for (auto node = m_Root; node; node = (node->Leaf ? nullptr : child(node, 0)))
+        {
+            levels++;
+        }
+        return levels;
+    }
+
+    size_type node_count() const noexcept
+    {
+        return count_subtree(m_Root);
+    }
+
+private:
+
+    static const key_type& key_of(const value_type& Value) noexcept
+    {
+        return TKeyOfValue::get(Value);
+    }
+
+    static leaf_node* child(leaf_node* Node, size_t Index) noexcept
+    {
+        NT_ASSERT(!Node->Leaf);
+        return static_cast<internal_node*>(Node)->Children[Index];
+    }
+
+    static void set_child(leaf_node* Node, size_t Index, leaf_node* Child) noexcept
+    {
+        static_cast<internal_node*>(Node)->Children[Index] = Child;
+        Child->Parent = static_cast<internal_node*>(Node);
+        Child->Position = static_cast<uint16_t>(Index);
+    }
+
+    //
+    // Moves the element at Source to the uninitialized Target.
+    //
+    static void transfer(value_type* Target, value_type* Source) noexcept
+    {
+        ::new (static_cast<void*>(Target)) value_type(std::move(*Source));
+        std::destroy_at(Source);
+    }
+
+    //
+    // Halves the range without a branch on the comparison, the compiler
+    // turns the choice into a conditional move. A node fits in a few cache
+    // lines so this costs a few compares and no mispredictions.
+    //
+    template <typename TKeyArg>
+    size_t lower_bound_in(const leaf_node* Node, const TKeyArg& Key) const
+    {
+        size_t count = Node->Count;
+        if (count == 0)
+        {
+            return 0;
+        }
+
+        size_t first = 0;
+        while (count > 1)
+        {
+            auto half = (count / 2);
+            first = (m_Compare(key_of(*Node->slot(first + half - 1)), Key) ? (first + half) : first);
+            count -= half;
+        }
+        return (first + (m_Compare(key_of(*Node->slot(first)), Key) ? 1 : 0));
+    }
+
+    template <typename TNode, typename TAllocator>
+    static leaf_node* new_node(bool Leaf) noexcept(false)
+    {
+        TAllocator allocator;
+        auto node = ::new (static_cast<void*>(std::allocator_traits<TAllocator>::allocate(allocator, 1))) TNode;
+        node->Parent = nullptr;
+        node->Position = 0;
+        node->Count = 0;
+        node->Leaf = Leaf;
+        return node;
+    }
+
+    static leaf_node* new_like(const leaf_node* Node) noexcept(false)
+    {
+        return (Node->Leaf ?
+                new_node<leaf_node, leaf_allocator>(true) :
+                new_node<internal_node, internal_allocator>(false));
+    }
+
+    static void free_node(leaf_node* Node) noexcept
+    {
+        if (Node->Leaf)
+        {
+            leaf_allocator allocator;
+            std::allocator_traits<leaf_allocator>::deallocate(allocator, Node, 1);
+        }
+        else
+        {
+            internal_allocator allocator;
+            std::allocator_traits<internal_allocator>::deallocate(allocator, static_cast<internal_node*>(Node), 1);
+        }
+    }
+
+    static void destroy_subtree(leaf_node* Node) noexcept
+    {
+        if (!Node)
+        {
+            return;
+        }
+
+        if (!Node->Leaf)
+        {
+            for (size_t i = 0; i <= Node->Count; i++)
+            {
+                destroy_subtree(child(Node, i));
+            }
+        }
+
+        for (size_t i = 0; i < Node->Count; i++)
+        {
+            std::destroy_at(Node->slot(i));
+        }
+        free_node(Node);
+    }
+
+    static size_type count_subtree(leaf_node* Node) noexcept
+    {
+        if (!Node)
+        {
+            return 0;
+        }
+
+        size_type count = 1;
+        if (!Node->Leaf)
+        {
+            for (size_t i = 0; i <= Node->Count; i++)
+            {
+                count += count_subtree(child(Node, i));
+            }
+        }
+        return count;
+    }
+
+    //
+    // Inserts at Position of a leaf, splitting it first if it's full.
+    //
+    template <typename... TArgs>
+    iterator insert_in_leaf(leaf_node* Node, size_t Position, TArgs&&... Args)
+    {
+        if (Node->Count == node_slots)
+        {
+            split(Node, Position);
+        }
+
+        for (auto i = Node->Count; i > Position; i--)
+        {
+            transfer(Node->slot(i), Node->slot(i - 1));
+        }
+
+        try
+        {
+            ::new (static_cast<void*>(Node->slot(Position))) value_type(std::forward<TArgs>(Args)...);
+        }
+        catch (...)
+        {
+            //
+            // The split, if any, leaves a valid tree.
+            //
+            for (size_t i = Position; i < Node->Count; i++)
+            {
+                transfer(Node->slot(i), Node->slot(i + 1));
+            }
+            throw;
+        }
+
+        Node->Count++;
+        m_Size++;
+        return iterator(Node, Position);
+    }
+
+    //
+    // Splits the full Node in two under its parent, splitting the parent
+    // first if it's full too. Position is where an element is about to be
+    // inserted, Node and Position are updated to the side it goes to. An
+    // insert past the last element of the tree leaves the left node full,
+    // so ascending inserts (IDs are handed out mostly ascending) fill the
+    // nodes rather than leave them half empty.
+    //
+    void split(leaf_node*& Node, size_t& Position) noexcept(false)
+    {
+        NT_ASSERT(Node->Count == node_slots);
+
+        //
+        // Allocate first, so a failure leaves the tree unchanged.
+        //
+        auto sibling = new_like(Node);
+
+        leaf_node* parent = Node->Parent;
+        if (!parent)
+        {
+            try
+            {
+                parent = new_node<internal_node, internal_allocator>(false);
+            }
+            catch (...)
+            {
+                free_node(sibling);
+                throw;
+            }
+            set_child(parent, 0, Node);
+            m_Root = parent;
+        }
+        else if (parent->Count == node_slots)
+        {
+            try
+            {
+                size_t parentPosition = Node->Position;
+                split(parent, parentPosition);
+            }
+            catch (...)
+            {
+                free_node(sibling);
+                throw;
+            }
+            parent = Node->Parent;
+        }
+
+        size_t count = Node->Count;
+        size_t median = (((Position == count) && is_right_edge(Node)) ? (count - 1) : (count / 2));
+
+        for (size_t i = (median + 1); i < count; i++)
+        {
+            transfer(sibling->slot(i - median - 1), Node->slot(i));
+        }
+        sibling->Count = static_cast<uint16_t>(count - median - 1);
+
+        if (!Node->Leaf)
+        {
+            for (size_t i = (median + 1); i <= count; i++)
+            {
+                set_child(sibling, (i - median - 1), child(Node, i));
+            }
+        }
+
+        Node->Count = static_cast<uint16_t>(median);
+        insert_separator(parent, Node->Position, Node->slot(median), sibling);
+
+        if (Node == m_Rightmost)
+        {
+            m_Rightmost = sibling;
+        }
+
+        if (Position > median)
+        {
+            Node = sibling;
+            Position -= (median + 1);
+        }
+    }
+
+    static bool is_right_edge(const leaf_node* Node) noexcept
+    {
+        for (; Node->Parent; Node = Node->Parent)
+        {
+            if (Node->Position != Node->Parent->Count)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //
+    // Moves Separator to Position of the internal node Node, which has
+    // room, with Child to its right.
+    //
+    static void insert_separator(leaf_node* Node, size_t Position, value_type* Separator, leaf_node* Child) noexcept
+    {
+        NT_ASSERT(Node->Count < node_slots);
+
+        for (size_t i = Node->Count; i > Position; i--)
+        {
+            transfer(Node->slot(i), Node->slot(i - 1));
+            set_child(Node, (i + 1), child(Node, i));
+        }
+
+        transfer(Node->slot(Position), Separator);
+        set_child(Node, (Position + 1), Child);
+        Node->Count++;
+    }
+
+    //
+    // Erases the element at Position of Node. An element of an internal
+    // node is replaced by its predecessor, which is last in a leaf.
+    //
+    void erase_at(leaf_node* Node, size_t Position) noexcept
+    {
+        std::destroy_at(Node->slot(Position));
+
+        if (!Node->Leaf)
+        {
+            auto leaf = child(Node, Position);
+            while (!leaf->Leaf)
+            {
+                leaf = child(leaf, leaf->Count);
+            }
+            transfer(Node->slot(Position), leaf->slot(leaf->Count - 1));
+            leaf->Count--;
+            Node = leaf;
+        }
+        else
+        {
+            for (size_t i = (Position + 1); i < Node->Count; i++)
+            {
+                transfer(Node->slot(i - 1), Node->slot(i));
+            }
+            Node->Count--;
+        }
+
+        m_Size--;
+        rebalance(Node);
+    }
+
+    //
+    // Refills Node after an erase, merging it with a sibling if they fit in
+    // one node and otherwise moving elements over from a sibling. A merge
+    // takes a separator from the parent, which may then need refilling.
+    //
+    void rebalance(leaf_node* Node) noexcept
+    {
+        for (;;)
+        {
+            if (Node == m_Root)
+            {
+                if (Node->Count == 0)
+                {
+                    if (Node->Leaf)
+                    {
+                        m_Root = nullptr;
+                        m_Leftmost = nullptr;
+                        m_Rightmost = nullptr;
+                    }
+                    else
+                    {
+                        m_Root = child(Node, 0);
+                        m_Root->Parent = nullptr;
+                        m_Root->Position = 0;
+                    }
+                    free_node(Node);
+                }
+                return;
+            }
+
+            if (Node->Count >= min_slots)
+            {
+                return;
+            }
+
+            leaf_node* parent = Node->Parent;
+            size_t position = Node->Position;
+            auto left = ((position > 0) ? child(parent, (position - 1)) : nullptr);
+            auto right = ((position < parent->Count) ? child(parent, (position + 1)) : nullptr);
+
+            if (left && ((static_cast<size_t>(left->Count) + 1 + Node->Count) <= node_slots))
+            {
+                merge(left, Node);
+                Node = parent;
+                continue;
+            }
+
+            if (right && ((static_cast<size_t>(Node->Count) + 1 + right->Count) <= node_slots))
+            {
+                merge(Node, right);
+                Node = parent;
+                continue;
+            }
+
+            //
+            // Any sibling which couldn't be merged has more than enough,
+            // even the two out.
+            //
+            if (left)
+            {
+                move_to_right(left, Node, ((left->Count - Node->Count) / 2));
+            }
+            else
+            {
+                move_to_left(Node, right, ((right->Count - Node->Count) / 2));
+            }
+            return;
+        }
+    }
+
+    //
+    // Appends the separator between Left and Right and the elements of Right
+    // to Left, then frees Right.
+    //
+    void merge(leaf_node* Left, leaf_node* Right) noexcept
+    {
+        leaf_node* parent = Left->Parent;
+        size_t separator = Left->Position;
+        size_t count = Left->Count;
+
+        transfer(Left->slot(count), parent->slot(separator));
+        for (size_t i = 0; i < Right->Count; i++)
+        {
+            transfer(Left->slot(count + 1 + i), Right->slot(i));
+        }
+
+        if (!Left->Leaf)
+        {
+            for (size_t i = 0; i <= Right->Count; i++)
+            {
+                set_child(Left, (count + 1 + i), child(Right, i));
+            }
+        }
+
+        Left->Count = static_cast<uint16_t>(count + 1 + Right->Count);
+
+        for (size_t i = (separator + 1); i < parent->Count; i++)
+        {
+            transfer(parent->slot(i - 1), parent->slot(i));
+            set_child(parent, i, child(parent, (i + 1)));
+        }
+        parent->Count--;
+
+        if (Right == m_Rightmost)
+        {
+            m_Rightmost = Left;
+        }
+
+        Right->Count = 0;
+        free_node(Right);
+    }
+
+    //
+    // Moves Count elements from the front of Right through the separator to
+    // the back of Left.
+    //
+    static void move_to_left(leaf_node* Left, leaf_node* Right, size_t Count) noexcept
+    {
+        Count = ((Count == 0) ? 1 : Count);
+        leaf_node* parent = Left->Parent;
+        size_t separator = Left->Position;
+        size_t leftCount = Left->Count;
+
+        transfer(Left->slot(leftCount), parent->slot(separator));
+        for (size_t i = 0; i < (Count - 1); i++)
+        {
+            transfer(Left->slot(leftCount + 1 + i), Right->slot(i));
+        }
+        transfer(parent->slot(separator), Right->slot(Count - 1));
+        for (size_t i = Count; i < Right->Count; i++)
+        {
+            transfer(Right->slot(i - Count), Right->slot(i));
+        }
+
+        if (!Left->Leaf)
+        {
+            for (size_t i = 0; i < Count; i++)
+            {
+                set_child(Left, (leftCount + 1 + i), child(Right, i));
+            }
+            for (size_t i = Count; i <= Right->Count; i++)
+            {
+                set_child(Right, (i - Count), child(Right, i));
+            }
+        }
+
+        Left->Count = static_cast<uint16_t>(leftCount + Count);
+        Right->Count = static_cast<uint16_t>(Right->Count - Count);
+    }
+
+    //
+    // Moves Count elements from the back of Left through the separator to
+    // the front of Right.
+    //
+    static void move_to_right(leaf_node* Left, leaf_node* Right, size_t Count) noexcept
+    {
+        Count = ((Count == 0) ? 1 : Count);
+        leaf_node* parent = Left->Parent;
+        size_t separator = Left->Position;
+        size_t leftCount = Left->Count;
+        size_t rightCount = Right->Count;
+
+        for (size_t i = rightCount; i > 0; i--)
+        {
+            transfer(Right->slot(i - 1 + Count), Right->slot(i - 1));
+        }
+        transfer(Right->slot(Count - 1), parent->slot(separator));
+        for (size_t i = 0; i < (Count - 1); i++)
+        {
+            transfer(Right->slot(i), Left->slot(leftCount - Count + 1 + i));
+        }
+        transfer(parent->slot(separator), Left->slot(leftCount - Count));
+
+        if (!Left->Leaf)
+        {
+            for (size_t i = (rightCount + 1); i > 0; i--)
+            {
+                set_child(Right, (i - 1 + Count), child(Right, (i - 1)));
+            }
+            for (size_t i = 0; i < Count; i++)
+            {
+                set_child(Right, i, child(Left, (leftCount - Count + 1 + i)));
+            }
+        }
+
+        Left->Count = static_cast<uint16_t>(leftCount - Count);
+        Right->Count = static_cast<uint16_t>(rightCount + Count);
+    }
+
+    void take(btree& Other) noexcept
+    {
+        m_Root = Other.m_Root;
+        m_Leftmost = Other.m_Leftmost;
+        m_Rightmost = Other.m_Rightmost;
+        m_Size = Other.m_Size;
+        Other.m_Root = nullptr;
+        Other.m_Leftmost = nullptr;
+        Other.m_Rightmost = nullptr;
+        Other.m_Size = 0;
+    }
+
+    //
+    // Copies the shape of Other node for node. Each node is linked in
+    // before it's filled, so clear can free a partial copy.
+    //
+    void copy_from(const btree& Other) noexcept(false)
+    {
+        if (!Other.m_Root)
+        {
+            return;
+        }
+
+        try
+        {
+            m_Root = new_like(Other.m_Root);
+            copy_subtree(m_Root, Other.m_Root);
+        }
+        catch (...)
+        {
+            clear();
+            throw;
+        }
+
+        m_Leftmost = m_Root;
+        while (!m_Leftmost->Leaf)
+        {
+            m_Leftmost = child(m_Leftmost, 0);
+        }
+        m_Rightmost = m_Root;
+        while (!m_Rightmost->Leaf)
+        {
+            m_Rightmost = child(m_Rightmost, m_Rightmost->Count);
+        }
+        m_Size = Other.m_Size;
+    }
+
+    static void copy_subtree(leaf_node* Node, leaf_node* Source) noexcept(false)
+    {
+        for (size_t i = 0; i <= Source->Count; i++)
+        {
+            if (!Source->Leaf)
+            {
+                static_cast<internal_node*>(Node)->Children[i] = nullptr;
+                auto copy = new_like(child(Source, i));
+                set_child(Node, i, copy);
+                copy_subtree(copy, child(Source, i));
+            }
+
+            if (i < Source->Count)
+            {
+                ::new (static_cast<void*>(Node->slot(i))) value_type(*Source->slot(i));
+                Node->Count++;
+            }
+        }
+    }
+
+    key_compare m_Compare{};
+    leaf_node* m_Root = nullptr;
+    leaf_node* m_Leftmost = nullptr;
+    leaf_node* m_Rightmost = nullptr;
+    size_type m_Size = 0;
+
+};
+
+}
@@ -0,0 +1,420 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/btree_map.hpp
+// Author:   Johnny Shaw
+// Abstract: B-tree backed ordered map
+//
+// An ordered map with the interface of std::map, see jxy/btree.hpp. Each
+// node holds as many elements as fit in t_NodeBytes, a lookup touches a node
+// per level and there is one pool allocation per node. Inserting or erasing
+// invalidates iterators, pointers, and references to the elements.
+//
+// jxylib                   STL equivalent
+// ---------------------------------------------------------------------------
+// jxy::btree_map           std::map
+//
+#pragma once
+#include <jxy/memory.hpp>
+#include <jxy/btree.hpp>
+#include <stdexcept>
+#include <algorithm>
+#include <tuple>
+
+namespace jxy
+{
+
+template <typename TKey,
+          typename T,
+          POOL_TYPE t_PoolType,
+          ULONG t_PoolTag,
+          typename TCompare = std::less<TKey>,
+          size_t t_NodeBytes = (4 * SYSTEM_CACHE_ALIGNMENT_SIZE)>
+class btree_map
+{
+    using tree_type = details::btree<TKey,
+                                     std::pair<const TKey, T>,
+                                     details::btree_pair_key,
+                                     TCompare,
+                                     t_PoolType,
+                                     t_PoolTag,
+                                     t_NodeBytes>;
+
+public:
+
+    using key_type = TKey;
+    using mapped_type = T;
+    using value_type = std::pair<const TKey, T>;
+    using key_compare = TCompare;
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using pointer = value_type*;
+    using const_pointer = const value_type*;
+    using iterator = typename tree_type::iterator;
+    using const_iterator = typename tree_type::const_iterator;
+    using reverse_iterator = typename tree_type::reverse_iterator;
+    using const_reverse_iterator = typename tree_type::const_reverse_iterator;
+
+    static constexpr size_t node_capacity = tree_type::node_capacity;
+
+    ~btree_map() noexcept = default;
+
+    btree_map() = default;
+
+    explicit btree_map(const key_compare& Compare) : m_Tree(Compare)
+    {
+    }
+
+    template <typename TIter>
+    btree_map(TIter First, TIter Last, const key_compare& Compare = key_compare()) noexcept(false)
+        : m_Tree(Compare)
+    {
+        insert(First, Last);
+    }
+
+    btree_map(std::initializer_list<value_type> Init, const key_compare& Compare = key_compare()) noexcept(false)
+        : m_Tree(Compare)
+    {
+        insert(Init);
+    }
+
+    btree_map(const btree_map&) = default;
+    btree_map(btree_map&&) noexcept = default;
+    btree_map& operator=(const btree_map&) = default;
+    btree_map& operator=(btree_map&&) noexcept = default;
+
+    btree_map& operator=(std::initializer_list<value_type> Init) noexcept(false)
+    {
+        btree_map copy(Init, key_comp());
+        swap(copy);
+        return *this;
+    }
+
+    iterator begin() noexcept
+    {
+        return m_Tree.begin();
+    }
+
+    const_iterator begin() const noexcept
+    {
+        return m_Tree.begin();
+    }
+
+    iterator end() noexcept
+    {
+        return m_Tree.end();
+    }
+
+    const_iterator end() const noexcept
+    {
+        return m_Tree.end();
+    }
+
+    const_iterator cbegin() const noexcept
+    {
+        return m_Tree.cbegin();
+    }
+
+    const_iterator cend() const noexcept
+    {
+        return m_Tree.cend();
+    }
+
+    reverse_iterator rbegin() noexcept
+    {
+        return m_Tree.rbegin();
+    }
+
+    const_reverse_iterator rbegin() const noexcept
+    {
+        return m_Tree.rbegin();
+    }
+
+    reverse_iterator rend() noexcept
+    {
+        return m_Tree.rend();
+    }
+
+    const_reverse_iterator rend() const noexcept
+    {
+        return m_Tree.rend();
+    }
+
+    const_reverse_iterator crbegin() const noexcept
+    {
+        return m_Tree.crbegin();
+    }
+
+    const_reverse_iterator crend() const noexcept
+    {
+        return m_Tree.crend();
+    }
+
+    _NODISCARD
+    bool empty() const noexcept
+    {
+        return m_Tree.empty();
+    }
+
+    size_type size() const noexcept
+    {
+        return m_Tree.size();
+    }
+
+    size_type max_size() const noexcept
+    {
+        return m_Tree.max_size();
+    }
+
+    key_compare key_comp() const
+    {
+        return m_Tree.key_comp();
+    }
+
+    //
+    // The height of the tree and the number of nodes allocated.
+    //
+    size_type height() const noexcept
+    {
+        return m_Tree.height();
+    }
+
+    size_type node_count() const noexcept
+    {
+        return m_Tree.node_count();
+    }
+
+    mapped_type& operator[](const key_type& Key) noexcept(false)
+    {
+        return try_emplace(Key).first->second;
+    }
+
+    mapped_type& operator[](key_type&& Key) noexcept(false)
+    {
+        return try_emplace(std::move(Key)).first->second;
+    }
+
+    mapped_type& at(const key_type& Key)
+    {
+        auto it = find(Key);
+        if (it == end())
+        {
+            throw std::out_of_range("invalid btree_map key");
+        }
+        return it->second;
+    }
+
+    const mapped_type& at(const key_type& Key) const
+    {
+        auto it = find(Key);
+        if (it == end())
+        {
+            throw std::out_of_range("invalid btree_map key");
+        }
+        return it->second;
+    }
+
+    std::pair<iterator, bool> insert(const value_type& Value) noexcept(false)
+    {
+        return m_Tree.emplace_unique_key(Value.first, Value);
+    }
+
+    std::pair<iterator, bool> insert(value_type&& Value) noexcept(false)
+    {
+        return m_Tree.emplace_unique_key(Value.first, std::move(Value));
+    }
+
+    template <typename TPair,
+              typename = std::enable_if_t<std::is_constructible_v<value_type, TPair&&>>>
+    std::pair<iterator, bool> insert(TPair&& Value) noexcept(false)
+    {
+        return m_Tree.emplace_unique(std::forward<TPair>(Value));
+    }
+
+    iterator insert(const_iterator, const value_type& Value) noexcept(false)
+    {
+        return insert(Value).first;
+    }
+
+    iterator insert(const_iterator, value_type&& Value) noexcept(false)
+    {
+        return insert(std::move(Value)).first;
+    }
+
+    template <typename TIter>
+    void insert(TIter First, TIter Last) noexcept(false)
+    {
+        for (; First != Last; ++First)
+        {
+            m_Tree.emplace_unique(*First);
+        }
+    }
+
+    void insert(std::initializer_list<value_type> Init) noexcept(false)
+    {
+        insert(Init.begin(), Init.end());
+    }
+
+    template <typename... TArgs>
+    std::pair<iterator, bool> emplace(TArgs&&... Args) noexcept(false)
+    {
+        return m_Tree.emplace_unique(std::forward<TArgs>(Args)...);
+    }
+
+    template <typename... TArgs>
+    iterator emplace_hint(const_iterator, TArgs&&... Args) noexcept(false)
+    {
+        return emplace(std::forward<TArgs>(Args)...).first;
+    }
+
+    template <typename... TArgs>
+    std::pair<iterator, bool> try_emplace(const key_type& Key, TArgs&&... Args) noexcept(false)
+    {
+        return m_Tree.emplace_unique_key(Key,
+                                         std::piecewise_construct,
+                                         std::forward_as_tuple(Key),
+                                         std::forward_as_tuple(std::forward<TArgs>(Args)...));
+    }
+
+    template <typename... TArgs>
+    std::pair<iterator, bool> try_emplace(key_type&& Key, TArgs&&... Args) noexcept(false)
+    {
+        return m_Tree.emplace_unique_key(Key,
+                                         std::piecewise_construct,
+                                         std::forward_as_tuple(std::move(Key)),
+                                         std::forward_as_tuple(std::forward<TArgs>(Args)...));
+    }
+
+    template <typename TMapped>
+    std::pair<iterator, bool> insert_or_assign(const key_type& Key, TMapped&& Mapped) noexcept(false)
+    {
+        auto res = try_emplace(Key, std::forward<TMapped>(Mapped));
+        if (!res.second)
+        {
+            res.first->second = std::forward<TMapped>(Mapped);
+        }
+        return res;
+    }
+
+    template <typename TMapped>
+    std::pair<iterator, bool> insert_or_assign(key_type&& Key, TMapped&& Mapped) noexcept(false)
+    {
+        auto res = try_emplace(std::move(Key), std::forward<TMapped>(Mapped));
+        if (!res.second)
+        {
+            res.first->second = std::forward<TMapped>(Mapped);
+        }
+        return res;
+    }
+
+    iterator erase(iterator Where) noexcept(false)
+    {
+        return m_Tree.erase(Where);
+    }
+
+    iterator erase(const_iterator Where) noexcept(false)
+    {
+        return m_Tree.erase(Where);
+    }
+
+    iterator erase(const_iterator First, const_iterator Last) noexcept(false)
+    {
+        return m_Tree.erase(First, Last);
+    }
+
+    size_type erase(const key_type& Key) noexcept(false)
+    {
+        return m_Tree.erase_key(Key);
+    }
+
+    void clear() noexcept
+    {
+        m_Tree.clear();
+    }
+
+    void swap(btree_map& Other) noexcept
+    {
+        m_Tree.swap(Other.m_Tree);
+    }
+
+    iterator find(const key_type& Key)
+    {
+        return m_Tree.find(Key);
+    }
+
+    const_iterator find(const key_type& Key) const
+    {
+        return m_Tree.find(Key);
+    }
+
+    size_type count(const key_type& Key) const
+    {
+        return m_Tree.count(Key);
+    }
+
+    bool contains(const key_type& Key) const
+    {
+        return m_Tree.contains(Key);
+    }
+
+    iterator lower_bound(const key_type& Key)
+    {
+        return m_Tree.lower_bound(Key);
+    }
+
+    const_iterator lower_bound(const key_type& Key) const
+    {
+        return m_Tree.lower_bound(Key);
+    }
+
+    iterator upper_bound(const key_type& Key)
+    {
+        return m_Tree.upper_bound(Key);
+    }
+
+    const_iterator upper_bound(const key_type& Key) const
+    {
+        return m_Tree.upper_bound(Key);
+    }
+
+    std::pair<iterator, iterator> equal_range(const key_type& Key)
+    {
+        return m_Tree.equal_range(Key);
+    }
+
+    std::pair<const_iterator, const_iterator> equal_range(const key_type& Key) const
+    {
+        return m_Tree.equal_range(Key);
+    }
+
+    friend bool operator==(const btree_map& Left, const btree_map& Right)
+    {
+        return std::equal(Left.begin(), Left.end(), Right.begin(), Right.end());
+    }
+
+    friend bool operator!=(const btree_map& Left, const btree_map& Right)
+    {
+        return !(Left == Right);
+    }
+
+private:
+
+    tree_type m_Tree;
+
+};
+
+template <typename TKey,
+          typename T,
+          POOL_TYPE t_PoolType,
+          ULONG t_PoolTag,
+          typename TCompare,
+          size_t t_NodeBytes>
+void swap(btree_map<TKey, T, t_PoolType, t_PoolTag, TCompare, t_NodeBytes>& Left,
+          btree_map<TKey, T, t_PoolType, t_PoolTag, TCompare, t_NodeBytes>& Right) noexcept
+{
+    Left.swap(Right);
+}
+
+}
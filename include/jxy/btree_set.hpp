@@ -0,0 +1,302 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/btree_set.hpp
+// Author:   Johnny Shaw
+// Abstract: B-tree backed ordered set
+//
+// An ordered set with the interface of std::set, see jxy/btree.hpp.
+// Inserting or erasing invalidates iterators, pointers, and references to
+// the elements.
+//
+// jxylib                   STL equivalent
+// ---------------------------------------------------------------------------
+// jxy::btree_set           std::set
+//
+#pragma once
+#include <jxy/memory.hpp>
+#include <jxy/btree.hpp>
+#include <algorithm>
+
+namespace jxy
+{
+
+template <typename TKey,
+          POOL_TYPE t_PoolType,
+          ULONG t_PoolTag,
+          typename TCompare = std::less<TKey>,
+          size_t t_NodeBytes = (4 * SYSTEM_CACHE_ALIGNMENT_SIZE)>
+class btree_set
+{
+    using tree_type = details::btree<TKey,
+                                     TKey,
+                                     details::btree_identity_key,
+                                     TCompare,
+                                     t_PoolType,
+                                     t_PoolTag,
+                                     t_NodeBytes>;
+
+public:
+
+    using key_type = TKey;
+    using value_type = TKey;
+    using key_compare = TCompare;
+    using value_compare = TCompare;
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using pointer = value_type*;
+    using const_pointer = const value_type*;
+
+    //
+    // Elements are keys, they may only be read through an iterator.
+    //
+    using iterator = typename tree_type::const_iterator;
+    using const_iterator = typename tree_type::const_iterator;
+    using reverse_iterator = typename tree_type::const_reverse_iterator;
+    using const_reverse_iterator = typename tree_type::const_reverse_iterator;
+
+    static constexpr size_t node_capacity = tree_type::node_capacity;
+
+    ~btree_set() noexcept = default;
+
+    btree_set() = default;
+
+    explicit btree_set(const key_compare& Compare) : m_Tree(Compare)
+    {
+    }
+
+    template <typename TIter>
+    btree_set(TIter First, TIter Last, const key_compare& Compare = key_compare()) noexcept(false)
+        : m_Tree(Compare)
+    {
+        insert(First, Last);
+    }
+
+    btree_set(std::initializer_list<value_type> Init, const key_compare& Compare = key_compare()) noexcept(false)
+        : m_Tree(Compare)
+    {
+        insert(Init);
+    }
+
+    btree_set(const btree_set&) = default;
+    btree_set(btree_set&&) noexcept = default;
+    btree_set& operator=(const btree_set&) = default;
+    btree_set& operator=(btree_set&&) noexcept = default;
+
+    btree_set& operator=(std::initializer_list<value_type> Init) noexcept(false)
+    {
+        btree_set copy(Init, key_comp());
+        swap(copy);
+        return *this;
+    }
+
+    const_iterator begin() const noexcept
+    {
+        return m_Tree.begin();
+    }
+
+    const_iterator end() const noexcept
+    {
+        return m_Tree.end();
+    }
+
+    const_iterator cbegin() const noexcept
+    {
+        return m_Tree.cbegin();
+    }
+
+    const_iterator cend() const noexcept
+    {
+        return m_Tree.cend();
+    }
+
+    const_reverse_iterator rbegin() const noexcept
+    {
+        return m_Tree.rbegin();
+    }
+
+    const_reverse_iterator rend() const noexcept
+    {
+        return m_Tree.rend();
+    }
+
+    const_reverse_iterator crbegin() const noexcept
+    {
+        return m_Tree.crbegin();
+    }
+
+    const_reverse_iterator crend() const noexcept
+    {
+        return m_Tree.crend();
+    }
+
+    _NODISCARD
+    bool empty() const noexcept
+    {
+        return m_Tree.empty();
+    }
+
+    size_type size() const noexcept
+    {
+        return m_Tree.size();
+    }
+
+    size_type max_size() const noexcept
+    {
+        return m_Tree.max_size();
+    }
+
+    key_compare key_comp() const
+    {
+        return m_Tree.key_comp();
+    }
+
+    value_compare value_comp() const
+    {
+        return m_Tree.key_comp();
+    }
+
+    //
+    // The height of the tree and the number of nodes allocated.
+    //
+    size_type height() const noexcept
+    {
+        return m_Tree.height();
+    }
+
+    size_type node_count() const noexcept
+    {
+        return m_Tree.node_count();
+    }
+
+    std::pair<iterator, bool> insert(const value_type& Value) noexcept(false)
+    {
+        return m_Tree.emplace_unique_key(Value, Value);
+    }
+
+    std::pair<iterator, bool> insert(value_type&& Value) noexcept(false)
+    {
+        return m_Tree.emplace_unique_key(Value, std::move(Value));
+    }
+
+    iterator insert(const_iterator, const value_type& Value) noexcept(false)
+    {
+        return insert(Value).first;
+    }
+
+    iterator insert(const_iterator, value_type&& Value) noexcept(false)
+    {
+        return insert(std::move(Value)).first;
+    }
+
+    template <typename TIter>
+    void insert(TIter First, TIter Last) noexcept(false)
+    {
+        for (; First != Last; ++First)
+        {
+            m_Tree.emplace_unique(*First);
+        }
+    }
+
+    void insert(std::initializer_list<value_type> Init) noexcept(false)
+    {
+        insert(Init.begin(), Init.end());
+    }
+
+    template <typename... TArgs>
+    std::pair<iterator, bool> emplace(TArgs&&... Args) noexcept(false)
+    {
+        return m_Tree.emplace_unique(std::forward<TArgs>(Args)...);
+    }
+
+    template <typename... TArgs>
+    iterator emplace_hint(const_iterator, TArgs&&... Args) noexcept(false)
+    {
+        return emplace(std::forward<TArgs>(Args)...).first;
+    }
+
+    iterator erase(const_iterator Where) noexcept(false)
+    {
+        return m_Tree.erase(Where);
+    }
+
+    iterator erase(const_iterator First, const_iterator Last) noexcept(false)
+    {
+        return m_Tree.erase(First, Last);
+    }
+
+    size_type erase(const key_type& Key) noexcept(false)
+    {
+        return m_Tree.erase_key(Key);
+    }
+
+    void clear() noexcept
+    {
+        m_Tree.clear();
+    }
+
+    void swap(btree_set& Other) noexcept
+    {
+        m_Tree.swap(Other.m_Tree);
+    }
+
+    const_iterator find(const key_type& Key) const
+    {
+        return m_Tree.find(Key);
+    }
+
+    size_type count(const key_type& Key) const
+    {
+        return m_Tree.count(Key);
+    }
+
+    bool contains(const key_type& Key) const
+    {
+        return m_Tree.contains(Key);
+    }
+
+    const_iterator lower_bound(const key_type& Key) const
+    {
+        return m_Tree.lower_bound(Key);
+    }
+
+    const_iterator upper_bound(const key_type& Key) const
+    {
+        return m_Tree.upper_bound(Key);
+    }
+
+    std::pair<const_iterator, const_iterator> equal_range(const key_type& Key) const
+    {
+        return m_Tree.equal_range(Key);
+    }
+
+    friend bool operator==(const btree_set& Left, const btree_set& Right)
+    {
+        return std::equal(Left.begin(), Left.end(), Right.begin(), Right.end());
+    }
+
+    friend bool operator!=(const btree_set& Left, const btree_set& Right)
+    {
+        return !(Left == Right);
+    }
+
+private:
+
+    tree_type m_Tree;
+
+};
+
+template <typename TKey,
+          POOL_TYPE t_PoolType,
+          ULONG t_PoolTag,
+          typename TCompare,
+          size_t t_NodeBytes>
+void swap(btree_set<TKey, t_PoolType, t_PoolTag, TCompare, t_NodeBytes>& Left,
+          btree_set<TKey, t_PoolType, t_PoolTag, TCompare, t_NodeBytes>& Right) noexcept
+{
+    Left.swap(Right);
+}
+
+}
@@ -0,0 +1,245 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/concurrent_hash_map.hpp
+// Author:   Johnny Shaw
+// Abstract: Hash map split into independently locked stripes
+//
+// A map guarded by one jxy::shared_mutex serializes every writer, such as
+// the global thread map written on every thread create and exit on every
+// processor. jxy::concurrent_hash_map splits the keys over t_Stripes
+// jxy::unordered_maps, each with its own lock and on its own cache line.
+// Writers of keys in different stripes don't contend, readers take the
+// stripe lock shared.
+//
+// There are no iterators, an element is only reachable under its stripe
+// lock. find copies the value out, visit and for_each call a function with
+// the lock held. Don't call back into the map from those functions. size
+// sums the stripes one at a time, with concurrent writers it is a snapshot
+// of no single moment.
+//
+// The stripe locks are push locks, use at or below APC_LEVEL.
+//
+// jxylib                       STL equivalent
+// ---------------------------------------------------------------------------
+// jxy::concurrent_hash_map     None
+//
+#pragma once
+#include <fltKernel.h>
+#include <jxy/memory.hpp>
+#include <jxy/unordered_map.hpp>
+#include <jxy/locks.hpp>
+
+namespace jxy
+{
+
+template <typename TKey,
+          typename T,
+          POOL_TYPE t_PoolType,
+          ULONG t_PoolTag,
+          size_t t_Stripes = 16,
+          typename THash = std::hash<TKey>,
+          typename TKeyEqual = std::equal_to<TKey>>
+class concurrent_hash_map
+{
+    static_assert((t_Stripes > 0) && ((t_Stripes & (t_Stripes - 1)) == 0),
+                  "t_Stripes must be a power of two");
+
+    using map_type = unordered_map<TKey, T, t_PoolType, t_PoolTag, THash, TKeyEqual>;
+
+    struct alignas(SYSTEM_CACHE_ALIGNMENT_SIZE) stripe
+    {
+        mutable shared_mutex Mutex;
+        map_type Map;
+    };
+
+public:
+
+    static constexpr POOL_TYPE pool_type = t_PoolType;
+    static constexpr ULONG pool_tag = t_PoolTag;
+    static constexpr size_t stripe_count = t_Stripes;
+
+    using key_type = TKey;
+    using mapped_type = T;
+    using value_type = std::pair<const TKey, T>;
+    using size_type = size_t;
+    using hasher = THash;
+    using key_equal = TKeyEqual;
+
+    concurrent_hash_map() = default;
+
+    concurrent_hash_map(const concurrent_hash_map&) = delete;
+    concurrent_hash_map& operator=(const concurrent_hash_map&) = delete;
+
+    //
+    // Copies the value of Key to Value. Returns false if Key isn't found.
+    //
+    bool find(const key_type& Key, mapped_type& Value) const
+    {
+        return visit(Key, [&Value](const mapped_type& Found) { Value = Found; });
+    }
+
+    bool contains(const key_type& Key) const
+    {
+        auto& part = stripe_for(Key);
+        shared_lock<shared_mutex> lock(part.Mutex);
+        return (part.Map.find(Key) != part.Map.end());
+    }
+
+    //
+    // Calls Function(const T&) with the value of Key under the shared
+    // stripe lock. Returns false if Key isn't found.
+    //
+    template <typename TFunction>
+    bool visit(const key_type& Key, TFunction&& Function) const
+    {
+        auto& part = stripe_for(Key);
+        shared_lock<shared_mutex> lock(part.Mutex);
+        auto it = part.Map.find(Key);
+        if (it == part.Map.end())
+        {
+            return false;
+        }
+        Function(it->second);
+        return true;
+    }
+
+    //
+    // Inserts the value if Key isn't found. Returns true if it was inserted,
+    // otherwise the map is unchanged.
+    //
+    template <typename... TArgs>
+    bool try_emplace(const key_type& Key, TArgs&&... Args)
+    {
+        auto& part = stripe_for(Key);
+        unique_lock<shared_mutex> lock(part.Mutex);
+        return part.Map.try_emplace(Key, std::forward<TArgs>(Args)...).second;
+    }
+
+    //
+    // Inserts or replaces the value of Key. Returns true if it was inserted.
+    //
+    template <typename TMapped>
+    bool insert_or_assign(const key_type& Key, TMapped&& Value)
+    {
+        auto& part = stripe_for(Key);
+        unique_lock<shared_mutex> lock(part.Mutex);
+        return part.Map.insert_or_assign(Key, std::forward<TMapped>(Value)).second;
+    }
+
+    size_type erase(const key_type& Key)
+    {
+        auto& part = stripe_for(Key);
+        unique_lock<shared_mutex> lock(part.Mutex);
+        return part.Map.erase(Key);
+    }
+
+    //
+    // Erases Key and moves its value to Erased. Returns false if Key isn't
+    // found.
+    //
+    bool erase(const key_type& Key, mapped_type& Erased)
+    {
+        auto& part = stripe_for(Key);
+        unique_lock<shared_mutex> lock(part.Mutex);
+        auto it = part.Map.find(Key);
+        if (it == part.Map.end())
+        {
+            return false;
+        }
+        Erased = std::move(it->second);
+        part.Map.erase(it);
+        return true;
+    }
+
+    //
+    // Calls Function(const TKey&, const T&) for each element, one stripe at
+    // a time under its shared lock.
+    //
+    template <typename TFunction>
+    void for_each(TFunction&& Function) const
+    {
+        for (auto& part : m_Stripes)
+        {
+            shared_lock<shared_mutex> lock(part.Mutex);
+            for (const auto& entry : part.Map)
+            {
+                Function(entry.first, entry.second);
+            }
+        }
+    }
+
+    size_type size() const
+    {
+        size_type count = 0;
+        for (auto& part : m_Stripes)
+        {
+            shared_lock<shared_mutex> lock(part.Mutex);
+            count += part.Map.size();
+        }
+        return count;
+    }
+
+    _NODISCARD
+    bool empty() const
+    {
+        return (size() == 0);
+    }
+
+    void clear()
+    {
+        for (auto& part : m_Stripes)
+        {
+            unique_lock<shared_mutex> lock(part.Mutex);
+            part.Map.clear();
+        }
+    }
+
+    //
+    // Sizes the stripes for Count elements spread evenly.
+    //
+    void reserve(size_type Count)
+    {
+        for (auto& part : m_Stripes)
+        {
+            unique_lock<shared_mutex> lock(part.Mutex);
+            part.Map.reserve((Count + t_Stripes - 1) / t_Stripes);
+        }
+    }
+
+private:
+
+    //
+    // The stripes use a mix of the hash unrelated to the bucket index the
+    // stripe map takes from the top bits of the hash, so the keys of a
+    // stripe still spread over its buckets.
+    //
+    const stripe& stripe_for(const key_type& Key) const
+    {
+        auto mixed = static_cast<size_t>(m_Hash(Key));
+        if constexpr (sizeof(size_t) == 8)
+        {
+            mixed ^= (mixed >> 33);
+            mixed *= 0xff51afd7ed558ccdull;
+            mixed ^= (mixed >> 33);
+        }
+        else
+        {
+            mixed ^= (mixed >> 16);
+            mixed *= 0x85ebca6bul;
+            mixed ^= (mixed >> 13);
+        }
+        return m_Stripes[mixed & (t_Stripes - 1)];
+    }
+
+    stripe& stripe_for(const key_type& Key)
+    {
+        return const_cast<stripe&>(static_cast<const concurrent_hash_map*>(this)->stripe_for(Key));
+    }
+
+    hasher m_Hash{};
+    stripe m_Stripes[t_Stripes];
+
+};
+
+}
@@ -0,0 +1,142 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/flat_hash_map.hpp
+// Author:   Johnny Shaw
+// Abstract: Open addressing hash map
+//
+// jxy::flat_hash_map has the interface of std::unordered_map with the
+// elements stored inline in one allocation (see jxy/flat_hash_table.hpp).
+// Lookups compare 16 control bytes at a time and rarely touch more than one
+// cache line of elements. Unlike std::unordered_map any insert which grows
+// the table moves the elements, don't hold references or pointers to them
+// across an insert. There are no buckets, bucket_count is the number of
+// slots.
+//
+// jxylib                   STL equivalent
+// ---------------------------------------------------------------------------
+// jxy::flat_hash_map       std::unordered_map
+//
+#pragma once
+#include <jxy/memory.hpp>
+#include <jxy/flat_hash_table.hpp>
+#include <stdexcept>
+
+namespace jxy
+{
+
+template <typename TKey,
+          typename T,
+          POOL_TYPE t_PoolType,
+          ULONG t_PoolTag,
+          typename THash = std::hash<TKey>,
+          typename TKeyEqual = std::equal_to<TKey>,
+          typename TAlloc = allocator<std::pair<const TKey, T>, t_PoolType, t_PoolTag>>
+class flat_hash_map : public details::flat_hash_table<TKey,
+                                                      std::pair<const TKey, T>,
+                                                      details::hash_key_first,
+                                                      THash,
+                                                      TKeyEqual,
+                                                      TAlloc>
+{
+    using base = details::flat_hash_table<TKey,
+                                          std::pair<const TKey, T>,
+                                          details::hash_key_first,
+                                          THash,
+                                          TKeyEqual,
+                                          TAlloc>;
+
+public:
+
+    static constexpr POOL_TYPE pool_type = t_PoolType;
+    static constexpr ULONG pool_tag = t_PoolTag;
+
+    using mapped_type = T;
+    using typename base::key_type;
+    using typename base::value_type;
+    using typename base::iterator;
+    using typename base::const_iterator;
+
+    using base::base;
+
+    flat_hash_map() = default;
+
+    flat_hash_map& operator=(std::initializer_list<value_type> Values)
+    {
+        base::operator=(Values);
+        return *this;
+    }
+
+    template <typename... TArgs>
+    std::pair<iterator, bool> try_emplace(const key_type& Key, TArgs&&... Args)
+    {
+        return base::emplace_key(Key,
+                                 std::piecewise_construct,
+                                 std::forward_as_tuple(Key),
+                                 std::forward_as_tuple(std::forward<TArgs>(Args)...));
+    }
+
+    template <typename... TArgs>
+    std::pair<iterator, bool> try_emplace(key_type&& Key, TArgs&&... Args)
+    {
+        return base::emplace_key(Key,
+                                 std::piecewise_construct,
+                                 std::forward_as_tuple(std::move(Key)),
+                                 std::forward_as_tuple(std::forward<TArgs>(Args)...));
+    }
+
+    template <typename TMapped>
+    std::pair<iterator, bool> insert_or_assign(const key_type& Key, TMapped&& Value)
+    {
+        auto result = try_emplace(Key, std::forward<TMapped>(Value));
+        if (!result.second)
+        {
+            result.first->second = std::forward<TMapped>(Value);
+        }
+        return result;
+    }
+
+    template <typename TMapped>
+    std::pair<iterator, bool> insert_or_assign(key_type&& Key, TMapped&& Value)
+    {
+        auto result = try_emplace(std::move(Key), std::forward<TMapped>(Value));
+        if (!result.second)
+        {
+            result.first->second = std::forward<TMapped>(Value);
+        }
+        return result;
+    }
+
+    mapped_type& operator[](const key_type& Key)
+    {
+        return try_emplace(Key).first->second;
+    }
+
+    mapped_type& operator[](key_type&& Key)
+    {
+        return try_emplace(std::move(Key)).first->second;
+    }
+
+    mapped_type& at(const key_type& Key)
+    {
+        auto it = base::find(Key);
+        if (it == base::end())
+        {
+            throw std::out_of_range("invalid flat_hash_map<K, T> key");
+        }
+        return it->second;
+    }
+
+    const mapped_type& at(const key_type& Key) const
+    {
+        auto it = base::find(Key);
+        if (it == base::end())
+        {
+            throw std::out_of_range("invalid flat_hash_map<K, T> key");
+        }
+        return it->second;
+    }
+
+};
+
+}
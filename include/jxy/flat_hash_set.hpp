@@ -0,0 +1,36 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/flat_hash_set.hpp
+// Author:   Johnny Shaw
+// Abstract: Open addressing hash set
+//
+// jxy::flat_hash_set has the interface of std::unordered_set with the
+// elements stored inline in one allocation (see jxy/flat_hash_table.hpp).
+// Any insert which grows the table moves the elements.
+//
+// jxylib                   STL equivalent
+// ---------------------------------------------------------------------------
+// jxy::flat_hash_set       std::unordered_set
+//
+#pragma once
+#include <jxy/memory.hpp>
+#include <jxy/flat_hash_table.hpp>
+
+namespace jxy
+{
+
+template <typename TKey,
+          POOL_TYPE t_PoolType,
+          ULONG t_PoolTag,
+          typename THash = std::hash<TKey>,
+          typename TKeyEqual = std::equal_to<TKey>,
+          typename TAlloc = allocator<TKey, t_PoolType, t_PoolTag>>
+using flat_hash_set = details::flat_hash_table<TKey,
+                                               TKey,
+                                               details::hash_key_identity,
+                                               THash,
+                                               TKeyEqual,
+                                               TAlloc>;
+
+}
@@ -0,0 +1,1148 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/flat_hash_table.hpp
+// Author:   Johnny Shaw
+// Abstract: Open addressing hash table probed a group of slots at a time
+//
+// jxy::details::flat_hash_table is laid out like the "Swiss tables". The
+// elements live inline in one pool allocation, an array of slots followed by
+// one control byte per slot. A control byte is either empty, deleted (a
+// tombstone), or 7 bits of the hash of the element in the slot. A lookup
+// loads 16 control bytes at once, compares all of them to the 7 bits of the
+// hash being looked up, and only compares keys for those which match, the
+// keys of other elements are never touched. A group with an empty byte ends
+// the probe.
+//
+// Groups are compared with SSE2 on x64 (JXY_FLAT_HASH_SSE2), the x64 kernel
+// preserves the XMM state so nothing needs to be saved around the integer
+// SSE2 instructions. Elsewhere a portable loop over the bytes is used, define
+// JXY_FLAT_HASH_SSE2 to 0 to force it. The first 15 control bytes are cloned
+// after the last one so a group may be loaded at any slot.
+//
+// Tables hold up to 7/8 of their capacity, erasing leaves a tombstone unless
+// no probe could have passed the slot. When the growth room is used up by
+// tombstones the table is rebuilt at the same capacity instead of grown.
+//
+// Inserting may move elements, iterators, references, and pointers to
+// elements are invalidated by any insert which rehashes. Erasing never moves
+// elements. A default constructed table does not allocate.
+//
+#pragma once
+#include <fltKernel.h>
+#include <jxy/memory.hpp>
+#include <jxy/hash_table.hpp>
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+#include <intrin.h>
+
+#ifndef JXY_FLAT_HASH_SSE2
+#if defined(_M_X64) || defined(__x86_64__)
+#define JXY_FLAT_HASH_SSE2 1
+#else
+#define JXY_FLAT_HASH_SSE2 0
+#endif
+#endif
+
+#if JXY_FLAT_HASH_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace jxy
+{
+
+namespace details
+{
+
+using flat_hash_ctrl = int8_t;
+
+static constexpr flat_hash_ctrl flat_hash_empty = -128;
+static constexpr flat_hash_ctrl flat_hash_deleted = -2;
+static constexpr size_t flat_hash_group_width = 16;
+static constexpr size_t flat_hash_min_capacity = 16;
+
+inline ULONG flat_hash_lowest_bit(uint32_t Mask) noexcept
+{
+    unsigned long index;
+    _BitScanForward(&index, Mask);
+    return static_cast<ULONG>(index);
+}
+
+//
+// Bit i of a match is set when control byte i of the group matches.
+//
+class flat_hash_group
+{
+public:
+
+    explicit flat_hash_group(const flat_hash_ctrl* Ctrl) noexcept
+    {
+#if JXY_FLAT_HASH_SSE2
+        m_Ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Ctrl));
+#else
+        for (size_t i = 0; i < flat_hash_group_width; i++)
+        {
+            m_Ctrl[i] = Ctrl[i];
+        }
+#endif
+    }
+
+    uint32_t match(flat_hash_ctrl Hash) const noexcept
+    {
+#if JXY_FLAT_HASH_SSE2
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(Hash), m_Ctrl)));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < flat_hash_group_width; i++)
+        {
+            mask |= (static_cast<uint32_t>(m_Ctrl[i] == Hash) << i);
+        }
+        return mask;
+#endif
+    }
+
+    uint32_t match_empty() const noexcept
+    {
+        return match(flat_hash_empty);
+    }
+
+    //
+    // Empty and deleted are the only negative control bytes.
+    //
+    uint32_t match_empty_or_deleted() const noexcept
+    {
+#if JXY_FLAT_HASH_SSE2
+        return static_cast<uint32_t>(_mm_movemask_epi8(m_Ctrl));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < flat_hash_group_width; i++)
+        {
+            mask |= (static_cast<uint32_t>(m_Ctrl[i] < 0) << i);
+        }
+        return mask;
+#endif
+    }
+
+private:
+
+#if JXY_FLAT_HASH_SSE2
+    __m128i m_Ctrl;
+#else
+    flat_hash_ctrl m_Ctrl[flat_hash_group_width];
+#endif
+
+};
+
+template <typename TKey,
+          typename TValue,
+          typename TKeyOf,
+          typename THash,
+          typename TKeyEqual,
+          typename TAllocator>
+class flat_hash_table
+{
+    //
+    // The unit of the single allocation, aligned for the slots.
+    //
+    struct alignas(TValue) block
+    {
+        unsigned char Bytes[alignof(TValue)];
+    };
+
+    using alloc_traits = std::allocator_traits<TAllocator>;
+    using value_allocator = typename alloc_traits::template rebind_alloc<TValue>;
+    using value_traits = std::allocator_traits<value_allocator>;
+    using block_allocator = typename alloc_traits::template rebind_alloc<block>;
+    using block_traits = std::allocator_traits<block_allocator>;
+
+public:
+
+    using key_type = TKey;
+    using value_type = TValue;
+    using hasher = THash;
+    using key_equal = TKeyEqual;
+    using allocator_type = TAllocator;
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using pointer = value_type*;
+    using const_pointer = const value_type*;
+
+    template <bool t_Const>
+    class iterator_base
+    {
+        friend class flat_hash_table;
+
+    public:
+
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = TValue;
+        using difference_type = ptrdiff_t;
+        using pointer = std::conditional_t<t_Const, const TValue*, TValue*>;
+        using reference = std::conditional_t<t_Const, const TValue&, TValue&>;
+
+        constexpr iterator_base() noexcept = default;
+
+        template <bool t_Other, std::enable_if_t<(t_Const && !t_Other), int> = 0>
+        iterator_base(const iterator_base<t_Other>& Other) noexcept
+            : m_Ctrl(Other.m_Ctrl),
+              m_Slot(Other.m_Slot),
+              m_CtrlEnd(Other.m_CtrlEnd)
+        {
+        }
+
+        reference operator*() const noexcept
+        {
+            return *m_Slot;
+        }
+
+        pointer operator->() const noexcept
+        {
+            return m_Slot;
+        }
+
+        iterator_base& operator++() noexcept
+        {
+            ++m_Ctrl;
+            ++m_Slot;
+            skip_empty();
+            return *this;
+        }
+
+        iterator_base operator++(int) noexcept
+        {
+            auto previous = *this;
+            ++(*this);
+            return previous;
+        }
+
+        friend bool operator==(const iterator_base& Left, const iterator_base& Right) noexcept
+        {
+            return (Left.m_Slot == Right.m_Slot);
+        }
+
+        friend bool operator!=(const iterator_base& Left, const iterator_base& Right) noexcept
+        {
+            return (Left.m_Slot != Right.m_Slot);
+        }
+
+    private:
+
+        iterator_base(const flat_hash_ctrl* Ctrl, TValue* Slot, const flat_hash_ctrl* CtrlEnd) noexcept
+            : m_Ctrl(Ctrl),
+              m_Slot(Slot),
+              m_CtrlEnd(CtrlEnd)
+        {
+        }
+
+        //
+        // The end iterator has a null slot.
+        //
+        void skip_empty() noexcept
+        {
+            while ((m_Ctrl != m_CtrlEnd) && (*m_Ctrl < 0))
+            {
+                ++m_Ctrl;
+                ++m_Slot;
+            }
+
+            if (m_Ctrl == m_CtrlEnd)
+            {
+                m_Slot = nullptr;
+            }
+        }
+
+        template <bool>
+        friend class iterator_base;
+
+        const flat_hash_ctrl* m_Ctrl = nullptr;
+        TValue* m_Slot = nullptr;
+        const flat_hash_ctrl* m_CtrlEnd = nullptr;
+
+    };
+
+    using iterator = iterator_base<false>;
+    using const_iterator = iterator_base<true>;
+
+    flat_hash_table() noexcept(std::is_nothrow_default_constructible_v<value_allocator>) = default;
+
+    explicit flat_hash_table(
+        size_type Count,
+        const hasher& Hash = hasher(),
+        const key_equal& Equal = key_equal(),
+        const allocator_type& Allocator = allocator_type())
+        : m_Hash(Hash),
+          m_Equal(Equal),
+          m_Alloc(Allocator)
+    {
+        reserve(Count);
+    }
+
+    explicit flat_hash_table(const allocator_type& Allocator) noexcept
+        : m_Alloc(Allocator)
+    {
+    }
+
+    template <typename TInputIt>
+    flat_hash_table(
+        TInputIt First,
+        TInputIt Last,
+        size_type Count = 0,
+        const hasher& Hash = hasher(),
+        const key_equal& Equal = key_equal(),
+        const allocator_type& Allocator = allocator_type())
+        : flat_hash_table(Count, Hash, Equal, Allocator)
+    {
+        insert(First, Last);
+    }
+
+    flat_hash_table(
+        std::initializer_list<value_type> Values,
+        size_type Count = 0,
+        const hasher& Hash = hasher(),
+        const key_equal& Equal = key_equal(),
+        const allocator_type& Allocator = allocator_type())
+        : flat_hash_table(Values.begin(), Values.end(), Count, Hash, Equal, Allocator)
+    {
+    }
+
+    //
+    // Delegates so the destructor frees what was copied if an element copy
+    // throws.
+    //
+    flat_hash_table(const flat_hash_table& Other)
+        : flat_hash_table(0,
+                          Other.m_Hash,
+                          Other.m_Equal,
+                          allocator_type(value_traits::select_on_container_copy_construction(Other.m_Alloc)))
+    {
+        copy_from(Other);
+    }
+
+    flat_hash_table(flat_hash_table&& Other) noexcept
+        : m_Hash(std::move(Other.m_Hash)),
+          m_Equal(std::move(Other.m_Equal)),
+          m_Alloc(std::move(Other.m_Alloc))
+    {
+        steal(Other);
+    }
+
+    ~flat_hash_table() noexcept
+    {
+        destroy();
+    }
+
+    flat_hash_table& operator=(const flat_hash_table& Other)
+    {
+        if (this != &Other)
+        {
+            destroy();
+            if constexpr (value_traits::propagate_on_container_copy_assignment::value)
+            {
+                m_Alloc = Other.m_Alloc;
+            }
+            m_Hash = Other.m_Hash;
+            m_Equal = Other.m_Equal;
+            copy_from(Other);
+        }
+        return *this;
+    }
+
+    flat_hash_table& operator=(flat_hash_table&& Other) noexcept(value_traits::propagate_on_container_move_assignment::value ||
+                                                                 value_traits::is_always_equal::value)
+    {
+        if (this == &Other)
+        {
+            return *this;
+        }
+
+        destroy();
+        m_Hash = std::move(Other.m_Hash);
+        m_Equal = std::move(Other.m_Equal);
+
+        if constexpr (value_traits::propagate_on_container_move_assignment::value)
+        {
+            m_Alloc = std::move(Other.m_Alloc);
+            steal(Other);
+        }
+        else if constexpr (value_traits::is_always_equal::value)
+        {
+            steal(Other);
+        }
+        else
+        {
+            if (m_Alloc == Other.m_Alloc)
+            {
+                steal(Other);
+            }
+            else
+            {
+                //
+                // The memory belongs to the other allocator, move the
+                // elements instead.
+                //
+                reserve(Other.size());
+                for (auto& value : Other)
+                {
+                    emplace(std::move(value));
+                }
+                Other.clear();
+            }
+        }
+        return *this;
+    }
+
+    flat_hash_table& operator=(std::initializer_list<value_type> Values)
+    {
+        clear();
+        insert(Values);
+        return *this;
+    }
+
+    allocator_type get_allocator() const noexcept
+    {
+        return allocator_type(m_Alloc);
+    }
+
+    hasher hash_function() const
+    {
+        return m_Hash;
+    }
+
+    key_equal key_eq() const
+    {
+        return m_Equal;
+    }
+
+    iterator begin() noexcept
+    {
+        return make_begin<iterator>();
+    }
+
+    const_iterator begin() const noexcept
+    {
+        return make_begin<const_iterator>();
+    }
+
+    const_iterator cbegin() const noexcept
+    {
+        return begin();
+    }
+
+    iterator end() noexcept
+    {
+        return iterator();
+    }
+
+    const_iterator end() const noexcept
+    {
+        return const_iterator();
+    }
+
+    const_iterator cend() const noexcept
+    {
+        return const_iterator();
+    }
+
+    _NODISCARD
+    bool empty() const noexcept
+    {
+        return (m_Size == 0);
+    }
+
+    size_type size() const noexcept
+    {
+        return m_Size;
+    }
+
+    size_type max_size() const noexcept
+    {
+        return (static_cast<size_type>(1) << ((sizeof(size_t) * 8) - 8));
+    }
+
+    //
+    // Number of slots, a table holds up to 7/8 of them.
+    //
+    size_type capacity() const noexcept
+    {
+        return m_Capacity;
+    }
+
+    size_type bucket_count() const noexcept
+    {
+        return m_Capacity;
+    }
+
+    //
+    // Percent of the slots in use.
+    //
+    size_type load_factor() const noexcept
+    {
+        return (m_Capacity ? ((m_Size * 100) / m_Capacity) : 0);
+    }
+
+    void clear() noexcept
+    {
+        if (m_Capacity == 0)
+        {
+            return;
+        }
+
+        for (size_type i = 0; i < m_Capacity; i++)
+        {
+            if (m_Ctrl[i] >= 0)
+            {
+                value_traits::destroy(m_Alloc, &m_Slots[i]);
+            }
+        }
+        reset_ctrl();
+        m_Size = 0;
+    }
+
+    template <typename... TArgs>
+    std::pair<iterator, bool> emplace(TArgs&&... Args)
+    {
+        //
+        // The key is needed first, build the value aside and move it in.
+        //
+        value_holder holder(*this, std::forward<TArgs>(Args)...);
+        const auto& key = TKeyOf()(holder.value());
+
+        auto result = find_or_prepare_insert(key);
+        if (result.second)
+        {
+            insert_slot(result.first, std::move(holder.value()));
+        }
+        return { make_iterator(result.first), result.second };
+    }
+
+    template <typename... TArgs>
+    iterator emplace_hint(const_iterator, TArgs&&... Args)
+    {
+        return emplace(std::forward<TArgs>(Args)...).first;
+    }
+
+    std::pair<iterator, bool> insert(const value_type& Value)
+    {
+        return emplace_key(TKeyOf()(Value), Value);
+    }
+
+    std::pair<iterator, bool> insert(value_type&& Value)
+    {
+        return emplace_key(TKeyOf()(Value), std::move(Value));
+    }
+
+    template <typename TPair, std::enable_if_t<std::is_constructible_v<value_type, TPair&&>, int> = 0>
+    std::pair<iterator, bool> insert(TPair&& Value)
+    {
+        return emplace(std::forward<TPair>(Value));
+    }
+
+    iterator insert(const_iterator, const value_type& Value)
+    {
+        return insert(Value).first;
+    }
+
+    iterator insert(const_iterator, value_type&& Value)
+    {
+        return insert(std::move(Value)).first;
+    }
+
+    template <typename TInputIt>
+    void insert(TInputIt First, TInputIt Last)
+    {
+        for (; First != Last; ++First)
+        {
+            emplace(*First);
+        }
+    }
+
+    void insert(std::initializer_list<value_type> Values)
+    {
+        insert(Values.begin(), Values.end());
+    }
+
+    iterator erase(const_iterator Position) noexcept
+    {
+        auto index = static_cast<size_type>(Position.m_Ctrl - m_Ctrl);
+        erase_slot(index);
+
+        iterator next(Position.m_Ctrl, &m_Slots[index], Position.m_CtrlEnd);
+        next.skip_empty();
+        return next;
+    }
+
+    iterator erase(iterator Position) noexcept
+    {
+        return erase(const_iterator(Position));
+    }
+
+    iterator erase(const_iterator First, const_iterator Last) noexcept
+    {
+        while (First != Last)
+        {
+            First = erase(First);
+        }
+        return iterator(Last.m_Ctrl, const_cast<TValue*>(Last.m_Slot), Last.m_CtrlEnd);
+    }
+
+    size_type erase(const key_type& Key) noexcept
+    {
+        size_type index;
+        if (!find_index(Key, index))
+        {
+            return 0;
+        }
+
+        erase_slot(index);
+        return 1;
+    }
+
+    void swap(flat_hash_table& Other) noexcept
+    {
+        if constexpr (value_traits::propagate_on_container_swap::value)
+        {
+            std::swap(m_Alloc, Other.m_Alloc);
+        }
+        else if constexpr (!value_traits::is_always_equal::value)
+        {
+            NT_ASSERT(m_Alloc == Other.m_Alloc);
+        }
+        std::swap(m_Hash, Other.m_Hash);
+        std::swap(m_Equal, Other.m_Equal);
+        std::swap(m_Ctrl, Other.m_Ctrl);
+        std::swap(m_Slots, Other.m_Slots);
+        std::swap(m_Capacity, Other.m_Capacity);
+        std::swap(m_Shift, Other.m_Shift);
+        std::swap(m_Size, Other.m_Size);
+        std::swap(m_GrowthLeft, Other.m_GrowthLeft);
+    }
+
+    iterator find(const key_type& Key) noexcept
+    {
+        size_type index;
+        return (find_index(Key, index) ? make_iterator(index) : end());
+    }
+
+    const_iterator find(const key_type& Key) const noexcept
+    {
+        size_type index;
+        return (find_index(Key, index) ? make_iterator(index) : end());
+    }
+
+    size_type count(const key_type& Key) const noexcept
+    {
+        size_type index;
+        return (find_index(Key, index) ? 1 : 0);
+    }
+
+    bool contains(const key_type& Key) const noexcept
+    {
+        size_type index;
+        return find_index(Key, index);
+    }
+
+    std::pair<iterator, iterator> equal_range(const key_type& Key) noexcept
+    {
+        auto first = find(Key);
+        auto last = first;
+        if (last != end())
+        {
+            ++last;
+        }
+        return { first, last };
+    }
+
+    std::pair<const_iterator, const_iterator> equal_range(const key_type& Key) const noexcept
+    {
+        auto first = find(Key);
+        auto last = first;
+        if (last != end())
+        {
+            ++last;
+        }
+        return { first, last };
+    }
+
+    //
+    // Makes room for Count elements without another rehash.
+    //
+    void reserve(size_type Count)
+    {
+        auto required = capacity_for(Count);
+        if (required > m_Capacity)
+        {
+            resize(required);
+        }
+    }
+
+    //
+    // Rebuilds the table with at least Count slots (and enough for the
+    // current size), dropping any tombstones.
+    //
+    void rehash(size_type Count)
+    {
+        auto required = capacity_for(m_Size);
+        size_type capacity = flat_hash_min_capacity;
+        while ((capacity < Count) || (capacity < required))
+        {
+            capacity *= 2;
+        }
+
+        if ((m_Size == 0) && (Count == 0))
+        {
+            destroy();
+            return;
+        }
+
+        resize(capacity);
+    }
+
+protected:
+
+    //
+    // Constructs the value from the arguments only if the key is not found.
+    //
+    template <typename... TArgs>
+    std::pair<iterator, bool> emplace_key(const key_type& Key, TArgs&&... Args)
+    {
+        auto result = find_or_prepare_insert(Key);
+        if (result.second)
+        {
+            insert_slot(result.first, std::forward<TArgs>(Args)...);
+        }
+        return { make_iterator(result.first), result.second };
+    }
+
+private:
+
+    //
+    // A value constructed outside of the table, for emplace.
+    //
+    class value_holder
+    {
+    public:
+
+        template <typename... TArgs>
+        value_holder(flat_hash_table& Table, TArgs&&... Args) : m_Table(Table)
+        {
+            value_traits::construct(m_Table.m_Alloc, &value(), std::forward<TArgs>(Args)...);
+        }
+
+        ~value_holder() noexcept
+        {
+            value_traits::destroy(m_Table.m_Alloc, &value());
+        }
+
+        TValue& value() noexcept
+        {
+            return *reinterpret_cast<TValue*>(&m_Storage);
+        }
+
+    private:
+
+        flat_hash_table& m_Table;
+        std::aligned_storage_t<sizeof(TValue), alignof(TValue)> m_Storage;
+
+    };
+
+    struct probe
+    {
+        size_type Position;
+        flat_hash_ctrl Hash;
+    };
+
+    //
+    // The slot comes from the top bits of the hash times 2^64 / phi, the
+    // control byte from the 7 bits below them. The probe depends on the
+    // capacity, an insert keeps the hash to probe again after a resize.
+    //
+    probe make_probe(size_t Hash) const noexcept
+    {
+        size_t mixed;
+        if constexpr (sizeof(size_t) == 8)
+        {
+            mixed = (Hash * static_cast<size_t>(0x9e3779b97f4a7c15ull));
+        }
+        else
+        {
+            mixed = (Hash * static_cast<size_t>(0x9e3779b9ul));
+        }
+
+        return { static_cast<size_type>(mixed >> m_Shift),
+                 static_cast<flat_hash_ctrl>((mixed >> (m_Shift - 7)) & 0x7f) };
+    }
+
+    size_type mask() const noexcept
+    {
+        return (m_Capacity - 1);
+    }
+
+    bool find_index(const key_type& Key, size_type& Index) const
+    {
+        if (m_Size == 0)
+        {
+            return false;
+        }
+
+        return find_index(Key, m_Hash(Key), Index);
+    }
+
+    bool find_index(const key_type& Key, size_t Hash, size_type& Index) const
+    {
+        auto probe = make_probe(Hash);
+        auto position = probe.Position;
+        for (size_type step = flat_hash_group_width; ; step += flat_hash_group_width)
+        {
+            flat_hash_group group(&m_Ctrl[position]);
+
+            for (auto match = group.match(probe.Hash); match; match &= (match - 1))
+            {
+                auto index = ((position + flat_hash_lowest_bit(match)) & mask());
+                if (m_Equal(TKeyOf()(m_Slots[index]), Key))
+                {
+                    Index = index;
+                    return true;
+                }
+            }
+
+            if (group.match_empty())
+            {
+                return false;
+            }
+
+            //
+            // Triangular steps over the groups visit every group of a power
+            // of two table.
+            //
+            position = ((position + step) & mask());
+        }
+    }
+
+    size_type find_first_non_full(size_type Position) const noexcept
+    {
+        for (size_type step = flat_hash_group_width; ; step += flat_hash_group_width)
+        {
+            auto match = flat_hash_group(&m_Ctrl[Position]).match_empty_or_deleted();
+            if (match)
+            {
+                return ((Position + flat_hash_lowest_bit(match)) & mask());
+            }
+            Position = ((Position + step) & mask());
+        }
+    }
+
+    //
+    // Returns the slot of the key, or claims a slot for it and returns true.
+    // The control byte of a claimed slot is set, the caller constructs the
+    // value or releases the slot.
+    //
+    std::pair<size_type, bool> find_or_prepare_insert(const key_type& Key)
+    {
+        auto hash = m_Hash(Key);
+
+        size_type index;
+        if ((m_Size != 0) && find_index(Key, hash, index))
+        {
+            return { index, false };
+        }
+
+        if (m_GrowthLeft == 0)
+        {
+            //
+            // Rebuild at the same capacity when tombstones took the room.
+            //
+            if ((m_Capacity != 0) && ((m_Size * 16) <= (m_Capacity * 7)))
+            {
+                resize(m_Capacity);
+            }
+            else
+            {
+                resize(m_Capacity ? (m_Capacity * 2) : flat_hash_min_capacity);
+            }
+        }
+
+        auto probe = make_probe(hash);
+        index = find_first_non_full(probe.Position);
+        if (m_Ctrl[index] == flat_hash_empty)
+        {
+            m_GrowthLeft--;
+        }
+        set_ctrl(index, probe.Hash);
+        return { index, true };
+    }
+
+    template <typename... TArgs>
+    void insert_slot(size_type Index, TArgs&&... Args)
+    {
+        try
+        {
+            value_traits::construct(m_Alloc, &m_Slots[Index], std::forward<TArgs>(Args)...);
+        }
+        catch (...)
+        {
+            set_ctrl(Index, flat_hash_deleted);
+            throw;
+        }
+        m_Size++;
+    }
+
+    void erase_slot(size_type Index) noexcept
+    {
+        value_traits::destroy(m_Alloc, &m_Slots[Index]);
+        m_Size--;
+
+        //
+        // If an empty byte is within a group width on both sides no probe
+        // ever went past this slot, it may become empty again.
+        //
+        auto emptyAfter = flat_hash_group(&m_Ctrl[Index]).match_empty();
+        auto emptyBefore = flat_hash_group(&m_Ctrl[(Index - flat_hash_group_width) & mask()]).match_empty();
+        if (emptyAfter && emptyBefore)
+        {
+            unsigned long lastBefore;
+            _BitScanReverse(&lastBefore, emptyBefore);
+            auto distance = (flat_hash_lowest_bit(emptyAfter) + (flat_hash_group_width - 1 - lastBefore));
+            if (distance < flat_hash_group_width)
+            {
+                set_ctrl(Index, flat_hash_empty);
+                m_GrowthLeft++;
+                return;
+            }
+        }
+
+        set_ctrl(Index, flat_hash_deleted);
+    }
+
+    void set_ctrl(size_type Index, flat_hash_ctrl Ctrl) noexcept
+    {
+        m_Ctrl[Index] = Ctrl;
+        if (Index < (flat_hash_group_width - 1))
+        {
+            m_Ctrl[m_Capacity + Index] = Ctrl;
+        }
+    }
+
+    void reset_ctrl() noexcept
+    {
+        for (size_type i = 0; i < (m_Capacity + flat_hash_group_width - 1); i++)
+        {
+            m_Ctrl[i] = flat_hash_empty;
+        }
+        m_GrowthLeft = growth_for(m_Capacity);
+    }
+
+    static size_type growth_for(size_type Capacity) noexcept
+    {
+        return (Capacity - (Capacity / 8));
+    }
+
+    static size_type capacity_for(size_type Count) noexcept
+    {
+        if (Count == 0)
+        {
+            return 0;
+        }
+
+        size_type capacity = flat_hash_min_capacity;
+        while (growth_for(capacity) < Count)
+        {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    //
+    // The slots then the control bytes, in blocks.
+    //
+    static size_type blocks_for(size_type Capacity) noexcept
+    {
+        auto bytes = ((Capacity * sizeof(TValue)) + Capacity + flat_hash_group_width - 1);
+        return ((bytes + sizeof(block) - 1) / sizeof(block));
+    }
+
+    void resize(size_type Capacity)
+    {
+        if (Capacity > max_size())
+        {
+            throw std::bad_alloc();
+        }
+
+        block_allocator allocator(m_Alloc);
+        auto memory = block_traits::allocate(allocator, blocks_for(Capacity));
+
+        auto oldCtrl = m_Ctrl;
+        auto oldSlots = m_Slots;
+        auto oldCapacity = m_Capacity;
+        auto oldShift = m_Shift;
+        auto oldGrowthLeft = m_GrowthLeft;
+
+        m_Slots = reinterpret_cast<TValue*>(memory);
+        m_Ctrl = reinterpret_cast<flat_hash_ctrl*>(m_Slots + Capacity);
+        m_Capacity = Capacity;
+        m_Shift = (sizeof(size_t) * 8);
+        for (auto count = Capacity; count > 1; count /= 2)
+        {
+            m_Shift--;
+        }
+        reset_ctrl();
+
+        //
+        // Moved if that can't throw, otherwise copied so the old table is
+        // intact if a copy throws.
+        //
+        size_type moved = 0;
+        try
+        {
+            for (size_type i = 0; i < oldCapacity; i++)
+            {
+                if (oldCtrl[i] >= 0)
+                {
+                    auto& value = oldSlots[i];
+                    auto probe = make_probe(m_Hash(TKeyOf()(value)));
+                    auto index = find_first_non_full(probe.Position);
+                    value_traits::construct(m_Alloc, &m_Slots[index], std::move_if_noexcept(value));
+                    set_ctrl(index, probe.Hash);
+                    moved++;
+                }
+            }
+        }
+        catch (...)
+        {
+            for (size_type i = 0; i < Capacity; i++)
+            {
+                if (m_Ctrl[i] >= 0)
+                {
+                    value_traits::destroy(m_Alloc, &m_Slots[i]);
+                }
+            }
+            block_traits::deallocate(allocator, memory, blocks_for(Capacity));
+
+            m_Ctrl = oldCtrl;
+            m_Slots = oldSlots;
+            m_Capacity = oldCapacity;
+            m_Shift = oldShift;
+            m_GrowthLeft = oldGrowthLeft;
+            throw;
+        }
+
+        m_GrowthLeft -= moved;
+
+        if (oldCapacity)
+        {
+            for (size_type i = 0; i < oldCapacity; i++)
+            {
+                if (oldCtrl[i] >= 0)
+                {
+                    value_traits::destroy(m_Alloc, &oldSlots[i]);
+                }
+            }
+            block_traits::deallocate(allocator, reinterpret_cast<block*>(oldSlots), blocks_for(oldCapacity));
+        }
+    }
+
+    template <typename TIterator>
+    TIterator make_begin() const noexcept
+    {
+        if (m_Size == 0)
+        {
+            return TIterator();
+        }
+
+        TIterator it(m_Ctrl, m_Slots, (m_Ctrl + m_Capacity));
+        it.skip_empty();
+        return it;
+    }
+
+    iterator make_iterator(size_type Index) const noexcept
+    {
+        return iterator(&m_Ctrl[Index], &m_Slots[Index], (m_Ctrl + m_Capacity));
+    }
+
+    void copy_from(const flat_hash_table& Other)
+    {
+        reserve(Other.m_Size);
+        for (const auto& value : Other)
+        {
+            auto probe = make_probe(m_Hash(TKeyOf()(value)));
+            auto index = find_first_non_full(probe.Position);
+            value_traits::construct(m_Alloc, &m_Slots[index], value);
+            set_ctrl(index, probe.Hash);
+            m_GrowthLeft--;
+            m_Size++;
+        }
+    }
+
+    void steal(flat_hash_table& Other) noexcept
+    {
+        m_Ctrl = std::exchange(Other.m_Ctrl, nullptr);
+        m_Slots = std::exchange(Other.m_Slots, nullptr);
+        m_Capacity = std::exchange(Other.m_Capacity, 0);
+        m_Shift = Other.m_Shift;
+        m_Size = std::exchange(Other.m_Size, 0);
+        m_GrowthLeft = std::exchange(Other.m_GrowthLeft, 0);
+    }
+
+    void destroy() noexcept
+    {
+        clear();
+        if (m_Capacity)
+        {
+            block_allocator allocator(m_Alloc);
+            block_traits::deallocate(allocator, reinterpret_cast<block*>(m_Slots), blocks_for(m_Capacity));
+            m_Ctrl = nullptr;
+            m_Slots = nullptr;
+            m_Capacity = 0;
+            m_GrowthLeft = 0;
+        }
+    }
+
+    hasher m_Hash{};
+    key_equal m_Equal{};
+    value_allocator m_Alloc{};
+    flat_hash_ctrl* m_Ctrl = nullptr;
+    TValue* m_Slots = nullptr;
+    size_type m_Capacity = 0;
+    ULONG m_Shift = 0;
+    size_type m_Size = 0;
+    size_type m_GrowthLeft = 0;
+
+};
+
+template <typename TKey, typename TValue, typename TKeyOf, typename THash, typename TKeyEqual, typename TAllocator>
+bool operator==(
+    const flat_hash_table<TKey, TValue, TKeyOf, THash, TKeyEqual, TAllocator>& Left,
+    const flat_hash_table<TKey, TValue, TKeyOf, THash, TKeyEqual, TAllocator>& Right)
+{
+    if (Left.size() != Right.size())
+    {
+        return false;
+    }
+
+    for (const auto& value : Left)
+    {
+        auto it = Right.find(TKeyOf()(value));
+        if ((it == Right.end()) || !(*it == value))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template <typename TKey, typename TValue, typename TKeyOf, typename THash, typename TKeyEqual, typename TAllocator>
+bool operator!=(
+    const flat_hash_table<TKey, TValue, TKeyOf, THash, TKeyEqual, TAllocator>& Left,
+    const flat_hash_table<TKey, TValue, TKeyOf, THash, TKeyEqual, TAllocator>& Right)
+{
+    return !(Left == Right);
+}
+
+}
+
+}
@@ -0,0 +1,905 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/flat_map.hpp
+// Author:   Johnny Shaw
+// Abstract: Sorted vector backed maps
+//
+// In the style of the C++23 std::flat_map, see jxy/flat_tree.hpp. The keys
+// and the mapped values are kept in two jxy::vectors, a lookup binary
+// searches the keys alone and walking the values (values()) is walking an
+// array. Inserting or erasing moves the elements after the position and
+// invalidates iterators.
+//
+// Like std::flat_map dereferencing an iterator returns a pair of references
+// by value (std::pair<const TKey&, T&>), bind it with "auto" or "const auto&"
+// rather than "auto&".
+//
+// jxylib                   STL equivalent
+// ---------------------------------------------------------------------------
+// jxy::flat_map            std::flat_map (C++23)
+// jxy::flat_multimap       std::flat_multimap (C++23)
+//
+#pragma once
+#include <jxy/memory.hpp>
+#include <jxy/flat_tree.hpp>
+#include <stdexcept>
+#include <tuple>
+
+namespace jxy
+{
+
+namespace details
+{
+
+template <typename TKey,
+          typename T,
+          typename TCompare,
+          typename TKeyContainer,
+          typename TMappedContainer,
+          bool t_Multi>
+class flat_map_base
+{
+public:
+
+    using key_type = TKey;
+    using mapped_type = T;
+    using value_type = std::pair<TKey, T>;
+    using key_compare = TCompare;
+    using reference = std::pair<const TKey&, T&>;
+    using const_reference = std::pair<const TKey&, const T&>;
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+    using key_container_type = TKeyContainer;
+    using mapped_container_type = TMappedContainer;
+    using sorted_type = std::conditional_t<t_Multi, sorted_equivalent_t, sorted_unique_t>;
+
+    struct containers
+    {
+        key_container_type keys;
+        mapped_container_type values;
+    };
+
+    class value_compare
+    {
+    public:
+
+        bool operator()(const_reference Left, const_reference Right) const
+        {
+            return m_Compare(Left.first, Right.first);
+        }
+
+    private:
+
+        friend class flat_map_base;
+
+        value_compare(const key_compare& Compare) : m_Compare(Compare)
+        {
+        }
+
+        key_compare m_Compare;
+
+    };
+
+    template <bool t_Const>
+    class iterator_base
+    {
+        friend class flat_map_base;
+
+        using key_iterator = typename TKeyContainer::const_iterator;
+        using mapped_iterator = std::conditional_t<t_Const,
+                                                   typename TMappedContainer::const_iterator,
+                                                   typename TMappedContainer::iterator>;
+
+    public:
+
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = std::pair<TKey, T>;
+        using difference_type = ptrdiff_t;
+        using reference = std::conditional_t<t_Const, const_reference, flat_map_base::reference>;
+
+        //
+        // operator-> hands out the address of a pair of references.
+        //
+        struct pointer
+        {
+            const reference* operator->() const noexcept
+            {
+                return &Reference;
+            }
+
+            reference Reference;
+        };
+
+        iterator_base() = default;
+
+        template <bool t_Other, std::enable_if_t<(t_Const && !t_Other), int> = 0>
+        iterator_base(const iterator_base<t_Other>& Other) noexcept
+            : m_Key(Other.m_Key),
+              m_Mapped(Other.m_Mapped)
+        {
+        }
+
+        reference operator*() const noexcept
+        {
+            return reference(*m_Key, *m_Mapped);
+        }
+
+        pointer operator->() const noexcept
+        {
+            return pointer{ **this };
+        }
+
+        reference operator[](difference_type Offset) const noexcept
+        {
+            return *(*this + Offset);
+        }
+
+        iterator_base& operator++() noexcept
+        {
+            ++m_Key;
+            ++m_Mapped;
+            return *this;
+        }
+
+        iterator_base operator++(int) noexcept
+        {
+            auto previous = *this;
+            ++(*this);
+            return previous;
+        }
+
+        iterator_base& operator--() noexcept
+        {
+            --m_Key;
+            --m_Mapped;
+            return *this;
+        }
+
+        iterator_base operator--(int) noexcept
+        {
+            auto previous = *this;
+            --(*this);
+            return previous;
+        }
+
+        iterator_base& operator+=(difference_type Offset) noexcept
+        {
+            m_Key += Offset;
+            m_Mapped += Offset;
+            return *this;
+        }
+
+        iterator_base& operator-=(difference_type Offset) noexcept
+        {
+            m_Key -= Offset;
+            m_Mapped -= Offset;
+            return *this;
+        }
+
+        friend iterator_base operator+(iterator_base It, difference_type Offset) noexcept
+        {
+            return (It += Offset);
+        }
+
+        friend iterator_base operator+(difference_type Offset, iterator_base It) noexcept
+        {
+            return (It += Offset);
+        }
+
+        friend iterator_base operator-(iterator_base It, difference_type Offset) noexcept
+        {
+            return (It -= Offset);
+        }
+
+        friend difference_type operator-(const iterator_base& Left, const iterator_base& Right) noexcept
+        {
+            return (Left.m_Key - Right.m_Key);
+        }
+
+        friend bool operator==(const iterator_base& Left, const iterator_base& Right) noexcept
+        {
+            return (Left.m_Key == Right.m_Key);
+        }
+
+        friend bool operator!=(const iterator_base& Left, const iterator_base& Right) noexcept
+        {
+            return (Left.m_Key != Right.m_Key);
+        }
+
+        friend bool operator<(const iterator_base& Left, const iterator_base& Right) noexcept
+        {
+            return (Left.m_Key < Right.m_Key);
+        }
+
+        friend bool operator>(const iterator_base& Left, const iterator_base& Right) noexcept
+        {
+            return (Left.m_Key > Right.m_Key);
+        }
+
+        friend bool operator<=(const iterator_base& Left, const iterator_base& Right) noexcept
+        {
+            return (Left.m_Key <= Right.m_Key);
+        }
+
+        friend bool operator>=(const iterator_base& Left, const iterator_base& Right) noexcept
+        {
+            return (Left.m_Key >= Right.m_Key);
+        }
+
+    private:
+
+        iterator_base(key_iterator Key, mapped_iterator Mapped) noexcept
+            : m_Key(Key),
+              m_Mapped(Mapped)
+        {
+        }
+
+        template <bool>
+        friend class iterator_base;
+
+        key_iterator m_Key{};
+        mapped_iterator m_Mapped{};
+
+    };
+
+    using iterator = iterator_base<false>;
+    using const_iterator = iterator_base<true>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    flat_map_base() = default;
+
+    explicit flat_map_base(const key_compare& Compare) : m_Compare(Compare)
+    {
+    }
+
+    flat_map_base(
+        key_container_type Keys,
+        mapped_container_type Values,
+        const key_compare& Compare = key_compare())
+        : m_Compare(Compare),
+          m_Keys(std::move(Keys)),
+          m_Values(std::move(Values))
+    {
+        NT_ASSERT(m_Keys.size() == m_Values.size());
+        order_from(0, false);
+    }
+
+    flat_map_base(
+        sorted_type,
+        key_container_type Keys,
+        mapped_container_type Values,
+        const key_compare& Compare = key_compare())
+        : m_Compare(Compare),
+          m_Keys(std::move(Keys)),
+          m_Values(std::move(Values))
+    {
+        NT_ASSERT(m_Keys.size() == m_Values.size());
+    }
+
+    template <typename TInputIt>
+    flat_map_base(TInputIt First, TInputIt Last, const key_compare& Compare = key_compare())
+        : m_Compare(Compare)
+    {
+        insert(First, Last);
+    }
+
+    template <typename TInputIt>
+    flat_map_base(sorted_type Sorted, TInputIt First, TInputIt Last, const key_compare& Compare = key_compare())
+        : m_Compare(Compare)
+    {
+        insert(Sorted, First, Last);
+    }
+
+    flat_map_base(std::initializer_list<value_type> Values, const key_compare& Compare = key_compare())
+        : flat_map_base(Values.begin(), Values.end(), Compare)
+    {
+    }
+
+    flat_map_base(
+        sorted_type Sorted,
+        std::initializer_list<value_type> Values,
+        const key_compare& Compare = key_compare())
+        : flat_map_base(Sorted, Values.begin(), Values.end(), Compare)
+    {
+    }
+
+    flat_map_base& operator=(std::initializer_list<value_type> Values)
+    {
+        clear();
+        insert(Values);
+        return *this;
+    }
+
+    iterator begin() noexcept
+    {
+        return iterator(m_Keys.cbegin(), m_Values.begin());
+    }
+
+    const_iterator begin() const noexcept
+    {
+        return const_iterator(m_Keys.cbegin(), m_Values.cbegin());
+    }
+
+    iterator end() noexcept
+    {
+        return iterator(m_Keys.cend(), m_Values.end());
+    }
+
+    const_iterator end() const noexcept
+    {
+        return const_iterator(m_Keys.cend(), m_Values.cend());
+    }
+
+    const_iterator cbegin() const noexcept
+    {
+        return begin();
+    }
+
+    const_iterator cend() const noexcept
+    {
+        return end();
+    }
+
+    reverse_iterator rbegin() noexcept
+    {
+        return reverse_iterator(end());
+    }
+
+    const_reverse_iterator rbegin() const noexcept
+    {
+        return const_reverse_iterator(end());
+    }
+
+    reverse_iterator rend() noexcept
+    {
+        return reverse_iterator(begin());
+    }
+
+    const_reverse_iterator rend() const noexcept
+    {
+        return const_reverse_iterator(begin());
+    }
+
+    const_reverse_iterator crbegin() const noexcept
+    {
+        return rbegin();
+    }
+
+    const_reverse_iterator crend() const noexcept
+    {
+        return rend();
+    }
+
+    _NODISCARD
+    bool empty() const noexcept
+    {
+        return m_Keys.empty();
+    }
+
+    size_type size() const noexcept
+    {
+        return m_Keys.size();
+    }
+
+    size_type max_size() const noexcept
+    {
+        return std::min<size_type>(m_Keys.max_size(), m_Values.max_size());
+    }
+
+    size_type capacity() const noexcept
+    {
+        return std::min<size_type>(m_Keys.capacity(), m_Values.capacity());
+    }
+
+    void reserve(size_type Count)
+    {
+        m_Keys.reserve(Count);
+        m_Values.reserve(Count);
+    }
+
+    void shrink_to_fit()
+    {
+        m_Keys.shrink_to_fit();
+        m_Values.shrink_to_fit();
+    }
+
+    template <typename... TArgs>
+    auto emplace(TArgs&&... Args)
+    {
+        value_type value(std::forward<TArgs>(Args)...);
+        if constexpr (t_Multi)
+        {
+            auto position = std::upper_bound(m_Keys.cbegin(), m_Keys.cend(), value.first, m_Compare);
+            return insert_at(position, std::move(value.first), std::move(value.second));
+        }
+        else
+        {
+            return emplace_key(std::move(value.first), std::move(value.second));
+        }
+    }
+
+    template <typename... TArgs>
+    iterator emplace_hint(const_iterator, TArgs&&... Args)
+    {
+        if constexpr (t_Multi)
+        {
+            return emplace(std::forward<TArgs>(Args)...);
+        }
+        else
+        {
+            return emplace(std::forward<TArgs>(Args)...).first;
+        }
+    }
+
+    auto insert(const value_type& Value)
+    {
+        return emplace(Value);
+    }
+
+    auto insert(value_type&& Value)
+    {
+        return emplace(std::move(Value));
+    }
+
+    template <typename TPair, std::enable_if_t<std::is_constructible_v<value_type, TPair&&>, int> = 0>
+    auto insert(TPair&& Value)
+    {
+        return emplace(std::forward<TPair>(Value));
+    }
+
+    iterator insert(const_iterator Hint, const value_type& Value)
+    {
+        return emplace_hint(Hint, Value);
+    }
+
+    iterator insert(const_iterator Hint, value_type&& Value)
+    {
+        return emplace_hint(Hint, std::move(Value));
+    }
+
+    template <typename TInputIt>
+    void insert(TInputIt First, TInputIt Last)
+    {
+        insert_range(First, Last, false);
+    }
+
+    template <typename TInputIt>
+    void insert(sorted_type, TInputIt First, TInputIt Last)
+    {
+        insert_range(First, Last, true);
+    }
+
+    void insert(std::initializer_list<value_type> Values)
+    {
+        insert(Values.begin(), Values.end());
+    }
+
+    void insert(sorted_type Sorted, std::initializer_list<value_type> Values)
+    {
+        insert(Sorted, Values.begin(), Values.end());
+    }
+
+    containers extract() &&
+    {
+        return containers{ std::move(m_Keys), std::move(m_Values) };
+    }
+
+    //
+    // Takes keys which are already sorted (and unique for the unique
+    // containers) and their values.
+    //
+    void replace(key_container_type&& Keys, mapped_container_type&& Values)
+    {
+        NT_ASSERT(Keys.size() == Values.size());
+        m_Keys = std::move(Keys);
+        m_Values = std::move(Values);
+    }
+
+    iterator erase(const_iterator Position)
+    {
+        auto index = (Position.m_Key - m_Keys.cbegin());
+        m_Values.erase(m_Values.cbegin() + index);
+        return iterator(m_Keys.erase(Position.m_Key), (m_Values.begin() + index));
+    }
+
+    iterator erase(iterator Position)
+    {
+        return erase(const_iterator(Position));
+    }
+
+    iterator erase(const_iterator First, const_iterator Last)
+    {
+        auto index = (First.m_Key - m_Keys.cbegin());
+        m_Values.erase(First.m_Mapped, Last.m_Mapped);
+        return iterator(m_Keys.erase(First.m_Key, Last.m_Key), (m_Values.begin() + index));
+    }
+
+    size_type erase(const key_type& Key)
+    {
+        auto range = equal_range(Key);
+        auto count = static_cast<size_type>(range.second - range.first);
+        erase(range.first, range.second);
+        return count;
+    }
+
+    void swap(flat_map_base& Other) noexcept
+    {
+        std::swap(m_Compare, Other.m_Compare);
+        m_Keys.swap(Other.m_Keys);
+        m_Values.swap(Other.m_Values);
+    }
+
+    void clear() noexcept
+    {
+        m_Keys.clear();
+        m_Values.clear();
+    }
+
+    key_compare key_comp() const
+    {
+        return m_Compare;
+    }
+
+    value_compare value_comp() const
+    {
+        return value_compare(m_Compare);
+    }
+
+    const key_container_type& keys() const noexcept
+    {
+        return m_Keys;
+    }
+
+    const mapped_container_type& values() const noexcept
+    {
+        return m_Values;
+    }
+
+    iterator find(const key_type& Key)
+    {
+        return make_iterator<iterator>(find_index(Key));
+    }
+
+    const_iterator find(const key_type& Key) const
+    {
+        return make_iterator<const_iterator>(find_index(Key));
+    }
+
+    size_type count(const key_type& Key) const
+    {
+        auto range = std::equal_range(m_Keys.cbegin(), m_Keys.cend(), Key, m_Compare);
+        return static_cast<size_type>(range.second - range.first);
+    }
+
+    bool contains(const key_type& Key) const
+    {
+        return (find_index(Key) != m_Keys.size());
+    }
+
+    iterator lower_bound(const key_type& Key)
+    {
+        return make_iterator<iterator>(lower_index(Key));
+    }
+
+    const_iterator lower_bound(const key_type& Key) const
+    {
+        return make_iterator<const_iterator>(lower_index(Key));
+    }
+
+    iterator upper_bound(const key_type& Key)
+    {
+        return make_iterator<iterator>(upper_index(Key));
+    }
+
+    const_iterator upper_bound(const key_type& Key) const
+    {
+        return make_iterator<const_iterator>(upper_index(Key));
+    }
+
+    std::pair<iterator, iterator> equal_range(const key_type& Key)
+    {
+        return { lower_bound(Key), upper_bound(Key) };
+    }
+
+    std::pair<const_iterator, const_iterator> equal_range(const key_type& Key) const
+    {
+        return { lower_bound(Key), upper_bound(Key) };
+    }
+
+    friend bool operator==(const flat_map_base& Left, const flat_map_base& Right)
+    {
+        return (std::equal(Left.m_Keys.cbegin(), Left.m_Keys.cend(), Right.m_Keys.cbegin(), Right.m_Keys.cend()) &&
+                std::equal(Left.m_Values.cbegin(), Left.m_Values.cend(), Right.m_Values.cbegin(), Right.m_Values.cend()));
+    }
+
+    friend bool operator!=(const flat_map_base& Left, const flat_map_base& Right)
+    {
+        return !(Left == Right);
+    }
+
+protected:
+
+    //
+    // Constructs the mapped value from the arguments only if the key is not
+    // found, the unique maps use this for try_emplace.
+    //
+    template <typename TKeyArg, typename... TArgs>
+    std::pair<iterator, bool> emplace_key(TKeyArg&& Key, TArgs&&... Args)
+    {
+        auto position = std::lower_bound(m_Keys.cbegin(), m_Keys.cend(), Key, m_Compare);
+        if ((position != m_Keys.cend()) && !m_Compare(Key, *position))
+        {
+            auto index = static_cast<size_type>(position - m_Keys.cbegin());
+            return { make_iterator<iterator>(index), false };
+        }
+
+        return { insert_at(position, std::forward<TKeyArg>(Key), std::forward<TArgs>(Args)...), true };
+    }
+
+private:
+
+    template <typename TIterator>
+    TIterator make_iterator(size_type Index) const noexcept
+    {
+        auto& values = const_cast<mapped_container_type&>(m_Values);
+        return TIterator((m_Keys.cbegin() + Index), (values.begin() + Index));
+    }
+
+    size_type lower_index(const key_type& Key) const
+    {
+        return static_cast<size_type>(
+            std::lower_bound(m_Keys.cbegin(), m_Keys.cend(), Key, m_Compare) - m_Keys.cbegin());
+    }
+
+    size_type upper_index(const key_type& Key) const
+    {
+        return static_cast<size_type>(
+            std::upper_bound(m_Keys.cbegin(), m_Keys.cend(), Key, m_Compare) - m_Keys.cbegin());
+    }
+
+    //
+    // The index of the key or size() when it's not found.
+    //
+    size_type find_index(const key_type& Key) const
+    {
+        auto index = lower_index(Key);
+        if ((index == m_Keys.size()) || m_Compare(Key, m_Keys[index]))
+        {
+            return m_Keys.size();
+        }
+        return index;
+    }
+
+    template <typename TKeyArg, typename... TArgs>
+    iterator insert_at(typename TKeyContainer::const_iterator Position, TKeyArg&& Key, TArgs&&... Args)
+    {
+        auto index = (Position - m_Keys.cbegin());
+        auto key = m_Keys.insert(Position, std::forward<TKeyArg>(Key));
+        try
+        {
+            return iterator(key, m_Values.emplace(m_Values.cbegin() + index, std::forward<TArgs>(Args)...));
+        }
+        catch (...)
+        {
+            m_Keys.erase(key);
+            throw;
+        }
+    }
+
+    template <typename TInputIt>
+    void insert_range(TInputIt First, TInputIt Last, bool Sorted)
+    {
+        auto existing = m_Keys.size();
+        try
+        {
+            for (; First != Last; ++First)
+            {
+                const value_type& value = *First;
+                m_Keys.push_back(value.first);
+                try
+                {
+                    m_Values.push_back(value.second);
+                }
+                catch (...)
+                {
+                    m_Keys.pop_back();
+                    throw;
+                }
+            }
+        }
+        catch (...)
+        {
+            m_Keys.erase(m_Keys.begin() + existing, m_Keys.end());
+            m_Values.erase(m_Values.begin() + existing, m_Values.end());
+            throw;
+        }
+        order_from(existing, Sorted);
+    }
+
+    //
+    // Elements which std::move_if_noexcept moved into the merged containers
+    // are moved back if the merge fails, copied elements were left as they
+    // were.
+    //
+    template <typename U>
+    static void restore_moved(U& Target, U& Source) noexcept
+    {
+        if constexpr (std::is_nothrow_move_constructible_v<U> || !std::is_copy_constructible_v<U>)
+        {
+            Target = std::move(Source);
+        }
+    }
+
+    //
+    // Merges the elements from First on into the sorted elements before it.
+    // On failure the elements before First are as they were and the
+    // appended elements are removed.
+    //
+    void order_from(size_type First, bool Sorted)
+    {
+        if (First == m_Keys.size())
+        {
+            return;
+        }
+
+        try
+        {
+            auto order = flat_merge_order<t_Multi>(m_Keys, First, Sorted, m_Compare);
+
+            //
+            // Build both before replacing either so a failure leaves the
+            // containers in step.
+            //
+            key_container_type keys(m_Keys.get_allocator());
+            mapped_container_type values(m_Values.get_allocator());
+            keys.reserve(order.size());
+            values.reserve(order.size());
+            try
+            {
+                for (auto index : order)
+                {
+                    keys.push_back(std::move_if_noexcept(m_Keys[index]));
+                    values.push_back(std::move_if_noexcept(m_Values[index]));
+                }
+            }
+            catch (...)
+            {
+                for (size_type i = 0; i < keys.size(); i++)
+                {
+                    restore_moved(m_Keys[order[i]], keys[i]);
+                }
+                for (size_type i = 0; i < values.size(); i++)
+                {
+                    restore_moved(m_Values[order[i]], values[i]);
+                }
+                throw;
+            }
+            m_Keys.swap(keys);
+            m_Values.swap(values);
+        }
+        catch (...)
+        {
+            m_Keys.erase(m_Keys.begin() + First, m_Keys.end());
+            m_Values.erase(m_Values.begin() + First, m_Values.end());
+            throw;
+        }
+    }
+
+    key_compare m_Compare{};
+    key_container_type m_Keys{};
+    mapped_container_type m_Values{};
+
+};
+
+}
+
+template <typename TKey,
+          typename T,
+          POOL_TYPE t_PoolType,
+          ULONG t_PoolTag,
+          typename TCompare = std::less<TKey>,
+          typename TKeyContainer = vector<TKey, t_PoolType, t_PoolTag>,
+          typename TMappedContainer = vector<T, t_PoolType, t_PoolTag>>
+class flat_map : public details::flat_map_base<TKey, T, TCompare, TKeyContainer, TMappedContainer, false>
+{
+    using base = details::flat_map_base<TKey, T, TCompare, TKeyContainer, TMappedContainer, false>;
+
+public:
+
+    static constexpr POOL_TYPE pool_type = t_PoolType;
+    static constexpr ULONG pool_tag = t_PoolTag;
+
+    using typename base::key_type;
+    using typename base::mapped_type;
+    using typename base::value_type;
+    using typename base::iterator;
+    using typename base::const_iterator;
+
+    using base::base;
+
+    flat_map() = default;
+
+    flat_map& operator=(std::initializer_list<value_type> Values)
+    {
+        base::operator=(Values);
+        return *this;
+    }
+
+    template <typename... TArgs>
+    std::pair<iterator, bool> try_emplace(const key_type& Key, TArgs&&... Args)
+    {
+        return base::emplace_key(Key, std::forward<TArgs>(Args)...);
+    }
+
+    template <typename... TArgs>
+    std::pair<iterator, bool> try_emplace(key_type&& Key, TArgs&&... Args)
+    {
+        return base::emplace_key(std::move(Key), std::forward<TArgs>(Args)...);
+    }
+
+    template <typename TMapped>
+    std::pair<iterator, bool> insert_or_assign(const key_type& Key, TMapped&& Value)
+    {
+        auto result = try_emplace(Key, std::forward<TMapped>(Value));
+        if (!result.second)
+        {
+            result.first->second = std::forward<TMapped>(Value);
+        }
+        return result;
+    }
+
+    template <typename TMapped>
+    std::pair<iterator, bool> insert_or_assign(key_type&& Key, TMapped&& Value)
+    {
+        auto result = try_emplace(std::move(Key), std::forward<TMapped>(Value));
+        if (!result.second)
+        {
+            result.first->second = std::forward<TMapped>(Value);
+        }
+        return result;
+    }
+
+    mapped_type& operator[](const key_type& Key)
+    {
+        return try_emplace(Key).first->second;
+    }
+
+    mapped_type& operator[](key_type&& Key)
+    {
+        return try_emplace(std::move(Key)).first->second;
+    }
+
+    mapped_type& at(const key_type& Key)
+    {
+        auto it = base::find(Key);
+        if (it == base::end())
+        {
+            throw std::out_of_range("invalid flat_map<K, T> key");
+        }
+        return it->second;
+    }
+
+    const mapped_type& at(const key_type& Key) const
+    {
+        auto it = base::find(Key);
+        if (it == base::end())
+        {
+            throw std::out_of_range("invalid flat_map<K, T> key");
+        }
+        return it->second;
+    }
+
+};
+
+template <typename TKey,
+          typename T,
+          POOL_TYPE t_PoolType,
+          ULONG t_PoolTag,
+          typename TCompare = std::less<TKey>,
+          typename TKeyContainer = vector<TKey, t_PoolType, t_PoolTag>,
+          typename TMappedContainer = vector<T, t_PoolType, t_PoolTag>>
+using flat_multimap = details::flat_map_base<TKey, T, TCompare, TKeyContainer, TMappedContainer, true>;
+
+}
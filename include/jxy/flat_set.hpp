@@ -0,0 +1,38 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/flat_set.hpp
+// Author:   Johnny Shaw
+// Abstract: Sorted vector backed sets
+//
+// In the style of the C++23 std::flat_set, see jxy/flat_tree.hpp. The
+// elements are kept sorted in a jxy::vector, inserting or erasing moves the
+// elements after the position and invalidates iterators.
+//
+// jxylib                   STL equivalent
+// ---------------------------------------------------------------------------
+// jxy::flat_set            std::flat_set (C++23)
+// jxy::flat_multiset       std::flat_multiset (C++23)
+//
+#pragma once
+#include <jxy/memory.hpp>
+#include <jxy/flat_tree.hpp>
+
+namespace jxy
+{
+
+template <typename TKey,
+          POOL_TYPE t_PoolType,
+          ULONG t_PoolTag,
+          typename TCompare = std::less<TKey>,
+          typename TContainer = vector<TKey, t_PoolType, t_PoolTag>>
+using flat_set = details::flat_tree<TKey, TCompare, TContainer, false>;
+
+template <typename TKey,
+          POOL_TYPE t_PoolType,
+          ULONG t_PoolTag,
+          typename TCompare = std::less<TKey>,
+          typename TContainer = vector<TKey, t_PoolType, t_PoolTag>>
+using flat_multiset = details::flat_tree<TKey, TCompare, TContainer, true>;
+
+}
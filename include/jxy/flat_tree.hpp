@@ -0,0 +1,505 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/flat_tree.hpp
+// Author:   Johnny Shaw
+// Abstract: Sorted contiguous containers, shared by flat_map and flat_set
+//
+// The flat containers keep their elements sorted in vectors, a lookup is a
+// binary search over contiguous keys and iteration walks memory in order.
+// Inserting or erasing a single element shifts the elements after it, they
+// suit containers written in a burst and then read.
+//
+// Bulk inserts append the new elements, order them, and merge them with the
+// existing elements into new vectors in a single pass. std::stable_sort and
+// std::inplace_merge are avoided on purpose, they allocate their temporary
+// buffers with the global operator new which jxystl doesn't provide. When
+// the elements are known to be sorted already pass jxy::sorted_unique (or
+// jxy::sorted_equivalent for the multi containers) to skip ordering them.
+//
+#pragma once
+#include <fltKernel.h>
+#include <jxy/memory.hpp>
+#include <jxy/vector.hpp>
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+
+namespace jxy
+{
+
+struct sorted_unique_t
+{
+    explicit sorted_unique_t() = default;
+};
+
+inline constexpr sorted_unique_t sorted_unique{};
+
+struct sorted_equivalent_t
+{
+    explicit sorted_equivalent_t() = default;
+};
+
+inline constexpr sorted_equivalent_t sorted_equivalent{};
+
+namespace details
+{
+
+template <typename TContainer>
+using flat_index_vector = std::vector<
+    size_t,
+    typename std::allocator_traits<typename TContainer::allocator_type>::template rebind_alloc<size_t>>;
+
+//
+// Returns the order to take the elements of Keys in, the sorted elements
+// before First and then the appended elements from First on. Equivalent
+// keys keep their relative order (existing elements first), for the unique
+// containers only the first of equivalent keys is taken.
+//
+template <bool t_Multi, typename TKeys, typename TCompare>
+flat_index_vector<TKeys> flat_merge_order(
+    const TKeys& Keys,
+    size_t First,
+    bool Sorted,
+    const TCompare& Compare)
+{
+    using index_allocator = typename flat_index_vector<TKeys>::allocator_type;
+
+    flat_index_vector<TKeys> appended{ index_allocator(Keys.get_allocator()) };
+    appended.reserve(Keys.size() - First);
+    for (size_t i = First; i < Keys.size(); i++)
+    {
+        appended.push_back(i);
+    }
+
+    if (!Sorted)
+    {
+        //
+        // The index breaks ties so the sort is stable.
+        //
+        std::sort(appended.begin(),
+                  appended.end(),
+                  [&Keys, &Compare](size_t Left, size_t Right)
+                  {
+                      if (Compare(Keys[Left], Keys[Right]))
+                      {
+                          return true;
+                      }
+                      if (Compare(Keys[Right], Keys[Left]))
+                      {
+                          return false;
+                      }
+                      return (Left < Right);
+                  });
+    }
+
+    flat_index_vector<TKeys> order{ index_allocator(Keys.get_allocator()) };
+    order.reserve(Keys.size());
+
+    size_t existing = 0;
+    size_t added = 0;
+    while ((existing < First) || (added < appended.size()))
+    {
+        size_t next;
+        if ((added == appended.size()) ||
+            ((existing < First) && !Compare(Keys[appended[added]], Keys[existing])))
+        {
+            next = existing++;
+        }
+        else
+        {
+            next = appended[added++];
+        }
+
+        if constexpr (!t_Multi)
+        {
+            if (!order.empty() && !Compare(Keys[order.back()], Keys[next]))
+            {
+                continue;
+            }
+        }
+
+        order.push_back(next);
+    }
+
+    return order;
+}
+
+//
+// Rebuilds Container in the given order.
+//
+template <typename TContainer, typename TOrder>
+void flat_apply_order(TContainer& Container, const TOrder& Order)
+{
+    TContainer result(Container.get_allocator());
+    result.reserve(Order.size());
+    for (auto index : Order)
+    {
+        result.push_back(std::move_if_noexcept(Container[index]));
+    }
+    Container.swap(result);
+}
+
+template <typename TKey, typename TCompare, typename TContainer, bool t_Multi>
+class flat_tree
+{
+public:
+
+    using key_type = TKey;
+    using value_type = TKey;
+    using key_compare = TCompare;
+    using value_compare = TCompare;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+    using container_type = TContainer;
+    using iterator = typename TContainer::const_iterator;
+    using const_iterator = typename TContainer::const_iterator;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    using sorted_type = std::conditional_t<t_Multi, sorted_equivalent_t, sorted_unique_t>;
+
+    flat_tree() = default;
+
+    explicit flat_tree(const key_compare& Compare) : m_Compare(Compare)
+    {
+    }
+
+    explicit flat_tree(container_type Container, const key_compare& Compare = key_compare())
+        : m_Compare(Compare),
+          m_Container(std::move(Container))
+    {
+        order_from(0, false);
+    }
+
+    flat_tree(sorted_type, container_type Container, const key_compare& Compare = key_compare())
+        : m_Compare(Compare),
+          m_Container(std::move(Container))
+    {
+    }
+
+    template <typename TInputIt>
+    flat_tree(TInputIt First, TInputIt Last, const key_compare& Compare = key_compare())
+        : m_Compare(Compare)
+    {
+        insert(First, Last);
+    }
+
+    template <typename TInputIt>
+    flat_tree(sorted_type Sorted, TInputIt First, TInputIt Last, const key_compare& Compare = key_compare())
+        : m_Compare(Compare)
+    {
+        insert(Sorted, First, Last);
+    }
+
+    flat_tree(std::initializer_list<value_type> Values, const key_compare& Compare = key_compare())
+        : flat_tree(Values.begin(), Values.end(), Compare)
+    {
+    }
+
+    flat_tree(sorted_type Sorted, std::initializer_list<value_type> Values, const key_compare& Compare = key_compare())
+        : flat_tree(Sorted, Values.begin(), Values.end(), Compare)
+    {
+    }
+
+    flat_tree& operator=(std::initializer_list<value_type> Values)
+    {
+        clear();
+        insert(Values);
+        return *this;
+    }
+
+    iterator begin() const noexcept
+    {
+        return m_Container.begin();
+    }
+
+    iterator end() const noexcept
+    {
+        return m_Container.end();
+    }
+
+    const_iterator cbegin() const noexcept
+    {
+        return m_Container.cbegin();
+    }
+
+    const_iterator cend() const noexcept
+    {
+        return m_Container.cend();
+    }
+
+    reverse_iterator rbegin() const noexcept
+    {
+        return reverse_iterator(end());
+    }
+
+    reverse_iterator rend() const noexcept
+    {
+        return reverse_iterator(begin());
+    }
+
+    const_reverse_iterator crbegin() const noexcept
+    {
+        return rbegin();
+    }
+
+    const_reverse_iterator crend() const noexcept
+    {
+        return rend();
+    }
+
+    _NODISCARD
+    bool empty() const noexcept
+    {
+        return m_Container.empty();
+    }
+
+    size_type size() const noexcept
+    {
+        return m_Container.size();
+    }
+
+    size_type max_size() const noexcept
+    {
+        return m_Container.max_size();
+    }
+
+    size_type capacity() const noexcept
+    {
+        return m_Container.capacity();
+    }
+
+    void reserve(size_type Count)
+    {
+        m_Container.reserve(Count);
+    }
+
+    void shrink_to_fit()
+    {
+        m_Container.shrink_to_fit();
+    }
+
+    template <typename... TArgs>
+    auto emplace(TArgs&&... Args)
+    {
+        return insert(value_type(std::forward<TArgs>(Args)...));
+    }
+
+    template <typename... TArgs>
+    iterator emplace_hint(const_iterator, TArgs&&... Args)
+    {
+        if constexpr (t_Multi)
+        {
+            return emplace(std::forward<TArgs>(Args)...);
+        }
+        else
+        {
+            return emplace(std::forward<TArgs>(Args)...).first;
+        }
+    }
+
+    auto insert(const value_type& Value)
+    {
+        return insert_value(Value);
+    }
+
+    auto insert(value_type&& Value)
+    {
+        return insert_value(std::move(Value));
+    }
+
+    iterator insert(const_iterator Hint, const value_type& Value)
+    {
+        return emplace_hint(Hint, Value);
+    }
+
+    iterator insert(const_iterator Hint, value_type&& Value)
+    {
+        return emplace_hint(Hint, std::move(Value));
+    }
+
+    template <typename TInputIt>
+    void insert(TInputIt First, TInputIt Last)
+    {
+        insert_range(First, Last, false);
+    }
+
+    template <typename TInputIt>
+    void insert(sorted_type, TInputIt First, TInputIt Last)
+    {
+        insert_range(First, Last, true);
+    }
+
+    void insert(std::initializer_list<value_type> Values)
+    {
+        insert(Values.begin(), Values.end());
+    }
+
+    void insert(sorted_type Sorted, std::initializer_list<value_type> Values)
+    {
+        insert(Sorted, Values.begin(), Values.end());
+    }
+
+    container_type extract() &&
+    {
+        return std::move(m_Container);
+    }
+
+    //
+    // Takes a container which is already sorted (and unique for the unique
+    // containers).
+    //
+    void replace(container_type&& Container)
+    {
+        m_Container = std::move(Container);
+    }
+
+    iterator erase(const_iterator Position)
+    {
+        return m_Container.erase(Position);
+    }
+
+    iterator erase(const_iterator First, const_iterator Last)
+    {
+        return m_Container.erase(First, Last);
+    }
+
+    size_type erase(const key_type& Key)
+    {
+        auto range = equal_range(Key);
+        auto count = static_cast<size_type>(std::distance(range.first, range.second));
+        m_Container.erase(range.first, range.second);
+        return count;
+    }
+
+    void swap(flat_tree& Other) noexcept
+    {
+        std::swap(m_Compare, Other.m_Compare);
+        m_Container.swap(Other.m_Container);
+    }
+
+    void clear() noexcept
+    {
+        m_Container.clear();
+    }
+
+    key_compare key_comp() const
+    {
+        return m_Compare;
+    }
+
+    value_compare value_comp() const
+    {
+        return m_Compare;
+    }
+
+    iterator find(const key_type& Key) const
+    {
+        auto it = lower_bound(Key);
+        if ((it == end()) || m_Compare(Key, *it))
+        {
+            return end();
+        }
+        return it;
+    }
+
+    size_type count(const key_type& Key) const
+    {
+        auto range = equal_range(Key);
+        return static_cast<size_type>(std::distance(range.first, range.second));
+    }
+
+    bool contains(const key_type& Key) const
+    {
+        return (find(Key) != end());
+    }
+
+    iterator lower_bound(const key_type& Key) const
+    {
+        return std::lower_bound(begin(), end(), Key, m_Compare);
+    }
+
+    iterator upper_bound(const key_type& Key) const
+    {
+        return std::upper_bound(begin(), end(), Key, m_Compare);
+    }
+
+    std::pair<iterator, iterator> equal_range(const key_type& Key) const
+    {
+        return std::equal_range(begin(), end(), Key, m_Compare);
+    }
+
+    friend bool operator==(const flat_tree& Left, const flat_tree& Right)
+    {
+        return std::equal(Left.begin(), Left.end(), Right.begin(), Right.end());
+    }
+
+    friend bool operator!=(const flat_tree& Left, const flat_tree& Right)
+    {
+        return !(Left == Right);
+    }
+
+private:
+
+    template <typename TValue>
+    auto insert_value(TValue&& Value)
+    {
+        if constexpr (t_Multi)
+        {
+            auto position = upper_bound(Value);
+            return m_Container.insert(position, std::forward<TValue>(Value));
+        }
+        else
+        {
+            auto position = lower_bound(Value);
+            if ((position != end()) && !m_Compare(Value, *position))
+            {
+                return std::pair<iterator, bool>(position, false);
+            }
+            return std::pair<iterator, bool>(m_Container.insert(position, std::forward<TValue>(Value)), true);
+        }
+    }
+
+    template <typename TInputIt>
+    void insert_range(TInputIt First, TInputIt Last, bool Sorted)
+    {
+        auto existing = m_Container.size();
+        m_Container.insert(m_Container.end(), First, Last);
+        order_from(existing, Sorted);
+    }
+
+    //
+    // Merges the elements from First on into the sorted elements before it.
+    // On failure the appended elements are removed.
+    //
+    void order_from(size_type First, bool Sorted)
+    {
+        if (First == m_Container.size())
+        {
+            return;
+        }
+
+        try
+        {
+            auto order = flat_merge_order<t_Multi>(m_Container, First, Sorted, m_Compare);
+            flat_apply_order(m_Container, order);
+        }
+        catch (...)
+        {
+            m_Container.erase(m_Container.begin() + First, m_Container.end());
+            throw;
+        }
+    }
+
+    key_compare m_Compare{};
+    container_type m_Container{};
+
+};
+
+}
+
+}
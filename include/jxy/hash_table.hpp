@@ -0,0 +1,1047 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/hash_table.hpp
+// Author:   Johnny Shaw
+// Abstract: Hash table with integer load factor math
+//
+// The std::unordered_ containers keep their load factor as a float and call
+// ceilf when deciding to rehash, floating point state is not something to
+// touch casually in kernel context. jxy::details::hash_table implements the
+// same interface with all of that math in integers. Load factors are whole
+// percentages, 100 is an average of one element per bucket (the std default
+// of 1.0f).
+//
+// Elements are nodes chained from a power of two bucket array, the bucket
+// of a hash is chosen with Fibonacci hashing (the hash times 2^64 / phi,
+// top bits) so weak hashes (identity hashes of PIDs, aligned pointers) still
+// spread over the buckets. Each node keeps its hash, rehashing never calls
+// the hasher and lookups compare the hash before the key. Equivalent keys
+// (the multi containers) are adjacent in a chain and keep their relative
+// order across a rehash.
+//
+// A default constructed table does not allocate, the bucket array is made
+// on the first insert. Iterators are invalidated by a rehash, references to
+// elements are not.
+//
+#pragma once
+#include <fltKernel.h>
+#include <jxy/memory.hpp>
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+
+namespace jxy
+{
+
+static constexpr size_t hash_default_max_load_factor = 100;
+
+namespace details
+{
+
+static constexpr size_t hash_min_bucket_count = 8;
+
+struct hash_key_identity
+{
+    template <typename T>
+    const T& operator()(const T& Value) const noexcept
+    {
+        return Value;
+    }
+};
+
+struct hash_key_first
+{
+    template <typename T>
+    const typename T::first_type& operator()(const T& Value) const noexcept
+    {
+        return Value.first;
+    }
+};
+
+template <typename TKey,
+          typename TValue,
+          typename TKeyOf,
+          typename THash,
+          typename TKeyEqual,
+          typename TAllocator,
+          bool t_Multi>
+class hash_table
+{
+    struct node
+    {
+        node* Next;
+        size_t Hash;
+        TValue Value;
+    };
+
+    using alloc_traits = std::allocator_traits<TAllocator>;
+    using node_allocator = typename alloc_traits::template rebind_alloc<node>;
+    using node_traits = std::allocator_traits<node_allocator>;
+    using bucket_allocator = typename alloc_traits::template rebind_alloc<node*>;
+    using bucket_traits = std::allocator_traits<bucket_allocator>;
+
+public:
+
+    using key_type = TKey;
+    using value_type = TValue;
+    using hasher = THash;
+    using key_equal = TKeyEqual;
+    using allocator_type = TAllocator;
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using pointer = value_type*;
+    using const_pointer = const value_type*;
+
+    template <bool t_Const>
+    class iterator_base
+    {
+        friend class hash_table;
+
+    public:
+
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = TValue;
+        using difference_type = ptrdiff_t;
+        using pointer = std::conditional_t<t_Const, const TValue*, TValue*>;
+        using reference = std::conditional_t<t_Const, const TValue&, TValue&>;
+
+        constexpr iterator_base() noexcept = default;
+
+        template <bool t_Other, std::enable_if_t<(t_Const && !t_Other), int> = 0>
+        iterator_base(const iterator_base<t_Other>& Other) noexcept
+            : m_Node(Other.m_Node),
+              m_Bucket(Other.m_Bucket),
+              m_BucketEnd(Other.m_BucketEnd)
+        {
+        }
+
+        reference operator*() const noexcept
+        {
+            return m_Node->Value;
+        }
+
+        pointer operator->() const noexcept
+        {
+            return &m_Node->Value;
+        }
+
+        iterator_base& operator++() noexcept
+        {
+            m_Node = m_Node->Next;
+            if (!m_Node)
+            {
+                while (++m_Bucket != m_BucketEnd)
+                {
+                    if (*m_Bucket)
+                    {
+                        m_Node = *m_Bucket;
+                        break;
+                    }
+                }
+            }
+            return *this;
+        }
+
+        iterator_base operator++(int) noexcept
+        {
+            auto previous = *this;
+            ++(*this);
+            return previous;
+        }
+
+        friend bool operator==(const iterator_base& Left, const iterator_base& Right) noexcept
+        {
+            return (Left.m_Node == Right.m_Node);
+        }
+
+        friend bool operator!=(const iterator_base& Left, const iterator_base& Right) noexcept
+        {
+            return (Left.m_Node != Right.m_Node);
+        }
+
+    private:
+
+        iterator_base(node* Node, node* const* Bucket, node* const* BucketEnd) noexcept
+            : m_Node(Node),
+              m_Bucket(Bucket),
+              m_BucketEnd(BucketEnd)
+        {
+        }
+
+        template <bool>
+        friend class iterator_base;
+
+        node* m_Node = nullptr;
+        node* const* m_Bucket = nullptr;
+        node* const* m_BucketEnd = nullptr;
+
+    };
+
+    using iterator = iterator_base<false>;
+    using const_iterator = iterator_base<true>;
+
+    hash_table() noexcept(std::is_nothrow_default_constructible_v<node_allocator>) = default;
+
+    explicit hash_table(
+        size_type BucketCount,
+        const hasher& Hash = hasher(),
+        const key_equal& Equal = key_equal(),
+        const allocator_type& Allocator = allocator_type())
+        : m_Hash(Hash),
+          m_Equal(Equal),
+          m_Alloc(Allocator)
+    {
+        rehash(BucketCount);
+    }
+
+    explicit hash_table(const allocator_type& Allocator) noexcept
+        : m_Alloc(Allocator)
+    {
+    }
+
+    template <typename TInputIt>
+    hash_table(
+        TInputIt First,
+        TInputIt Last,
+        size_type BucketCount = 0,
+        const hasher& Hash = hasher(),
+        const key_equal& Equal = key_equal(),
+        const allocator_type& Allocator = allocator_type())
+        : hash_table(BucketCount, Hash, Equal, Allocator)
+    {
+        insert(First, Last);
+    }
+
+    hash_table(
+        std::initializer_list<value_type> Values,
+        size_type BucketCount = 0,
+        const hasher& Hash = hasher(),
+        const key_equal& Equal = key_equal(),
+        const allocator_type& Allocator = allocator_type())
+        : hash_table(Values.begin(), Values.end(), BucketCount, Hash, Equal, Allocator)
+    {
+    }
+
+    //
+    // Delegates so the destructor frees what was copied if an element copy
+    // throws.
+    //
+    hash_table(const hash_table& Other)
+        : hash_table(0,
+                     Other.m_Hash,
+                     Other.m_Equal,
+                     allocator_type(node_traits::select_on_container_copy_construction(Other.m_Alloc)))
+    {
+        m_MaxLoadFactor = Other.m_MaxLoadFactor;
+        copy_from(Other);
+    }
+
+    hash_table(hash_table&& Other) noexcept
+        : m_Hash(std::move(Other.m_Hash)),
+          m_Equal(std::move(Other.m_Equal)),
+          m_Alloc(std::move(Other.m_Alloc))
+    {
+        steal(Other);
+    }
+
+    ~hash_table() noexcept
+    {
+        destroy();
+    }
+
+    hash_table& operator=(const hash_table& Other)
+    {
+        if (this != &Other)
+        {
+            destroy();
+            if constexpr (node_traits::propagate_on_container_copy_assignment::value)
+            {
+                m_Alloc = Other.m_Alloc;
+            }
+            m_Hash = Other.m_Hash;
+            m_Equal = Other.m_Equal;
+            m_MaxLoadFactor = Other.m_MaxLoadFactor;
+            copy_from(Other);
+        }
+        return *this;
+    }
+
+    hash_table& operator=(hash_table&& Other) noexcept(node_traits::propagate_on_container_move_assignment::value ||
+                                                       node_traits::is_always_equal::value)
+    {
+        if (this == &Other)
+        {
+            return *this;
+        }
+
+        destroy();
+        m_Hash = std::move(Other.m_Hash);
+        m_Equal = std::move(Other.m_Equal);
+
+        if constexpr (node_traits::propagate_on_container_move_assignment::value)
+        {
+            m_Alloc = std::move(Other.m_Alloc);
+            steal(Other);
+        }
+        else if constexpr (node_traits::is_always_equal::value)
+        {
+            steal(Other);
+        }
+        else
+        {
+            if (m_Alloc == Other.m_Alloc)
+            {
+                steal(Other);
+            }
+            else
+            {
+                //
+                // The memory belongs to the other allocator, move the
+                // elements instead.
+                //
+                m_MaxLoadFactor = Other.m_MaxLoadFactor;
+                reserve(Other.size());
+                for (auto& value : Other)
+                {
+                    emplace(std::move(value));
+                }
+                Other.clear();
+            }
+        }
+        return *this;
+    }
+
+    hash_table& operator=(std::initializer_list<value_type> Values)
+    {
+        clear();
+        insert(Values);
+        return *this;
+    }
+
+    allocator_type get_allocator() const noexcept
+    {
+        return allocator_type(m_Alloc);
+    }
+
+    hasher hash_function() const
+    {
+        return m_Hash;
+    }
+
+    key_equal key_eq() const
+    {
+        return m_Equal;
+    }
+
+    iterator begin() noexcept
+    {
+        return make_begin<iterator>();
+    }
+
+    const_iterator begin() const noexcept
+    {
+        return make_begin<const_iterator>();
+    }
+
+    const_iterator cbegin() const noexcept
+    {
+        return begin();
+    }
+
+    iterator end() noexcept
+    {
+        return iterator();
+    }
+
+    const_iterator end() const noexcept
+    {
+        return const_iterator();
+    }
+
+    const_iterator cend() const noexcept
+    {
+        return const_iterator();
+    }
+
+    _NODISCARD
+    bool empty() const noexcept
+    {
+        return (m_Size == 0);
+    }
+
+    size_type size() const noexcept
+    {
+        return m_Size;
+    }
+
+    size_type max_size() const noexcept
+    {
+        return (static_cast<size_type>(-1) / sizeof(node));
+    }
+
+    void clear() noexcept
+    {
+        for (size_type i = 0; i < m_BucketCount; i++)
+        {
+            auto current = m_Buckets[i];
+            while (current)
+            {
+                auto next = current->Next;
+                destroy_node(current);
+                current = next;
+            }
+            m_Buckets[i] = nullptr;
+        }
+        m_Size = 0;
+    }
+
+    template <typename... TArgs>
+    auto emplace(TArgs&&... Args)
+    {
+        node_holder holder(*this, make_node(std::forward<TArgs>(Args)...));
+        const auto& key = TKeyOf()(holder.Node->Value);
+        auto hash = m_Hash(key);
+
+        if constexpr (t_Multi)
+        {
+            reserve_for_insert();
+            return make_iterator(link(holder.release(), hash));
+        }
+        else
+        {
+            auto existing = find_node(key, hash);
+            if (existing)
+            {
+                return std::pair<iterator, bool>(make_iterator(existing), false);
+            }
+
+            reserve_for_insert();
+            return std::pair<iterator, bool>(make_iterator(link(holder.release(), hash)), true);
+        }
+    }
+
+    template <typename... TArgs>
+    iterator emplace_hint(const_iterator, TArgs&&... Args)
+    {
+        if constexpr (t_Multi)
+        {
+            return emplace(std::forward<TArgs>(Args)...);
+        }
+        else
+        {
+            return emplace(std::forward<TArgs>(Args)...).first;
+        }
+    }
+
+    auto insert(const value_type& Value)
+    {
+        return emplace(Value);
+    }
+
+    auto insert(value_type&& Value)
+    {
+        return emplace(std::move(Value));
+    }
+
+    template <typename TPair, std::enable_if_t<std::is_constructible_v<value_type, TPair&&>, int> = 0>
+    auto insert(TPair&& Value)
+    {
+        return emplace(std::forward<TPair>(Value));
+    }
+
+    iterator insert(const_iterator Hint, const value_type& Value)
+    {
+        return emplace_hint(Hint, Value);
+    }
+
+    iterator insert(const_iterator Hint, value_type&& Value)
+    {
+        return emplace_hint(Hint, std::move(Value));
+    }
+
+    template <typename TInputIt>
+    void insert(TInputIt First, TInputIt Last)
+    {
+        for (; First != Last; ++First)
+        {
+            emplace(*First);
+        }
+    }
+
+    void insert(std::initializer_list<value_type> Values)
+    {
+        insert(Values.begin(), Values.end());
+    }
+
+    iterator erase(const_iterator Position) noexcept
+    {
+        auto erased = Position.m_Node;
+        auto next = Position;
+        ++next;
+
+        auto bucket = &m_Buckets[bucket_index(erased->Hash)];
+        while (*bucket != erased)
+        {
+            bucket = &(*bucket)->Next;
+        }
+        *bucket = erased->Next;
+
+        destroy_node(erased);
+        m_Size--;
+
+        return iterator(next.m_Node, next.m_Bucket, next.m_BucketEnd);
+    }
+
+    iterator erase(iterator Position) noexcept
+    {
+        return erase(const_iterator(Position));
+    }
+
+    iterator erase(const_iterator First, const_iterator Last) noexcept
+    {
+        while (First != Last)
+        {
+            First = erase(First);
+        }
+        return iterator(Last.m_Node, Last.m_Bucket, Last.m_BucketEnd);
+    }
+
+    size_type erase(const key_type& Key) noexcept
+    {
+        if (m_Size == 0)
+        {
+            return 0;
+        }
+
+        auto hash = m_Hash(Key);
+        auto link = &m_Buckets[bucket_index(hash)];
+        while (*link && !node_matches(*link, Key, hash))
+        {
+            link = &(*link)->Next;
+        }
+
+        size_type erased = 0;
+        while (*link && node_matches(*link, Key, hash))
+        {
+            auto current = *link;
+            *link = current->Next;
+            destroy_node(current);
+            erased++;
+            if constexpr (!t_Multi)
+            {
+                break;
+            }
+        }
+
+        m_Size -= erased;
+        return erased;
+    }
+
+    void swap(hash_table& Other) noexcept
+    {
+        if constexpr (node_traits::propagate_on_container_swap::value)
+        {
+            std::swap(m_Alloc, Other.m_Alloc);
+        }
+        else if constexpr (!node_traits::is_always_equal::value)
+        {
+            NT_ASSERT(m_Alloc == Other.m_Alloc);
+        }
+        std::swap(m_Hash, Other.m_Hash);
+        std::swap(m_Equal, Other.m_Equal);
+        std::swap(m_Buckets, Other.m_Buckets);
+        std::swap(m_BucketCount, Other.m_BucketCount);
+        std::swap(m_BucketShift, Other.m_BucketShift);
+        std::swap(m_Size, Other.m_Size);
+        std::swap(m_MaxLoadFactor, Other.m_MaxLoadFactor);
+    }
+
+    iterator find(const key_type& Key) noexcept
+    {
+        return make_iterator(find_node(Key, m_Hash(Key)));
+    }
+
+    const_iterator find(const key_type& Key) const noexcept
+    {
+        return make_iterator(find_node(Key, m_Hash(Key)));
+    }
+
+    size_type count(const key_type& Key) const noexcept
+    {
+        auto hash = m_Hash(Key);
+        auto current = find_node(Key, hash);
+        if constexpr (!t_Multi)
+        {
+            return (current ? 1 : 0);
+        }
+        else
+        {
+            size_type result = 0;
+            for (; current && node_matches(current, Key, hash); current = current->Next)
+            {
+                result++;
+            }
+            return result;
+        }
+    }
+
+    bool contains(const key_type& Key) const noexcept
+    {
+        return (find_node(Key, m_Hash(Key)) != nullptr);
+    }
+
+    std::pair<iterator, iterator> equal_range(const key_type& Key) noexcept
+    {
+        auto range = find_range(Key);
+        return { make_iterator(range.first), range_end(range.second) };
+    }
+
+    std::pair<const_iterator, const_iterator> equal_range(const key_type& Key) const noexcept
+    {
+        auto range = find_range(Key);
+        return { make_iterator(range.first), range_end(range.second) };
+    }
+
+    size_type bucket_count() const noexcept
+    {
+        return m_BucketCount;
+    }
+
+    size_type bucket(const key_type& Key) const noexcept
+    {
+        return (m_BucketCount ? bucket_index(m_Hash(Key)) : 0);
+    }
+
+    size_type bucket_size(size_type Bucket) const noexcept
+    {
+        size_type result = 0;
+        for (auto current = m_Buckets[Bucket]; current; current = current->Next)
+        {
+            result++;
+        }
+        return result;
+    }
+
+    //
+    // Percent, 100 is an average of one element per bucket.
+    //
+    size_type load_factor() const noexcept
+    {
+        return (m_BucketCount ? ((m_Size * 100) / m_BucketCount) : 0);
+    }
+
+    size_type max_load_factor() const noexcept
+    {
+        return m_MaxLoadFactor;
+    }
+
+    void max_load_factor(size_type LoadFactor)
+    {
+        NT_ASSERT(LoadFactor > 0);
+        m_MaxLoadFactor = (LoadFactor ? LoadFactor : 1);
+        reserve(m_Size);
+    }
+
+    //
+    // Makes at least BucketCount buckets and enough buckets for the current
+    // size at the maximum load factor.
+    //
+    void rehash(size_type BucketCount)
+    {
+        auto required = buckets_for(m_Size);
+        if (BucketCount < required)
+        {
+            BucketCount = required;
+        }
+
+        if (BucketCount == 0)
+        {
+            return;
+        }
+
+        size_type count = details::hash_min_bucket_count;
+        while (count < BucketCount)
+        {
+            count *= 2;
+        }
+
+        if (count != m_BucketCount)
+        {
+            relink(count);
+        }
+    }
+
+    void reserve(size_type Count)
+    {
+        if (buckets_for(Count) > m_BucketCount)
+        {
+            rehash(buckets_for(Count));
+        }
+    }
+
+protected:
+
+    //
+    // Constructs the value from the arguments only if the key is not found,
+    // the unique containers use this for try_emplace.
+    //
+    template <typename... TArgs>
+    std::pair<iterator, bool> emplace_key(const key_type& Key, TArgs&&... Args)
+    {
+        auto hash = m_Hash(Key);
+        auto existing = find_node(Key, hash);
+        if (existing)
+        {
+            return { make_iterator(existing), false };
+        }
+
+        node_holder holder(*this, make_node(std::forward<TArgs>(Args)...));
+        reserve_for_insert();
+        return { make_iterator(link(holder.release(), hash)), true };
+    }
+
+private:
+
+    //
+    // Destroys a node not yet linked into the table.
+    //
+    struct node_holder
+    {
+        node_holder(hash_table& Table, node* Node) noexcept : Table(Table), Node(Node)
+        {
+        }
+
+        ~node_holder() noexcept
+        {
+            if (Node)
+            {
+                Table.destroy_node(Node);
+            }
+        }
+
+        node* release() noexcept
+        {
+            return std::exchange(Node, nullptr);
+        }
+
+        hash_table& Table;
+        node* Node;
+    };
+
+    template <typename... TArgs>
+    node* make_node(TArgs&&... Args)
+    {
+        auto created = node_traits::allocate(m_Alloc, 1);
+        try
+        {
+            node_traits::construct(m_Alloc, std::addressof(created->Value), std::forward<TArgs>(Args)...);
+        }
+        catch (...)
+        {
+            node_traits::deallocate(m_Alloc, created, 1);
+            throw;
+        }
+        created->Next = nullptr;
+        created->Hash = 0;
+        return created;
+    }
+
+    void destroy_node(node* Node) noexcept
+    {
+        node_traits::destroy(m_Alloc, std::addressof(Node->Value));
+        node_traits::deallocate(m_Alloc, Node, 1);
+    }
+
+    //
+    // The top bits of the hash times 2^64 / phi.
+    //
+    size_type bucket_index(size_t Hash) const noexcept
+    {
+        if constexpr (sizeof(size_t) == 8)
+        {
+            return static_cast<size_type>((Hash * static_cast<size_t>(0x9e3779b97f4a7c15ull)) >> m_BucketShift);
+        }
+        else
+        {
+            return static_cast<size_type>((Hash * static_cast<size_t>(0x9e3779b9ul)) >> m_BucketShift);
+        }
+    }
+
+    size_type buckets_for(size_type Count) const noexcept
+    {
+        return (((Count * 100) + m_MaxLoadFactor - 1) / m_MaxLoadFactor);
+    }
+
+    bool node_matches(const node* Node, const key_type& Key, size_t Hash) const
+    {
+        return ((Node->Hash == Hash) && m_Equal(TKeyOf()(Node->Value), Key));
+    }
+
+    node* find_node(const key_type& Key, size_t Hash) const
+    {
+        if (m_Size == 0)
+        {
+            return nullptr;
+        }
+
+        for (auto current = m_Buckets[bucket_index(Hash)]; current; current = current->Next)
+        {
+            if (node_matches(current, Key, Hash))
+            {
+                return current;
+            }
+        }
+        return nullptr;
+    }
+
+    //
+    // The first and the last node with the key.
+    //
+    std::pair<node*, node*> find_range(const key_type& Key) const
+    {
+        auto hash = m_Hash(Key);
+        auto first = find_node(Key, hash);
+        if (!first)
+        {
+            return { nullptr, nullptr };
+        }
+
+        auto last = first;
+        if constexpr (t_Multi)
+        {
+            while (last->Next && node_matches(last->Next, Key, hash))
+            {
+                last = last->Next;
+            }
+        }
+        return { first, last };
+    }
+
+    //
+    // The range ends at the element following Last, which may be in a later
+    // bucket.
+    //
+    iterator range_end(node* Last) const noexcept
+    {
+        auto result = make_iterator(Last);
+        if (Last)
+        {
+            ++result;
+        }
+        return result;
+    }
+
+    template <typename TIterator>
+    TIterator make_begin() const noexcept
+    {
+        if (m_Size == 0)
+        {
+            return TIterator();
+        }
+
+        auto bucket = m_Buckets;
+        while (!*bucket)
+        {
+            bucket++;
+        }
+        return TIterator(*bucket, bucket, (m_Buckets + m_BucketCount));
+    }
+
+    iterator make_iterator(node* Node) const noexcept
+    {
+        if (!Node)
+        {
+            return iterator();
+        }
+        return iterator(Node, (m_Buckets + bucket_index(Node->Hash)), (m_Buckets + m_BucketCount));
+    }
+
+    void reserve_for_insert()
+    {
+        if (((m_Size + 1) * 100) > (m_BucketCount * m_MaxLoadFactor))
+        {
+            auto required = buckets_for(m_Size + 1);
+            rehash((m_BucketCount * 2) > required ? (m_BucketCount * 2) : required);
+        }
+    }
+
+    node* link(node* Node, size_t Hash) noexcept
+    {
+        Node->Hash = Hash;
+        auto bucket = &m_Buckets[bucket_index(Hash)];
+
+        if constexpr (t_Multi)
+        {
+            //
+            // Keep equivalent keys together, after the last one.
+            //
+            for (auto current = *bucket; current; current = current->Next)
+            {
+                if (node_matches(current, TKeyOf()(Node->Value), Hash))
+                {
+                    while (current->Next && node_matches(current->Next, TKeyOf()(Node->Value), Hash))
+                    {
+                        current = current->Next;
+                    }
+                    Node->Next = current->Next;
+                    current->Next = Node;
+                    m_Size++;
+                    return Node;
+                }
+            }
+        }
+
+        Node->Next = *bucket;
+        *bucket = Node;
+        m_Size++;
+        return Node;
+    }
+
+    void relink(size_type BucketCount)
+    {
+        bucket_allocator allocator(m_Alloc);
+        auto buckets = bucket_traits::allocate(allocator, BucketCount);
+        for (size_type i = 0; i < BucketCount; i++)
+        {
+            buckets[i] = nullptr;
+        }
+
+        ULONG shift = (sizeof(size_t) * 8);
+        for (auto count = BucketCount; count > 1; count /= 2)
+        {
+            shift--;
+        }
+
+        auto oldBuckets = m_Buckets;
+        auto oldCount = m_BucketCount;
+
+        m_Buckets = buckets;
+        m_BucketCount = BucketCount;
+        m_BucketShift = shift;
+
+        for (size_type i = 0; i < oldCount; i++)
+        {
+            auto current = oldBuckets[i];
+            while (current)
+            {
+                //
+                // Move runs of equivalent keys as a block to keep their
+                // order.
+                //
+                auto last = current;
+                if constexpr (t_Multi)
+                {
+                    while (last->Next &&
+                           node_matches(last->Next, TKeyOf()(current->Value), current->Hash))
+                    {
+                        last = last->Next;
+                    }
+                }
+
+                auto next = last->Next;
+                auto bucket = &m_Buckets[bucket_index(current->Hash)];
+                last->Next = *bucket;
+                *bucket = current;
+                current = next;
+            }
+        }
+
+        if (oldBuckets)
+        {
+            bucket_traits::deallocate(allocator, oldBuckets, oldCount);
+        }
+    }
+
+    void copy_from(const hash_table& Other)
+    {
+        if (Other.m_Size == 0)
+        {
+            return;
+        }
+
+        rehash(Other.m_BucketCount);
+
+        //
+        // Linking each node again keeps equivalent keys together and in
+        // order.
+        //
+        for (const auto& value : Other)
+        {
+            node_holder holder(*this, make_node(value));
+            link(holder.release(), m_Hash(TKeyOf()(value)));
+        }
+    }
+
+    void steal(hash_table& Other) noexcept
+    {
+        m_Buckets = std::exchange(Other.m_Buckets, nullptr);
+        m_BucketCount = std::exchange(Other.m_BucketCount, 0);
+        m_BucketShift = Other.m_BucketShift;
+        m_Size = std::exchange(Other.m_Size, 0);
+        m_MaxLoadFactor = Other.m_MaxLoadFactor;
+    }
+
+    void destroy() noexcept
+    {
+        clear();
+        if (m_Buckets)
+        {
+            bucket_allocator allocator(m_Alloc);
+            bucket_traits::deallocate(allocator, m_Buckets, m_BucketCount);
+            m_Buckets = nullptr;
+            m_BucketCount = 0;
+        }
+    }
+
+    hasher m_Hash{};
+    key_equal m_Equal{};
+    node_allocator m_Alloc{};
+    node** m_Buckets = nullptr;
+    size_type m_BucketCount = 0;
+    ULONG m_BucketShift = 0;
+    size_type m_Size = 0;
+    size_type m_MaxLoadFactor = hash_default_max_load_factor;
+
+};
+
+template <typename TKey, typename TValue, typename TKeyOf, typename THash, typename TKeyEqual, typename TAllocator, bool t_Multi>
+bool operator==(
+    const hash_table<TKey, TValue, TKeyOf, THash, TKeyEqual, TAllocator, t_Multi>& Left,
+    const hash_table<TKey, TValue, TKeyOf, THash, TKeyEqual, TAllocator, t_Multi>& Right)
+{
+    if (Left.size() != Right.size())
+    {
+        return false;
+    }
+
+    for (auto it = Left.begin(); it != Left.end();)
+    {
+        const auto& key = TKeyOf()(*it);
+        auto leftRange = Left.equal_range(key);
+        auto rightRange = Right.equal_range(key);
+        if (!std::is_permutation(leftRange.first, leftRange.second, rightRange.first, rightRange.second))
+        {
+            return false;
+        }
+        it = leftRange.second;
+    }
+
+    return true;
+}
+
+template <typename TKey, typename TValue, typename TKeyOf, typename THash, typename TKeyEqual, typename TAllocator, bool t_Multi>
+bool operator!=(
+    const hash_table<TKey, TValue, TKeyOf, THash, TKeyEqual, TAllocator, t_Multi>& Left,
+    const hash_table<TKey, TValue, TKeyOf, THash, TKeyEqual, TAllocator, t_Multi>& Right)
+{
+    return !(Left == Right);
+}
+
+}
+
+}
@@ -0,0 +1,557 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/id_table.hpp
+// Author:   Johnny Shaw
+// Abstract: Direct indexed table for process and thread IDs
+//
+// Process and thread IDs are handle table indices, small integers which are
+// multiples of 4. jxy::id_table indexes a directory of pages with the ID,
+// ID / 4 selects a page and a slot in it, a lookup is two loads and no
+// comparisons. Pages are allocated when the first ID in their range is
+// inserted and freed when the last one is erased, one empty page is kept
+// to avoid reallocating when an ID range is entered and left repeatedly.
+// The directory grows to cover the largest ID inserted.
+//
+// The table suits IDs drawn from the whole system, such as the global
+// process and thread maps. The IDs of a single process's threads are
+// scattered, each would likely get a page of its own.
+//
+// The interface follows jxy::map for the members the maps use, the elements
+// are std::pair<const uint32_t, T> and iteration is in ID order. IDs which
+// aren't multiples of 4 would share a slot with the ID below them, inserting
+// one throws std::invalid_argument and looking one up finds nothing.
+//
+// jxylib                   STL equivalent
+// ---------------------------------------------------------------------------
+// jxy::id_table            None
+//
+#pragma once
+#include <fltKernel.h>
+#include <jxy/memory.hpp>
+#include <jxy/vector.hpp>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <intrin.h>
+
+namespace jxy
+{
+
+template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag, uint32_t t_PageSlots = 128>
+class id_table
+{
+    static_assert((t_PageSlots >= 32) && ((t_PageSlots & (t_PageSlots - 1)) == 0),
+                  "t_PageSlots must be a power of two of at least 32");
+
+public:
+
+    static constexpr POOL_TYPE pool_type = t_PoolType;
+    static constexpr ULONG pool_tag = t_PoolTag;
+
+    using key_type = uint32_t;
+    using mapped_type = T;
+    using value_type = std::pair<const key_type, T>;
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+
+private:
+
+    static constexpr uint32_t page_slots = t_PageSlots;
+    static constexpr uint32_t bitmap_words = (t_PageSlots / 32);
+
+    struct page
+    {
+        uint32_t Bitmap[bitmap_words];
+        uint32_t Count;
+        alignas(value_type) unsigned char Storage[sizeof(value_type) * t_PageSlots];
+
+        value_type* slot(uint32_t Slot) noexcept
+        {
+            return reinterpret_cast<value_type*>(Storage) + Slot;
+        }
+
+        bool occupied(uint32_t Slot) const noexcept
+        {
+            return ((Bitmap[Slot / 32] & (1ul << (Slot % 32))) != 0);
+        }
+    };
+
+    using page_allocator = allocator<page, t_PoolType, t_PoolTag>;
+    using page_traits = std::allocator_traits<page_allocator>;
+    using directory_type = vector<page*, t_PoolType, t_PoolTag>;
+
+    static uint32_t slot_index(key_type Id) noexcept
+    {
+        return (Id / 4);
+    }
+
+    static uint32_t lowest_bit(uint32_t Mask) noexcept
+    {
+        unsigned long index;
+        _BitScanForward(&index, Mask);
+        return static_cast<uint32_t>(index);
+    }
+
+public:
+
+    template <bool t_Const>
+    class iterator_base
+    {
+        friend class id_table;
+
+    public:
+
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = typename id_table::value_type;
+        using difference_type = ptrdiff_t;
+        using pointer = std::conditional_t<t_Const, const value_type*, value_type*>;
+        using reference = std::conditional_t<t_Const, const value_type&, value_type&>;
+
+        iterator_base() = default;
+
+        template <bool t_Other, std::enable_if_t<(t_Const && !t_Other), int> = 0>
+        iterator_base(const iterator_base<t_Other>& Other) noexcept
+            : m_Directory(Other.m_Directory),
+              m_Index(Other.m_Index)
+        {
+        }
+
+        reference operator*() const noexcept
+        {
+            return *current();
+        }
+
+        pointer operator->() const noexcept
+        {
+            return current();
+        }
+
+        iterator_base& operator++() noexcept
+        {
+            m_Index = next_occupied(*m_Directory, (m_Index + 1));
+            return *this;
+        }
+
+        iterator_base operator++(int) noexcept
+        {
+            auto previous = *this;
+            ++(*this);
+            return previous;
+        }
+
+        friend bool operator==(const iterator_base& Left, const iterator_base& Right) noexcept
+        {
+            return (Left.m_Index == Right.m_Index);
+        }
+
+        friend bool operator!=(const iterator_base& Left, const iterator_base& Right) noexcept
+        {
+            return (Left.m_Index != Right.m_Index);
+        }
+
+    private:
+
+        template <bool>
+        friend class iterator_base;
+
+        iterator_base(const directory_type* Directory, size_t Index) noexcept
+            : m_Directory(Directory),
+              m_Index(Index)
+        {
+        }
+
+        pointer current() const noexcept
+        {
+            return (*m_Directory)[m_Index / page_slots]->slot(static_cast<uint32_t>(m_Index % page_slots));
+        }
+
+        const directory_type* m_Directory = nullptr;
+        size_t m_Index = 0;
+
+    };
+
+    using iterator = iterator_base<false>;
+    using const_iterator = iterator_base<true>;
+
+    id_table() = default;
+
+    id_table(const id_table& Other) : id_table()
+    {
+        m_Directory.reserve(Other.m_Directory.size());
+        for (const auto& entry : Other)
+        {
+            try_emplace(entry.first, entry.second);
+        }
+    }
+
+    id_table(id_table&& Other) noexcept
+        : m_Directory(std::move(Other.m_Directory)),
+          m_Spare(std::exchange(Other.m_Spare, nullptr)),
+          m_Size(std::exchange(Other.m_Size, 0))
+    {
+        Other.m_Directory.clear();
+    }
+
+    id_table& operator=(const id_table& Other)
+    {
+        if (this != &Other)
+        {
+            id_table copy(Other);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    id_table& operator=(id_table&& Other) noexcept
+    {
+        if (this != &Other)
+        {
+            id_table moved(std::move(Other));
+            swap(moved);
+        }
+        return *this;
+    }
+
+    ~id_table() noexcept
+    {
+        clear();
+        release_spare();
+    }
+
+    iterator begin() noexcept
+    {
+        return iterator(&m_Directory, next_occupied(m_Directory, 0));
+    }
+
+    const_iterator begin() const noexcept
+    {
+        return const_iterator(&m_Directory, next_occupied(m_Directory, 0));
+    }
+
+    iterator end() noexcept
+    {
+        return iterator(&m_Directory, end_index());
+    }
+
+    const_iterator end() const noexcept
+    {
+        return const_iterator(&m_Directory, end_index());
+    }
+
+    const_iterator cbegin() const noexcept
+    {
+        return begin();
+    }
+
+    const_iterator cend() const noexcept
+    {
+        return end();
+    }
+
+    _NODISCARD
+    bool empty() const noexcept
+    {
+        return (m_Size == 0);
+    }
+
+    size_type size() const noexcept
+    {
+        return m_Size;
+    }
+
+    //
+    // The number of pages allocated, not counting the spare.
+    //
+    size_type page_count() const noexcept
+    {
+        size_type count = 0;
+        for (auto entry : m_Directory)
+        {
+            count += (entry ? 1 : 0);
+        }
+        return count;
+    }
+
+    template <typename... TArgs>
+    std::pair<iterator, bool> try_emplace(key_type Id, TArgs&&... Args)
+    {
+        if ((Id % 4) != 0)
+        {
+            throw std::invalid_argument("id_table<T> key is not a multiple of 4");
+        }
+
+        auto index = slot_index(Id);
+        auto pageIndex = (index / page_slots);
+        auto slot = (index % page_slots);
+
+        if (pageIndex >= m_Directory.size())
+        {
+            m_Directory.resize(static_cast<size_t>(pageIndex) + 1, nullptr);
+        }
+
+        auto& entry = m_Directory[pageIndex];
+        if (entry && entry->occupied(slot))
+        {
+            return { iterator(&m_Directory, index), false };
+        }
+
+        bool created = false;
+        if (!entry)
+        {
+            entry = acquire_page();
+            created = true;
+        }
+
+        try
+        {
+            ::new (static_cast<void*>(entry->slot(slot))) value_type(
+                std::piecewise_construct,
+                std::forward_as_tuple(Id),
+                std::forward_as_tuple(std::forward<TArgs>(Args)...));
+        }
+        catch (...)
+        {
+            if (created)
+            {
+                release_page(std::exchange(entry, nullptr));
+            }
+            throw;
+        }
+
+        entry->Bitmap[slot / 32] |= (1ul << (slot % 32));
+        entry->Count++;
+        m_Size++;
+
+        return { iterator(&m_Directory, index), true };
+    }
+
+    std::pair<iterator, bool> insert(const value_type& Value)
+    {
+        return try_emplace(Value.first, Value.second);
+    }
+
+    template <typename TMapped>
+    std::pair<iterator, bool> insert_or_assign(key_type Id, TMapped&& Value)
+    {
+        auto result = try_emplace(Id, std::forward<TMapped>(Value));
+        if (!result.second)
+        {
+            result.first->second = std::forward<TMapped>(Value);
+        }
+        return result;
+    }
+
+    mapped_type& operator[](key_type Id)
+    {
+        return try_emplace(Id).first->second;
+    }
+
+    iterator find(key_type Id) noexcept
+    {
+        auto value = lookup(Id);
+        return (value ? iterator(&m_Directory, slot_index(Id)) : end());
+    }
+
+    const_iterator find(key_type Id) const noexcept
+    {
+        auto value = lookup(Id);
+        return (value ? const_iterator(&m_Directory, slot_index(Id)) : end());
+    }
+
+    size_type count(key_type Id) const noexcept
+    {
+        return (lookup(Id) ? 1 : 0);
+    }
+
+    bool contains(key_type Id) const noexcept
+    {
+        return (lookup(Id) != nullptr);
+    }
+
+    iterator erase(const_iterator Position) noexcept
+    {
+        auto index = Position.m_Index;
+        erase_slot(index);
+        return iterator(&m_Directory, next_occupied(m_Directory, index + 1));
+    }
+
+    iterator erase(iterator Position) noexcept
+    {
+        return erase(const_iterator(Position));
+    }
+
+    size_type erase(key_type Id) noexcept
+    {
+        if (!lookup(Id))
+        {
+            return 0;
+        }
+        erase_slot(slot_index(Id));
+        return 1;
+    }
+
+    //
+    // Erases the elements and frees the pages, the directory is kept.
+    //
+    void clear() noexcept
+    {
+        for (auto& entry : m_Directory)
+        {
+            if (entry)
+            {
+                destroy_page(std::exchange(entry, nullptr));
+            }
+        }
+        m_Size = 0;
+    }
+
+    //
+    // Frees the spare page and the directory entries past the last page.
+    //
+    void shrink_to_fit()
+    {
+        release_spare();
+        while (!m_Directory.empty() && !m_Directory.back())
+        {
+            m_Directory.pop_back();
+        }
+        m_Directory.shrink_to_fit();
+    }
+
+    void swap(id_table& Other) noexcept
+    {
+        m_Directory.swap(Other.m_Directory);
+        std::swap(m_Spare, Other.m_Spare);
+        std::swap(m_Size, Other.m_Size);
+    }
+
+private:
+
+    value_type* lookup(key_type Id) const noexcept
+    {
+        auto index = slot_index(Id);
+        auto pageIndex = (index / page_slots);
+        if (pageIndex >= m_Directory.size())
+        {
+            return nullptr;
+        }
+
+        auto entry = m_Directory[pageIndex];
+        auto slot = (index % page_slots);
+        if (!entry || !entry->occupied(slot))
+        {
+            return nullptr;
+        }
+
+        auto value = entry->slot(slot);
+        return ((value->first == Id) ? value : nullptr);
+    }
+
+    size_t end_index() const noexcept
+    {
+        return (m_Directory.size() * page_slots);
+    }
+
+    //
+    // The index of the first element at or after Index, or the end index.
+    //
+    static size_t next_occupied(const directory_type& Directory, size_t Index) noexcept
+    {
+        for (auto pageIndex = (Index / page_slots); pageIndex < Directory.size(); pageIndex++)
+        {
+            auto entry = Directory[pageIndex];
+            if (entry)
+            {
+                auto first = ((pageIndex == (Index / page_slots)) ? static_cast<uint32_t>(Index % page_slots) : 0);
+                for (auto word = (first / 32); word < bitmap_words; word++)
+                {
+                    auto bits = entry->Bitmap[word];
+                    if (word == (first / 32))
+                    {
+                        bits &= (~0ul << (first % 32));
+                    }
+                    if (bits)
+                    {
+                        return ((pageIndex * page_slots) + (word * 32) + lowest_bit(bits));
+                    }
+                }
+            }
+        }
+        return (Directory.size() * page_slots);
+    }
+
+    void erase_slot(size_t Index) noexcept
+    {
+        auto& entry = m_Directory[Index / page_slots];
+        auto slot = static_cast<uint32_t>(Index % page_slots);
+        NT_ASSERT(entry && entry->occupied(slot));
+
+        std::destroy_at(entry->slot(slot));
+        entry->Bitmap[slot / 32] &= ~(1ul << (slot % 32));
+        m_Size--;
+        if (--entry->Count == 0)
+        {
+            release_page(std::exchange(entry, nullptr));
+        }
+    }
+
+    page* acquire_page()
+    {
+        auto result = std::exchange(m_Spare, nullptr);
+        if (!result)
+        {
+            page_allocator allocator;
+            result = page_traits::allocate(allocator, 1);
+        }
+        RtlZeroMemory(result->Bitmap, sizeof(result->Bitmap));
+        result->Count = 0;
+        return result;
+    }
+
+    //
+    // Frees an empty page, or keeps it as the spare.
+    //
+    void release_page(page* Page) noexcept
+    {
+        NT_ASSERT(Page->Count == 0);
+        if (!m_Spare)
+        {
+            m_Spare = Page;
+            return;
+        }
+        page_allocator allocator;
+        page_traits::deallocate(allocator, Page, 1);
+    }
+
+    void destroy_page(page* Page) noexcept
+    {
+        for (uint32_t word = 0; word < bitmap_words; word++)
+        {
+            for (auto bits = Page->Bitmap[word]; bits; bits &= (bits - 1))
+            {
+                std::destroy_at(Page->slot((word * 32) + lowest_bit(bits)));
+            }
+        }
+        Page->Count = 0;
+        release_page(Page);
+    }
+
+    void release_spare() noexcept
+    {
+        if (m_Spare)
+        {
+            page_allocator allocator;
+            page_traits::deallocate(allocator, std::exchange(m_Spare, nullptr), 1);
+        }
+    }
+
+    directory_type m_Directory;
+    page* m_Spare = nullptr;
+    size_type m_Size = 0;
+
+};
+
+}
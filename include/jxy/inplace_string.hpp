@@ -0,0 +1,758 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/inplace_string.hpp
+// Author:   Johnny Shaw
+// Abstract: Strings with their characters inside the object
+//
+// The MSVC STL small string buffer holds 15 chars or 7 wchar_ts, most file
+// names are longer than that and cost a pool allocation each.
+//
+// jxy::inplace_basic_string holds up to t_Capacity characters inside the
+// object and never allocates. Assigning more throws std::length_error, use
+// it for strings with a known bound.
+//
+// jxy::inplace_or_heap_basic_string holds up to t_Capacity characters
+// inside the object and moves them to the pool when it grows past that, for
+// strings which are almost always short but have no bound, such as the file
+// part of an image name. It is a jxy::small_vector of the characters and
+// the terminator.
+//
+// Both are null terminated and have the members of std::basic_string most
+// of the drivers use (assign, append, find, rfind, compare, substr,
+// conversion to std::basic_string_view). The iterators are pointers. The
+// object is about t_Capacity characters larger than a std::basic_string,
+// keep the capacity to the common case.
+//
+// jxylib                               STL equivalent
+// ---------------------------------------------------------------------------
+// jxy::inplace_basic_string            None
+// jxy::inplace_string                  None
+// jxy::inplace_wstring                 None
+// jxy::inplace_or_heap_basic_string    None
+// jxy::inplace_or_heap_string          None
+// jxy::inplace_or_heap_wstring         None
+//
+#pragma once
+#include <fltKernel.h>
+#include <jxy/small_vector.hpp>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+
+namespace jxy
+{
+
+namespace details
+{
+
+//
+// The std::basic_string members shared by the inplace strings, over the
+// storage of TDerived. TDerived provides data(), size(), and
+// resize_for_overwrite(Count), which makes room for Count characters,
+// terminates them, and may move the characters.
+//
+template <typename TDerived, typename T>
+class inplace_string_base
+{
+public:
+
+    using traits_type = std::char_traits<T>;
+    using value_type = T;
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using iterator = T*;
+    using const_iterator = const T*;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    using view_type = std::basic_string_view<T>;
+
+    static constexpr size_type npos = static_cast<size_type>(-1);
+
+    TDerived& assign(const T* String, size_type Count) noexcept(false)
+    {
+        if (aliases(String))
+        {
+            //
+            // Part of this string, which is at least as long as Count.
+            //
+            auto first = data();
+            traits_type::move(first, String, Count);
+            derived().resize_for_overwrite(Count);
+        }
+        else
+        {
+            traits_type::copy(derived().resize_for_overwrite(Count), String, Count);
+        }
+        return derived();
+    }
+
+    TDerived& assign(const T* String) noexcept(false)
+    {
+        return assign(String, traits_type::length(String));
+    }
+
+    TDerived& assign(view_type View) noexcept(false)
+    {
+        return assign(View.data(), View.size());
+    }
+
+    TDerived& assign(size_type Count, T Char) noexcept(false)
+    {
+        traits_type::assign(derived().resize_for_overwrite(Count), Count, Char);
+        return derived();
+    }
+
+    template <typename TIterator,
+              typename = std::enable_if_t<!std::is_integral_v<TIterator>>>
+    TDerived& assign(TIterator First, TIterator Last) noexcept(false)
+    {
+        using category = typename std::iterator_traits<TIterator>::iterator_category;
+        if constexpr (std::is_pointer_v<TIterator> &&
+                      std::is_same_v<typename std::iterator_traits<TIterator>::value_type, T>)
+        {
+            return assign(First, static_cast<size_type>(Last - First));
+        }
+        else if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>)
+        {
+            auto count = static_cast<size_type>(std::distance(First, Last));
+            std::copy(First, Last, derived().resize_for_overwrite(count));
+            return derived();
+        }
+        else
+        {
+            clear();
+            for (; First != Last; ++First)
+            {
+                push_back(*First);
+            }
+            return derived();
+        }
+    }
+
+    TDerived& append(const T* String, size_type Count) noexcept(false)
+    {
+        auto oldSize = size();
+        if (aliases(String))
+        {
+            auto offset = static_cast<size_type>(String - data());
+            auto first = derived().resize_for_overwrite(oldSize + Count);
+            traits_type::copy((first + oldSize), (first + offset), Count);
+        }
+        else
+        {
+            auto first = derived().resize_for_overwrite(oldSize + Count);
+            traits_type::copy((first + oldSize), String, Count);
+        }
+        return derived();
+    }
+
+    TDerived& append(const T* String) noexcept(false)
+    {
+        return append(String, traits_type::length(String));
+    }
+
+    TDerived& append(view_type View) noexcept(false)
+    {
+        return append(View.data(), View.size());
+    }
+
+    TDerived& append(size_type Count, T Char) noexcept(false)
+    {
+        auto oldSize = size();
+        traits_type::assign((derived().resize_for_overwrite(oldSize + Count) + oldSize), Count, Char);
+        return derived();
+    }
+
+    TDerived& operator+=(view_type View) noexcept(false)
+    {
+        return append(View);
+    }
+
+    TDerived& operator+=(T Char) noexcept(false)
+    {
+        push_back(Char);
+        return derived();
+    }
+
+    void push_back(T Char) noexcept(false)
+    {
+        append(1, Char);
+    }
+
+    void pop_back() noexcept
+    {
+        NT_ASSERT(!empty());
+        derived().resize_for_overwrite(size() - 1);
+    }
+
+    void resize(size_type Count, T Char = T()) noexcept(false)
+    {
+        auto oldSize = size();
+        if (Count <= oldSize)
+        {
+            derived().resize_for_overwrite(Count);
+        }
+        else
+        {
+            append((Count - oldSize), Char);
+        }
+    }
+
+    void clear() noexcept
+    {
+        derived().resize_for_overwrite(0);
+    }
+
+    TDerived& erase(size_type Offset = 0, size_type Count = npos) noexcept(false)
+    {
+        check_offset(Offset);
+        Count = clamp(Offset, Count);
+        auto first = data();
+        traits_type::move((first + Offset), (first + Offset + Count), (size() - Offset - Count));
+        derived().resize_for_overwrite(size() - Count);
+        return derived();
+    }
+
+    _NODISCARD
+    bool empty() const noexcept
+    {
+        return (size() == 0);
+    }
+
+    size_type size() const noexcept
+    {
+        return derived().size();
+    }
+
+    size_type length() const noexcept
+    {
+        return size();
+    }
+
+    T* data() noexcept
+    {
+        return derived().data();
+    }
+
+    const T* data() const noexcept
+    {
+        return derived().data();
+    }
+
+    const T* c_str() const noexcept
+    {
+        return data();
+    }
+
+    operator view_type() const noexcept
+    {
+        return view_type(data(), size());
+    }
+
+    reference operator[](size_type Index) noexcept
+    {
+        NT_ASSERT(Index <= size());
+        return data()[Index];
+    }
+
+    const_reference operator[](size_type Index) const noexcept
+    {
+        NT_ASSERT(Index <= size());
+        return data()[Index];
+    }
+
+    reference at(size_type Index) noexcept(false)
+    {
+        check_index(Index);
+        return data()[Index];
+    }
+
+    const_reference at(size_type Index) const noexcept(false)
+    {
+        check_index(Index);
+        return data()[Index];
+    }
+
+    reference front() noexcept
+    {
+        return data()[0];
+    }
+
+    const_reference front() const noexcept
+    {
+        return data()[0];
+    }
+
+    reference back() noexcept
+    {
+        return data()[size() - 1];
+    }
+
+    const_reference back() const noexcept
+    {
+        return data()[size() - 1];
+    }
+
+    iterator begin() noexcept
+    {
+        return data();
+    }
+
+    const_iterator begin() const noexcept
+    {
+        return data();
+    }
+
+    iterator end() noexcept
+    {
+        return (data() + size());
+    }
+
+    const_iterator end() const noexcept
+    {
+        return (data() + size());
+    }
+
+    const_iterator cbegin() const noexcept
+    {
+        return begin();
+    }
+
+    const_iterator cend() const noexcept
+    {
+        return end();
+    }
+
+    reverse_iterator rbegin() noexcept
+    {
+        return reverse_iterator(end());
+    }
+
+    const_reverse_iterator rbegin() const noexcept
+    {
+        return const_reverse_iterator(end());
+    }
+
+    reverse_iterator rend() noexcept
+    {
+        return reverse_iterator(begin());
+    }
+
+    const_reverse_iterator rend() const noexcept
+    {
+        return const_reverse_iterator(begin());
+    }
+
+    size_type find(view_type View, size_type Offset = 0) const noexcept
+    {
+        return view().find(View, Offset);
+    }
+
+    size_type find(T Char, size_type Offset = 0) const noexcept
+    {
+        return view().find(Char, Offset);
+    }
+
+    size_type rfind(view_type View, size_type Offset = npos) const noexcept
+    {
+        return view().rfind(View, Offset);
+    }
+
+    size_type rfind(T Char, size_type Offset = npos) const noexcept
+    {
+        return view().rfind(Char, Offset);
+    }
+
+    int compare(view_type View) const noexcept
+    {
+        return view().compare(View);
+    }
+
+    TDerived substr(size_type Offset = 0, size_type Count = npos) const noexcept(false)
+    {
+        check_offset(Offset);
+        TDerived result;
+        result.assign((data() + Offset), clamp(Offset, Count));
+        return result;
+    }
+
+protected:
+
+    inplace_string_base() = default;
+
+private:
+
+    TDerived& derived() noexcept
+    {
+        return static_cast<TDerived&>(*this);
+    }
+
+    const TDerived& derived() const noexcept
+    {
+        return static_cast<const TDerived&>(*this);
+    }
+
+    view_type view() const noexcept
+    {
+        return view_type(data(), size());
+    }
+
+    bool aliases(const T* String) const noexcept
+    {
+        return (std::less_equal<const T*>()(data(), String) &&
+                std::less<const T*>()(String, (data() + size())));
+    }
+
+    size_type clamp(size_type Offset, size_type Count) const noexcept
+    {
+        auto remaining = (size() - Offset);
+        return ((Count < remaining) ? Count : remaining);
+    }
+
+    void check_offset(size_type Offset) const noexcept(false)
+    {
+        if (Offset > size())
+        {
+            throw std::out_of_range("invalid string position");
+        }
+    }
+
+    void check_index(size_type Index) const noexcept(false)
+    {
+        if (Index >= size())
+        {
+            throw std::out_of_range("invalid string position");
+        }
+    }
+
+};
+
+template <typename TLeft, typename TRight, typename T>
+bool operator==(const inplace_string_base<TLeft, T>& Left, const inplace_string_base<TRight, T>& Right) noexcept
+{
+    return (std::basic_string_view<T>(Left) == std::basic_string_view<T>(Right));
+}
+
+template <typename TLeft, typename TRight, typename T>
+bool operator!=(const inplace_string_base<TLeft, T>& Left, const inplace_string_base<TRight, T>& Right) noexcept
+{
+    return !(Left == Right);
+}
+
+template <typename TLeft, typename TRight, typename T>
+bool operator<(const inplace_string_base<TLeft, T>& Left, const inplace_string_base<TRight, T>& Right) noexcept
+{
+    return (std::basic_string_view<T>(Left) < std::basic_string_view<T>(Right));
+}
+
+template <typename TDerived, typename T>
+bool operator==(const inplace_string_base<TDerived, T>& Left, std::basic_string_view<T> Right) noexcept
+{
+    return (std::basic_string_view<T>(Left) == Right);
+}
+
+template <typename TDerived, typename T>
+bool operator==(std::basic_string_view<T> Left, const inplace_string_base<TDerived, T>& Right) noexcept
+{
+    return (Left == std::basic_string_view<T>(Right));
+}
+
+template <typename TDerived, typename T>
+bool operator!=(const inplace_string_base<TDerived, T>& Left, std::basic_string_view<T> Right) noexcept
+{
+    return !(Left == Right);
+}
+
+template <typename TDerived, typename T>
+bool operator!=(std::basic_string_view<T> Left, const inplace_string_base<TDerived, T>& Right) noexcept
+{
+    return !(Left == Right);
+}
+
+template <typename TDerived, typename T>
+bool operator==(const inplace_string_base<TDerived, T>& Left, const T* Right) noexcept
+{
+    return (std::basic_string_view<T>(Left) == std::basic_string_view<T>(Right));
+}
+
+template <typename TDerived, typename T>
+bool operator!=(const inplace_string_base<TDerived, T>& Left, const T* Right) noexcept
+{
+    return !(Left == Right);
+}
+
+}
+
+template <typename T, size_t t_Capacity>
+class inplace_basic_string : public details::inplace_string_base<inplace_basic_string<T, t_Capacity>, T>
+{
+    using base = details::inplace_string_base<inplace_basic_string<T, t_Capacity>, T>;
+    friend base;
+
+public:
+
+    using typename base::size_type;
+    using typename base::view_type;
+
+    inplace_basic_string() noexcept
+    {
+        m_Chars[0] = T();
+    }
+
+    inplace_basic_string(const T* String) noexcept(false)
+        : inplace_basic_string()
+    {
+        base::assign(String);
+    }
+
+    inplace_basic_string(const T* String, size_type Count) noexcept(false)
+        : inplace_basic_string()
+    {
+        base::assign(String, Count);
+    }
+
+    explicit inplace_basic_string(view_type View) noexcept(false)
+        : inplace_basic_string()
+    {
+        base::assign(View);
+    }
+
+    template <typename TIterator,
+              typename = std::enable_if_t<!std::is_integral_v<TIterator>>>
+    inplace_basic_string(TIterator First, TIterator Last) noexcept(false)
+        : inplace_basic_string()
+    {
+        base::assign(First, Last);
+    }
+
+    inplace_basic_string(const inplace_basic_string& Other) noexcept
+        : m_Size(Other.m_Size)
+    {
+        base::traits_type::copy(m_Chars, Other.m_Chars, (m_Size + 1));
+    }
+
+    inplace_basic_string& operator=(const inplace_basic_string& Other) noexcept
+    {
+        if (this != &Other)
+        {
+            m_Size = Other.m_Size;
+            base::traits_type::copy(m_Chars, Other.m_Chars, (m_Size + 1));
+        }
+        return *this;
+    }
+
+    inplace_basic_string& operator=(view_type View) noexcept(false)
+    {
+        return base::assign(View);
+    }
+
+    inplace_basic_string& operator=(const T* String) noexcept(false)
+    {
+        return base::assign(String);
+    }
+
+    T* data() noexcept
+    {
+        return m_Chars;
+    }
+
+    const T* data() const noexcept
+    {
+        return m_Chars;
+    }
+
+    size_type size() const noexcept
+    {
+        return m_Size;
+    }
+
+    static constexpr size_type capacity() noexcept
+    {
+        return t_Capacity;
+    }
+
+    static constexpr size_type max_size() noexcept
+    {
+        return t_Capacity;
+    }
+
+    void reserve(size_type Count) noexcept(false)
+    {
+        if (Count > t_Capacity)
+        {
+            throw std::length_error("inplace_basic_string<T> too long");
+        }
+    }
+
+private:
+
+    T* resize_for_overwrite(size_type Count) noexcept(false)
+    {
+        reserve(Count);
+        m_Size = Count;
+        m_Chars[Count] = T();
+        return m_Chars;
+    }
+
+    size_type m_Size = 0;
+    T m_Chars[t_Capacity + 1];
+
+};
+
+template <size_t t_Capacity>
+using inplace_string = inplace_basic_string<char, t_Capacity>;
+
+template <size_t t_Capacity>
+using inplace_wstring = inplace_basic_string<wchar_t, t_Capacity>;
+
+template <typename T, size_t t_Capacity, POOL_TYPE t_PoolType, ULONG t_PoolTag>
+class inplace_or_heap_basic_string
+    : public details::inplace_string_base<inplace_or_heap_basic_string<T, t_Capacity, t_PoolType, t_PoolTag>, T>
+{
+    using base = details::inplace_string_base<inplace_or_heap_basic_string<T, t_Capacity, t_PoolType, t_PoolTag>, T>;
+    friend base;
+
+public:
+
+    static constexpr POOL_TYPE pool_type = t_PoolType;
+    static constexpr ULONG pool_tag = t_PoolTag;
+
+    using typename base::size_type;
+    using typename base::view_type;
+
+    inplace_or_heap_basic_string() noexcept
+    {
+        m_Chars.emplace_back();
+    }
+
+    inplace_or_heap_basic_string(const T* String) noexcept(false)
+        : inplace_or_heap_basic_string()
+    {
+        base::assign(String);
+    }
+
+    inplace_or_heap_basic_string(const T* String, size_type Count) noexcept(false)
+        : inplace_or_heap_basic_string()
+    {
+        base::assign(String, Count);
+    }
+
+    explicit inplace_or_heap_basic_string(view_type View) noexcept(false)
+        : inplace_or_heap_basic_string()
+    {
+        base::assign(View);
+    }
+
+    template <typename TIterator,
+              typename = std::enable_if_t<!std::is_integral_v<TIterator>>>
+    inplace_or_heap_basic_string(TIterator First, TIterator Last) noexcept(false)
+        : inplace_or_heap_basic_string()
+    {
+        base::assign(First, Last);
+    }
+
+    inplace_or_heap_basic_string(const inplace_or_heap_basic_string&) = default;
+    inplace_or_heap_basic_string& operator=(const inplace_or_heap_basic_string&) = default;
+
+    //
+    // The source is left empty rather than without a terminator.
+    //
+    inplace_or_heap_basic_string(inplace_or_heap_basic_string&& Other) noexcept
+        : m_Chars(std::move(Other.m_Chars))
+    {
+        Other.m_Chars.emplace_back();
+    }
+
+    inplace_or_heap_basic_string& operator=(inplace_or_heap_basic_string&& Other) noexcept
+    {
+        if (this != &Other)
+        {
+            m_Chars = std::move(Other.m_Chars);
+            Other.m_Chars.emplace_back();
+        }
+        return *this;
+    }
+
+    inplace_or_heap_basic_string& operator=(view_type View) noexcept(false)
+    {
+        return base::assign(View);
+    }
+
+    inplace_or_heap_basic_string& operator=(const T* String) noexcept(false)
+    {
+        return base::assign(String);
+    }
+
+    T* data() noexcept
+    {
+        return m_Chars.data();
+    }
+
+    const T* data() const noexcept
+    {
+        return m_Chars.data();
+    }
+
+    size_type size() const noexcept
+    {
+        return (m_Chars.size() - 1);
+    }
+
+    size_type capacity() const noexcept
+    {
+        return (m_Chars.capacity() - 1);
+    }
+
+    size_type max_size() const noexcept
+    {
+        return (m_Chars.max_size() - 1);
+    }
+
+    void reserve(size_type Count) noexcept(false)
+    {
+        m_Chars.reserve(Count + 1);
+    }
+
+    void shrink_to_fit() noexcept(false)
+    {
+        m_Chars.shrink_to_fit();
+    }
+
+    //
+    // True while the characters are in the object.
+    //
+    bool is_inline() const noexcept
+    {
+        return m_Chars.is_inline();
+    }
+
+private:
+
+    T* resize_for_overwrite(size_type Count) noexcept(false)
+    {
+        if (Count >= max_size())
+        {
+            throw std::length_error("inplace_or_heap_basic_string<T> too long");
+        }
+
+        m_Chars.resize_for_overwrite(Count + 1);
+        m_Chars[Count] = T();
+        return m_Chars.data();
+    }
+
+    small_vector<T, (t_Capacity + 1), t_PoolType, t_PoolTag> m_Chars;
+
+};
+
+template <size_t t_Capacity, POOL_TYPE t_PoolType, ULONG t_PoolTag>
+using inplace_or_heap_string = inplace_or_heap_basic_string<char, t_Capacity, t_PoolType, t_PoolTag>;
+
+template <size_t t_Capacity, POOL_TYPE t_PoolType, ULONG t_PoolTag>
+using inplace_or_heap_wstring = inplace_or_heap_basic_string<wchar_t, t_Capacity, t_PoolType, t_PoolTag>;
+
+}
@@ -0,0 +1,281 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/interval_map.hpp
+// Author:   Johnny Shaw
+// Abstract: Maps half open key ranges to values
+//
+// jxy::interval_map maps ranges [Start, End) to values and finds the range
+// containing a key with a binary search, such as the module containing an
+// address. The ranges are kept disjoint, assigning a range which overlaps
+// existing ranges trims or splits them so the latest assignment owns the
+// overlapped keys, as with an image mapped over part of another.
+//
+// The ranges are kept in a jxy::flat_map keyed by their start, the mapped
+// value is a pair of the end and the value. A lookup searches the starts
+// alone. Assigning and erasing shifts the ranges after the position.
+//
+// jxylib                   STL equivalent
+// ---------------------------------------------------------------------------
+// jxy::interval_map        None
+//
+#pragma once
+#include <fltKernel.h>
+#include <jxy/memory.hpp>
+#include <jxy/flat_map.hpp>
+
+namespace jxy
+{
+
+template <typename TKey,
+          typename T,
+          POOL_TYPE t_PoolType,
+          ULONG t_PoolTag,
+          typename TCompare = std::less<TKey>>
+class interval_map
+{
+    using map_type = flat_map<TKey, std::pair<TKey, T>, t_PoolType, t_PoolTag, TCompare>;
+
+public:
+
+    static constexpr POOL_TYPE pool_type = t_PoolType;
+    static constexpr ULONG pool_tag = t_PoolTag;
+
+    using key_type = TKey;
+    using mapped_type = T;
+    using key_compare = TCompare;
+    using size_type = size_t;
+
+    //
+    // Dereferences to a pair of the range start and a pair of the range end
+    // and the value, entry.second.second is the value.
+    //
+    using iterator = typename map_type::iterator;
+    using const_iterator = typename map_type::const_iterator;
+
+    interval_map() = default;
+
+    explicit interval_map(const key_compare& Compare) : m_Map(Compare)
+    {
+    }
+
+    iterator begin() noexcept
+    {
+        return m_Map.begin();
+    }
+
+    const_iterator begin() const noexcept
+    {
+        return m_Map.begin();
+    }
+
+    iterator end() noexcept
+    {
+        return m_Map.end();
+    }
+
+    const_iterator end() const noexcept
+    {
+        return m_Map.end();
+    }
+
+    _NODISCARD
+    bool empty() const noexcept
+    {
+        return m_Map.empty();
+    }
+
+    //
+    // The number of disjoint ranges, an assignment which splits a range
+    // adds two.
+    //
+    size_type size() const noexcept
+    {
+        return m_Map.size();
+    }
+
+    void reserve(size_type Count)
+    {
+        m_Map.reserve(Count);
+    }
+
+    void clear() noexcept
+    {
+        m_Map.clear();
+    }
+
+    //
+    // Maps [Start, End) to Value, replacing what was mapped at those keys.
+    // Room is reserved before any range is changed, when copying T can't
+    // throw a failed assignment leaves the map as it was.
+    //
+    template <typename TValue>
+    iterator assign(const key_type& Start, const key_type& End, TValue&& Value)
+    {
+        if (!m_Map.key_comp()(Start, End))
+        {
+            return end();
+        }
+
+        m_Map.reserve(m_Map.size() + 2);
+        auto it = carve(Start, End);
+        return insert_at(it, Start, End, std::forward<TValue>(Value));
+    }
+
+    //
+    // Unmaps [Start, End), ranges partly inside are trimmed or split.
+    //
+    void erase(const key_type& Start, const key_type& End)
+    {
+        if (!m_Map.key_comp()(Start, End))
+        {
+            return;
+        }
+
+        m_Map.reserve(m_Map.size() + 1);
+        carve(Start, End);
+    }
+
+    //
+    // Erases a whole range.
+    //
+    iterator erase(const_iterator Position)
+    {
+        return m_Map.erase(Position);
+    }
+
+    //
+    // Finds the range containing Key.
+    //
+    iterator find(const key_type& Key)
+    {
+        return find_range(*this, Key);
+    }
+
+    const_iterator find(const key_type& Key) const
+    {
+        return find_range(*this, Key);
+    }
+
+    bool contains(const key_type& Key) const
+    {
+        return (find(Key) != end());
+    }
+
+    //
+    // The ranges overlapping [Start, End).
+    //
+    std::pair<iterator, iterator> overlapping(const key_type& Start, const key_type& End)
+    {
+        return overlapping_ranges(*this, Start, End);
+    }
+
+    std::pair<const_iterator, const_iterator> overlapping(const key_type& Start, const key_type& End) const
+    {
+        return overlapping_ranges(*this, Start, End);
+    }
+
+    friend bool operator==(const interval_map& Left, const interval_map& Right)
+    {
+        return (Left.m_Map == Right.m_Map);
+    }
+
+    friend bool operator!=(const interval_map& Left, const interval_map& Right)
+    {
+        return !(Left == Right);
+    }
+
+private:
+
+    template <typename TSelf>
+    static auto find_range(TSelf& Self, const key_type& Key)
+    {
+        auto it = Self.m_Map.upper_bound(Key);
+        if (it == Self.m_Map.begin())
+        {
+            return Self.m_Map.end();
+        }
+
+        --it;
+        if (!Self.m_Map.key_comp()(Key, it->second.first))
+        {
+            return Self.m_Map.end();
+        }
+
+        return it;
+    }
+
+    template <typename TSelf>
+    static auto overlapping_ranges(TSelf& Self, const key_type& Start, const key_type& End)
+    {
+        auto first = Self.m_Map.lower_bound(Start);
+        if ((first != Self.m_Map.begin()) &&
+            Self.m_Map.key_comp()(Start, std::prev(first)->second.first))
+        {
+            --first;
+        }
+        return std::make_pair(first, Self.m_Map.lower_bound(End));
+    }
+
+    template <typename TValue>
+    iterator insert_at(iterator Position, const key_type& Start, const key_type& End, TValue&& Value)
+    {
+        return m_Map.emplace_hint(Position, Start, std::pair<TKey, T>(End, std::forward<TValue>(Value)));
+    }
+
+    //
+    // Removes [Start, End) from the ranges and returns where a range
+    // starting at Start goes. The caller reserves room for the split.
+    //
+    iterator carve(const key_type& Start, const key_type& End)
+    {
+        auto less = m_Map.key_comp();
+
+        auto it = m_Map.lower_bound(Start);
+        if (it != m_Map.begin())
+        {
+            auto previous = std::prev(it);
+            auto& [previousEnd, previousValue] = previous->second;
+            if (less(Start, previousEnd))
+            {
+                if (less(End, previousEnd))
+                {
+                    //
+                    // The range is inside the previous, split it.
+                    //
+                    T tailValue(previousValue);
+                    auto tailEnd = std::exchange(previousEnd, Start);
+                    return insert_at(it, End, tailEnd, std::move(tailValue));
+                }
+
+                previousEnd = Start;
+            }
+        }
+
+        auto last = it;
+        while ((last != m_Map.end()) && less(last->first, End) && !less(End, last->second.first))
+        {
+            ++last;
+        }
+
+        if ((last != m_Map.end()) && less(last->first, End))
+        {
+            //
+            // The last range continues past End, keep its tail.
+            //
+            auto tailEnd = last->second.first;
+            T tailValue(std::move_if_noexcept(last->second.second));
+            auto index = (it - m_Map.begin());
+            m_Map.erase(it, std::next(last));
+            insert_at(m_Map.begin() + index, End, tailEnd, std::move(tailValue));
+            return (m_Map.begin() + index);
+        }
+
+        return m_Map.erase(it, last);
+    }
+
+    map_type m_Map;
+
+};
+
+}
@@ -0,0 +1,416 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/intrusive_ptr.hpp
+// Author:   Johnny Shaw
+// Abstract: Intrusive reference counted pointers
+//
+// jxy::make_intrusive allocates the object with a small header immediately
+// before it which holds the strong and weak reference counts. There is no
+// separate control block and jxy::intrusive_ptr is a single pointer, copying
+// one is a single interlocked increment on memory adjacent to the object.
+//
+// The pool type and tag are captured by jxy::make_intrusive and recorded in
+// the header, so the pointer type only depends on the object type. Objects
+// must be created by jxy::make_intrusive, a pointer from anywhere else can't
+// be adopted. There are no conversions between pointer types, the header is
+// found from the exact object address.
+//
+// The strong references collectively hold one weak reference. The object is
+// destroyed when the last strong reference is released and the memory is
+// returned to the pool when the last weak reference is released.
+//
+// jxylib                       STL equivalent
+// ---------------------------------------------------------------------------
+// jxy::intrusive_ptr           std::shared_ptr
+// jxy::intrusive_weak_ptr      std::weak_ptr
+// jxy::make_intrusive          std::allocate_shared
+//
+#pragma once
+#include <fltKernel.h>
+#include <jxy/memory.hpp>
+
+namespace jxy
+{
+
+namespace details
+{
+
+struct DECLSPEC_ALIGN(MEMORY_ALLOCATION_ALIGNMENT) intrusive_header
+{
+    volatile LONG Strong;
+    volatile LONG Weak;
+
+    //
+    // Destroys the object, or when Free is set returns the memory.
+    //
+    void (*Dispose)(intrusive_header* Header, bool Free) noexcept;
+};
+
+template <typename T>
+intrusive_header* intrusive_header_of(T* Object) noexcept
+{
+    return reinterpret_cast<intrusive_header*>(
+        reinterpret_cast<uint8_t*>(const_cast<std::remove_cv_t<T>*>(Object)) -
+        sizeof(intrusive_header));
+}
+
+inline void intrusive_release_weak(intrusive_header* Header) noexcept
+{
+    if (InterlockedDecrement(&Header->Weak) == 0)
+    {
+        Header->Dispose(Header, true);
+    }
+}
+
+inline void intrusive_release(intrusive_header* Header) noexcept
+{
+    if (InterlockedDecrement(&Header->Strong) == 0)
+    {
+        Header->Dispose(Header, false);
+        intrusive_release_weak(Header);
+    }
+}
+
+template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag>
+struct intrusive_block
+{
+    //
+    // The object follows the header, the header is at the end of the
+    // (possibly larger) leading space so it is always directly before it.
+    //
+    static constexpr size_t alignment = (alignof(T) > MEMORY_ALLOCATION_ALIGNMENT ?
+                                         alignof(T) : MEMORY_ALLOCATION_ALIGNMENT);
+    static constexpr size_t object_offset = (sizeof(intrusive_header) > alignment ?
+                                             sizeof(intrusive_header) : alignment);
+    static constexpr size_t size = (object_offset + sizeof(T));
+
+    static void* allocate() noexcept(false)
+    {
+        if constexpr (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+        {
+            return ::operator new(size, std::align_val_t{ alignment }, t_PoolType, t_PoolTag);
+        }
+        else
+        {
+            return ::operator new(size, t_PoolType, t_PoolTag);
+        }
+    }
+
+    static void deallocate(void* Block) noexcept
+    {
+        if constexpr (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+        {
+            ::operator delete(Block, size, std::align_val_t{ alignment }, t_PoolType, t_PoolTag);
+        }
+        else
+        {
+            ::operator delete(Block, size, t_PoolType, t_PoolTag);
+        }
+    }
+
+    static T* object(void* Block) noexcept
+    {
+        return reinterpret_cast<T*>(static_cast<uint8_t*>(Block) + object_offset);
+    }
+
+    static void dispose(intrusive_header* Header, bool Free) noexcept
+    {
+        auto block = (reinterpret_cast<uint8_t*>(Header) + sizeof(intrusive_header) - object_offset);
+        if (Free)
+        {
+            deallocate(block);
+        }
+        else
+        {
+            object(block)->~T();
+        }
+    }
+};
+
+}
+
+template <typename T>
+class intrusive_weak_ptr;
+
+template <typename T>
+class intrusive_ptr
+{
+public:
+
+    using element_type = T;
+
+    constexpr intrusive_ptr() noexcept = default;
+
+    constexpr intrusive_ptr(std::nullptr_t) noexcept
+    {
+    }
+
+    ~intrusive_ptr() noexcept
+    {
+        reset();
+    }
+
+    intrusive_ptr(const intrusive_ptr& Other) noexcept : m_Object(Other.m_Object)
+    {
+        if (m_Object)
+        {
+            InterlockedIncrement(&details::intrusive_header_of(m_Object)->Strong);
+        }
+    }
+
+    intrusive_ptr(intrusive_ptr&& Other) noexcept : m_Object(Other.m_Object)
+    {
+        Other.m_Object = nullptr;
+    }
+
+    intrusive_ptr& operator=(const intrusive_ptr& Other) noexcept
+    {
+        intrusive_ptr(Other).swap(*this);
+        return *this;
+    }
+
+    intrusive_ptr& operator=(intrusive_ptr&& Other) noexcept
+    {
+        intrusive_ptr(std::move(Other)).swap(*this);
+        return *this;
+    }
+
+    intrusive_ptr& operator=(std::nullptr_t) noexcept
+    {
+        reset();
+        return *this;
+    }
+
+    void reset() noexcept
+    {
+        auto object = m_Object;
+        m_Object = nullptr;
+        if (object)
+        {
+            details::intrusive_release(details::intrusive_header_of(object));
+        }
+    }
+
+    void swap(intrusive_ptr& Other) noexcept
+    {
+        std::swap(m_Object, Other.m_Object);
+    }
+
+    T* get() const noexcept
+    {
+        return m_Object;
+    }
+
+    T& operator*() const noexcept
+    {
+        return *m_Object;
+    }
+
+    T* operator->() const noexcept
+    {
+        return m_Object;
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return (m_Object != nullptr);
+    }
+
+    long use_count() const noexcept
+    {
+        return (m_Object ? ReadNoFence(&details::intrusive_header_of(m_Object)->Strong) : 0);
+    }
+
+private:
+
+    template <typename U>
+    friend class intrusive_weak_ptr;
+
+    template <typename U, POOL_TYPE t_PoolType, ULONG t_PoolTag, typename... TArgs>
+    friend intrusive_ptr<U> make_intrusive(TArgs&&... Args) noexcept(false);
+
+    //
+    // Adopts a reference that has already been taken.
+    //
+    explicit intrusive_ptr(T* Object) noexcept : m_Object(Object)
+    {
+    }
+
+    T* m_Object = nullptr;
+
+};
+
+template <typename T>
+class intrusive_weak_ptr
+{
+public:
+
+    using element_type = T;
+
+    constexpr intrusive_weak_ptr() noexcept = default;
+
+    ~intrusive_weak_ptr() noexcept
+    {
+        reset();
+    }
+
+    intrusive_weak_ptr(const intrusive_ptr<T>& Other) noexcept : m_Object(Other.m_Object)
+    {
+        acquire();
+    }
+
+    intrusive_weak_ptr(const intrusive_weak_ptr& Other) noexcept : m_Object(Other.m_Object)
+    {
+        acquire();
+    }
+
+    intrusive_weak_ptr(intrusive_weak_ptr&& Other) noexcept : m_Object(Other.m_Object)
+    {
+        Other.m_Object = nullptr;
+    }
+
+    intrusive_weak_ptr& operator=(const intrusive_weak_ptr& Other) noexcept
+    {
+        intrusive_weak_ptr(Other).swap(*this);
+        return *this;
+    }
+
+    intrusive_weak_ptr& operator=(intrusive_weak_ptr&& Other) noexcept
+    {
+        intrusive_weak_ptr(std::move(Other)).swap(*this);
+        return *this;
+    }
+
+    intrusive_weak_ptr& operator=(const intrusive_ptr<T>& Other) noexcept
+    {
+        intrusive_weak_ptr(Other).swap(*this);
+        return *this;
+    }
+
+    void reset() noexcept
+    {
+        auto object = m_Object;
+        m_Object = nullptr;
+        if (object)
+        {
+            details::intrusive_release_weak(details::intrusive_header_of(object));
+        }
+    }
+
+    void swap(intrusive_weak_ptr& Other) noexcept
+    {
+        std::swap(m_Object, Other.m_Object);
+    }
+
+    long use_count() const noexcept
+    {
+        return (m_Object ? ReadNoFence(&details::intrusive_header_of(m_Object)->Strong) : 0);
+    }
+
+    bool expired() const noexcept
+    {
+        return (use_count() == 0);
+    }
+
+    //
+    // Takes a strong reference if the object is still alive.
+    //
+    intrusive_ptr<T> lock() const noexcept
+    {
+        if (!m_Object)
+        {
+            return nullptr;
+        }
+
+        auto header = details::intrusive_header_of(m_Object);
+        auto strong = ReadNoFence(&header->Strong);
+        while (strong != 0)
+        {
+            auto previous = InterlockedCompareExchange(&header->Strong, (strong + 1), strong);
+            if (previous == strong)
+            {
+                return intrusive_ptr<T>(m_Object);
+            }
+            strong = previous;
+        }
+
+        return nullptr;
+    }
+
+private:
+
+    void acquire() noexcept
+    {
+        if (m_Object)
+        {
+            InterlockedIncrement(&details::intrusive_header_of(m_Object)->Weak);
+        }
+    }
+
+    T* m_Object = nullptr;
+
+};
+
+template <typename T, typename U>
+bool operator==(const intrusive_ptr<T>& Left, const intrusive_ptr<U>& Right) noexcept
+{
+    return (Left.get() == Right.get());
+}
+
+template <typename T, typename U>
+bool operator!=(const intrusive_ptr<T>& Left, const intrusive_ptr<U>& Right) noexcept
+{
+    return (Left.get() != Right.get());
+}
+
+template <typename T>
+bool operator==(const intrusive_ptr<T>& Left, std::nullptr_t) noexcept
+{
+    return (Left.get() == nullptr);
+}
+
+template <typename T>
+bool operator!=(const intrusive_ptr<T>& Left, std::nullptr_t) noexcept
+{
+    return (Left.get() != nullptr);
+}
+
+template <typename T>
+bool operator==(std::nullptr_t, const intrusive_ptr<T>& Right) noexcept
+{
+    return (Right.get() == nullptr);
+}
+
+template <typename T>
+bool operator!=(std::nullptr_t, const intrusive_ptr<T>& Right) noexcept
+{
+    return (Right.get() != nullptr);
+}
+
+template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag, typename... TArgs>
+intrusive_ptr<T> make_intrusive(TArgs&&... Args) noexcept(false)
+{
+    using block_type = details::intrusive_block<T, t_PoolType, t_PoolTag>;
+
+    auto block = block_type::allocate();
+    auto object = block_type::object(block);
+    try
+    {
+        ::new (static_cast<void*>(object)) T(std::forward<TArgs>(Args)...);
+    }
+    catch (...)
+    {
+        block_type::deallocate(block);
+        throw;
+    }
+
+    auto header = details::intrusive_header_of(object);
+    header->Strong = 1;
+    header->Weak = 1;
+    header->Dispose = &block_type::dispose;
+
+    return intrusive_ptr<T>(object);
+}
+
+}
@@ -0,0 +1,248 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/large_buffer.hpp
+// Author:   Johnny Shaw
+// Abstract: Page granular buffers with reuse
+//
+// jxy::large_buffer owns an uninitialized, page granular buffer. It is meant
+// for large transient buffers that are filled by a query, such as
+// ZwQuerySystemInformation. Nothing is zeroed, the query overwrites it.
+//
+// Freed buffers are kept in a small global cache and handed back out for a
+// later request of a similar size (no more than twice the request) with the
+// same pool type and tag, so a repeated enumeration does not allocate a fresh
+// multi-megabyte buffer each time. Cached buffers are returned to the pool
+// by jxy::flush_large_buffer_cache and jxy::trim_caches, a driver *must*
+// call one of them during unload after all large buffers are destroyed.
+//
+// jxy::large_buffer::query calls a query routine and grows the buffer
+// geometrically while it reports the buffer is too small.
+//
+// jxylib                       STL equivalent
+// ---------------------------------------------------------------------------
+// jxy::large_buffer            None
+//
+#pragma once
+#include <fltKernel.h>
+#include <jxy/memory.hpp>
+#include <utility>
+
+namespace jxy
+{
+
+static constexpr size_t large_buffer_cache_entries = 8;
+
+//
+// Buffers larger than this are never cached.
+//
+static constexpr size_t large_buffer_cache_max_capacity = (64 * 1024 * 1024);
+
+struct large_buffer_cache_stats
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t cached_bytes;
+};
+
+_IRQL_requires_max_(APC_LEVEL)
+size_t flush_large_buffer_cache() noexcept;
+
+large_buffer_cache_stats query_large_buffer_cache_stats() noexcept;
+
+namespace details
+{
+
+//
+// Returns a buffer of at least Size bytes and its page rounded capacity, or
+// null on failure.
+//
+void* large_buffer_allocate(
+    POOL_TYPE PoolType,
+    ULONG PoolTag,
+    size_t Size,
+    size_t& Capacity) noexcept;
+
+void large_buffer_free(
+    void* Memory,
+    POOL_TYPE PoolType,
+    ULONG PoolTag,
+    size_t Capacity) noexcept;
+
+}
+
+template <POOL_TYPE t_PoolType, ULONG t_PoolTag>
+class large_buffer
+{
+public:
+
+    static constexpr POOL_TYPE pool_type = t_PoolType;
+    static constexpr ULONG pool_tag = t_PoolTag;
+
+    constexpr large_buffer() noexcept = default;
+
+    explicit large_buffer(size_t Size) noexcept(false)
+    {
+        resize_discard(Size);
+    }
+
+    ~large_buffer() noexcept
+    {
+        reset();
+    }
+
+    large_buffer(large_buffer&& Other) noexcept
+        : m_Memory(std::exchange(Other.m_Memory, nullptr)),
+          m_Size(std::exchange(Other.m_Size, 0)),
+          m_Capacity(std::exchange(Other.m_Capacity, 0))
+    {
+    }
+
+    large_buffer& operator=(large_buffer&& Other) noexcept
+    {
+        if (this != &Other)
+        {
+            reset();
+            m_Memory = std::exchange(Other.m_Memory, nullptr);
+            m_Size = std::exchange(Other.m_Size, 0);
+            m_Capacity = std::exchange(Other.m_Capacity, 0);
+        }
+        return *this;
+    }
+
+    large_buffer(const large_buffer&) = delete;
+    large_buffer& operator=(const large_buffer&) = delete;
+
+    void* data() const noexcept
+    {
+        return m_Memory;
+    }
+
+    template <typename T>
+    T* as() const noexcept
+    {
+        return static_cast<T*>(m_Memory);
+    }
+
+    size_t size() const noexcept
+    {
+        return m_Size;
+    }
+
+    size_t capacity() const noexcept
+    {
+        return m_Capacity;
+    }
+
+    bool empty() const noexcept
+    {
+        return (m_Size == 0);
+    }
+
+    //
+    // Makes the buffer at least Size bytes. The contents are not preserved
+    // when the buffer has to be replaced.
+    //
+    void resize_discard(size_t Size) noexcept(false)
+    {
+        if ((Size <= m_Capacity) && m_Memory)
+        {
+            m_Size = Size;
+            return;
+        }
+
+        reset();
+
+        size_t capacity = 0;
+        auto memory = details::large_buffer_allocate(t_PoolType, t_PoolTag, Size, capacity);
+        if (!memory)
+        {
+            throw std::bad_alloc();
+        }
+        details::pool_stats_allocate(t_PoolTag, capacity);
+        details::pool_trace_allocate(t_PoolTag, capacity);
+
+        m_Memory = memory;
+        m_Size = Size;
+        m_Capacity = capacity;
+    }
+
+    //
+    // Returns the buffer to the cache.
+    //
+    void reset() noexcept
+    {
+        if (m_Memory)
+        {
+            details::pool_stats_free(t_PoolTag, m_Capacity);
+            details::large_buffer_free(m_Memory, t_PoolType, t_PoolTag, m_Capacity);
+            m_Memory = nullptr;
+            m_Size = 0;
+            m_Capacity = 0;
+        }
+    }
+
+    //
+    // Fills the buffer with a query, for example:
+    // NTSTATUS Query(void* Buffer, ULONG Length, PULONG ReturnLength)
+    //
+    // While the query returns STATUS_INFO_LENGTH_MISMATCH,
+    // STATUS_BUFFER_TOO_SMALL, or STATUS_BUFFER_OVERFLOW the buffer grows to
+    // the larger of the returned length and twice the capacity, the required
+    // size may grow again before the next query. On success the size is the
+    // returned length.
+    //
+    template <typename TQuery>
+    NTSTATUS query(TQuery&& Query) noexcept(false)
+    {
+        if (!m_Memory)
+        {
+            resize_discard(PAGE_SIZE);
+        }
+
+        for (;;)
+        {
+            auto length = ((m_Capacity > MAXULONG) ? MAXULONG : static_cast<ULONG>(m_Capacity));
+
+            ULONG returnLength = 0;
+            auto status = Query(m_Memory, length, &returnLength);
+            if ((status != STATUS_INFO_LENGTH_MISMATCH) &&
+                (status != STATUS_BUFFER_TOO_SMALL) &&
+                (status != STATUS_BUFFER_OVERFLOW))
+            {
+                if (NT_SUCCESS(status))
+                {
+                    m_Size = ((returnLength != 0) && (returnLength <= length) ? returnLength : length);
+                }
+                return status;
+            }
+
+            if (length == MAXULONG)
+            {
+                return status;
+            }
+
+            auto required = (m_Capacity * 2);
+            if (returnLength > required)
+            {
+                required = returnLength;
+            }
+            resize_discard(required);
+        }
+    }
+
+private:
+
+    void* m_Memory = nullptr;
+    size_t m_Size = 0;
+    size_t m_Capacity = 0;
+
+};
+
+template <ULONG t_PoolTag>
+using paged_large_buffer = large_buffer<PagedPool, t_PoolTag>;
+
+template <ULONG t_PoolTag>
+using non_paged_large_buffer = large_buffer<NonPagedPoolNx, t_PoolTag>;
+
+}
@@ -18,6 +18,7 @@
 //
 #pragma once
 #include <fltKernel.h>
+#include <jxy/pool_backend.hpp>
 #include <shared_mutex>
 
 namespace jxy
@@ -54,13 +55,10 @@ public:
 
     mutex() noexcept(false)
     {
-#pragma warning(push)
-#pragma warning(disable : 4996) // FIXME - deprecated function
         m_GuardedMutex = static_cast<PKGUARDED_MUTEX>(
-            ExAllocatePoolWithTag(NonPagedPoolNx,
-                                  sizeof(*m_GuardedMutex),
-                                  t_PoolTag));
-#pragma warning(pop)
+            details::pool_allocate(NonPagedPoolNx,
+                                   sizeof(*m_GuardedMutex),
+                                   t_PoolTag));
         if (!m_GuardedMutex)
         {
             throw std::bad_alloc();
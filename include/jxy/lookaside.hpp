@@ -0,0 +1,258 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/lookaside.hpp
+// Author:   Johnny Shaw
+// Abstract: Lookaside list allocator
+//
+// Node based containers (map, set, list) and allocate_shared make exactly one
+// single-object allocation per element. The jxy::lookaside_allocator serves
+// these single-object requests from a fixed-size lookaside list, modeled
+// after ExInitializeLookasideListEx. Freed blocks are pushed onto an
+// interlocked singly linked list (up to a maximum depth) and popped on the
+// next allocation, avoiding a trip to the pool. Array requests (Count > 1)
+// always go to the pool.
+//
+// There is one lookaside list per rebound type, pool type, pool tag, and
+// depth. Lists are constant initialized (no CRT initialization is required)
+// and register themselves in a global registry on first use. Since cached
+// blocks are held until freed back to the pool, a driver *must* call
+// jxy::flush_lookaside_caches during unload after all containers using the
+// allocator have been destroyed.
+//
+// jxylib                       STL equivalent
+// ---------------------------------------------------------------------------
+// jxy::lookaside_allocator     std::allocator
+//
+#pragma once
+#include <fltKernel.h>
+#include <jxy/memory.hpp>
+
+namespace jxy
+{
+
+namespace details
+{
+
+class lookaside_list
+{
+public:
+
+    constexpr lookaside_list(
+        POOL_TYPE PoolType,
+        ULONG PoolTag,
+        size_t BlockSize,
+        USHORT Depth) noexcept
+        : m_PoolType(PoolType),
+          m_PoolTag(PoolTag),
+          m_BlockSize(BlockSize < sizeof(SLIST_ENTRY) ? sizeof(SLIST_ENTRY) : BlockSize),
+          m_Depth(Depth)
+    {
+    }
+
+    lookaside_list(const lookaside_list&) = delete;
+    lookaside_list& operator=(const lookaside_list&) = delete;
+
+    _NODISCARD
+    void* allocate() noexcept(false);
+
+    void free(void* Memory) noexcept;
+
+    size_t flush() noexcept;
+
+    static size_t flush_all() noexcept;
+
+    size_t block_size() const noexcept
+    {
+        return m_BlockSize;
+    }
+
+    USHORT depth() const noexcept
+    {
+        return m_Depth;
+    }
+
+    USHORT cached() noexcept
+    {
+        return QueryDepthSList(&m_ListHead);
+    }
+
+    ULONG total_allocates() const noexcept
+    {
+        return static_cast<ULONG>(m_TotalAllocates);
+    }
+
+    ULONG allocate_misses() const noexcept
+    {
+        return static_cast<ULONG>(m_AllocateMisses);
+    }
+
+    ULONG total_frees() const noexcept
+    {
+        return static_cast<ULONG>(m_TotalFrees);
+    }
+
+    ULONG free_misses() const noexcept
+    {
+        return static_cast<ULONG>(m_FreeMisses);
+    }
+
+private:
+
+    void register_list() noexcept;
+
+    SLIST_HEADER m_ListHead{};
+    SLIST_ENTRY m_RegistryEntry{};
+    const POOL_TYPE m_PoolType;
+    const ULONG m_PoolTag;
+    const size_t m_BlockSize;
+    const USHORT m_Depth;
+    LONG m_Registered = 0;
+    LONG m_TotalAllocates = 0;
+    LONG m_AllocateMisses = 0;
+    LONG m_TotalFrees = 0;
+    LONG m_FreeMisses = 0;
+
+};
+
+template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag, USHORT t_Depth>
+class lookaside_allocator
+{
+public:
+
+    static_assert(!std::is_const_v<T>,
+                  "The C++ Standard forbids containers of const elements "
+                  "because allocator<const T> is ill-formed.");
+
+    static constexpr POOL_TYPE pool_type = t_PoolType;
+    static constexpr ULONG pool_tag = t_PoolTag;
+    static constexpr USHORT depth = t_Depth;
+
+    using _From_primary = lookaside_allocator;
+
+    using value_type = T;
+
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+
+    using propagate_on_container_move_assignment = std::true_type;
+
+    constexpr lookaside_allocator() noexcept {}
+
+    constexpr lookaside_allocator(const lookaside_allocator&) noexcept = default;
+
+    template <typename Other>
+    constexpr lookaside_allocator(const lookaside_allocator<Other, t_PoolType, t_PoolTag, t_Depth>&) noexcept
+    {
+    }
+
+    _CONSTEXPR20 ~lookaside_allocator() = default;
+    _CONSTEXPR20 lookaside_allocator& operator=(const lookaside_allocator&) = default;
+
+    _CONSTEXPR20
+    void deallocate(
+        value_type* const Memory,
+        const size_type Count)
+    {
+        if constexpr (alignof(value_type) > MEMORY_ALLOCATION_ALIGNMENT)
+        {
+            allocator<value_type, t_PoolType, t_PoolTag>().deallocate(Memory, Count);
+        }
+        else
+        {
+            if (!Memory)
+            {
+                return;
+            }
+
+            details::pool_stats_free(t_PoolTag, (sizeof(value_type) * Count));
+
+            if (Count == 1)
+            {
+                s_List.free(Memory);
+            }
+            else
+            {
+                ExFreePoolWithTag(Memory, t_PoolTag);
+            }
+        }
+    }
+
+    _NODISCARD _CONSTEXPR20
+    __declspec(allocator)
+    value_type* allocate(_CRT_GUARDOVERFLOW const size_type Count)
+    {
+        if constexpr (alignof(value_type) > MEMORY_ALLOCATION_ALIGNMENT)
+        {
+            //
+            // Lookaside blocks only have the natural pool alignment,
+            // over-aligned types bypass the list.
+            //
+            return allocator<value_type, t_PoolType, t_PoolTag>().allocate(Count);
+        }
+        else
+        {
+            if (Count == 1)
+            {
+                auto memory = static_cast<value_type*>(s_List.allocate());
+                details::pool_stats_allocate(t_PoolTag, sizeof(value_type));
+                details::pool_trace_allocate(t_PoolTag, sizeof(value_type));
+                return memory;
+            }
+
+            auto memory = static_cast<value_type*>(
+                pool_allocate(t_PoolType,
+                              (sizeof(value_type) * Count),
+                              t_PoolTag));
+            if (!memory)
+            {
+                throw std::bad_alloc();
+            }
+            details::pool_stats_allocate(t_PoolTag, (sizeof(value_type) * Count));
+            details::pool_trace_allocate(t_PoolTag, (sizeof(value_type) * Count));
+            return memory;
+        }
+    }
+
+    //
+    // Exposes the lookaside list backing this (rebound) allocator type, this
+    // is useful for inspecting the allocation statistics.
+    //
+    static lookaside_list& list() noexcept
+    {
+        return s_List;
+    }
+
+    template <typename Other>
+    struct rebind
+    {
+        using other = lookaside_allocator<Other, t_PoolType, t_PoolTag, t_Depth>;
+    };
+
+private:
+
+    static inline lookaside_list s_List{ t_PoolType,
+                                         t_PoolTag,
+                                         sizeof(value_type),
+                                         t_Depth };
+
+};
+
+}
+
+template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag, USHORT t_Depth = 256>
+using lookaside_allocator = details::lookaside_allocator<T, t_PoolType, t_PoolTag, t_Depth>;
+
+template <typename T, ULONG t_PoolTag, USHORT t_Depth = 256>
+using paged_lookaside_allocator = details::lookaside_allocator<T, PagedPool, t_PoolTag, t_Depth>;
+
+template <typename T, ULONG t_PoolTag, USHORT t_Depth = 256>
+using non_paged_lookaside_allocator = details::lookaside_allocator<T, NonPagedPoolNx, t_PoolTag, t_Depth>;
+
+//
+// Frees every cached block in every lookaside list back to the pool. Returns
+// the number of bytes released. This must be called during driver unload.
+//
+size_t flush_lookaside_caches() noexcept;
+
+}
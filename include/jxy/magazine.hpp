@@ -0,0 +1,66 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/magazine.hpp
+// Author:   Johnny Shaw
+// Abstract: Per-CPU magazine cache for the tagged new/delete operators
+//
+// This is an optional caching layer between the tagged new/delete operators
+// and the pool. It follows the magazine design (Bonwick and Adams), each CPU
+// has a small table of slots keyed by pool type, pool tag, and size class.
+// Each slot holds a loaded and previous magazine of cached blocks. Blocks
+// are only ever handed back out for the same pool type and tag they were
+// allocated with, so pool tagging stays accurate.
+//
+// The cache is disabled until jxy::initialize_magazine_cache is called, when
+// disabled the new/delete operators go straight to the pool and sizes are
+// not rounded up to a size class. Only sized deletes (jxy::default_delete,
+// the sized tagged delete operator) can return blocks to the cache since the
+// size class must be known. As with the standard sized delete, the memory
+// must have come from the tagged new and the size must be that of the object
+// allocated, not of a base class. jxy::default_delete frees types with a
+// virtual destructor unsized. A block is only cached if the pool block is at
+// least the size of its class, blocks allocated before the cache was enabled
+// are freed to the pool.
+//
+// Initialization and uninitialization are not synchronized with allocations,
+// initialize during driver entry and uninitialize during driver unload after
+// all allocations are released.
+//
+#pragma once
+#include <fltKernel.h>
+#include <cstdint>
+
+namespace jxy
+{
+
+struct magazine_cache_stats
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t flushes;
+};
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS initialize_magazine_cache() noexcept;
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void uninitialize_magazine_cache() noexcept;
+
+_IRQL_requires_max_(APC_LEVEL)
+size_t flush_magazine_cache() noexcept;
+
+magazine_cache_stats query_magazine_cache_stats() noexcept;
+
+namespace details
+{
+
+size_t magazine_round_size(size_t Size) noexcept;
+
+void* magazine_allocate(size_t Size, POOL_TYPE PoolType, ULONG PoolTag) noexcept;
+
+bool magazine_free(void* Memory, size_t Size, POOL_TYPE PoolType, ULONG PoolTag) noexcept;
+
+}
+
+}
@@ -9,6 +9,13 @@
 // ---------------------------------------------------------------------------
 // jxy::map             std::map 
 // jxy::multimap        std::multimap 
+// jxy::tagged_map      std::map
+// jxy::tagged_multimap std::multimap
+// jxy::pmr::map        std::pmr::map
+// jxy::pmr::multimap   std::pmr::multimap
+//
+// The jxy::pmr aliases are declared here, the resources to construct them
+// with are in <jxy/memory_resource.hpp>.
 //
 #pragma once
 #include <jxy/memory.hpp>
@@ -33,4 +40,30 @@ template <typename TKey,
           typename TAlloc = allocator<std::pair<const TKey, T>, t_PoolType, t_PoolTag>>
 using multimap = std::multimap<TKey, T, TLess, TAlloc>;
 
-}
\ No newline at end of file
+//
+// The tag is given at runtime, see jxy::tagged_allocator.
+//
+template <typename TKey,
+          typename T,
+          POOL_TYPE t_PoolType,
+          typename TLess = std::less<TKey>>
+using tagged_map = std::map<TKey, T, TLess, tagged_allocator<std::pair<const TKey, T>, t_PoolType>>;
+
+template <typename TKey,
+          typename T,
+          POOL_TYPE t_PoolType,
+          typename TLess = std::less<TKey>>
+using tagged_multimap = std::multimap<TKey, T, TLess, tagged_allocator<std::pair<const TKey, T>, t_PoolType>>;
+
+}
+
+namespace jxy::pmr
+{
+
+template <typename TKey, typename T, typename TLess = std::less<TKey>>
+using map = std::pmr::map<TKey, T, TLess>;
+
+template <typename TKey, typename T, typename TLess = std::less<TKey>>
+using multimap = std::pmr::multimap<TKey, T, TLess>;
+
+}
@@ -18,10 +18,45 @@
 // jxy::default_delete  std::default_delete
 // jxy::unique_ptr      std::unique_ptr
 // jxy::shared_ptr      std::shared_ptr
+// jxy::make_unique_aligned  None
+// jxy::make_unique_for_overwrite   std::make_unique_for_overwrite (cpp20)
+// jxy::make_shared_for_overwrite   std::make_shared_for_overwrite (cpp20)
+// jxy::default_init_allocator      None
+// jxy::tagged_allocator            std::pmr::polymorphic_allocator
+// jxy::cache_aligned   None
+//
+// The allocators and deleters honor alignof(T) beyond the natural pool
+// alignment, types declared alignas(SYSTEM_CACHE_ALIGNMENT_SIZE) may be used
+// with any of them.
+//
+// jxy::make_unique and jxy::make_shared value-initialize, a trivial type is
+// zeroed. The for_overwrite variants default-initialize instead, which leaves
+// trivial types uninitialized, for buffers the caller fills right away. The
+// jxy::default_init_allocator does the same for containers, resize and the
+// count constructor of a jxy::vector of a trivial type skip zeroing the new
+// elements. Arrays (T[]) are supported by jxy::make_unique and
+// jxy::make_unique_for_overwrite for trivially destructible types only. Like
+// the compiler's array new the element count is stored in a cookie just
+// before the elements, so the array deleter can give the size to the sized
+// delete. An array unique_ptr must be created by one of them.
+//
+// jxy::allocator takes the pool tag as a template parameter, containers
+// which differ only by tag are distinct types and are instantiated once per
+// tag. jxy::tagged_allocator carries the tag as a runtime member instead, so
+// every container of an element type and pool type shares one instantiation
+// (see jxy::tagged_vector, jxy::tagged_wstring, and jxy::tagged_map). Like
+// the std::pmr allocators it does not propagate on assignment, a container
+// keeps the tag it was constructed with. Move or copy assigning from a
+// container with another tag reallocates under the destination tag rather
+// than taking the buffer. Swapping containers swaps their tags along with
+// their memory, memory is always freed under the tag it was allocated with.
 //
 #pragma once
 #include <fltKernel.h>
 #include <jxy/alloc.hpp>
+#include <jxy/pool_backend.hpp>
+#include <jxy/pool_stats.hpp>
+#include <jxy/pool_trace.hpp>
 #include <memory>
 
 namespace jxy
@@ -30,6 +65,49 @@ namespace jxy
 namespace details
 {
 
+//
+// The allocators allocate through the tagged new and free through the sized
+// tagged delete, the same path as the jxy deleters, so container memory is
+// served from the magazine cache and counted in the pool statistics in one
+// place. An empty allocation is a one byte block, as in the tagged new.
+//
+template <typename T>
+size_t allocation_size(size_t Count) noexcept
+{
+    return ((Count == 0) ? 1 : (sizeof(T) * Count));
+}
+
+template <typename T>
+T* allocate_elements(POOL_TYPE PoolType, ULONG PoolTag, size_t Count) noexcept(false)
+{
+    if (Count > (static_cast<size_t>(-1) / sizeof(T)))
+    {
+        throw std::bad_alloc();
+    }
+
+    if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+    {
+        return static_cast<T*>(::operator new(allocation_size<T>(Count), std::align_val_t{ alignof(T) }, PoolType, PoolTag));
+    }
+    else
+    {
+        return static_cast<T*>(::operator new(allocation_size<T>(Count), PoolType, PoolTag));
+    }
+}
+
+template <typename T>
+void deallocate_elements(T* Memory, POOL_TYPE PoolType, ULONG PoolTag, size_t Count) noexcept
+{
+    if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+    {
+        ::operator delete(Memory, allocation_size<T>(Count), std::align_val_t{ alignof(T) }, PoolType, PoolTag);
+    }
+    else
+    {
+        ::operator delete(Memory, allocation_size<T>(Count), PoolType, PoolTag);
+    }
+}
+
 template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag>
 class allocator
 {
@@ -66,11 +144,11 @@ public:
     _CONSTEXPR20
     void deallocate(
         value_type* const Memory,
-        const size_type)
+        const size_type Count)
     {
         if (Memory)
         {
-            ExFreePoolWithTag(Memory, t_PoolTag);
+            deallocate_elements(Memory, t_PoolType, t_PoolTag, Count);
         }
     }
 
@@ -78,18 +156,7 @@ public:
     __declspec(allocator)
     value_type* allocate(_CRT_GUARDOVERFLOW const size_type Count)
     {
-#pragma warning(push)
-#pragma warning(disable : 4996) // FIXME - deprecated function
-        auto memory = static_cast<value_type*>(
-            ExAllocatePoolWithTag(t_PoolType,
-                                  (sizeof(value_type) * Count),
-                                  t_PoolTag));
-#pragma warning(pop)
-        if (!memory)
-        {
-            throw std::bad_alloc();
-        }
-        return memory;
+        return allocate_elements<value_type>(t_PoolType, t_PoolTag, Count);
     }
 
     //
@@ -164,6 +231,96 @@ public:
 
 };
 
+template <typename T, POOL_TYPE t_PoolType>
+class tagged_allocator
+{
+public:
+
+    static_assert(!std::is_const_v<T>,
+                  "The C++ Standard forbids containers of const elements "
+                  "because allocator<const T> is ill-formed.");
+
+    static constexpr POOL_TYPE pool_type = t_PoolType;
+
+    using value_type = T;
+
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+
+    //
+    // Swapping exchanges the memory, the tags go with it. Assigning from a
+    // container with another tag reallocates under the destination tag.
+    //
+    using propagate_on_container_copy_assignment = std::false_type;
+    using propagate_on_container_move_assignment = std::false_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+    explicit constexpr tagged_allocator(ULONG PoolTag) noexcept : m_PoolTag(PoolTag)
+    {
+    }
+
+    constexpr tagged_allocator(const tagged_allocator&) noexcept = default;
+
+    template <typename Other>
+    constexpr tagged_allocator(const tagged_allocator<Other, t_PoolType>& Right) noexcept
+        : m_PoolTag(Right.pool_tag())
+    {
+    }
+
+    ~tagged_allocator() = default;
+    tagged_allocator& operator=(const tagged_allocator&) = default;
+
+    void deallocate(
+        value_type* const Memory,
+        const size_type Count) noexcept
+    {
+        if (Memory)
+        {
+            deallocate_elements(Memory, t_PoolType, m_PoolTag, Count);
+        }
+    }
+
+    _NODISCARD
+    __declspec(allocator)
+    value_type* allocate(_CRT_GUARDOVERFLOW const size_type Count)
+    {
+        return allocate_elements<value_type>(t_PoolType, m_PoolTag, Count);
+    }
+
+    ULONG pool_tag() const noexcept
+    {
+        return m_PoolTag;
+    }
+
+    template <typename Other>
+    struct rebind
+    {
+        using other = tagged_allocator<Other, t_PoolType>;
+    };
+
+private:
+
+    ULONG m_PoolTag;
+
+};
+
+template <typename T, typename U, POOL_TYPE t_PoolType>
+constexpr bool operator==(
+    const tagged_allocator<T, t_PoolType>& Left,
+    const tagged_allocator<U, t_PoolType>& Right) noexcept
+{
+    return (Left.pool_tag() == Right.pool_tag());
+}
+
+template <typename T, typename U, POOL_TYPE t_PoolType>
+constexpr bool operator!=(
+    const tagged_allocator<T, t_PoolType>& Left,
+    const tagged_allocator<U, t_PoolType>& Right) noexcept
+{
+    return (Left.pool_tag() != Right.pool_tag());
+}
+
 template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag>
 class default_delete
 {
@@ -176,13 +333,8 @@ public:
 
     constexpr default_delete() noexcept = default;
 
-    template <typename Other, std::enable_if_t<
-                              (std::is_convertible_v<T*, typename Other::value_type*> &&
-                              (t_PoolType == Other::pool_type) &&
-                              (t_PoolTag == Other::pool_tag)), int> = 0>
-    default_delete(const default_delete<typename Other::value_type, 
-                                        Other::pool_type, 
-                                        Other::pool_tag>&) noexcept 
+    template <typename Other, std::enable_if_t<std::is_convertible_v<Other*, T*>, int> = 0>
+    default_delete(const default_delete<Other, t_PoolType, t_PoolTag>&) noexcept
     {
     }
 
@@ -192,14 +344,212 @@ public:
         if (Pointer)
         {
             Pointer->~T();
-            ExFreePoolWithTag(Pointer, t_PoolTag);
+
+            //
+            // With a virtual destructor the object may be a larger derived
+            // type, sizeof(T) isn't its size. It's freed unsized so it never
+            // goes back to the magazine cache under the wrong size class.
+            //
+            if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            {
+                if constexpr (std::has_virtual_destructor_v<T>)
+                {
+                    ::operator delete(Pointer, std::align_val_t{ alignof(T) }, t_PoolType, t_PoolTag);
+                }
+                else
+                {
+                    ::operator delete(Pointer, sizeof(T), std::align_val_t{ alignof(T) }, t_PoolType, t_PoolTag);
+                }
+            }
+            else if constexpr (std::has_virtual_destructor_v<T>)
+            {
+                ::operator delete(Pointer, t_PoolType, t_PoolTag);
+            }
+            else
+            {
+                ::operator delete(Pointer, sizeof(T), t_PoolType, t_PoolTag);
+            }
+        }
+    }
+
+};
+
+template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag, size_t t_Alignment>
+class aligned_delete
+{
+public:
+
+    static_assert((t_Alignment & (t_Alignment - 1)) == 0, "alignment must be a power of two");
+    static_assert(t_Alignment >= alignof(T), "alignment must satisfy the type alignment");
+
+    static constexpr POOL_TYPE pool_type = t_PoolType;
+    static constexpr ULONG pool_tag = t_PoolTag;
+    static constexpr size_t alignment = t_Alignment;
+
+    using value_type = T;
+
+    constexpr aligned_delete() noexcept = default;
+
+    void operator()(T* Pointer) const noexcept
+    {
+        static_assert(0 < sizeof(Pointer), "can't delete an incomplete type");
+        if (Pointer)
+        {
+            Pointer->~T();
+            ::operator delete(Pointer, sizeof(T), std::align_val_t{ t_Alignment }, t_PoolType, t_PoolTag);
+        }
+    }
+
+};
+
+//
+// The element count is stored at the end of a cookie which keeps the
+// elements at their alignment.
+//
+template <typename T>
+struct array_cookie
+{
+    static constexpr size_t size = (alignof(T) > MEMORY_ALLOCATION_ALIGNMENT ?
+                                    alignof(T) : MEMORY_ALLOCATION_ALIGNMENT);
+    static_assert(size >= sizeof(size_t), "the cookie must hold the count");
+
+    static T* elements(void* Block, size_t Count) noexcept
+    {
+        auto elements = (static_cast<uint8_t*>(Block) + size);
+        reinterpret_cast<size_t*>(elements)[-1] = Count;
+        return reinterpret_cast<T*>(elements);
+    }
+
+    static void* block(T* Elements) noexcept
+    {
+        return (reinterpret_cast<uint8_t*>(Elements) - size);
+    }
+
+    static size_t block_size(T* Elements) noexcept
+    {
+        return (size + (sizeof(T) * reinterpret_cast<size_t*>(Elements)[-1]));
+    }
+};
+
+template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag>
+class default_delete<T[], t_PoolType, t_PoolTag>
+{
+public:
+
+    static_assert(std::is_trivially_destructible_v<T>,
+                  "arrays are only supported for trivially destructible types, "
+                  "use a jxy::vector instead");
+
+    static constexpr POOL_TYPE pool_type = t_PoolType;
+    static constexpr ULONG pool_tag = t_PoolTag;
+
+    using value_type = T;
+
+    constexpr default_delete() noexcept = default;
+
+    void operator()(T* Pointer) const noexcept
+    {
+        static_assert(0 < sizeof(T), "can't delete an incomplete type");
+        if (Pointer)
+        {
+            using cookie = array_cookie<T>;
+            if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            {
+                ::operator delete[](cookie::block(Pointer),
+                                    cookie::block_size(Pointer),
+                                    std::align_val_t{ alignof(T) },
+                                    t_PoolType,
+                                    t_PoolTag);
+            }
+            else
+            {
+                ::operator delete[](cookie::block(Pointer),
+                                    cookie::block_size(Pointer),
+                                    t_PoolType,
+                                    t_PoolTag);
+            }
         }
     }
 
 };
 
+//
+// Allocates the storage for an array of Count elements and its cookie
+// through the tagged array new, the elements are not constructed. The
+// result is freed by default_delete<T[]>.
+//
+template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag>
+T* allocate_array(size_t Count) noexcept(false)
+{
+    using cookie = array_cookie<T>;
+
+    if (Count > ((static_cast<size_t>(-1) - cookie::size) / sizeof(T)))
+    {
+        throw std::bad_alloc();
+    }
+
+    void* block;
+    if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+    {
+        block = ::operator new[](cookie::size + (sizeof(T) * Count), std::align_val_t{ alignof(T) }, t_PoolType, t_PoolTag);
+    }
+    else
+    {
+        block = ::operator new[](cookie::size + (sizeof(T) * Count), t_PoolType, t_PoolTag);
+    }
+    return cookie::elements(block, Count);
+}
+
 }
 
+//
+// Adapts an allocator to default-initialize rather than value-initialize
+// elements constructed without arguments. Construction with arguments is
+// passed through to the adapted allocator.
+//
+template <typename TAllocator>
+class default_init_adaptor : public TAllocator
+{
+public:
+
+    using TAllocator::TAllocator;
+
+    constexpr default_init_adaptor() noexcept = default;
+
+    constexpr default_init_adaptor(const TAllocator& Allocator) noexcept : TAllocator(Allocator)
+    {
+    }
+
+    template <typename Other>
+    constexpr default_init_adaptor(const default_init_adaptor<Other>& Right) noexcept
+        : TAllocator(static_cast<const Other&>(Right))
+    {
+    }
+
+    template <typename Other>
+    struct rebind
+    {
+        using other = default_init_adaptor<
+            typename std::allocator_traits<TAllocator>::template rebind_alloc<Other>>;
+    };
+
+    template <typename U>
+    void construct(U* const Memory) noexcept(std::is_nothrow_default_constructible_v<U>)
+    {
+        ::new (static_cast<void*>(Memory)) U;
+    }
+
+    template <typename U, typename... TArgs>
+    void construct(U* const Memory, TArgs&&... Args)
+    {
+        std::allocator_traits<TAllocator>::construct(
+            static_cast<TAllocator&>(*this),
+            Memory,
+            std::forward<TArgs>(Args)...);
+    }
+
+};
+
 template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag>
 using allocator = details::allocator<T, t_PoolType, t_PoolTag>;
 
@@ -209,6 +559,18 @@ using paged_allocator = details::allocator<T, PagedPool, t_PoolTag>;
 template <typename T, ULONG t_PoolTag>
 using non_paged_allocator = details::allocator<T, NonPagedPoolNx, t_PoolTag>;
 
+template <typename T, POOL_TYPE t_PoolType>
+using tagged_allocator = details::tagged_allocator<T, t_PoolType>;
+
+template <typename T>
+using paged_tagged_allocator = details::tagged_allocator<T, PagedPool>;
+
+template <typename T>
+using non_paged_tagged_allocator = details::tagged_allocator<T, NonPagedPoolNx>;
+
+template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag>
+using default_init_allocator = default_init_adaptor<allocator<T, t_PoolType, t_PoolTag>>;
+
 template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag>
 using default_delete = details::default_delete<T, t_PoolType, t_PoolTag>;
 
@@ -221,12 +583,72 @@ using default_non_paged_delete = details::default_delete<T, NonPagedPoolNx, t_Po
 template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag, typename TDeleter = default_delete<T, t_PoolType, t_PoolTag>>
 using unique_ptr = std::unique_ptr<T, TDeleter>;
 
-template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag, typename... TArgs>
+template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag, typename... TArgs, std::enable_if_t<!std::is_array_v<T>, int> = 0>
 unique_ptr<T, t_PoolType, t_PoolTag> make_unique(TArgs&&... Args) noexcept(false)
 {
     return unique_ptr<T, t_PoolType, t_PoolTag>(new(t_PoolType, t_PoolTag)T(std::forward<TArgs>(Args)...));
 }
 
+template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag, std::enable_if_t<(std::is_array_v<T> && (std::extent_v<T> == 0)), int> = 0>
+unique_ptr<T, t_PoolType, t_PoolTag> make_unique(size_t Count) noexcept(false)
+{
+    using element_type = std::remove_extent_t<T>;
+    unique_ptr<T, t_PoolType, t_PoolTag> pointer(details::allocate_array<element_type, t_PoolType, t_PoolTag>(Count));
+    std::uninitialized_value_construct_n(pointer.get(), Count);
+    return pointer;
+}
+
+template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag, std::enable_if_t<!std::is_array_v<T>, int> = 0>
+unique_ptr<T, t_PoolType, t_PoolTag> make_unique_for_overwrite() noexcept(false)
+{
+    return unique_ptr<T, t_PoolType, t_PoolTag>(new(t_PoolType, t_PoolTag)T);
+}
+
+template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag, std::enable_if_t<(std::is_array_v<T> && (std::extent_v<T> == 0)), int> = 0>
+unique_ptr<T, t_PoolType, t_PoolTag> make_unique_for_overwrite(size_t Count) noexcept(false)
+{
+    using element_type = std::remove_extent_t<T>;
+    unique_ptr<T, t_PoolType, t_PoolTag> pointer(details::allocate_array<element_type, t_PoolType, t_PoolTag>(Count));
+    std::uninitialized_default_construct_n(pointer.get(), Count);
+    return pointer;
+}
+
+//
+// Places the object on its own cache line(s) by default, useful for per-CPU
+// counters and lock words that would otherwise false share.
+//
+template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag, size_t t_Alignment = SYSTEM_CACHE_ALIGNMENT_SIZE>
+using aligned_unique_ptr = std::unique_ptr<T, details::aligned_delete<T, t_PoolType, t_PoolTag,
+                                                                      (t_Alignment > alignof(T) ? t_Alignment : alignof(T))>>;
+
+template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag, size_t t_Alignment = SYSTEM_CACHE_ALIGNMENT_SIZE, typename... TArgs>
+aligned_unique_ptr<T, t_PoolType, t_PoolTag, t_Alignment> make_unique_aligned(TArgs&&... Args) noexcept(false)
+{
+    using pointer_type = aligned_unique_ptr<T, t_PoolType, t_PoolTag, t_Alignment>;
+    constexpr auto alignment = std::align_val_t{ pointer_type::deleter_type::alignment };
+
+    auto memory = ::operator new(sizeof(T), alignment, t_PoolType, t_PoolTag);
+    try
+    {
+        return pointer_type(::new (memory) T(std::forward<TArgs>(Args)...));
+    }
+    catch (...)
+    {
+        ::operator delete(memory, sizeof(T), alignment, t_PoolType, t_PoolTag);
+        throw;
+    }
+}
+
+//
+// Pads and aligns a value to a cache line, a jxy::vector of these keeps each
+// element on its own cache line.
+//
+template <typename T>
+struct alignas(SYSTEM_CACHE_ALIGNMENT_SIZE) cache_aligned
+{
+    T value;
+};
+
 template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag>
 using shared_ptr = std::shared_ptr<T>;
 
@@ -248,4 +670,16 @@ shared_ptr<T, t_PoolType, t_PoolTag> make_shared(TArgs&&... Args) noexcept(false
     return std::allocate_shared<T, allocator>(allocator(), std::forward<TArgs>(Args)...);
 }
 
+//
+// std::allocate_shared constructs through the allocator, the default-init
+// adaptor makes that a default-initialization. Arrays are not supported, the
+// cpp17 std::allocate_shared does not take them.
+//
+template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag, std::enable_if_t<!std::is_array_v<T>, int> = 0>
+shared_ptr<T, t_PoolType, t_PoolTag> make_shared_for_overwrite() noexcept(false)
+{
+    using allocator = jxy::default_init_allocator<T, t_PoolType, t_PoolTag>;
+    return std::allocate_shared<T, allocator>(allocator());
+}
+
 }
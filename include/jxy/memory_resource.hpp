@@ -0,0 +1,246 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/memory_resource.hpp
+// Author:   Johnny Shaw
+// Abstract: Pool type and tag aware memory resources <memory_resource>
+//
+// The jxy containers carry the pool type and tag as template parameters,
+// every pool type and tag combination is a distinct type. The jxy::pmr
+// resources carry the pool type and tag at runtime instead, containers using
+// std::pmr::polymorphic_allocator (jxy::pmr::vector, jxy::pmr::map, etc.)
+// are a single type regardless of the resource, pool type, or tag.
+//
+// Every resource here bottoms out at a jxy::pmr::tagged_resource, so a pool
+// type and tag must always be specified. There is intentionally no default
+// resource, std::pmr::get_default_resource is not implemented and anything
+// using it (such as default constructing a polymorphic_allocator) will not
+// link.
+//
+// Resources compare equal only to themselves. Two tagged resources for the
+// same pool type and tag would be interchangeable, but telling that a
+// memory_resource is a tagged resource needs RTTI, which the kernel doesn't
+// have.
+//
+// jxylib                                   STL equivalent
+// ---------------------------------------------------------------------------
+// jxy::pmr::tagged_resource                std::pmr::new_delete_resource
+// jxy::pmr::unsynchronized_pool_resource   std::pmr::unsynchronized_pool_resource
+// jxy::pmr::synchronized_pool_resource     std::pmr::synchronized_pool_resource
+// jxy::pmr::monotonic_buffer_resource      std::pmr::monotonic_buffer_resource
+//
+#pragma once
+#include <fltKernel.h>
+#include <jxy/locks.hpp>
+#include <memory_resource>
+
+namespace jxy::pmr
+{
+
+using memory_resource = std::pmr::memory_resource;
+using pool_options = std::pmr::pool_options;
+
+template <typename T>
+using polymorphic_allocator = std::pmr::polymorphic_allocator<T>;
+
+class tagged_resource : public memory_resource
+{
+public:
+
+    tagged_resource(POOL_TYPE PoolType, ULONG PoolTag) noexcept
+        : m_PoolType(PoolType),
+          m_PoolTag(PoolTag)
+    {
+    }
+
+    tagged_resource(const tagged_resource&) = default;
+    tagged_resource& operator=(const tagged_resource&) = default;
+
+    POOL_TYPE pool_type() const noexcept
+    {
+        return m_PoolType;
+    }
+
+    ULONG pool_tag() const noexcept
+    {
+        return m_PoolTag;
+    }
+
+protected:
+
+    void* do_allocate(size_t Bytes, size_t Align) override;
+
+    void do_deallocate(void* Memory, size_t Bytes, size_t Align) override;
+
+    bool do_is_equal(const memory_resource& Other) const noexcept override;
+
+private:
+
+    POOL_TYPE m_PoolType;
+    ULONG m_PoolTag;
+
+};
+
+namespace details
+{
+
+//
+// The std pool resources take their upstream resource at construction.
+// This holds the tagged upstream so it is constructed before (and destroyed
+// after) the std resource that uses it.
+//
+class tagged_upstream
+{
+protected:
+
+    tagged_upstream(POOL_TYPE PoolType, ULONG PoolTag) noexcept
+        : m_Upstream(PoolType, PoolTag)
+    {
+    }
+
+    tagged_resource m_Upstream;
+
+};
+
+}
+
+class unsynchronized_pool_resource : private details::tagged_upstream,
+                                     public std::pmr::unsynchronized_pool_resource
+{
+public:
+
+    unsynchronized_pool_resource(
+        POOL_TYPE PoolType,
+        ULONG PoolTag,
+        const pool_options& Options = {}) noexcept(false)
+        : details::tagged_upstream(PoolType, PoolTag),
+          std::pmr::unsynchronized_pool_resource(Options, &m_Upstream)
+    {
+    }
+
+    POOL_TYPE pool_type() const noexcept
+    {
+        return m_Upstream.pool_type();
+    }
+
+    ULONG pool_tag() const noexcept
+    {
+        return m_Upstream.pool_tag();
+    }
+
+};
+
+//
+// The MSVC synchronized_pool_resource depends on std::mutex. This guards an
+// unsynchronized pool with a jxy::shared_mutex (push lock) instead, it may be
+// used at or below APC_LEVEL.
+//
+class synchronized_pool_resource : public memory_resource
+{
+public:
+
+    synchronized_pool_resource(
+        POOL_TYPE PoolType,
+        ULONG PoolTag,
+        const pool_options& Options = {}) noexcept(false)
+        : m_Resource(PoolType, PoolTag, Options)
+    {
+    }
+
+    void release() noexcept
+    {
+        jxy::unique_lock<jxy::shared_mutex> lock(m_Lock);
+        m_Resource.release();
+    }
+
+    memory_resource* upstream_resource() const noexcept
+    {
+        return m_Resource.upstream_resource();
+    }
+
+    pool_options options() const noexcept
+    {
+        return m_Resource.options();
+    }
+
+    POOL_TYPE pool_type() const noexcept
+    {
+        return m_Resource.pool_type();
+    }
+
+    ULONG pool_tag() const noexcept
+    {
+        return m_Resource.pool_tag();
+    }
+
+protected:
+
+    void* do_allocate(size_t Bytes, size_t Align) override
+    {
+        jxy::unique_lock<jxy::shared_mutex> lock(m_Lock);
+        return m_Resource.allocate(Bytes, Align);
+    }
+
+    void do_deallocate(void* Memory, size_t Bytes, size_t Align) override
+    {
+        jxy::unique_lock<jxy::shared_mutex> lock(m_Lock);
+        m_Resource.deallocate(Memory, Bytes, Align);
+    }
+
+    bool do_is_equal(const memory_resource& Other) const noexcept override
+    {
+        return (this == &Other);
+    }
+
+private:
+
+    jxy::shared_mutex m_Lock;
+    unsynchronized_pool_resource m_Resource;
+
+};
+
+class monotonic_buffer_resource : private details::tagged_upstream,
+                                  public std::pmr::monotonic_buffer_resource
+{
+public:
+
+    monotonic_buffer_resource(
+        POOL_TYPE PoolType,
+        ULONG PoolTag) noexcept
+        : details::tagged_upstream(PoolType, PoolTag),
+          std::pmr::monotonic_buffer_resource(&m_Upstream)
+    {
+    }
+
+    monotonic_buffer_resource(
+        POOL_TYPE PoolType,
+        ULONG PoolTag,
+        size_t InitialSize) noexcept
+        : details::tagged_upstream(PoolType, PoolTag),
+          std::pmr::monotonic_buffer_resource(InitialSize, &m_Upstream)
+    {
+    }
+
+    monotonic_buffer_resource(
+        POOL_TYPE PoolType,
+        ULONG PoolTag,
+        void* Buffer,
+        size_t BufferSize) noexcept
+        : details::tagged_upstream(PoolType, PoolTag),
+          std::pmr::monotonic_buffer_resource(Buffer, BufferSize, &m_Upstream)
+    {
+    }
+
+    POOL_TYPE pool_type() const noexcept
+    {
+        return m_Upstream.pool_type();
+    }
+
+    ULONG pool_tag() const noexcept
+    {
+        return m_Upstream.pool_tag();
+    }
+
+};
+
+}
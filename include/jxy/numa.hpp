@@ -0,0 +1,182 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/numa.hpp
+// Author:   Johnny Shaw
+// Abstract: NUMA node aware allocation
+//
+// The jxy::numa_allocator and the node aware tagged new prefer memory from
+// a specific NUMA node, by default the node of the current processor. This
+// uses ExAllocatePool3 with a preferred node extended parameter (Windows 10
+// 2004 and later). The node is a preference, the pool may satisfy the
+// request from another node when the preferred node is exhausted.
+//
+// Node aware memory is ordinary pool memory and is freed with the usual
+// tagged delete or any jxy allocator of the same pool tag. The
+// jxy::numa_allocator instances compare equal only for the same node, so
+// containers don't move elements between allocators for different nodes.
+// Note that a sized delete may return a block to the magazine cache (see
+// jxy/magazine.hpp), which does not track nodes.
+//
+// jxylib                   STL equivalent
+// ---------------------------------------------------------------------------
+// jxy::numa_allocator      std::allocator
+//
+#pragma once
+#include <fltKernel.h>
+#include <jxy/memory.hpp>
+
+namespace jxy
+{
+
+static constexpr ULONG numa_current_node = static_cast<ULONG>(-1);
+
+//
+// Selects the node aware tagged new, for example:
+// new (NonPagedPoolNx, 'gaT0', jxy::numa_node{}) T();
+// new (NonPagedPoolNx, 'gaT0', jxy::numa_node{ 1 }) T();
+//
+struct numa_node
+{
+    ULONG number = numa_current_node;
+};
+
+namespace details
+{
+
+ULONG numa_resolve_node(ULONG Node) noexcept;
+
+void* numa_pool_allocate(
+    POOL_TYPE PoolType,
+    size_t Size,
+    ULONG PoolTag,
+    ULONG Node) noexcept;
+
+template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag>
+class numa_allocator
+{
+public:
+
+    static_assert(!std::is_const_v<T>,
+                  "The C++ Standard forbids containers of const elements "
+                  "because allocator<const T> is ill-formed.");
+    static_assert(alignof(T) <= MEMORY_ALLOCATION_ALIGNMENT,
+                  "over-aligned types are not supported by the numa allocator");
+
+    static constexpr POOL_TYPE pool_type = t_PoolType;
+    static constexpr ULONG pool_tag = t_PoolTag;
+
+    using value_type = T;
+
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+    constexpr numa_allocator(ULONG Node = numa_current_node) noexcept : m_Node(Node)
+    {
+    }
+
+    constexpr numa_allocator(const numa_allocator&) noexcept = default;
+
+    template <typename Other>
+    constexpr numa_allocator(const numa_allocator<Other, t_PoolType, t_PoolTag>& Right) noexcept
+        : m_Node(Right.node())
+    {
+    }
+
+    ~numa_allocator() = default;
+    numa_allocator& operator=(const numa_allocator&) = default;
+
+    void deallocate(
+        value_type* const Memory,
+        const size_type Count) noexcept
+    {
+        if (Memory)
+        {
+            details::pool_stats_free(t_PoolTag, (sizeof(value_type) * Count));
+            ExFreePoolWithTag(Memory, t_PoolTag);
+        }
+    }
+
+    _NODISCARD
+    __declspec(allocator)
+    value_type* allocate(_CRT_GUARDOVERFLOW const size_type Count)
+    {
+        if (Count > (static_cast<size_type>(-1) / sizeof(value_type)))
+        {
+            throw std::bad_alloc();
+        }
+
+        auto memory = static_cast<value_type*>(
+            numa_pool_allocate(t_PoolType,
+                               (sizeof(value_type) * Count),
+                               t_PoolTag,
+                               m_Node));
+        if (!memory)
+        {
+            throw std::bad_alloc();
+        }
+        details::pool_stats_allocate(t_PoolTag, (sizeof(value_type) * Count));
+        details::pool_trace_allocate(t_PoolTag, (sizeof(value_type) * Count));
+        return memory;
+    }
+
+    //
+    // The preferred node, jxy::numa_current_node means the node of the
+    // processor doing the allocation.
+    //
+    constexpr ULONG node() const noexcept
+    {
+        return m_Node;
+    }
+
+    template <typename Other>
+    struct rebind
+    {
+        using other = numa_allocator<Other, t_PoolType, t_PoolTag>;
+    };
+
+private:
+
+    ULONG m_Node;
+
+};
+
+template <typename T, typename U, POOL_TYPE t_PoolType, ULONG t_PoolTag>
+constexpr bool operator==(
+    const numa_allocator<T, t_PoolType, t_PoolTag>& Left,
+    const numa_allocator<U, t_PoolType, t_PoolTag>& Right) noexcept
+{
+    return (Left.node() == Right.node());
+}
+
+template <typename T, typename U, POOL_TYPE t_PoolType, ULONG t_PoolTag>
+constexpr bool operator!=(
+    const numa_allocator<T, t_PoolType, t_PoolTag>& Left,
+    const numa_allocator<U, t_PoolType, t_PoolTag>& Right) noexcept
+{
+    return !(Left == Right);
+}
+
+}
+
+template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag>
+using numa_allocator = details::numa_allocator<T, t_PoolType, t_PoolTag>;
+
+template <typename T, ULONG t_PoolTag>
+using paged_numa_allocator = details::numa_allocator<T, PagedPool, t_PoolTag>;
+
+template <typename T, ULONG t_PoolTag>
+using non_paged_numa_allocator = details::numa_allocator<T, NonPagedPoolNx, t_PoolTag>;
+
+}
+
+void* __cdecl operator new(size_t Size, POOL_TYPE PoolType, ULONG PoolTag, jxy::numa_node Node) noexcept(false);
+
+void __cdecl operator delete(void* Memory, POOL_TYPE PoolType, ULONG PoolTag, jxy::numa_node Node) noexcept;
+
+void __cdecl operator delete(void* Memory, size_t Size, POOL_TYPE PoolType, ULONG PoolTag, jxy::numa_node Node) noexcept;
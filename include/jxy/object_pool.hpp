@@ -0,0 +1,189 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/object_pool.hpp
+// Author:   Johnny Shaw
+// Abstract: Recycling pool of constructed objects
+//
+// jxy::object_pool hands out objects which are already constructed and takes
+// them back on release without destroying them. Anything the object owns is
+// kept, a pooled jxy::wstring keeps its capacity, so a scratch object used
+// on a hot path (a notify routine, for example) stops reallocating once the
+// pool is warm. Released objects are pushed onto an interlocked singly linked
+// list (up to a maximum depth) and popped on the next acquire, beyond the
+// depth they're destroyed.
+//
+// An object is handed out in the state it was released in, for example a
+// pooled string still holds its last contents, reset it before use. New
+// objects are value-initialized.
+//
+// The pool registers a trim callback (see jxy/trim.hpp), jxy::trim_caches
+// destroys the cached objects. The pool must outlive the objects acquired
+// from it.
+//
+// jxylib                       STL equivalent
+// ---------------------------------------------------------------------------
+// jxy::object_pool             None
+//
+#pragma once
+#include <fltKernel.h>
+#include <jxy/memory.hpp>
+#include <jxy/trim.hpp>
+
+namespace jxy
+{
+
+template <typename T, POOL_TYPE t_PoolType, ULONG t_PoolTag, USHORT t_Depth = 32>
+class object_pool
+{
+    struct node
+    {
+        SLIST_ENTRY Entry;
+        T Value;
+    };
+
+public:
+
+    static constexpr POOL_TYPE pool_type = t_PoolType;
+    static constexpr ULONG pool_tag = t_PoolTag;
+    static constexpr USHORT depth = t_Depth;
+
+    using value_type = T;
+
+    class releaser
+    {
+    public:
+
+        constexpr releaser() noexcept = default;
+
+        constexpr releaser(object_pool* Pool) noexcept : m_Pool(Pool)
+        {
+        }
+
+        void operator()(T* Object) const noexcept
+        {
+            if (Object)
+            {
+                m_Pool->release(Object);
+            }
+        }
+
+    private:
+
+        object_pool* m_Pool = nullptr;
+
+    };
+
+    using pointer = std::unique_ptr<T, releaser>;
+
+    object_pool() noexcept : m_Trim(&trim, this)
+    {
+        InitializeSListHead(&m_Free);
+        m_Trim.register_callback();
+    }
+
+    ~object_pool() noexcept
+    {
+        m_Trim.unregister_callback();
+        flush();
+    }
+
+    object_pool(const object_pool&) = delete;
+    object_pool& operator=(const object_pool&) = delete;
+
+    //
+    // Returns a cached object or a new value-initialized one.
+    //
+    _NODISCARD
+    pointer acquire() noexcept(false)
+    {
+        InterlockedIncrement(&m_TotalAcquires);
+
+        auto entry = InterlockedPopEntrySList(&m_Free);
+        if (entry)
+        {
+            return pointer(&CONTAINING_RECORD(entry, node, Entry)->Value, releaser(this));
+        }
+
+        InterlockedIncrement(&m_AcquireMisses);
+
+        auto created = jxy::make_unique<node, t_PoolType, t_PoolTag>();
+        return pointer(&created.release()->Value, releaser(this));
+    }
+
+    //
+    // Takes an object back, it is destroyed only when the pool is full.
+    //
+    void release(T* Object) noexcept
+    {
+        auto released = CONTAINING_RECORD(Object, node, Value);
+
+        //
+        // The depth check is racy, like the lookaside lists we may overshoot
+        // the maximum depth by a few entries under contention.
+        //
+        if (QueryDepthSList(&m_Free) < t_Depth)
+        {
+            InterlockedPushEntrySList(&m_Free, &released->Entry);
+            return;
+        }
+
+        default_delete<node, t_PoolType, t_PoolTag>()(released);
+    }
+
+    //
+    // Destroys the cached objects. Returns the number of bytes of nodes
+    // released, memory owned by the objects is not counted.
+    //
+    size_t flush() noexcept
+    {
+        size_t bytes = 0;
+
+        auto entry = InterlockedFlushSList(&m_Free);
+        while (entry)
+        {
+            auto next = entry->Next;
+            default_delete<node, t_PoolType, t_PoolTag>()(CONTAINING_RECORD(entry, node, Entry));
+            bytes += sizeof(node);
+            entry = next;
+        }
+
+        return bytes;
+    }
+
+    USHORT cached() noexcept
+    {
+        return QueryDepthSList(&m_Free);
+    }
+
+    ULONG total_acquires() const noexcept
+    {
+        return static_cast<ULONG>(m_TotalAcquires);
+    }
+
+    ULONG acquire_misses() const noexcept
+    {
+        return static_cast<ULONG>(m_AcquireMisses);
+    }
+
+private:
+
+    static size_t trim(void* Context) noexcept
+    {
+        return static_cast<object_pool*>(Context)->flush();
+    }
+
+    SLIST_HEADER m_Free;
+    details::trim_callback m_Trim;
+    LONG m_TotalAcquires = 0;
+    LONG m_AcquireMisses = 0;
+
+};
+
+template <typename T, ULONG t_PoolTag, USHORT t_Depth = 32>
+using paged_object_pool = object_pool<T, PagedPool, t_PoolTag, t_Depth>;
+
+template <typename T, ULONG t_PoolTag, USHORT t_Depth = 32>
+using non_paged_object_pool = object_pool<T, NonPagedPoolNx, t_PoolTag, t_Depth>;
+
+}
@@ -0,0 +1,192 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/per_cpu_rings.hpp
+// Author:   Johnny Shaw
+// Abstract: Per processor single producer rings drained by one consumer
+//
+// jxy::per_cpu_rings fans many producers into one consumer without a shared
+// lock or a shared cache line. There is one jxy::spsc_ring per processor,
+// a push raises to DISPATCH_LEVEL so nothing else runs on the processor,
+// which makes the processor the only producer of its ring. The consumer
+// drains the rings in batches, in order per processor but not across
+// processors.
+//
+// A push never waits and never allocates, the rings are allocated when
+// constructed. A push to a full ring fails and counts a drop for that ring.
+// Pushing is callable at or below DISPATCH_LEVEL. A push above it fails and
+// counts a drop, it could interrupt a push on the same processor. Since the
+// rings are written at DISPATCH_LEVEL the pool type must be non-paged.
+//
+// jxylib                   STL equivalent
+// ---------------------------------------------------------------------------
+// jxy::per_cpu_rings       None
+//
+#pragma once
+#include <fltKernel.h>
+#include <jxy/memory.hpp>
+#include <jxy/vector.hpp>
+#include <jxy/spsc_ring.hpp>
+
+namespace jxy
+{
+
+template <typename T, size_t t_Capacity, POOL_TYPE t_PoolType, ULONG t_PoolTag>
+class per_cpu_rings
+{
+    //
+    // Bit 0 of the pool type is the paged base type.
+    //
+    static_assert((static_cast<ULONG>(t_PoolType) & 0x1) == 0,
+                  "the rings are pushed to at DISPATCH_LEVEL, use a non-paged pool type");
+
+public:
+
+    using ring_type = spsc_ring<T, t_Capacity, t_PoolType, t_PoolTag>;
+
+private:
+
+    struct cpu_ring
+    {
+        ring_type Ring;
+        volatile LONG Dropped = 0;
+    };
+
+    using ring_pointer = unique_ptr<cpu_ring, t_PoolType, t_PoolTag>;
+
+public:
+
+    static constexpr POOL_TYPE pool_type = t_PoolType;
+    static constexpr ULONG pool_tag = t_PoolTag;
+
+    using value_type = T;
+    using size_type = size_t;
+
+    _IRQL_requires_max_(APC_LEVEL)
+    per_cpu_rings() noexcept(false)
+    {
+        auto count = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+        m_Rings.reserve(count);
+        for (ULONG i = 0; i < count; i++)
+        {
+            m_Rings.emplace_back(make_unique<cpu_ring, t_PoolType, t_PoolTag>());
+        }
+    }
+
+    per_cpu_rings(const per_cpu_rings&) = delete;
+    per_cpu_rings& operator=(const per_cpu_rings&) = delete;
+
+    //
+    // Constructs an element in the ring of the current processor. Returns
+    // false and counts a drop if the ring is full.
+    //
+    template <typename... TArgs>
+    _IRQL_requires_max_(DISPATCH_LEVEL)
+    bool try_emplace(TArgs&&... Args) noexcept(std::is_nothrow_constructible_v<T, TArgs&&...>)
+    {
+        if (KeGetCurrentIrql() > DISPATCH_LEVEL)
+        {
+            NT_ASSERT(false);
+            InterlockedIncrement(&m_Rings[KeGetCurrentProcessorNumberEx(nullptr)]->Dropped);
+            return false;
+        }
+
+        auto oldIrql = KeRaiseIrqlToDpcLevel();
+
+        auto cpu = m_Rings[KeGetCurrentProcessorNumberEx(nullptr)].get();
+        auto pushed = cpu->Ring.try_emplace(std::forward<TArgs>(Args)...);
+        if (!pushed)
+        {
+            InterlockedIncrement(&cpu->Dropped);
+        }
+
+        KeLowerIrql(oldIrql);
+
+        return pushed;
+    }
+
+    _IRQL_requires_max_(DISPATCH_LEVEL)
+    bool try_push(const T& Value) noexcept(std::is_nothrow_copy_constructible_v<T>)
+    {
+        return try_emplace(Value);
+    }
+
+    _IRQL_requires_max_(DISPATCH_LEVEL)
+    bool try_push(T&& Value) noexcept(std::is_nothrow_move_constructible_v<T>)
+    {
+        return try_emplace(std::move(Value));
+    }
+
+    //
+    // Consumer side. Pops up to MaxBatch elements from each ring in turn,
+    // calling Function(T&) for each, and returns the number popped. The
+    // rings are drained once each, call again until it returns 0 to empty
+    // them.
+    //
+    template <typename TFunction>
+    size_type drain(TFunction&& Function, size_type MaxBatch = t_Capacity)
+    {
+        size_type popped = 0;
+        for (auto& cpu : m_Rings)
+        {
+            popped += cpu->Ring.pop_batch(Function, MaxBatch);
+        }
+        return popped;
+    }
+
+    //
+    // The ring of processor Index, for a consumer which drains the rings on
+    // its own schedule. Don't push to it directly.
+    //
+    ring_type& ring(size_type Index) noexcept
+    {
+        return m_Rings[Index]->Ring;
+    }
+
+    size_type ring_count() const noexcept
+    {
+        return m_Rings.size();
+    }
+
+    size_type dropped(size_type Index) const noexcept
+    {
+        return static_cast<ULONG>(ReadNoFence(&m_Rings[Index]->Dropped));
+    }
+
+    size_type dropped() const noexcept
+    {
+        size_type count = 0;
+        for (size_type i = 0; i < m_Rings.size(); i++)
+        {
+            count += dropped(i);
+        }
+        return count;
+    }
+
+    //
+    // The number of elements over all the rings, with concurrent producers
+    // it is a snapshot of no single moment.
+    //
+    size_type size() const noexcept
+    {
+        size_type count = 0;
+        for (auto& cpu : m_Rings)
+        {
+            count += cpu->Ring.size();
+        }
+        return count;
+    }
+
+    _NODISCARD
+    bool empty() const noexcept
+    {
+        return (size() == 0);
+    }
+
+private:
+
+    vector<ring_pointer, t_PoolType, t_PoolTag> m_Rings;
+
+};
+
+}
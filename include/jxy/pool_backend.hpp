@@ -0,0 +1,102 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/pool_backend.hpp
+// Author:   Johnny Shaw
+// Abstract: Pool allocation backend
+//
+// Every pool allocation made by jxystl goes through jxy::details::pool_allocate
+// or jxy::details::pool_allocate_zero. The backend is selected at compile
+// time with JXY_POOL_BACKEND, which must be the same for jxystl and
+// everything using it.
+//
+// JXY_POOL_BACKEND_WITH_TAG (the default) uses ExAllocatePoolWithTag and
+// runs on every supported version of Windows. JXY_POOL_BACKEND_POOL2 uses
+// ExAllocatePool2 (Windows 10 2004 and later). ExAllocatePool2 zeroes by
+// default, the backend always passes POOL_FLAG_UNINITIALIZED and only
+// zeroes when asked to, so both backends have the same semantics.
+// JXY_POOL_BACKEND_POOL3 uses ExAllocatePool3 (also Windows 10 2004 and
+// later) with the same flags and a priority extended parameter, the priority
+// is JXY_POOL_PRIORITY (NormalPoolPriority by default). A lower priority lets
+// the pool fail the allocations of a driver that can do without them when
+// memory is low.
+//
+// pool_allocate leaves the memory uninitialized, like ExAllocatePoolWithTag
+// always has. Use it for buffers that are immediately overwritten, zeroing
+// a large buffer first is a full pass over memory for nothing.
+// pool_allocate_zero is for memory that must start out zeroed, with the
+// ExAllocatePool2 backend the pool zeroes it.
+//
+#pragma once
+#include <fltKernel.h>
+#include <jxy/alloc.hpp>
+
+#define JXY_POOL_BACKEND_WITH_TAG 0
+#define JXY_POOL_BACKEND_POOL2 1
+#define JXY_POOL_BACKEND_POOL3 2
+
+#ifndef JXY_POOL_BACKEND
+#define JXY_POOL_BACKEND JXY_POOL_BACKEND_WITH_TAG
+#endif
+
+#ifndef JXY_POOL_PRIORITY
+#define JXY_POOL_PRIORITY NormalPoolPriority
+#endif
+
+namespace jxy::details
+{
+
+#if JXY_POOL_BACKEND == JXY_POOL_BACKEND_POOL3
+
+inline void* pool_allocate3(POOL_FLAGS Flags, size_t Size, ULONG PoolTag) noexcept
+{
+    POOL_EXTENDED_PARAMETER parameter;
+    RtlZeroMemory(&parameter, sizeof(parameter));
+    parameter.Type = PoolExtendedParameterPriority;
+    parameter.Optional = FALSE;
+    parameter.Priority = JXY_POOL_PRIORITY;
+
+    return ExAllocatePool3(Flags, Size, PoolTag, &parameter, 1);
+}
+
+#endif
+
+inline void* pool_allocate(POOL_TYPE PoolType, size_t Size, ULONG PoolTag) noexcept
+{
+#if JXY_POOL_BACKEND == JXY_POOL_BACKEND_POOL3
+    return pool_allocate3(pool_type_to_flags(PoolType), Size, PoolTag);
+#elif JXY_POOL_BACKEND == JXY_POOL_BACKEND_POOL2
+    return ExAllocatePool2(pool_type_to_flags(PoolType), Size, PoolTag);
+#else
+    //
+    // ExAllocatePoolWithTag is deprecated in favor of ExAllocatePool2, it is
+    // still the only one on Windows before 10 2004.
+    //
+#pragma warning(push)
+#pragma warning(disable : 4996)
+    return ExAllocatePoolWithTag(PoolType, Size, PoolTag);
+#pragma warning(pop)
+#endif
+}
+
+inline void* pool_allocate_zero(POOL_TYPE PoolType, size_t Size, ULONG PoolTag) noexcept
+{
+#if JXY_POOL_BACKEND == JXY_POOL_BACKEND_POOL3
+    return pool_allocate3((pool_type_to_flags(PoolType) & ~POOL_FLAG_UNINITIALIZED),
+                          Size,
+                          PoolTag);
+#elif JXY_POOL_BACKEND == JXY_POOL_BACKEND_POOL2
+    return ExAllocatePool2((pool_type_to_flags(PoolType) & ~POOL_FLAG_UNINITIALIZED),
+                           Size,
+                           PoolTag);
+#else
+    auto memory = pool_allocate(PoolType, Size, PoolTag);
+    if (memory)
+    {
+        RtlZeroMemory(memory, Size);
+    }
+    return memory;
+#endif
+}
+
+}
@@ -0,0 +1,96 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/pool_stats.hpp
+// Author:   Johnny Shaw
+// Abstract: Per-tag live allocation statistics
+//
+// Optional instrumentation of the jxy allocators and tagged new/delete. When
+// JXY_POOL_STATS is defined to 1 (for jxystl and everything using it) each
+// allocation and free is counted against its pool tag. Counters are sharded
+// per CPU and updated with interlocked operations, there are no locks. When
+// JXY_POOL_STATS is 0 (the default) the recording functions are empty inline
+// functions and the instrumentation compiles away entirely.
+//
+// Statistics are collected between jxy::initialize_pool_stats and
+// jxy::uninitialize_pool_stats. Up to jxy::pool_stats_max_tags distinct tags
+// are tracked, allocations for tags beyond that are counted against the
+// overflow entry (tag 0).
+//
+// Bytes outstanding is only accurate for frees that know their size. The
+// allocators, sized deletes, jxy deleters and memory resources always do.
+// The unsized tagged deletes count the free but leave its bytes outstanding.
+// Uninitializing waits for recording in progress on other threads. The peak is
+// sampled as a CPU's share of a tag grows and is accurate to within a page
+// per CPU.
+//
+#pragma once
+#include <fltKernel.h>
+#include <cstdint>
+
+#ifndef JXY_POOL_STATS
+#define JXY_POOL_STATS 0
+#endif
+
+namespace jxy
+{
+
+static constexpr size_t pool_stats_max_tags = 128;
+
+//
+// Power of two size buckets, 16 bytes or less through 64KB or more.
+//
+static constexpr size_t pool_stats_histogram_buckets = 13;
+
+struct pool_tag_stats
+{
+    ULONG tag;
+    uint64_t allocations;
+    uint64_t frees;
+    int64_t bytes_outstanding;
+    int64_t peak_bytes;
+    uint64_t histogram[pool_stats_histogram_buckets];
+};
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS initialize_pool_stats() noexcept;
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void uninitialize_pool_stats() noexcept;
+
+//
+// Copies out up to Count entries, one for each tag seen. Returns the number
+// of tags being tracked, which may be more than Count.
+//
+size_t query_pool_stats(pool_tag_stats* Stats, size_t Count) noexcept;
+
+//
+// Gets the statistics for a single tag, returns false if the tag has not
+// been seen.
+//
+bool query_pool_tag_stats(ULONG PoolTag, pool_tag_stats& Stats) noexcept;
+
+namespace details
+{
+
+#if JXY_POOL_STATS
+
+void pool_stats_allocate(ULONG PoolTag, size_t Size) noexcept;
+
+void pool_stats_free(ULONG PoolTag, size_t Size) noexcept;
+
+#else
+
+inline void pool_stats_allocate(ULONG, size_t) noexcept
+{
+}
+
+inline void pool_stats_free(ULONG, size_t) noexcept
+{
+}
+
+#endif
+
+}
+
+}
@@ -0,0 +1,79 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/pool_trace.hpp
+// Author:   Johnny Shaw
+// Abstract: Per-tag allocation call site tracing
+//
+// Optional instrumentation that attributes allocations to the code that made
+// them. When JXY_POOL_TRACE is defined to 1 (for jxystl and everything using
+// it) the jxy allocators and tagged new capture a short stack back trace for
+// each allocation. The call site is a hash of the return addresses, counts
+// and bytes are aggregated per (tag, call site). When JXY_POOL_TRACE is 0
+// (the default) the recording function is an empty inline function and the
+// instrumentation compiles away entirely.
+//
+// Call sites are assigned a slot in a global table the first time they're
+// seen, the slot is claimed with a compare exchange. Counters are per CPU,
+// there are no locks. Up to jxy::pool_trace_max_sites sites are tracked,
+// allocations from sites beyond that are counted against the overflow entry
+// (site hash 0). The return addresses of the first allocation from a site
+// are kept, resolve them with the debugger (ln) to find the code path.
+//
+// Capturing a back trace on every allocation is not free, this is meant for
+// finding hot allocation sites, not for production builds.
+//
+#pragma once
+#include <fltKernel.h>
+#include <cstdint>
+
+#ifndef JXY_POOL_TRACE
+#define JXY_POOL_TRACE 0
+#endif
+
+namespace jxy
+{
+
+static constexpr size_t pool_trace_max_sites = 512;
+static constexpr size_t pool_trace_frames = 6;
+
+struct pool_site_stats
+{
+    ULONG tag;
+    ULONG site;
+    uint64_t allocations;
+    uint64_t bytes;
+    void* frames[pool_trace_frames];
+};
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS initialize_pool_trace() noexcept;
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void uninitialize_pool_trace() noexcept;
+
+//
+// Copies out up to Count entries, one for each call site seen. Returns the
+// number of call sites being tracked, which may be more than Count.
+//
+size_t query_pool_trace(pool_site_stats* Sites, size_t Count) noexcept;
+
+namespace details
+{
+
+#if JXY_POOL_TRACE
+
+DECLSPEC_NOINLINE
+void pool_trace_allocate(ULONG PoolTag, size_t Size) noexcept;
+
+#else
+
+inline void pool_trace_allocate(ULONG, size_t) noexcept
+{
+}
+
+#endif
+
+}
+
+}
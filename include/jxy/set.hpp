@@ -9,6 +9,8 @@
 // ---------------------------------------------------------------------------
 // jxy::set             std::set 
 // jxy::multiset        std::multiset 
+// jxy::tagged_set      std::set
+// jxy::tagged_multiset std::multiset
 //
 #pragma once
 #include <jxy/memory.hpp>
@@ -31,4 +33,13 @@ template <typename T,
           typename TAllocator = jxy::allocator<T, t_PoolType, t_PoolTag>> 
 using multiset = std::multiset<T, TCompare, TAllocator>;
 
+//
+// The tag is given at runtime, see jxy::tagged_allocator.
+//
+template <typename T, POOL_TYPE t_PoolType, typename TCompare = std::less<T>>
+using tagged_set = std::set<T, TCompare, tagged_allocator<T, t_PoolType>>;
+
+template <typename T, POOL_TYPE t_PoolType, typename TCompare = std::less<T>>
+using tagged_multiset = std::multiset<T, TCompare, tagged_allocator<T, t_PoolType>>;
+
 }
@@ -0,0 +1,884 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/small_vector.hpp
+// Author:   Johnny Shaw
+// Abstract: Vector with inline storage for the first few elements
+//
+// jxy::small_vector keeps up to t_InlineCapacity elements inside the object
+// and only allocates from the pool when it grows past that, for the many
+// short lists which would otherwise cost a pool allocation each. Past the
+// inline capacity it behaves as jxy::vector, growing geometrically under
+// the pool type and tag.
+//
+// The interface is that of std::vector, with these differences:
+// - The iterators are pointers.
+// - Moving a small_vector whose elements are inline moves the elements, it
+//   can't take the buffer, so the iterators of the source don't follow the
+//   elements. Moving a spilled small_vector takes the buffer.
+// - swap moves the elements unless both small_vectors have spilled.
+// - shrink_to_fit moves the elements back inline when they fit.
+// - resize_for_overwrite default initializes the new elements, so trivial
+//   elements are left for the caller to write.
+//
+// The object is t_InlineCapacity elements larger than a jxy::vector, size
+// the inline capacity for the common case, not the worst case.
+//
+// jxylib               STL equivalent
+// ---------------------------------------------------------------------------
+// jxy::small_vector    None
+//
+#pragma once
+#include <fltKernel.h>
+#include <jxy/memory.hpp>
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+
+namespace jxy
+{
+
+template <typename T, size_t t_InlineCapacity, POOL_TYPE t_PoolType, ULONG t_PoolTag>
+class small_vector
+{
+    static_assert(t_InlineCapacity > 0, "t_InlineCapacity must not be zero");
+
+public:
+
+    static constexpr POOL_TYPE pool_type = t_PoolType;
+    static constexpr ULONG pool_tag = t_PoolTag;
+    static constexpr size_t inline_capacity = t_InlineCapacity;
+
+    using value_type = T;
+    using allocator_type = allocator<T, t_PoolType, t_PoolTag>;
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using iterator = T*;
+    using const_iterator = const T*;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+private:
+
+    using alloc_traits = std::allocator_traits<allocator_type>;
+
+public:
+
+    small_vector() noexcept
+        : m_First(inline_data())
+    {
+    }
+
+    explicit small_vector(size_type Count) noexcept(false)
+        : small_vector()
+    {
+        resize(Count);
+    }
+
+    small_vector(size_type Count, const T& Value) noexcept(false)
+        : small_vector()
+    {
+        assign(Count, Value);
+    }
+
+    template <typename TIterator,
+              typename = std::enable_if_t<!std::is_integral_v<TIterator>>>
+    small_vector(TIterator First, TIterator Last) noexcept(false)
+        : small_vector()
+    {
+        assign(First, Last);
+    }
+
+    small_vector(std::initializer_list<T> Values) noexcept(false)
+        : small_vector()
+    {
+        assign(Values.begin(), Values.end());
+    }
+
+    small_vector(const small_vector& Other) noexcept(false)
+        : small_vector()
+    {
+        assign(Other.begin(), Other.end());
+    }
+
+    small_vector(small_vector&& Other) noexcept(std::is_nothrow_move_constructible_v<T>)
+        : small_vector()
+    {
+        take(std::move(Other));
+    }
+
+    ~small_vector() noexcept
+    {
+        destroy(m_First, (m_First + m_Size));
+        release();
+    }
+
+    small_vector& operator=(const small_vector& Other) noexcept(false)
+    {
+        if (this != &Other)
+        {
+            assign(Other.begin(), Other.end());
+        }
+        return *this;
+    }
+
+    small_vector& operator=(small_vector&& Other) noexcept(std::is_nothrow_move_constructible_v<T>)
+    {
+        if (this != &Other)
+        {
+            clear();
+            if (!Other.is_inline())
+            {
+                release();
+                m_First = inline_data();
+                m_Capacity = t_InlineCapacity;
+            }
+            take(std::move(Other));
+        }
+        return *this;
+    }
+
+    small_vector& operator=(std::initializer_list<T> Values) noexcept(false)
+    {
+        assign(Values.begin(), Values.end());
+        return *this;
+    }
+
+    void assign(size_type Count, const T& Value) noexcept(false)
+    {
+        if (Count > m_Capacity)
+        {
+            small_vector replacement;
+            replacement.reserve(Count);
+            replacement.append(Count, Value);
+            *this = std::move(replacement);
+            return;
+        }
+
+        auto assigned = ((Count < m_Size) ? Count : m_Size);
+        std::fill_n(m_First, assigned, Value);
+        if (Count < m_Size)
+        {
+            truncate(Count);
+        }
+        else
+        {
+            append(Count - m_Size, Value);
+        }
+    }
+
+    template <typename TIterator,
+              typename = std::enable_if_t<!std::is_integral_v<TIterator>>>
+    void assign(TIterator First, TIterator Last) noexcept(false)
+    {
+        using category = typename std::iterator_traits<TIterator>::iterator_category;
+        if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>)
+        {
+            auto count = static_cast<size_type>(std::distance(First, Last));
+            if (count > m_Capacity)
+            {
+                small_vector replacement;
+                replacement.reserve(count);
+                replacement.append_range(First, Last);
+                *this = std::move(replacement);
+                return;
+            }
+
+            auto it = m_First;
+            auto end = (m_First + m_Size);
+            for (; (it != end) && (First != Last); ++it, ++First)
+            {
+                *it = *First;
+            }
+            if (it != end)
+            {
+                truncate(static_cast<size_type>(it - m_First));
+            }
+            else
+            {
+                append_range(First, Last);
+            }
+        }
+        else
+        {
+            clear();
+            for (; First != Last; ++First)
+            {
+                emplace_back(*First);
+            }
+        }
+    }
+
+    void assign(std::initializer_list<T> Values) noexcept(false)
+    {
+        assign(Values.begin(), Values.end());
+    }
+
+    allocator_type get_allocator() const noexcept
+    {
+        return allocator_type();
+    }
+
+    reference at(size_type Index) noexcept(false)
+    {
+        if (Index >= m_Size)
+        {
+            throw std::out_of_range("invalid small_vector<T> subscript");
+        }
+        return m_First[Index];
+    }
+
+    const_reference at(size_type Index) const noexcept(false)
+    {
+        if (Index >= m_Size)
+        {
+            throw std::out_of_range("invalid small_vector<T> subscript");
+        }
+        return m_First[Index];
+    }
+
+    reference operator[](size_type Index) noexcept
+    {
+        NT_ASSERT(Index < m_Size);
+        return m_First[Index];
+    }
+
+    const_reference operator[](size_type Index) const noexcept
+    {
+        NT_ASSERT(Index < m_Size);
+        return m_First[Index];
+    }
+
+    reference front() noexcept
+    {
+        return m_First[0];
+    }
+
+    const_reference front() const noexcept
+    {
+        return m_First[0];
+    }
+
+    reference back() noexcept
+    {
+        return m_First[m_Size - 1];
+    }
+
+    const_reference back() const noexcept
+    {
+        return m_First[m_Size - 1];
+    }
+
+    T* data() noexcept
+    {
+        return m_First;
+    }
+
+    const T* data() const noexcept
+    {
+        return m_First;
+    }
+
+    iterator begin() noexcept
+    {
+        return m_First;
+    }
+
+    const_iterator begin() const noexcept
+    {
+        return m_First;
+    }
+
+    iterator end() noexcept
+    {
+        return (m_First + m_Size);
+    }
+
+    const_iterator end() const noexcept
+    {
+        return (m_First + m_Size);
+    }
+
+    const_iterator cbegin() const noexcept
+    {
+        return begin();
+    }
+
+    const_iterator cend() const noexcept
+    {
+        return end();
+    }
+
+    reverse_iterator rbegin() noexcept
+    {
+        return reverse_iterator(end());
+    }
+
+    const_reverse_iterator rbegin() const noexcept
+    {
+        return const_reverse_iterator(end());
+    }
+
+    reverse_iterator rend() noexcept
+    {
+        return reverse_iterator(begin());
+    }
+
+    const_reverse_iterator rend() const noexcept
+    {
+        return const_reverse_iterator(begin());
+    }
+
+    const_reverse_iterator crbegin() const noexcept
+    {
+        return rbegin();
+    }
+
+    const_reverse_iterator crend() const noexcept
+    {
+        return rend();
+    }
+
+    _NODISCARD
+    bool empty() const noexcept
+    {
+        return (m_Size == 0);
+    }
+
+    size_type size() const noexcept
+    {
+        return m_Size;
+    }
+
+    size_type max_size() const noexcept
+    {
+        return alloc_traits::max_size(allocator_type());
+    }
+
+    size_type capacity() const noexcept
+    {
+        return m_Capacity;
+    }
+
+    //
+    // True while the elements are in the inline storage.
+    //
+    bool is_inline() const noexcept
+    {
+        return (m_First == inline_data());
+    }
+
+    void reserve(size_type Count) noexcept(false)
+    {
+        if (Count > m_Capacity)
+        {
+            reallocate(Count);
+        }
+    }
+
+    void shrink_to_fit() noexcept(false)
+    {
+        if (is_inline() || (m_Size == m_Capacity))
+        {
+            return;
+        }
+
+        if (m_Size <= t_InlineCapacity)
+        {
+            auto first = m_First;
+            auto capacity = m_Capacity;
+            relocate(first, m_Size, inline_data());
+            allocator_type allocator;
+            alloc_traits::deallocate(allocator, first, capacity);
+            m_First = inline_data();
+            m_Capacity = t_InlineCapacity;
+        }
+        else
+        {
+            reallocate(m_Size);
+        }
+    }
+
+    void clear() noexcept
+    {
+        truncate(0);
+    }
+
+    iterator insert(const_iterator Where, const T& Value) noexcept(false)
+    {
+        return emplace(Where, Value);
+    }
+
+    iterator insert(const_iterator Where, T&& Value) noexcept(false)
+    {
+        return emplace(Where, std::move(Value));
+    }
+
+    iterator insert(const_iterator Where, size_type Count, const T& Value) noexcept(false)
+    {
+        auto offset = static_cast<size_type>(Where - m_First);
+        if (Count == 0)
+        {
+            return (m_First + offset);
+        }
+
+        //
+        // Value may be an element, copy it before anything moves.
+        //
+        T copy(Value);
+        auto oldSize = m_Size;
+        ensure(m_Size + Count);
+        append(Count, copy);
+        std::rotate((m_First + offset), (m_First + oldSize), (m_First + m_Size));
+        return (m_First + offset);
+    }
+
+    template <typename TIterator,
+              typename = std::enable_if_t<!std::is_integral_v<TIterator>>>
+    iterator insert(const_iterator Where, TIterator First, TIterator Last) noexcept(false)
+    {
+        auto offset = static_cast<size_type>(Where - m_First);
+        auto oldSize = m_Size;
+
+        using category = typename std::iterator_traits<TIterator>::iterator_category;
+        if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>)
+        {
+            ensure(m_Size + static_cast<size_type>(std::distance(First, Last)));
+            append_range(First, Last);
+        }
+        else
+        {
+            for (; First != Last; ++First)
+            {
+                emplace_back(*First);
+            }
+        }
+
+        std::rotate((m_First + offset), (m_First + oldSize), (m_First + m_Size));
+        return (m_First + offset);
+    }
+
+    iterator insert(const_iterator Where, std::initializer_list<T> Values) noexcept(false)
+    {
+        return insert(Where, Values.begin(), Values.end());
+    }
+
+    template <typename... TArgs>
+    iterator emplace(const_iterator Where, TArgs&&... Args) noexcept(false)
+    {
+        auto offset = static_cast<size_type>(Where - m_First);
+        if (offset == m_Size)
+        {
+            emplace_back(std::forward<TArgs>(Args)...);
+            return (m_First + offset);
+        }
+
+        //
+        // The arguments may refer to elements, construct the value before
+        // anything moves.
+        //
+        T value(std::forward<TArgs>(Args)...);
+        ensure(m_Size + 1);
+
+        allocator_type allocator;
+        auto last = (m_First + m_Size);
+        alloc_traits::construct(allocator, last, std::move(*(last - 1)));
+        m_Size++;
+        std::move_backward((m_First + offset), (last - 1), last);
+        m_First[offset] = std::move(value);
+        return (m_First + offset);
+    }
+
+    iterator erase(const_iterator Where) noexcept(std::is_nothrow_move_assignable_v<T>)
+    {
+        return erase(Where, (Where + 1));
+    }
+
+    iterator erase(const_iterator First, const_iterator Last) noexcept(std::is_nothrow_move_assignable_v<T>)
+    {
+        auto first = const_cast<iterator>(First);
+        auto last = const_cast<iterator>(Last);
+        if (first != last)
+        {
+            auto newEnd = std::move(last, end(), first);
+            truncate(static_cast<size_type>(newEnd - m_First));
+        }
+        return first;
+    }
+
+    void push_back(const T& Value) noexcept(false)
+    {
+        emplace_back(Value);
+    }
+
+    void push_back(T&& Value) noexcept(false)
+    {
+        emplace_back(std::move(Value));
+    }
+
+    template <typename... TArgs>
+    reference emplace_back(TArgs&&... Args) noexcept(false)
+    {
+        allocator_type allocator;
+        if (m_Size < m_Capacity)
+        {
+            alloc_traits::construct(allocator, (m_First + m_Size), std::forward<TArgs>(Args)...);
+            m_Size++;
+            return back();
+        }
+
+        //
+        // The arguments may refer to elements, the new element is
+        // constructed in the new buffer before the old elements move.
+        //
+        auto capacity = grown(m_Size + 1);
+        auto first = alloc_traits::allocate(allocator, capacity);
+        try
+        {
+            alloc_traits::construct(allocator, (first + m_Size), std::forward<TArgs>(Args)...);
+        }
+        catch (...)
+        {
+            alloc_traits::deallocate(allocator, first, capacity);
+            throw;
+        }
+
+        try
+        {
+            relocate(m_First, m_Size, first);
+        }
+        catch (...)
+        {
+            alloc_traits::destroy(allocator, (first + m_Size));
+            alloc_traits::deallocate(allocator, first, capacity);
+            throw;
+        }
+
+        release();
+        m_First = first;
+        m_Capacity = capacity;
+        m_Size++;
+        return back();
+    }
+
+    void pop_back() noexcept
+    {
+        NT_ASSERT(m_Size > 0);
+        truncate(m_Size - 1);
+    }
+
+    void resize(size_type Count) noexcept(false)
+    {
+        if (Count < m_Size)
+        {
+            truncate(Count);
+            return;
+        }
+
+        reserve(Count);
+        allocator_type allocator;
+        while (m_Size < Count)
+        {
+            alloc_traits::construct(allocator, (m_First + m_Size));
+            m_Size++;
+        }
+    }
+
+    void resize(size_type Count, const T& Value) noexcept(false)
+    {
+        if (Count < m_Size)
+        {
+            truncate(Count);
+            return;
+        }
+
+        if (Count > m_Capacity)
+        {
+            T copy(Value);
+            reserve(Count);
+            append(Count - m_Size, copy);
+        }
+        else
+        {
+            append(Count - m_Size, Value);
+        }
+    }
+
+    void resize_for_overwrite(size_type Count) noexcept(false)
+    {
+        if (Count < m_Size)
+        {
+            truncate(Count);
+            return;
+        }
+
+        ensure(Count);
+        if constexpr (std::is_trivially_default_constructible_v<T>)
+        {
+            m_Size = Count;
+        }
+        else
+        {
+            while (m_Size < Count)
+            {
+                ::new (static_cast<void*>(m_First + m_Size)) T;
+                m_Size++;
+            }
+        }
+    }
+
+    void swap(small_vector& Other) noexcept(std::is_nothrow_move_constructible_v<T> &&
+                                            std::is_nothrow_swappable_v<T>)
+    {
+        if (this == &Other)
+        {
+            return;
+        }
+
+        if (!is_inline() && !Other.is_inline())
+        {
+            std::swap(m_First, Other.m_First);
+            std::swap(m_Size, Other.m_Size);
+            std::swap(m_Capacity, Other.m_Capacity);
+            return;
+        }
+
+        small_vector temp(std::move(Other));
+        Other = std::move(*this);
+        *this = std::move(temp);
+    }
+
+private:
+
+    T* inline_data() noexcept
+    {
+        return reinterpret_cast<T*>(m_Inline);
+    }
+
+    const T* inline_data() const noexcept
+    {
+        return reinterpret_cast<const T*>(m_Inline);
+    }
+
+    //
+    // The capacity to grow to for at least Count elements, 1.5 times the
+    // current capacity as the MSVC STL does.
+    //
+    size_type grown(size_type Count) const noexcept(false)
+    {
+        auto maximum = max_size();
+        if (Count > maximum)
+        {
+            throw std::length_error("small_vector<T> too long");
+        }
+
+        if (m_Capacity > (maximum - (m_Capacity / 2)))
+        {
+            return maximum;
+        }
+
+        auto geometric = (m_Capacity + (m_Capacity / 2));
+        return ((geometric < Count) ? Count : geometric);
+    }
+
+    void ensure(size_type Count) noexcept(false)
+    {
+        if (Count > m_Capacity)
+        {
+            reallocate(grown(Count));
+        }
+    }
+
+    static void destroy(T* First, T* Last) noexcept
+    {
+        allocator_type allocator;
+        for (; First != Last; ++First)
+        {
+            alloc_traits::destroy(allocator, First);
+        }
+    }
+
+    //
+    // Moves (or copies, if moving may throw and copying is possible) Count
+    // elements to uninitialized Target, then destroys the sources. On an
+    // exception the sources are untouched.
+    //
+    static void relocate(T* Source, size_type Count, T* Target) noexcept(false)
+    {
+        allocator_type allocator;
+        size_type done = 0;
+        try
+        {
+            for (; done < Count; done++)
+            {
+                alloc_traits::construct(allocator, (Target + done), std::move_if_noexcept(Source[done]));
+            }
+        }
+        catch (...)
+        {
+            destroy(Target, (Target + done));
+            throw;
+        }
+        destroy(Source, (Source + Count));
+    }
+
+    void reallocate(size_type Capacity) noexcept(false)
+    {
+        NT_ASSERT(Capacity >= m_Size);
+        if (Capacity > max_size())
+        {
+            throw std::length_error("small_vector<T> too long");
+        }
+
+        allocator_type allocator;
+        auto first = alloc_traits::allocate(allocator, Capacity);
+        try
+        {
+            relocate(m_First, m_Size, first);
+        }
+        catch (...)
+        {
+            alloc_traits::deallocate(allocator, first, Capacity);
+            throw;
+        }
+
+        release();
+        m_First = first;
+        m_Capacity = Capacity;
+    }
+
+    //
+    // Frees the pool buffer, the elements must already be destroyed or
+    // moved out.
+    //
+    void release() noexcept
+    {
+        if (!is_inline())
+        {
+            allocator_type allocator;
+            alloc_traits::deallocate(allocator, m_First, m_Capacity);
+        }
+    }
+
+    void truncate(size_type Count) noexcept
+    {
+        destroy((m_First + Count), (m_First + m_Size));
+        m_Size = Count;
+    }
+
+    //
+    // Appends within the capacity.
+    //
+    void append(size_type Count, const T& Value) noexcept(false)
+    {
+        NT_ASSERT((m_Size + Count) <= m_Capacity);
+        allocator_type allocator;
+        for (; Count > 0; Count--)
+        {
+            alloc_traits::construct(allocator, (m_First + m_Size), Value);
+            m_Size++;
+        }
+    }
+
+    template <typename TIterator>
+    void append_range(TIterator First, TIterator Last) noexcept(false)
+    {
+        allocator_type allocator;
+        for (; First != Last; ++First)
+        {
+            NT_ASSERT(m_Size < m_Capacity);
+            alloc_traits::construct(allocator, (m_First + m_Size), *First);
+            m_Size++;
+        }
+    }
+
+    //
+    // Takes the elements of Other, which is left empty. This must be empty,
+    // and must be inline if Other isn't.
+    //
+    void take(small_vector&& Other) noexcept(std::is_nothrow_move_constructible_v<T>)
+    {
+        NT_ASSERT(m_Size == 0);
+
+        if (Other.is_inline())
+        {
+            relocate(Other.m_First, Other.m_Size, m_First);
+            m_Size = Other.m_Size;
+            Other.m_Size = 0;
+        }
+        else
+        {
+            NT_ASSERT(is_inline());
+            m_First = Other.m_First;
+            m_Size = Other.m_Size;
+            m_Capacity = Other.m_Capacity;
+            Other.m_First = Other.inline_data();
+            Other.m_Size = 0;
+            Other.m_Capacity = t_InlineCapacity;
+        }
+    }
+
+    T* m_First;
+    size_type m_Size = 0;
+    size_type m_Capacity = t_InlineCapacity;
+    alignas(T) unsigned char m_Inline[sizeof(T) * t_InlineCapacity];
+
+};
+
+template <typename T, size_t t_InlineCapacity, POOL_TYPE t_PoolType, ULONG t_PoolTag>
+bool operator==(const small_vector<T, t_InlineCapacity, t_PoolType, t_PoolTag>& Left,
+                const small_vector<T, t_InlineCapacity, t_PoolType, t_PoolTag>& Right)
+{
+    return std::equal(Left.begin(), Left.end(), Right.begin(), Right.end());
+}
+
+template <typename T, size_t t_InlineCapacity, POOL_TYPE t_PoolType, ULONG t_PoolTag>
+bool operator!=(const small_vector<T, t_InlineCapacity, t_PoolType, t_PoolTag>& Left,
+                const small_vector<T, t_InlineCapacity, t_PoolType, t_PoolTag>& Right)
+{
+    return !(Left == Right);
+}
+
+template <typename T, size_t t_InlineCapacity, POOL_TYPE t_PoolType, ULONG t_PoolTag>
+bool operator<(const small_vector<T, t_InlineCapacity, t_PoolType, t_PoolTag>& Left,
+               const small_vector<T, t_InlineCapacity, t_PoolType, t_PoolTag>& Right)
+{
+    return std::lexicographical_compare(Left.begin(), Left.end(), Right.begin(), Right.end());
+}
+
+template <typename T, size_t t_InlineCapacity, POOL_TYPE t_PoolType, ULONG t_PoolTag>
+bool operator>(const small_vector<T, t_InlineCapacity, t_PoolType, t_PoolTag>& Left,
+               const small_vector<T, t_InlineCapacity, t_PoolType, t_PoolTag>& Right)
+{
+    return (Right < Left);
+}
+
+template <typename T, size_t t_InlineCapacity, POOL_TYPE t_PoolType, ULONG t_PoolTag>
+bool operator<=(const small_vector<T, t_InlineCapacity, t_PoolType, t_PoolTag>& Left,
+                const small_vector<T, t_InlineCapacity, t_PoolType, t_PoolTag>& Right)
+{
+    return !(Right < Left);
+}
+
+template <typename T, size_t t_InlineCapacity, POOL_TYPE t_PoolType, ULONG t_PoolTag>
+bool operator>=(const small_vector<T, t_InlineCapacity, t_PoolType, t_PoolTag>& Left,
+                const small_vector<T, t_InlineCapacity, t_PoolType, t_PoolTag>& Right)
+{
+    return !(Left < Right);
+}
+
+template <typename T, size_t t_InlineCapacity, POOL_TYPE t_PoolType, ULONG t_PoolTag>
+void swap(small_vector<T, t_InlineCapacity, t_PoolType, t_PoolTag>& Left,
+          small_vector<T, t_InlineCapacity, t_PoolType, t_PoolTag>& Right)
+    noexcept(noexcept(Left.swap(Right)))
+{
+    Left.swap(Right);
+}
+
+}
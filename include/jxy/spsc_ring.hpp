@@ -0,0 +1,225 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/spsc_ring.hpp
+// Author:   Johnny Shaw
+// Abstract: Single producer single consumer ring buffer
+//
+// jxy::spsc_ring is a bounded queue between exactly one producer and one
+// consumer, for handing work off from a notify callback to a worker. The
+// slots are allocated up front, pushing and popping never allocate and never
+// wait, a push to a full ring fails and a pop from an empty ring fails.
+//
+// The producer's tail index and the consumer's head index are on their own
+// cache lines. Each side also keeps the last index it read of the other
+// side, it only reads the other side's line again when the cached index
+// says the ring is full (producer) or holds fewer than asked for
+// (consumer). pop_batch publishes the head once for the whole batch.
+//
+// Only one thread may push at a time and only one may pop at a time, see
+// jxy::per_cpu_rings for many producers. A push is wait-free as long as
+// constructing T is, keep T trivially copyable or at least non-allocating.
+// If either side runs at DISPATCH_LEVEL the pool type must be non-paged.
+//
+// jxylib                   STL equivalent
+// ---------------------------------------------------------------------------
+// jxy::spsc_ring           None
+//
+#pragma once
+#include <fltKernel.h>
+#include <jxy/memory.hpp>
+
+namespace jxy
+{
+
+template <typename T, size_t t_Capacity, POOL_TYPE t_PoolType, ULONG t_PoolTag>
+class spsc_ring
+{
+    static_assert((t_Capacity >= 2) && ((t_Capacity & (t_Capacity - 1)) == 0),
+                  "t_Capacity must be a power of two");
+    static_assert(t_Capacity <= (1ul << 30), "t_Capacity is too large");
+
+    using slot_allocator = allocator<T, t_PoolType, t_PoolTag>;
+    using slot_traits = std::allocator_traits<slot_allocator>;
+
+    static constexpr ULONG index_mask = static_cast<ULONG>(t_Capacity - 1);
+
+public:
+
+    static constexpr POOL_TYPE pool_type = t_PoolType;
+    static constexpr ULONG pool_tag = t_PoolTag;
+
+    using value_type = T;
+    using size_type = size_t;
+
+    spsc_ring() noexcept(false)
+    {
+        slot_allocator allocator;
+        m_Slots = slot_traits::allocate(allocator, t_Capacity);
+    }
+
+    ~spsc_ring() noexcept
+    {
+        auto head = m_Consumer.Head;
+        auto tail = m_Producer.Tail;
+        for (; head != tail; head++)
+        {
+            std::destroy_at(m_Slots + (head & index_mask));
+        }
+
+        slot_allocator allocator;
+        slot_traits::deallocate(allocator, m_Slots, t_Capacity);
+    }
+
+    spsc_ring(const spsc_ring&) = delete;
+    spsc_ring& operator=(const spsc_ring&) = delete;
+
+    static constexpr size_type capacity() noexcept
+    {
+        return t_Capacity;
+    }
+
+    //
+    // Producer side. Constructs an element at the tail, returns false if
+    // the ring is full.
+    //
+    template <typename... TArgs>
+    bool try_emplace(TArgs&&... Args) noexcept(std::is_nothrow_constructible_v<T, TArgs&&...>)
+    {
+        auto tail = m_Producer.Tail;
+        if ((tail - m_Producer.CachedHead) == t_Capacity)
+        {
+            m_Producer.CachedHead = load_acquire(m_Consumer.Head);
+            if ((tail - m_Producer.CachedHead) == t_Capacity)
+            {
+                return false;
+            }
+        }
+
+        ::new (static_cast<void*>(m_Slots + (tail & index_mask))) T(std::forward<TArgs>(Args)...);
+        store_release(m_Producer.Tail, (tail + 1));
+        return true;
+    }
+
+    bool try_push(const T& Value) noexcept(std::is_nothrow_copy_constructible_v<T>)
+    {
+        return try_emplace(Value);
+    }
+
+    bool try_push(T&& Value) noexcept(std::is_nothrow_move_constructible_v<T>)
+    {
+        return try_emplace(std::move(Value));
+    }
+
+    //
+    // Consumer side. Moves the element at the head to Value, returns false
+    // if the ring is empty.
+    //
+    bool try_pop(T& Value) noexcept(std::is_nothrow_move_assignable_v<T>)
+    {
+        return (pop_batch([&Value](T& Popped) { Value = std::move(Popped); }, 1) != 0);
+    }
+
+    //
+    // Consumer side. Calls Function(T&) for up to Max elements in order
+    // and returns the number popped.
+    //
+    template <typename TFunction>
+    size_type pop_batch(TFunction&& Function, size_type Max = t_Capacity)
+    {
+        auto head = m_Consumer.Head;
+        auto available = static_cast<size_type>(m_Consumer.CachedTail - head);
+        if (available < Max)
+        {
+            m_Consumer.CachedTail = load_acquire(m_Producer.Tail);
+            available = static_cast<size_type>(m_Consumer.CachedTail - head);
+            if (available == 0)
+            {
+                return 0;
+            }
+        }
+
+        auto count = ((available < Max) ? available : Max);
+
+        //
+        // The head is published even if Function throws, for the elements
+        // consumed before it.
+        //
+        size_type popped = 0;
+        auto publish = [this, &head, &popped]()
+        {
+            if (popped)
+            {
+                store_release(m_Consumer.Head, head);
+            }
+        };
+
+        try
+        {
+            for (; popped < count; popped++, head++)
+            {
+                auto slot = (m_Slots + (head & index_mask));
+                Function(*slot);
+                std::destroy_at(slot);
+            }
+        }
+        catch (...)
+        {
+            publish();
+            throw;
+        }
+
+        publish();
+        return popped;
+    }
+
+    //
+    // Either side. The number of elements at some point during the call.
+    //
+    size_type size() const noexcept
+    {
+        auto tail = load_acquire(m_Producer.Tail);
+        auto head = load_acquire(m_Consumer.Head);
+        return static_cast<size_type>(tail - head);
+    }
+
+    _NODISCARD
+    bool empty() const noexcept
+    {
+        return (size() == 0);
+    }
+
+private:
+
+    //
+    // The indices count up and wrap, their difference is the element count.
+    //
+    static ULONG load_acquire(const volatile ULONG& Index) noexcept
+    {
+        return static_cast<ULONG>(ReadAcquire(reinterpret_cast<const volatile LONG*>(&Index)));
+    }
+
+    static void store_release(volatile ULONG& Index, ULONG Value) noexcept
+    {
+        WriteRelease(reinterpret_cast<volatile LONG*>(&Index), static_cast<LONG>(Value));
+    }
+
+    struct alignas(SYSTEM_CACHE_ALIGNMENT_SIZE) producer_side
+    {
+        volatile ULONG Tail = 0;
+        ULONG CachedHead = 0;
+    };
+
+    struct alignas(SYSTEM_CACHE_ALIGNMENT_SIZE) consumer_side
+    {
+        volatile ULONG Head = 0;
+        ULONG CachedTail = 0;
+    };
+
+    producer_side m_Producer;
+    consumer_side m_Consumer;
+    T* m_Slots = nullptr;
+
+};
+
+}
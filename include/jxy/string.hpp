@@ -10,6 +10,15 @@
 // jxy::basic_string    std::basic_string 
 // jxy::string          std::string 
 // jxy::wstring         std::wstring 
+// jxy::tagged_basic_string std::basic_string
+// jxy::tagged_string   std::string
+// jxy::tagged_wstring  std::wstring
+// jxy::pmr::basic_string std::pmr::basic_string
+// jxy::pmr::string     std::pmr::string
+// jxy::pmr::wstring    std::pmr::wstring
+//
+// The jxy::pmr aliases are declared here, the resources to construct them
+// with are in <jxy/memory_resource.hpp>.
 //
 #pragma once
 #include <jxy/memory.hpp>
@@ -34,4 +43,28 @@ template <POOL_TYPE t_PoolType,
           typename TAllocator = jxy::allocator<wchar_t, t_PoolType, t_PoolTag>>
 using wstring = basic_string<wchar_t, t_PoolType, t_PoolTag, TAllocator>;
 
+//
+// The tag is given at runtime, see jxy::tagged_allocator.
+//
+template <typename T, POOL_TYPE t_PoolType>
+using tagged_basic_string = std::basic_string<T, std::char_traits<T>, tagged_allocator<T, t_PoolType>>;
+
+template <POOL_TYPE t_PoolType>
+using tagged_string = tagged_basic_string<char, t_PoolType>;
+
+template <POOL_TYPE t_PoolType>
+using tagged_wstring = tagged_basic_string<wchar_t, t_PoolType>;
+
+}
+
+namespace jxy::pmr
+{
+
+template <typename T>
+using basic_string = std::pmr::basic_string<T>;
+
+using string = basic_string<char>;
+
+using wstring = basic_string<wchar_t>;
+
 }
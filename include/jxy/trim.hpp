@@ -0,0 +1,101 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/trim.hpp
+// Author:   Johnny Shaw
+// Abstract: Returning cached memory to the pool under memory pressure
+//
+// The caching layers (lookaside lists, the magazine cache, the large buffer
+// cache, and anything registered with a trim callback) hold freed blocks
+// until they are reused.
+// jxy::trim_caches returns all of the cached free blocks to the pool and
+// reports how many bytes were reclaimed. Blocks in use are not affected and
+// the caches refill as they are used again.
+//
+// jxy::initialize_cache_trimming starts a worker which waits on the
+// \KernelObjects\LowMemoryCondition event and trims the caches when the
+// system is low on memory. The event stays signaled while memory is low, the
+// worker trims at most once every jxy::trim_interval_ms while it is. Another
+// event may be given in place of the low memory condition, for example to
+// trim on a driver specific condition or to simulate memory pressure.
+//
+// Initialize during driver entry, after jxy::initialize_magazine_cache, and
+// uninitialize during driver unload before jxy::uninitialize_magazine_cache.
+//
+#pragma once
+#include <fltKernel.h>
+#include <cstdint>
+
+namespace jxy
+{
+
+static constexpr ULONG trim_interval_ms = 1000;
+
+struct trim_stats
+{
+    uint64_t trims;
+    uint64_t low_memory_trims;
+    uint64_t bytes_reclaimed;
+    uint64_t last_bytes_reclaimed;
+};
+
+//
+// Returns the cached free blocks of every caching layer to the pool. Returns
+// the number of bytes reclaimed.
+//
+_IRQL_requires_max_(APC_LEVEL)
+size_t trim_caches() noexcept;
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS initialize_cache_trimming(PKEVENT LowMemoryEvent = nullptr) noexcept;
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+void uninitialize_cache_trimming() noexcept;
+
+trim_stats query_trim_stats() noexcept;
+
+namespace details
+{
+
+//
+// Caching layers other than the built in jxystl caches register
+// a trim callback to have their free blocks reclaimed by jxy::trim_caches.
+// The callback returns the number of bytes it released. A registered
+// callback must be unregistered before it is destroyed, unregistering waits
+// for a trim in progress.
+//
+class trim_callback
+{
+public:
+
+    using function_type = size_t (*)(void* Context) noexcept;
+
+    constexpr trim_callback(function_type Function, void* Context) noexcept
+        : m_Function(Function),
+          m_Context(Context)
+    {
+    }
+
+    trim_callback(const trim_callback&) = delete;
+    trim_callback& operator=(const trim_callback&) = delete;
+
+    _IRQL_requires_max_(APC_LEVEL)
+    void register_callback() noexcept;
+
+    _IRQL_requires_max_(APC_LEVEL)
+    void unregister_callback() noexcept;
+
+    static size_t trim_all() noexcept;
+
+private:
+
+    function_type m_Function;
+    void* m_Context;
+    trim_callback* m_Next = nullptr;
+    bool m_Registered = false;
+
+};
+
+}
+
+}
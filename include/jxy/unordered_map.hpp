@@ -3,23 +3,154 @@
 // 
 // File:     jxystl/unordered_map.hpp
 // Author:   Johnny Shaw
-// Abstract: STL wrappers for <unordered_map> 
+// Abstract: Hash maps with integer load factors
+//
+// std::unordered_map keeps its load factor as a float (see
+// jxy/hash_table.hpp), these are jxy implementations of the same interface.
+// max_load_factor and load_factor are integer percentages.
 //
 // jxylib                   STL equivalent
 // ---------------------------------------------------------------------------
-// jxy::unordered_map       std::unordered_map 
-// jxy::unordered_miltimap  std::unordered_miltimap 
+// jxy::unordered_map       std::unordered_map
+// jxy::unordered_multimap  std::unordered_multimap
 //
 #pragma once
 #include <jxy/memory.hpp>
-#include <unordered_map>
+#include <jxy/hash_table.hpp>
+#include <stdexcept>
 
 namespace jxy
 {
 
-//
-// TODO - std::unordered_map uses some floating point arithmetic that hasn't
-// been easy to stub/redirect, needs some more thought/effort to get right.
-//
+template <typename TKey,
+          typename T,
+          POOL_TYPE t_PoolType,
+          ULONG t_PoolTag,
+          typename THash = std::hash<TKey>,
+          typename TKeyEqual = std::equal_to<TKey>,
+          typename TAlloc = allocator<std::pair<const TKey, T>, t_PoolType, t_PoolTag>>
+class unordered_map : public details::hash_table<TKey,
+                                                 std::pair<const TKey, T>,
+                                                 details::hash_key_first,
+                                                 THash,
+                                                 TKeyEqual,
+                                                 TAlloc,
+                                                 false>
+{
+    using base = details::hash_table<TKey,
+                                     std::pair<const TKey, T>,
+                                     details::hash_key_first,
+                                     THash,
+                                     TKeyEqual,
+                                     TAlloc,
+                                     false>;
+
+public:
+
+    static constexpr POOL_TYPE pool_type = t_PoolType;
+    static constexpr ULONG pool_tag = t_PoolTag;
+
+    using mapped_type = T;
+    using typename base::key_type;
+    using typename base::value_type;
+    using typename base::iterator;
+    using typename base::const_iterator;
+
+    using base::base;
+
+    unordered_map() = default;
+
+    unordered_map& operator=(std::initializer_list<value_type> Values)
+    {
+        base::operator=(Values);
+        return *this;
+    }
+
+    template <typename... TArgs>
+    std::pair<iterator, bool> try_emplace(const key_type& Key, TArgs&&... Args)
+    {
+        return base::emplace_key(Key,
+                                 std::piecewise_construct,
+                                 std::forward_as_tuple(Key),
+                                 std::forward_as_tuple(std::forward<TArgs>(Args)...));
+    }
+
+    template <typename... TArgs>
+    std::pair<iterator, bool> try_emplace(key_type&& Key, TArgs&&... Args)
+    {
+        return base::emplace_key(Key,
+                                 std::piecewise_construct,
+                                 std::forward_as_tuple(std::move(Key)),
+                                 std::forward_as_tuple(std::forward<TArgs>(Args)...));
+    }
+
+    template <typename TMapped>
+    std::pair<iterator, bool> insert_or_assign(const key_type& Key, TMapped&& Value)
+    {
+        auto result = try_emplace(Key, std::forward<TMapped>(Value));
+        if (!result.second)
+        {
+            result.first->second = std::forward<TMapped>(Value);
+        }
+        return result;
+    }
+
+    template <typename TMapped>
+    std::pair<iterator, bool> insert_or_assign(key_type&& Key, TMapped&& Value)
+    {
+        auto result = try_emplace(std::move(Key), std::forward<TMapped>(Value));
+        if (!result.second)
+        {
+            result.first->second = std::forward<TMapped>(Value);
+        }
+        return result;
+    }
+
+    mapped_type& operator[](const key_type& Key)
+    {
+        return try_emplace(Key).first->second;
+    }
+
+    mapped_type& operator[](key_type&& Key)
+    {
+        return try_emplace(std::move(Key)).first->second;
+    }
+
+    mapped_type& at(const key_type& Key)
+    {
+        auto it = base::find(Key);
+        if (it == base::end())
+        {
+            throw std::out_of_range("invalid unordered_map<K, T> key");
+        }
+        return it->second;
+    }
+
+    const mapped_type& at(const key_type& Key) const
+    {
+        auto it = base::find(Key);
+        if (it == base::end())
+        {
+            throw std::out_of_range("invalid unordered_map<K, T> key");
+        }
+        return it->second;
+    }
+
+};
+
+template <typename TKey,
+          typename T,
+          POOL_TYPE t_PoolType,
+          ULONG t_PoolTag,
+          typename THash = std::hash<TKey>,
+          typename TKeyEqual = std::equal_to<TKey>,
+          typename TAlloc = allocator<std::pair<const TKey, T>, t_PoolType, t_PoolTag>>
+using unordered_multimap = details::hash_table<TKey,
+                                               std::pair<const TKey, T>,
+                                               details::hash_key_first,
+                                               THash,
+                                               TKeyEqual,
+                                               TAlloc,
+                                               true>;
 
 }
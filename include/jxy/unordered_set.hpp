@@ -3,24 +3,50 @@
 // 
 // File:     jxystl/unordered_set.hpp
 // Author:   Johnny Shaw
-// Abstract: STL wrappers for <unordered_set> 
+// Abstract: Hash sets with integer load factors
+//
+// std::unordered_set keeps its load factor as a float (see
+// jxy/hash_table.hpp), these are jxy implementations of the same interface.
+// max_load_factor and load_factor are integer percentages.
 //
 // jxylib                   STL equivalent
 // ---------------------------------------------------------------------------
 // jxy::unordered_set       std::unordered_set
-// jxy::unordered_miltiset  std::unordered_miltiset 
+// jxy::unordered_multiset  std::unordered_multiset
 //
 #pragma once
 #include <jxy/memory.hpp>
-#include <unordered_set>
+#include <jxy/hash_table.hpp>
 
 namespace jxy
 {
 
-//
-// TODO - std::unordered_set uses some floating point arithmetic that hasn't
-// been easy to stub/redirect, needs some more thought/effort to get right.
-//
+template <typename TKey,
+          POOL_TYPE t_PoolType,
+          ULONG t_PoolTag,
+          typename THash = std::hash<TKey>,
+          typename TKeyEqual = std::equal_to<TKey>,
+          typename TAlloc = allocator<TKey, t_PoolType, t_PoolTag>>
+using unordered_set = details::hash_table<TKey,
+                                          TKey,
+                                          details::hash_key_identity,
+                                          THash,
+                                          TKeyEqual,
+                                          TAlloc,
+                                          false>;
 
-}
+template <typename TKey,
+          POOL_TYPE t_PoolType,
+          ULONG t_PoolTag,
+          typename THash = std::hash<TKey>,
+          typename TKeyEqual = std::equal_to<TKey>,
+          typename TAlloc = allocator<TKey, t_PoolType, t_PoolTag>>
+using unordered_multiset = details::hash_table<TKey,
+                                               TKey,
+                                               details::hash_key_identity,
+                                               THash,
+                                               TKeyEqual,
+                                               TAlloc,
+                                               true>;
 
+}
@@ -8,6 +8,11 @@
 // jxylib               STL equivalent
 // ---------------------------------------------------------------------------
 // jxy::vector          std::vector 
+// jxy::tagged_vector   std::vector
+// jxy::pmr::vector     std::pmr::vector
+//
+// The jxy::pmr aliases are declared here, the resources to construct them
+// with are in <jxy/memory_resource.hpp>.
 //
 #pragma once
 #include <jxy/memory.hpp>
@@ -32,4 +37,19 @@ template <typename T,
           typename TAllocator = jxy::allocator<T, NonPagedPoolNx, t_PoolTag>>
 using non_paged_vector = std::vector<T, TAllocator>;
 
+//
+// The tag is given at runtime, for example:
+// jxy::tagged_vector<int, PagedPool> vec(jxy::tagged_allocator<int, PagedPool>('0GAT'));
+//
+template <typename T, POOL_TYPE t_PoolType>
+using tagged_vector = std::vector<T, tagged_allocator<T, t_PoolType>>;
+
+}
+
+namespace jxy::pmr
+{
+
+template <typename T>
+using vector = std::pmr::vector<T>;
+
 }
@@ -9,6 +9,10 @@
 // the pool type and tags for all allocations.
 //
 #include <jxy/alloc.hpp>
+#include <jxy/pool_backend.hpp>
+#include <jxy/magazine.hpp>
+#include <jxy/pool_stats.hpp>
+#include <jxy/pool_trace.hpp>
 #include <stdexcept>
 
 void* __cdecl operator new(size_t Size, POOL_TYPE PoolType, ULONG PoolTag) noexcept(false)
@@ -18,20 +22,53 @@ void* __cdecl operator new(size_t Size, POOL_TYPE PoolType, ULONG PoolTag) noexc
         Size = 1;
     }
 
-#pragma warning(push)
-#pragma warning(disable : 4996) // FIXME - deprecated function
-    void* memory = ExAllocatePoolWithTag(PoolType, Size, PoolTag);
-#pragma warning(pop)
+    void* memory = jxy::details::magazine_allocate(Size, PoolType, PoolTag);
+    if (memory)
+    {
+        jxy::details::pool_stats_allocate(PoolTag, Size);
+        jxy::details::pool_trace_allocate(PoolTag, Size);
+        return memory;
+    }
+
+    //
+    // While the magazine cache is enabled round up to the size class so this
+    // block can be reused for any allocation in the class once it is
+    // returned to the cache.
+    //
+    memory = jxy::details::pool_allocate(PoolType,
+                                         jxy::details::magazine_round_size(Size),
+                                         PoolTag);
     if (!memory)
     {
         throw std::bad_alloc();
     }
+    jxy::details::pool_stats_allocate(PoolTag, Size);
+    jxy::details::pool_trace_allocate(PoolTag, Size);
     return memory;
 }
 
 void __cdecl operator delete(void* Memory, POOL_TYPE, ULONG PoolTag) noexcept
 {
     if (Memory)
+    {
+        //
+        // Unsized, the free is counted but not the bytes.
+        //
+        jxy::details::pool_stats_free(PoolTag, 0);
+        ExFreePoolWithTag(Memory, PoolTag);
+    }
+}
+
+void __cdecl operator delete(void* Memory, size_t Size, POOL_TYPE PoolType, ULONG PoolTag) noexcept
+{
+    if (!Memory)
+    {
+        return;
+    }
+
+    jxy::details::pool_stats_free(PoolTag, Size);
+
+    if (!jxy::details::magazine_free(Memory, Size, PoolType, PoolTag))
     {
         ExFreePoolWithTag(Memory, PoolTag);
     }
@@ -46,3 +83,154 @@ void __cdecl operator delete[](void* Memory, POOL_TYPE PoolType, ULONG PoolTag)
 {
     return operator delete(Memory, PoolType, PoolTag);
 }
+
+void __cdecl operator delete[](void* Memory, size_t Size, POOL_TYPE PoolType, ULONG PoolTag) noexcept
+{
+    return operator delete(Memory, Size, PoolType, PoolTag);
+}
+
+void* __cdecl operator new(size_t Size, std::align_val_t Alignment, POOL_TYPE PoolType, ULONG PoolTag) noexcept(false)
+{
+    if (Size == 0)
+    {
+        Size = 1;
+    }
+
+    auto memory = jxy::details::pool_allocate_aligned(PoolType,
+                                                      Size,
+                                                      static_cast<size_t>(Alignment),
+                                                      PoolTag);
+    if (!memory)
+    {
+        throw std::bad_alloc();
+    }
+    jxy::details::pool_stats_allocate(PoolTag, Size);
+    jxy::details::pool_trace_allocate(PoolTag, Size);
+    return memory;
+}
+
+void __cdecl operator delete(void* Memory, std::align_val_t Alignment, POOL_TYPE, ULONG PoolTag) noexcept
+{
+    if (Memory)
+    {
+        //
+        // Unsized, the free is counted but not the bytes.
+        //
+        jxy::details::pool_stats_free(PoolTag, 0);
+        jxy::details::pool_free_aligned(Memory, static_cast<size_t>(Alignment), PoolTag);
+    }
+}
+
+void __cdecl operator delete(void* Memory, size_t Size, std::align_val_t Alignment, POOL_TYPE, ULONG PoolTag) noexcept
+{
+    if (Memory)
+    {
+        jxy::details::pool_stats_free(PoolTag, Size);
+        jxy::details::pool_free_aligned(Memory, static_cast<size_t>(Alignment), PoolTag);
+    }
+}
+
+void* __cdecl operator new[](size_t Size, std::align_val_t Alignment, POOL_TYPE PoolType, ULONG PoolTag) noexcept(false)
+{
+    return operator new(Size, Alignment, PoolType, PoolTag);
+}
+
+void __cdecl operator delete[](void* Memory, std::align_val_t Alignment, POOL_TYPE PoolType, ULONG PoolTag) noexcept
+{
+    return operator delete(Memory, Alignment, PoolType, PoolTag);
+}
+
+void __cdecl operator delete[](void* Memory, size_t Size, std::align_val_t Alignment, POOL_TYPE PoolType, ULONG PoolTag) noexcept
+{
+    return operator delete(Memory, Size, Alignment, PoolType, PoolTag);
+}
+
+void* jxy::details::pool_allocate_aligned(
+    POOL_TYPE PoolType,
+    size_t Size,
+    size_t Alignment,
+    ULONG PoolTag) noexcept
+{
+    NT_ASSERT((Alignment & (Alignment - 1)) == 0);
+
+    //
+    // Within the natural pool alignment there is nothing to do. Otherwise
+    // over-allocate by the alignment, which always leaves room for the pool
+    // block pointer just before the aligned memory.
+    //
+    size_t extra = 0;
+    if (Alignment > MEMORY_ALLOCATION_ALIGNMENT)
+    {
+        extra = Alignment;
+        if (Size > (static_cast<size_t>(-1) - extra))
+        {
+            return nullptr;
+        }
+    }
+
+    auto memory = pool_allocate(PoolType, (Size + extra), PoolTag);
+    if (!memory || (extra == 0))
+    {
+        return memory;
+    }
+
+    auto aligned = ((reinterpret_cast<uintptr_t>(memory) + Alignment) & ~(Alignment - 1));
+    reinterpret_cast<void**>(aligned)[-1] = memory;
+    return reinterpret_cast<void*>(aligned);
+}
+
+void jxy::details::pool_free_aligned(void* Memory, size_t Alignment, ULONG PoolTag) noexcept
+{
+    if (!Memory)
+    {
+        return;
+    }
+
+    if (Alignment > MEMORY_ALLOCATION_ALIGNMENT)
+    {
+        Memory = static_cast<void**>(Memory)[-1];
+    }
+
+    ExFreePoolWithTag(Memory, PoolTag);
+}
+
+POOL_FLAGS jxy::details::pool_type_to_flags(POOL_TYPE PoolType) noexcept
+{
+    //
+    // POOL_TYPE is a combination of a base type (bit 0, paged) and modifier
+    // bits, cache aligned (4), session (32), and no-execute (512).
+    //
+    constexpr ULONG pagedMask = 0x1;
+    constexpr ULONG cacheAlignedMask = 0x4;
+    constexpr ULONG sessionMask = 0x20;
+    constexpr ULONG nxMask = 0x200;
+
+    auto type = static_cast<ULONG>(PoolType);
+
+    POOL_FLAGS flags = POOL_FLAG_UNINITIALIZED;
+
+    if (type & pagedMask)
+    {
+        flags |= POOL_FLAG_PAGED;
+    }
+    else if (type & nxMask)
+    {
+        flags |= POOL_FLAG_NON_PAGED;
+    }
+    else
+    {
+        flags |= POOL_FLAG_NON_PAGED_EXECUTE;
+    }
+
+    if (type & cacheAlignedMask)
+    {
+        flags |= POOL_FLAG_CACHE_ALIGNED;
+    }
+
+    if (type & sessionMask)
+    {
+        flags |= POOL_FLAG_SESSION;
+    }
+
+    return flags;
+}
@@ -0,0 +1,213 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/large_buffer.cpp
+// Author:   Johnny Shaw
+// Abstract: Page granular buffers with reuse
+//
+// The cache is a small table of recently freed buffers under a spin lock.
+// Large buffers are allocated rarely, the lock is only held to move entries
+// in and out of the table, never across a pool call. When the table is full
+// the entries are replaced in turn.
+//
+#include <jxy/large_buffer.hpp>
+#include <jxy/pool_backend.hpp>
+
+namespace jxy::details
+{
+
+struct large_buffer_entry
+{
+    void* Memory;
+    size_t Capacity;
+    POOL_TYPE PoolType;
+    ULONG PoolTag;
+};
+
+//
+// All zero (constant) initialized, an unlocked spin lock and empty entries.
+//
+static KSPIN_LOCK g_LargeBufferLock = 0;
+static large_buffer_entry g_LargeBuffers[large_buffer_cache_entries] = {};
+static ULONG g_LargeBufferNext = 0;
+
+static volatile LONG64 g_LargeBufferHits = 0;
+static volatile LONG64 g_LargeBufferMisses = 0;
+
+static size_t RoundToPages(size_t Size) noexcept
+{
+    if (Size == 0)
+    {
+        return PAGE_SIZE;
+    }
+    return ROUND_TO_PAGES(Size);
+}
+
+}
+
+void* jxy::details::large_buffer_allocate(
+    POOL_TYPE PoolType,
+    ULONG PoolTag,
+    size_t Size,
+    size_t& Capacity) noexcept
+{
+    Capacity = 0;
+
+    if (Size > (static_cast<size_t>(-1) - PAGE_SIZE))
+    {
+        return nullptr;
+    }
+
+    auto required = RoundToPages(Size);
+
+    //
+    // Take the smallest cached buffer that fits and is no more than twice
+    // the request.
+    //
+    large_buffer_entry found{};
+
+    KIRQL oldIrql;
+    KeAcquireSpinLock(&g_LargeBufferLock, &oldIrql);
+
+    large_buffer_entry* best = nullptr;
+    for (auto& entry : g_LargeBuffers)
+    {
+        if (!entry.Memory ||
+            (entry.PoolType != PoolType) ||
+            (entry.PoolTag != PoolTag) ||
+            (entry.Capacity < required) ||
+            ((entry.Capacity / 2) > required))
+        {
+            continue;
+        }
+
+        if (!best || (entry.Capacity < best->Capacity))
+        {
+            best = &entry;
+        }
+    }
+
+    if (best)
+    {
+        found = *best;
+        RtlZeroMemory(best, sizeof(*best));
+    }
+
+    KeReleaseSpinLock(&g_LargeBufferLock, oldIrql);
+
+    if (found.Memory)
+    {
+        InterlockedIncrement64(&g_LargeBufferHits);
+        Capacity = found.Capacity;
+        return found.Memory;
+    }
+
+    InterlockedIncrement64(&g_LargeBufferMisses);
+
+    auto memory = pool_allocate(PoolType, required, PoolTag);
+    if (memory)
+    {
+        Capacity = required;
+    }
+    return memory;
+}
+
+void jxy::details::large_buffer_free(
+    void* Memory,
+    POOL_TYPE PoolType,
+    ULONG PoolTag,
+    size_t Capacity) noexcept
+{
+    if (!Memory)
+    {
+        return;
+    }
+
+    if (Capacity > large_buffer_cache_max_capacity)
+    {
+        ExFreePoolWithTag(Memory, PoolTag);
+        return;
+    }
+
+    large_buffer_entry evicted{};
+
+    KIRQL oldIrql;
+    KeAcquireSpinLock(&g_LargeBufferLock, &oldIrql);
+
+    large_buffer_entry* slot = nullptr;
+    for (auto& entry : g_LargeBuffers)
+    {
+        if (!entry.Memory)
+        {
+            slot = &entry;
+            break;
+        }
+    }
+
+    if (!slot)
+    {
+        slot = &g_LargeBuffers[g_LargeBufferNext];
+        g_LargeBufferNext = ((g_LargeBufferNext + 1) % large_buffer_cache_entries);
+        evicted = *slot;
+    }
+
+    slot->Memory = Memory;
+    slot->Capacity = Capacity;
+    slot->PoolType = PoolType;
+    slot->PoolTag = PoolTag;
+
+    KeReleaseSpinLock(&g_LargeBufferLock, oldIrql);
+
+    if (evicted.Memory)
+    {
+        ExFreePoolWithTag(evicted.Memory, evicted.PoolTag);
+    }
+}
+
+size_t jxy::flush_large_buffer_cache() noexcept
+{
+    details::large_buffer_entry flushed[large_buffer_cache_entries];
+
+    KIRQL oldIrql;
+    KeAcquireSpinLock(&details::g_LargeBufferLock, &oldIrql);
+
+    RtlCopyMemory(flushed, details::g_LargeBuffers, sizeof(flushed));
+    RtlZeroMemory(details::g_LargeBuffers, sizeof(details::g_LargeBuffers));
+    details::g_LargeBufferNext = 0;
+
+    KeReleaseSpinLock(&details::g_LargeBufferLock, oldIrql);
+
+    size_t bytes = 0;
+    for (const auto& entry : flushed)
+    {
+        if (entry.Memory)
+        {
+            ExFreePoolWithTag(entry.Memory, entry.PoolTag);
+            bytes += entry.Capacity;
+        }
+    }
+
+    return bytes;
+}
+
+jxy::large_buffer_cache_stats jxy::query_large_buffer_cache_stats() noexcept
+{
+    large_buffer_cache_stats stats{};
+    stats.hits = static_cast<uint64_t>(ReadNoFence64(&details::g_LargeBufferHits));
+    stats.misses = static_cast<uint64_t>(ReadNoFence64(&details::g_LargeBufferMisses));
+
+    KIRQL oldIrql;
+    KeAcquireSpinLock(&details::g_LargeBufferLock, &oldIrql);
+
+    for (const auto& entry : details::g_LargeBuffers)
+    {
+        if (entry.Memory)
+        {
+            stats.cached_bytes += entry.Capacity;
+        }
+    }
+
+    KeReleaseSpinLock(&details::g_LargeBufferLock, oldIrql);
+
+    return stats;
+}
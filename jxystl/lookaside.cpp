@@ -0,0 +1,108 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/lookaside.cpp
+// Author:   Johnny Shaw
+// Abstract: Lookaside list allocator
+//
+#include <jxy/lookaside.hpp>
+
+namespace jxy::details
+{
+
+//
+// Every lookaside list that has been used is linked here. Entries are never
+// removed, lists have static storage duration and outlive any use of the
+// registry. This is zero (constant) initialized, an empty SLIST.
+//
+static SLIST_HEADER g_LookasideLists{};
+
+}
+
+void* jxy::details::lookaside_list::allocate() noexcept(false)
+{
+    register_list();
+
+    InterlockedIncrement(&m_TotalAllocates);
+
+    void* memory = InterlockedPopEntrySList(&m_ListHead);
+    if (memory)
+    {
+        return memory;
+    }
+
+    InterlockedIncrement(&m_AllocateMisses);
+
+    memory = details::pool_allocate(m_PoolType, m_BlockSize, m_PoolTag);
+    if (!memory)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void jxy::details::lookaside_list::free(void* Memory) noexcept
+{
+    InterlockedIncrement(&m_TotalFrees);
+
+    //
+    // Like the NT lookaside lists the depth check is racy, we may overshoot
+    // the maximum depth by a few entries under contention. That's fine.
+    //
+    if (QueryDepthSList(&m_ListHead) < m_Depth)
+    {
+        InterlockedPushEntrySList(&m_ListHead, static_cast<PSLIST_ENTRY>(Memory));
+        return;
+    }
+
+    InterlockedIncrement(&m_FreeMisses);
+    ExFreePoolWithTag(Memory, m_PoolTag);
+}
+
+size_t jxy::details::lookaside_list::flush() noexcept
+{
+    size_t bytes = 0;
+
+    auto entry = InterlockedFlushSList(&m_ListHead);
+    while (entry)
+    {
+        auto next = entry->Next;
+        ExFreePoolWithTag(entry, m_PoolTag);
+        bytes += m_BlockSize;
+        entry = next;
+    }
+
+    return bytes;
+}
+
+size_t jxy::details::lookaside_list::flush_all() noexcept
+{
+    size_t bytes = 0;
+
+    for (auto entry = RtlFirstEntrySList(&g_LookasideLists);
+         entry != nullptr;
+         entry = entry->Next)
+    {
+        bytes += CONTAINING_RECORD(entry, lookaside_list, m_RegistryEntry)->flush();
+    }
+
+    return bytes;
+}
+
+void jxy::details::lookaside_list::register_list() noexcept
+{
+    if (m_Registered != 0)
+    {
+        return;
+    }
+
+    if (InterlockedCompareExchange(&m_Registered, 1, 0) == 0)
+    {
+        InterlockedPushEntrySList(&g_LookasideLists, &m_RegistryEntry);
+    }
+}
+
+size_t jxy::flush_lookaside_caches() noexcept
+{
+    return details::lookaside_list::flush_all();
+}
@@ -0,0 +1,390 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/magazine.cpp
+// Author:   Johnny Shaw
+// Abstract: Per-CPU magazine cache for the tagged new/delete operators
+//
+// Each CPU structure is protected by a spin lock, only the owning CPU takes
+// it on the hot path so it is uncontended unless the cache is being flushed.
+// Cached blocks may be paged pool, they're never touched while the lock is
+// held and are always freed back to the pool after lowering IRQL.
+//
+// Blocks are only rounded up to their size class while the cache is enabled.
+// A block is only cached if the pool reports it is at least as large as its
+// class, so one allocated before the cache was enabled is freed to the pool.
+//
+#include <jxy/magazine.hpp>
+#include <jxy/pool_backend.hpp>
+#include <utility>
+
+namespace jxy::details
+{
+
+static constexpr POOL_TYPE k_MagazinePoolType = NonPagedPoolNxCacheAligned;
+static constexpr ULONG k_MagazinePoolTag = 'gMXJ';
+
+static constexpr ULONG k_MagazineRounds = 16;
+static constexpr ULONG k_MagazineSlots = 32;
+static constexpr ULONG k_MagazineProbes = 4;
+
+//
+// Size classes are 16 byte granular up to 128 bytes (the pool already rounds
+// to 16), then widen so the rounding waste stays at or below 25%.
+//
+static constexpr size_t k_SizeClasses[] =
+{
+    16, 32, 48, 64, 80, 96, 112, 128,
+    160, 192, 224, 256,
+    320, 384, 448, 512
+};
+static constexpr ULONG k_SizeClassCount = RTL_NUMBER_OF(k_SizeClasses);
+
+struct magazine
+{
+    ULONG Rounds;
+    void* Round[k_MagazineRounds];
+};
+
+struct magazine_slot
+{
+    bool InUse;
+    POOL_TYPE PoolType;
+    ULONG PoolTag;
+    ULONG SizeClass;
+    magazine Loaded;
+    magazine Previous;
+};
+
+struct DECLSPEC_CACHEALIGN magazine_cpu
+{
+    KSPIN_LOCK Lock;
+    uint64_t Hits;
+    uint64_t Misses;
+    uint64_t Flushes;
+    magazine_slot Slots[k_MagazineSlots];
+};
+
+static magazine_cpu* g_MagazineCpus = nullptr;
+static ULONG g_MagazineCpuCount = 0;
+
+//
+// Smallest class that can satisfy the size. The tagged new rounds every
+// block up to its class, so the same class is recovered from the size given
+// to the sized delete. jxy::default_delete only gives the size for the exact
+// type, objects with a virtual destructor are freed unsized.
+//
+static ULONG SizeClass(size_t Size) noexcept
+{
+    for (ULONG i = 0; i < k_SizeClassCount; i++)
+    {
+        if (Size <= k_SizeClasses[i])
+        {
+            return i;
+        }
+    }
+    return k_SizeClassCount;
+}
+
+static magazine_slot* FindSlot(
+    magazine_cpu* Cpu,
+    POOL_TYPE PoolType,
+    ULONG PoolTag,
+    ULONG SizeClass,
+    bool Claim) noexcept
+{
+    ULONG hash = (PoolTag * 0x9e3779b1ul) ^ (static_cast<ULONG>(PoolType) << 5) ^ SizeClass;
+
+    for (ULONG i = 0; i < k_MagazineProbes; i++)
+    {
+        auto slot = &Cpu->Slots[(hash + i) % k_MagazineSlots];
+        if (!slot->InUse)
+        {
+            if (!Claim)
+            {
+                continue;
+            }
+
+            slot->InUse = true;
+            slot->PoolType = PoolType;
+            slot->PoolTag = PoolTag;
+            slot->SizeClass = SizeClass;
+            slot->Loaded.Rounds = 0;
+            slot->Previous.Rounds = 0;
+            return slot;
+        }
+
+        if ((slot->PoolTag == PoolTag) &&
+            (slot->PoolType == PoolType) &&
+            (slot->SizeClass == SizeClass))
+        {
+            return slot;
+        }
+    }
+
+    return nullptr;
+}
+
+static void FreeRounds(const magazine& Magazine, ULONG PoolTag) noexcept
+{
+    for (ULONG i = 0; i < Magazine.Rounds; i++)
+    {
+        ExFreePoolWithTag(Magazine.Round[i], PoolTag);
+    }
+}
+
+}
+
+size_t jxy::details::magazine_round_size(size_t Size) noexcept
+{
+    if (!g_MagazineCpus)
+    {
+        return Size;
+    }
+
+    auto cls = SizeClass(Size);
+    if (cls == k_SizeClassCount)
+    {
+        return Size;
+    }
+    return k_SizeClasses[cls];
+}
+
+void* jxy::details::magazine_allocate(
+    size_t Size,
+    POOL_TYPE PoolType,
+    ULONG PoolTag) noexcept
+{
+    if (!g_MagazineCpus || (KeGetCurrentIrql() > DISPATCH_LEVEL))
+    {
+        return nullptr;
+    }
+
+    auto cls = SizeClass(Size);
+    if (cls == k_SizeClassCount)
+    {
+        return nullptr;
+    }
+
+    void* memory = nullptr;
+
+    auto oldIrql = KeRaiseIrqlToDpcLevel();
+
+    auto index = KeGetCurrentProcessorNumberEx(nullptr);
+    if (index < g_MagazineCpuCount)
+    {
+        auto cpu = &g_MagazineCpus[index];
+
+        KeAcquireSpinLockAtDpcLevel(&cpu->Lock);
+
+        auto slot = FindSlot(cpu, PoolType, PoolTag, cls, false);
+        if (slot)
+        {
+            if ((slot->Loaded.Rounds == 0) && (slot->Previous.Rounds > 0))
+            {
+                std::swap(slot->Loaded, slot->Previous);
+            }
+
+            if (slot->Loaded.Rounds > 0)
+            {
+                memory = slot->Loaded.Round[--slot->Loaded.Rounds];
+            }
+        }
+
+        if (memory)
+        {
+            cpu->Hits++;
+        }
+        else
+        {
+            cpu->Misses++;
+        }
+
+        KeReleaseSpinLockFromDpcLevel(&cpu->Lock);
+    }
+
+    KeLowerIrql(oldIrql);
+
+    return memory;
+}
+
+bool jxy::details::magazine_free(
+    void* Memory,
+    size_t Size,
+    POOL_TYPE PoolType,
+    ULONG PoolTag) noexcept
+{
+    if (!g_MagazineCpus || (KeGetCurrentIrql() > DISPATCH_LEVEL))
+    {
+        return false;
+    }
+
+    auto cls = SizeClass(Size);
+    if (cls == k_SizeClassCount)
+    {
+        return false;
+    }
+
+    BOOLEAN quotaCharged;
+    if (ExQueryPoolBlockSize(Memory, &quotaCharged) < k_SizeClasses[cls])
+    {
+        return false;
+    }
+
+    bool cached = false;
+    magazine flush;
+    flush.Rounds = 0;
+
+    auto oldIrql = KeRaiseIrqlToDpcLevel();
+
+    auto index = KeGetCurrentProcessorNumberEx(nullptr);
+    if (index < g_MagazineCpuCount)
+    {
+        auto cpu = &g_MagazineCpus[index];
+
+        KeAcquireSpinLockAtDpcLevel(&cpu->Lock);
+
+        auto slot = FindSlot(cpu, PoolType, PoolTag, cls, true);
+        if (slot)
+        {
+            if (slot->Loaded.Rounds == k_MagazineRounds)
+            {
+                //
+                // Both magazines full, the previous one is returned to the
+                // pool (outside of the lock) and becomes the empty loaded
+                // magazine.
+                //
+                if (slot->Previous.Rounds > 0)
+                {
+                    flush = slot->Previous;
+                    slot->Previous.Rounds = 0;
+                    cpu->Flushes++;
+                }
+
+                std::swap(slot->Loaded, slot->Previous);
+            }
+
+            slot->Loaded.Round[slot->Loaded.Rounds++] = Memory;
+            cached = true;
+        }
+
+        KeReleaseSpinLockFromDpcLevel(&cpu->Lock);
+    }
+
+    KeLowerIrql(oldIrql);
+
+    FreeRounds(flush, PoolTag);
+
+    return cached;
+}
+
+NTSTATUS jxy::initialize_magazine_cache() noexcept
+{
+    NT_ASSERT(details::g_MagazineCpus == nullptr);
+
+    auto count = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+    auto size = (sizeof(details::magazine_cpu) * count);
+
+    auto cpus = static_cast<details::magazine_cpu*>(
+        details::pool_allocate_zero(details::k_MagazinePoolType,
+                                    size,
+                                    details::k_MagazinePoolTag));
+    if (!cpus)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    for (ULONG i = 0; i < count; i++)
+    {
+        KeInitializeSpinLock(&cpus[i].Lock);
+    }
+
+    details::g_MagazineCpuCount = count;
+    details::g_MagazineCpus = cpus;
+
+    return STATUS_SUCCESS;
+}
+
+void jxy::uninitialize_magazine_cache() noexcept
+{
+    if (!details::g_MagazineCpus)
+    {
+        return;
+    }
+
+    flush_magazine_cache();
+
+    auto cpus = details::g_MagazineCpus;
+    details::g_MagazineCpus = nullptr;
+    details::g_MagazineCpuCount = 0;
+
+    ExFreePoolWithTag(cpus, details::k_MagazinePoolTag);
+}
+
+size_t jxy::flush_magazine_cache() noexcept
+{
+    size_t bytes = 0;
+
+    if (!details::g_MagazineCpus)
+    {
+        return bytes;
+    }
+
+    for (ULONG i = 0; i < details::g_MagazineCpuCount; i++)
+    {
+        auto cpu = &details::g_MagazineCpus[i];
+
+        for (auto& slot : cpu->Slots)
+        {
+            details::magazine_slot flush;
+            flush.InUse = false;
+
+            KIRQL oldIrql;
+            KeAcquireSpinLock(&cpu->Lock, &oldIrql);
+
+            if (slot.InUse)
+            {
+                flush = slot;
+                slot.InUse = false;
+                slot.Loaded.Rounds = 0;
+                slot.Previous.Rounds = 0;
+                cpu->Flushes++;
+            }
+
+            KeReleaseSpinLock(&cpu->Lock, oldIrql);
+
+            if (!flush.InUse)
+            {
+                continue;
+            }
+
+            details::FreeRounds(flush.Loaded, flush.PoolTag);
+            details::FreeRounds(flush.Previous, flush.PoolTag);
+
+            bytes += ((flush.Loaded.Rounds + flush.Previous.Rounds) *
+                      details::k_SizeClasses[flush.SizeClass]);
+        }
+    }
+
+    return bytes;
+}
+
+jxy::magazine_cache_stats jxy::query_magazine_cache_stats() noexcept
+{
+    magazine_cache_stats stats{};
+
+    if (!details::g_MagazineCpus)
+    {
+        return stats;
+    }
+
+    for (ULONG i = 0; i < details::g_MagazineCpuCount; i++)
+    {
+        const auto& cpu = details::g_MagazineCpus[i];
+        stats.hits += cpu.Hits;
+        stats.misses += cpu.Misses;
+        stats.flushes += cpu.Flushes;
+    }
+
+    return stats;
+}
@@ -0,0 +1,47 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/memory_resource.cpp
+// Author:   Johnny Shaw
+// Abstract: Pool type and tag aware memory resources <memory_resource>
+//
+#include <jxy/memory_resource.hpp>
+#include <jxy/alloc.hpp>
+#include <jxy/pool_stats.hpp>
+
+void* jxy::pmr::tagged_resource::do_allocate(size_t Bytes, size_t Align)
+{
+    if (Bytes == 0)
+    {
+        Bytes = 1;
+    }
+
+    auto memory = jxy::details::pool_allocate_aligned(m_PoolType, Bytes, Align, m_PoolTag);
+    if (!memory)
+    {
+        throw std::bad_alloc();
+    }
+
+    jxy::details::pool_stats_allocate(m_PoolTag, Bytes);
+    return memory;
+}
+
+void jxy::pmr::tagged_resource::do_deallocate(void* Memory, size_t Bytes, size_t Align)
+{
+    if (!Memory)
+    {
+        return;
+    }
+
+    jxy::details::pool_stats_free(m_PoolTag, (Bytes == 0 ? 1 : Bytes));
+    jxy::details::pool_free_aligned(Memory, Align, m_PoolTag);
+}
+
+bool jxy::pmr::tagged_resource::do_is_equal(const memory_resource& Other) const noexcept
+{
+    //
+    // Telling whether Other is a tagged resource would take a dynamic_cast,
+    // the kernel is built without RTTI. Only the same resource is equal.
+    //
+    return (this == &Other);
+}
@@ -13,6 +13,7 @@
 // for the kernel.
 //
 #include <fltKernel.h>
+#include <jxy/pool_backend.hpp>
 #include <stdexcept>
 #include <system_error>
 #include <intrin.h>
@@ -92,12 +93,9 @@ void __cdecl __std_exception_copy(
 
     size_t len = strlen(From->_What) + 1;
 
-#pragma warning(push)
-#pragma warning(disable : 4996) // FIXME - deprecated function
-    char* buff = static_cast<char*>(ExAllocatePoolWithTag(k_ExcCopyPoolType,
-                                                          len,
-                                                          k_ExcCopyPoolTag));
-#pragma warning(pop)
+    char* buff = static_cast<char*>(jxy::details::pool_allocate(k_ExcCopyPoolType,
+                                                                len,
+                                                                k_ExcCopyPoolTag));
     if (!buff)
     {
         //
@@ -0,0 +1,82 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/numa.cpp
+// Author:   Johnny Shaw
+// Abstract: NUMA node aware allocation
+//
+#include <jxy/numa.hpp>
+#include <jxy/pool_stats.hpp>
+#include <jxy/pool_trace.hpp>
+#include <jxy/magazine.hpp>
+
+ULONG jxy::details::numa_resolve_node(ULONG Node) noexcept
+{
+    if (Node == numa_current_node)
+    {
+        return KeGetCurrentNodeNumber();
+    }
+    return Node;
+}
+
+void* jxy::details::numa_pool_allocate(
+    POOL_TYPE PoolType,
+    size_t Size,
+    ULONG PoolTag,
+    ULONG Node) noexcept
+{
+    POOL_EXTENDED_PARAMETER parameter;
+    RtlZeroMemory(&parameter, sizeof(parameter));
+    parameter.Type = PoolExtendedParameterNumaNode;
+    parameter.Optional = FALSE;
+    parameter.PreferredNode = numa_resolve_node(Node);
+
+    return ExAllocatePool3(pool_type_to_flags(PoolType),
+                           ((Size == 0) ? 1 : Size),
+                           PoolTag,
+                           &parameter,
+                           1);
+}
+
+void* __cdecl operator new(size_t Size, POOL_TYPE PoolType, ULONG PoolTag, jxy::numa_node Node) noexcept(false)
+{
+    //
+    // Rounded to the magazine size class like the tagged new, the object may
+    // be released with the sized tagged delete.
+    //
+    auto memory = jxy::details::numa_pool_allocate(PoolType,
+                                                   jxy::details::magazine_round_size(Size),
+                                                   PoolTag,
+                                                   Node.number);
+    if (!memory)
+    {
+        throw std::bad_alloc();
+    }
+    jxy::details::pool_stats_allocate(PoolTag, Size);
+    jxy::details::pool_trace_allocate(PoolTag, Size);
+    return memory;
+}
+
+void __cdecl operator delete(void* Memory, POOL_TYPE, ULONG PoolTag, jxy::numa_node) noexcept
+{
+    if (Memory)
+    {
+        //
+        // Unsized, the free is counted but not the bytes.
+        //
+        jxy::details::pool_stats_free(PoolTag, 0);
+        ExFreePoolWithTag(Memory, PoolTag);
+    }
+}
+
+void __cdecl operator delete(void* Memory, size_t Size, POOL_TYPE, ULONG PoolTag, jxy::numa_node) noexcept
+{
+    if (Memory)
+    {
+        //
+        // Never cached, the block should go back to its node.
+        //
+        jxy::details::pool_stats_free(PoolTag, Size);
+        ExFreePoolWithTag(Memory, PoolTag);
+    }
+}
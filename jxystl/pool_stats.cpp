@@ -0,0 +1,411 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/pool_stats.cpp
+// Author:   Johnny Shaw
+// Abstract: Per-tag live allocation statistics
+//
+// Tags are assigned an index in a global table the first time they're seen,
+// the slot is claimed with a compare exchange so there is no lock. Each CPU
+// has a row of counters for every index. Recording only touches the current
+// CPU's row, querying sums the rows.
+//
+// Recording and querying hold a reference on the table for as long as they
+// use it. The references are counted on one of a fixed set of cache aligned
+// counters (picked by the current CPU) so they don't all contend on a single
+// line, and the counters are static so they outlive the table. Uninitializing
+// unpublishes the table and waits for the references to drain before it's
+// freed.
+//
+#include <jxy/pool_stats.hpp>
+#include <jxy/pool_backend.hpp>
+
+#if JXY_POOL_STATS
+
+namespace jxy::details
+{
+
+static constexpr POOL_TYPE k_PoolStatsPoolType = NonPagedPoolNxCacheAligned;
+static constexpr ULONG k_PoolStatsPoolTag = 'sPXJ';
+
+//
+// Index zero is the overflow entry, it is also where tag zero is counted.
+//
+static constexpr ULONG k_OverflowIndex = 0;
+
+//
+// A CPU samples the peak each time its share of a tag grows this much past
+// the last sample.
+//
+static constexpr LONG64 k_PeakSampleBytes = PAGE_SIZE;
+
+static constexpr ULONG k_ReferenceSlots = 64;
+
+struct pool_stats_counters
+{
+    volatile LONG64 Allocations;
+    volatile LONG64 Frees;
+    volatile LONG64 BytesAllocated;
+    volatile LONG64 BytesFreed;
+    volatile LONG64 HighWater;
+    volatile LONG64 Histogram[pool_stats_histogram_buckets];
+};
+
+struct DECLSPEC_CACHEALIGN pool_stats_cpu
+{
+    pool_stats_counters Tags[pool_stats_max_tags];
+};
+
+struct DECLSPEC_CACHEALIGN pool_stats_references
+{
+    volatile LONG Count;
+};
+
+static volatile LONG g_PoolStatsTags[pool_stats_max_tags] = {};
+static volatile LONG64 g_PoolStatsPeak[pool_stats_max_tags] = {};
+static pool_stats_references g_PoolStatsReferences[k_ReferenceSlots] = {};
+static pool_stats_cpu* volatile g_PoolStatsCpus = nullptr;
+static ULONG g_PoolStatsCpuCount = 0;
+
+//
+// Holds a reference on the table, cpus() is null if it isn't initialized or
+// is being torn down. The reference is released on the slot it was taken on
+// even if the thread has since moved to another CPU.
+//
+class pool_stats_reference
+{
+public:
+
+    pool_stats_reference() noexcept
+        : m_Slot(KeGetCurrentProcessorNumberEx(nullptr) % k_ReferenceSlots)
+    {
+        //
+        // The interlocked increment is a full barrier, if the table is seen
+        // here the teardown will see this reference.
+        //
+        InterlockedIncrement(&g_PoolStatsReferences[m_Slot].Count);
+        m_Cpus = g_PoolStatsCpus;
+    }
+
+    ~pool_stats_reference() noexcept
+    {
+        InterlockedDecrement(&g_PoolStatsReferences[m_Slot].Count);
+    }
+
+    pool_stats_reference(const pool_stats_reference&) = delete;
+    pool_stats_reference& operator=(const pool_stats_reference&) = delete;
+
+    pool_stats_cpu* cpus() const noexcept
+    {
+        return m_Cpus;
+    }
+
+private:
+
+    ULONG m_Slot;
+    pool_stats_cpu* m_Cpus;
+
+};
+
+static void WaitForReferences() noexcept
+{
+    for (ULONG i = 0; i < k_ReferenceSlots; i++)
+    {
+        while (ReadNoFence(&g_PoolStatsReferences[i].Count) != 0)
+        {
+            LARGE_INTEGER interval;
+            interval.QuadPart = -(10 * 1000); // 1ms
+            KeDelayExecutionThread(KernelMode, FALSE, &interval);
+        }
+    }
+}
+
+static ULONG TagIndex(ULONG PoolTag) noexcept
+{
+    if (PoolTag == 0)
+    {
+        return k_OverflowIndex;
+    }
+
+    constexpr ULONG slots = (pool_stats_max_tags - 1);
+    ULONG hash = ((PoolTag * 0x9e3779b1ul) % slots);
+
+    for (ULONG i = 0; i < slots; i++)
+    {
+        auto index = (1 + ((hash + i) % slots));
+        auto tag = static_cast<ULONG>(g_PoolStatsTags[index]);
+        if (tag == PoolTag)
+        {
+            return index;
+        }
+
+        if (tag == 0)
+        {
+            tag = static_cast<ULONG>(InterlockedCompareExchange(&g_PoolStatsTags[index],
+                                                               static_cast<LONG>(PoolTag),
+                                                               0));
+            if ((tag == 0) || (tag == PoolTag))
+            {
+                return index;
+            }
+        }
+    }
+
+    return k_OverflowIndex;
+}
+
+static ULONG HistogramBucket(size_t Size) noexcept
+{
+    ULONG bucket = 0;
+    size_t bound = 16;
+    while ((Size > bound) && (bucket < (pool_stats_histogram_buckets - 1)))
+    {
+        bound <<= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+static pool_stats_counters* CurrentCounters(pool_stats_cpu* Cpus, ULONG Index) noexcept
+{
+    auto cpu = KeGetCurrentProcessorNumberEx(nullptr);
+    if (cpu >= g_PoolStatsCpuCount)
+    {
+        return nullptr;
+    }
+
+    return &Cpus[cpu].Tags[Index];
+}
+
+static LONG64 BytesOutstanding(pool_stats_cpu* Cpus, ULONG Index) noexcept
+{
+    LONG64 bytes = 0;
+    for (ULONG i = 0; i < g_PoolStatsCpuCount; i++)
+    {
+        auto& counters = Cpus[i].Tags[Index];
+        bytes += ReadNoFence64(&counters.BytesAllocated);
+        bytes -= ReadNoFence64(&counters.BytesFreed);
+    }
+    return bytes;
+}
+
+static LONG64 SamplePeak(pool_stats_cpu* Cpus, ULONG Index) noexcept
+{
+    auto bytes = BytesOutstanding(Cpus, Index);
+
+    auto peak = ReadNoFence64(&g_PoolStatsPeak[Index]);
+    while (bytes > peak)
+    {
+        auto previous = InterlockedCompareExchange64(&g_PoolStatsPeak[Index], bytes, peak);
+        if (previous == peak)
+        {
+            return bytes;
+        }
+        peak = previous;
+    }
+
+    return peak;
+}
+
+static void CopyStats(pool_stats_cpu* Cpus, ULONG Index, pool_tag_stats& Stats) noexcept
+{
+    RtlZeroMemory(&Stats, sizeof(Stats));
+
+    Stats.tag = static_cast<ULONG>(g_PoolStatsTags[Index]);
+
+    for (ULONG i = 0; i < g_PoolStatsCpuCount; i++)
+    {
+        auto& counters = Cpus[i].Tags[Index];
+        Stats.allocations += ReadNoFence64(&counters.Allocations);
+        Stats.frees += ReadNoFence64(&counters.Frees);
+        for (ULONG j = 0; j < pool_stats_histogram_buckets; j++)
+        {
+            Stats.histogram[j] += ReadNoFence64(&counters.Histogram[j]);
+        }
+    }
+
+    Stats.bytes_outstanding = BytesOutstanding(Cpus, Index);
+    Stats.peak_bytes = SamplePeak(Cpus, Index);
+}
+
+}
+
+void jxy::details::pool_stats_allocate(ULONG PoolTag, size_t Size) noexcept
+{
+    pool_stats_reference reference;
+    if (!reference.cpus())
+    {
+        return;
+    }
+
+    auto index = TagIndex(PoolTag);
+    auto counters = CurrentCounters(reference.cpus(), index);
+    if (!counters)
+    {
+        return;
+    }
+
+    InterlockedIncrement64(&counters->Allocations);
+    InterlockedIncrement64(&counters->Histogram[HistogramBucket(Size)]);
+
+    auto bytes = static_cast<LONG64>(Size);
+    auto allocated = (InterlockedExchangeAdd64(&counters->BytesAllocated, bytes) + bytes);
+    auto share = (allocated - ReadNoFence64(&counters->BytesFreed));
+
+    auto highWater = ReadNoFence64(&counters->HighWater);
+    if ((share >= (highWater + k_PeakSampleBytes)) &&
+        (InterlockedCompareExchange64(&counters->HighWater, share, highWater) == highWater))
+    {
+        SamplePeak(reference.cpus(), index);
+    }
+}
+
+void jxy::details::pool_stats_free(ULONG PoolTag, size_t Size) noexcept
+{
+    pool_stats_reference reference;
+    if (!reference.cpus())
+    {
+        return;
+    }
+
+    auto counters = CurrentCounters(reference.cpus(), TagIndex(PoolTag));
+    if (!counters)
+    {
+        return;
+    }
+
+    //
+    // An unsized free (Size zero) is counted but its bytes are unknown, they
+    // stay outstanding.
+    //
+    InterlockedIncrement64(&counters->Frees);
+    if (Size > 0)
+    {
+        InterlockedExchangeAdd64(&counters->BytesFreed, static_cast<LONG64>(Size));
+    }
+}
+
+NTSTATUS jxy::initialize_pool_stats() noexcept
+{
+    NT_ASSERT(details::g_PoolStatsCpus == nullptr);
+
+    auto count = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+    auto size = (sizeof(details::pool_stats_cpu) * count);
+
+    auto cpus = static_cast<details::pool_stats_cpu*>(
+        details::pool_allocate_zero(details::k_PoolStatsPoolType,
+                                    size,
+                                    details::k_PoolStatsPoolTag));
+    if (!cpus)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    for (ULONG i = 0; i < pool_stats_max_tags; i++)
+    {
+        details::g_PoolStatsTags[i] = 0;
+        details::g_PoolStatsPeak[i] = 0;
+    }
+
+    details::g_PoolStatsCpuCount = count;
+    InterlockedExchangePointer(reinterpret_cast<void* volatile*>(&details::g_PoolStatsCpus), cpus);
+
+    return STATUS_SUCCESS;
+}
+
+void jxy::uninitialize_pool_stats() noexcept
+{
+    auto cpus = details::g_PoolStatsCpus;
+    if (!cpus)
+    {
+        return;
+    }
+
+    //
+    // Recorders that saw the table hold a reference, new ones will see null.
+    //
+    InterlockedExchangePointer(reinterpret_cast<void* volatile*>(&details::g_PoolStatsCpus), nullptr);
+    details::WaitForReferences();
+
+    details::g_PoolStatsCpuCount = 0;
+
+    ExFreePoolWithTag(cpus, details::k_PoolStatsPoolTag);
+}
+
+size_t jxy::query_pool_stats(pool_tag_stats* Stats, size_t Count) noexcept
+{
+    details::pool_stats_reference reference;
+    if (!reference.cpus())
+    {
+        return 0;
+    }
+
+    size_t found = 0;
+
+    for (ULONG i = 0; i < pool_stats_max_tags; i++)
+    {
+        if ((i != details::k_OverflowIndex) && (details::g_PoolStatsTags[i] == 0))
+        {
+            continue;
+        }
+
+        pool_tag_stats stats;
+        details::CopyStats(reference.cpus(), i, stats);
+
+        if ((i == details::k_OverflowIndex) && (stats.allocations == 0) && (stats.frees == 0))
+        {
+            continue;
+        }
+
+        if (found < Count)
+        {
+            Stats[found] = stats;
+        }
+        found++;
+    }
+
+    return found;
+}
+
+bool jxy::query_pool_tag_stats(ULONG PoolTag, pool_tag_stats& Stats) noexcept
+{
+    details::pool_stats_reference reference;
+    if (!reference.cpus())
+    {
+        return false;
+    }
+
+    for (ULONG i = 0; i < pool_stats_max_tags; i++)
+    {
+        if (static_cast<ULONG>(details::g_PoolStatsTags[i]) == PoolTag)
+        {
+            details::CopyStats(reference.cpus(), i, Stats);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#else
+
+NTSTATUS jxy::initialize_pool_stats() noexcept
+{
+    return STATUS_NOT_SUPPORTED;
+}
+
+void jxy::uninitialize_pool_stats() noexcept
+{
+}
+
+size_t jxy::query_pool_stats(pool_tag_stats*, size_t) noexcept
+{
+    return 0;
+}
+
+bool jxy::query_pool_tag_stats(ULONG, pool_tag_stats&) noexcept
+{
+    return false;
+}
+
+#endif
@@ -0,0 +1,313 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/pool_trace.cpp
+// Author:   Johnny Shaw
+// Abstract: Per-tag allocation call site tracing
+//
+// A call site is keyed by the pool tag and a hash of the captured return
+// addresses. Keys are assigned a slot in a global table the first time
+// they're seen, the slot is claimed with a compare exchange and the frames
+// are written once by the claimer. Each CPU has a row of counters for every
+// slot. Recording only touches the current CPU's row, querying sums the rows.
+//
+// Recording and querying hold a reference on the rows for as long as they use
+// them, counted as in jxystl/pool_stats.cpp on one of a fixed set of cache
+// aligned counters. Uninitializing unpublishes the rows and waits for the
+// references to drain before they're freed.
+//
+#include <jxy/pool_trace.hpp>
+#include <jxy/pool_backend.hpp>
+
+#if JXY_POOL_TRACE
+
+namespace jxy::details
+{
+
+static constexpr POOL_TYPE k_PoolTracePoolType = NonPagedPoolNxCacheAligned;
+static constexpr ULONG k_PoolTracePoolTag = 'tPXJ';
+
+//
+// Index zero is the overflow entry, its key is zero.
+//
+static constexpr ULONG k_OverflowIndex = 0;
+
+static constexpr ULONG k_ReferenceSlots = 64;
+
+struct pool_trace_site
+{
+    volatile LONG64 Key;
+    void* Frames[pool_trace_frames];
+};
+
+struct pool_trace_counters
+{
+    volatile LONG64 Allocations;
+    volatile LONG64 Bytes;
+};
+
+struct DECLSPEC_CACHEALIGN pool_trace_cpu
+{
+    pool_trace_counters Sites[pool_trace_max_sites];
+};
+
+struct DECLSPEC_CACHEALIGN pool_trace_references
+{
+    volatile LONG Count;
+};
+
+static pool_trace_site g_PoolTraceSites[pool_trace_max_sites] = {};
+static pool_trace_references g_PoolTraceReferences[k_ReferenceSlots] = {};
+static pool_trace_cpu* volatile g_PoolTraceCpus = nullptr;
+static ULONG g_PoolTraceCpuCount = 0;
+
+//
+// Holds a reference on the rows, cpus() is null if tracing isn't initialized
+// or is being torn down. The row count is read with the rows, it's published
+// before them and only cleared after the references drain.
+//
+class pool_trace_reference
+{
+public:
+
+    pool_trace_reference() noexcept
+        : m_Slot(KeGetCurrentProcessorNumberEx(nullptr) % k_ReferenceSlots)
+    {
+        InterlockedIncrement(&g_PoolTraceReferences[m_Slot].Count);
+        m_Cpus = g_PoolTraceCpus;
+        m_CpuCount = (m_Cpus ? g_PoolTraceCpuCount : 0);
+    }
+
+    ~pool_trace_reference() noexcept
+    {
+        InterlockedDecrement(&g_PoolTraceReferences[m_Slot].Count);
+    }
+
+    pool_trace_reference(const pool_trace_reference&) = delete;
+    pool_trace_reference& operator=(const pool_trace_reference&) = delete;
+
+    pool_trace_cpu* cpus() const noexcept
+    {
+        return m_Cpus;
+    }
+
+    ULONG cpu_count() const noexcept
+    {
+        return m_CpuCount;
+    }
+
+private:
+
+    ULONG m_Slot;
+    pool_trace_cpu* m_Cpus;
+    ULONG m_CpuCount;
+
+};
+
+static void WaitForReferences() noexcept
+{
+    for (ULONG i = 0; i < k_ReferenceSlots; i++)
+    {
+        while (ReadNoFence(&g_PoolTraceReferences[i].Count) != 0)
+        {
+            LARGE_INTEGER interval;
+            interval.QuadPart = -(10 * 1000); // 1ms
+            KeDelayExecutionThread(KernelMode, FALSE, &interval);
+        }
+    }
+}
+
+static ULONG SiteHash(void* const* Frames, ULONG Count) noexcept
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (ULONG i = 0; i < Count; i++)
+    {
+        hash ^= reinterpret_cast<uintptr_t>(Frames[i]);
+        hash *= 0x100000001b3ull;
+    }
+
+    auto site = static_cast<ULONG>(hash ^ (hash >> 32));
+    return ((site == 0) ? 1 : site);
+}
+
+static LONG64 SiteKey(ULONG PoolTag, ULONG Site) noexcept
+{
+    return static_cast<LONG64>((static_cast<ULONG64>(PoolTag) << 32) | Site);
+}
+
+static ULONG SiteIndex(LONG64 Key, void* const* Frames) noexcept
+{
+    constexpr ULONG slots = (pool_trace_max_sites - 1);
+    ULONG hash = ((static_cast<ULONG>(Key ^ (Key >> 32)) * 0x9e3779b1ul) % slots);
+
+    for (ULONG i = 0; i < slots; i++)
+    {
+        auto index = (1 + ((hash + i) % slots));
+        auto& site = g_PoolTraceSites[index];
+
+        auto key = ReadNoFence64(&site.Key);
+        if (key == Key)
+        {
+            return index;
+        }
+
+        if (key == 0)
+        {
+            key = InterlockedCompareExchange64(&site.Key, Key, 0);
+            if (key == 0)
+            {
+                RtlCopyMemory(site.Frames, Frames, sizeof(site.Frames));
+                return index;
+            }
+
+            if (key == Key)
+            {
+                return index;
+            }
+        }
+    }
+
+    return k_OverflowIndex;
+}
+
+}
+
+void jxy::details::pool_trace_allocate(ULONG PoolTag, size_t Size) noexcept
+{
+    pool_trace_reference reference;
+    if (!reference.cpus())
+    {
+        return;
+    }
+
+    //
+    // Skip this function, the first frame is in the allocator or new.
+    //
+    void* frames[pool_trace_frames] = {};
+    auto captured = RtlCaptureStackBackTrace(1,
+                                             static_cast<ULONG>(pool_trace_frames),
+                                             frames,
+                                             nullptr);
+
+    auto index = SiteIndex(SiteKey(PoolTag, SiteHash(frames, captured)), frames);
+
+    auto cpu = KeGetCurrentProcessorNumberEx(nullptr);
+    if (cpu >= reference.cpu_count())
+    {
+        return;
+    }
+
+    auto& counters = reference.cpus()[cpu].Sites[index];
+    InterlockedIncrement64(&counters.Allocations);
+    InterlockedExchangeAdd64(&counters.Bytes, static_cast<LONG64>(Size));
+}
+
+NTSTATUS jxy::initialize_pool_trace() noexcept
+{
+    NT_ASSERT(details::g_PoolTraceCpus == nullptr);
+
+    auto count = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+    auto size = (sizeof(details::pool_trace_cpu) * count);
+
+    auto cpus = static_cast<details::pool_trace_cpu*>(
+        details::pool_allocate_zero(details::k_PoolTracePoolType,
+                                    size,
+                                    details::k_PoolTracePoolTag));
+    if (!cpus)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    RtlZeroMemory(details::g_PoolTraceSites, sizeof(details::g_PoolTraceSites));
+
+    details::g_PoolTraceCpuCount = count;
+    InterlockedExchangePointer(reinterpret_cast<void* volatile*>(&details::g_PoolTraceCpus), cpus);
+
+    return STATUS_SUCCESS;
+}
+
+void jxy::uninitialize_pool_trace() noexcept
+{
+    auto cpus = details::g_PoolTraceCpus;
+    if (!cpus)
+    {
+        return;
+    }
+
+    //
+    // Recorders that saw the rows hold a reference, new ones will see null.
+    //
+    InterlockedExchangePointer(reinterpret_cast<void* volatile*>(&details::g_PoolTraceCpus), nullptr);
+    details::WaitForReferences();
+
+    details::g_PoolTraceCpuCount = 0;
+
+    ExFreePoolWithTag(cpus, details::k_PoolTracePoolTag);
+}
+
+size_t jxy::query_pool_trace(pool_site_stats* Sites, size_t Count) noexcept
+{
+    details::pool_trace_reference reference;
+    auto cpus = reference.cpus();
+    auto cpuCount = reference.cpu_count();
+    if (!cpus)
+    {
+        return 0;
+    }
+
+    size_t found = 0;
+
+    for (ULONG i = 0; i < pool_trace_max_sites; i++)
+    {
+        const auto& site = details::g_PoolTraceSites[i];
+        auto key = static_cast<ULONG64>(ReadNoFence64(&site.Key));
+        if ((i != details::k_OverflowIndex) && (key == 0))
+        {
+            continue;
+        }
+
+        pool_site_stats stats;
+        RtlZeroMemory(&stats, sizeof(stats));
+        stats.tag = static_cast<ULONG>(key >> 32);
+        stats.site = static_cast<ULONG>(key);
+        RtlCopyMemory(stats.frames, site.Frames, sizeof(stats.frames));
+
+        for (ULONG j = 0; j < cpuCount; j++)
+        {
+            const auto& counters = cpus[j].Sites[i];
+            stats.allocations += ReadNoFence64(&counters.Allocations);
+            stats.bytes += ReadNoFence64(&counters.Bytes);
+        }
+
+        if ((i == details::k_OverflowIndex) && (stats.allocations == 0))
+        {
+            continue;
+        }
+
+        if (found < Count)
+        {
+            Sites[found] = stats;
+        }
+        found++;
+    }
+
+    return found;
+}
+
+#else
+
+NTSTATUS jxy::initialize_pool_trace() noexcept
+{
+    return STATUS_NOT_SUPPORTED;
+}
+
+void jxy::uninitialize_pool_trace() noexcept
+{
+}
+
+size_t jxy::query_pool_trace(pool_site_stats*, size_t) noexcept
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,255 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     jxystl/trim.cpp
+// Author:   Johnny Shaw
+// Abstract: Returning cached memory to the pool under memory pressure
+//
+#include <jxy/trim.hpp>
+#include <jxy/large_buffer.hpp>
+#include <jxy/lookaside.hpp>
+#include <jxy/magazine.hpp>
+#include <jxy/memory.hpp>
+#include <jxy/thread.hpp>
+
+namespace jxy::details
+{
+
+static constexpr POOL_TYPE k_TrimPoolType = NonPagedPoolNx;
+static constexpr ULONG k_TrimPoolTag = 'mTXJ';
+
+//
+// Registered trim callbacks. Registration is rare, trims hold the lock
+// shared so unregistering waits for any trim in progress. Both are zero
+// (constant) initialized.
+//
+static EX_PUSH_LOCK g_TrimCallbackLock{};
+static trim_callback* g_TrimCallbacks = nullptr;
+
+static volatile LONG64 g_Trims = 0;
+static volatile LONG64 g_LowMemoryTrims = 0;
+static volatile LONG64 g_BytesReclaimed = 0;
+static volatile LONG64 g_LastBytesReclaimed = 0;
+
+struct trim_worker
+{
+    ~trim_worker() noexcept
+    {
+        if (LowMemory && Referenced)
+        {
+            ObDereferenceObject(LowMemory);
+        }
+    }
+
+    KEVENT Stop;
+    PKEVENT LowMemory = nullptr;
+    bool Referenced = false;
+    jxy::thread Thread;
+};
+
+static trim_worker* g_TrimWorker = nullptr;
+
+static NTSTATUS OpenLowMemoryCondition(PKEVENT* Event) noexcept
+{
+    UNICODE_STRING name = RTL_CONSTANT_STRING(L"\\KernelObjects\\LowMemoryCondition");
+    OBJECT_ATTRIBUTES attributes;
+    InitializeObjectAttributes(&attributes,
+                               &name,
+                               (OBJ_KERNEL_HANDLE | OBJ_CASE_INSENSITIVE),
+                               nullptr,
+                               nullptr);
+
+    HANDLE handle = nullptr;
+    auto status = ZwOpenEvent(&handle, SYNCHRONIZE, &attributes);
+    if (!NT_SUCCESS(status))
+    {
+        return status;
+    }
+
+    status = ObReferenceObjectByHandle(handle,
+                                       SYNCHRONIZE,
+                                       *ExEventObjectType,
+                                       KernelMode,
+                                       reinterpret_cast<PVOID*>(Event),
+                                       nullptr);
+    NT_VERIFY(NT_SUCCESS(ObCloseHandle(handle, KernelMode)));
+    return status;
+}
+
+static void TrimWorkerRoutine(trim_worker* Worker) noexcept
+{
+    PVOID objects[] = { &Worker->Stop, Worker->LowMemory };
+
+    for (;;)
+    {
+        auto status = KeWaitForMultipleObjects(RTL_NUMBER_OF(objects),
+                                               objects,
+                                               WaitAny,
+                                               Executive,
+                                               KernelMode,
+                                               FALSE,
+                                               nullptr,
+                                               nullptr);
+        if (status != STATUS_WAIT_1)
+        {
+            break;
+        }
+
+        trim_caches();
+        InterlockedIncrement64(&g_LowMemoryTrims);
+
+        //
+        // The low memory condition stays signaled until memory is available
+        // again. Hold off before trimming again so that the caches are not
+        // trimmed continuously while they are being used.
+        //
+        LARGE_INTEGER interval;
+        interval.QuadPart = -(static_cast<LONGLONG>(trim_interval_ms) * 10000);
+        if (KeWaitForSingleObject(&Worker->Stop,
+                                  Executive,
+                                  KernelMode,
+                                  FALSE,
+                                  &interval) == STATUS_SUCCESS)
+        {
+            break;
+        }
+    }
+}
+
+}
+
+void jxy::details::trim_callback::register_callback() noexcept
+{
+    FltAcquirePushLockExclusiveEx(&g_TrimCallbackLock, 0);
+
+    NT_ASSERT(!m_Registered);
+    m_Next = g_TrimCallbacks;
+    g_TrimCallbacks = this;
+    m_Registered = true;
+
+    FltReleasePushLockEx(&g_TrimCallbackLock, 0);
+}
+
+void jxy::details::trim_callback::unregister_callback() noexcept
+{
+    FltAcquirePushLockExclusiveEx(&g_TrimCallbackLock, 0);
+
+    if (m_Registered)
+    {
+        for (auto link = &g_TrimCallbacks; *link != nullptr; link = &(*link)->m_Next)
+        {
+            if (*link == this)
+            {
+                *link = m_Next;
+                break;
+            }
+        }
+
+        m_Next = nullptr;
+        m_Registered = false;
+    }
+
+    FltReleasePushLockEx(&g_TrimCallbackLock, 0);
+}
+
+size_t jxy::details::trim_callback::trim_all() noexcept
+{
+    size_t bytes = 0;
+
+    FltAcquirePushLockSharedEx(&g_TrimCallbackLock, 0);
+
+    for (auto callback = g_TrimCallbacks; callback != nullptr; callback = callback->m_Next)
+    {
+        bytes += callback->m_Function(callback->m_Context);
+    }
+
+    FltReleasePushLockEx(&g_TrimCallbackLock, 0);
+
+    return bytes;
+}
+
+size_t jxy::trim_caches() noexcept
+{
+    size_t bytes = flush_magazine_cache();
+    bytes += flush_lookaside_caches();
+    bytes += flush_large_buffer_cache();
+    bytes += details::trim_callback::trim_all();
+
+    InterlockedIncrement64(&details::g_Trims);
+    InterlockedExchangeAdd64(&details::g_BytesReclaimed, static_cast<LONG64>(bytes));
+    InterlockedExchange64(&details::g_LastBytesReclaimed, static_cast<LONG64>(bytes));
+
+    return bytes;
+}
+
+NTSTATUS jxy::initialize_cache_trimming(PKEVENT LowMemoryEvent) noexcept try
+{
+    NT_ASSERT(details::g_TrimWorker == nullptr);
+
+    auto worker = jxy::make_unique<details::trim_worker,
+                                   details::k_TrimPoolType,
+                                   details::k_TrimPoolTag>();
+
+    KeInitializeEvent(&worker->Stop, NotificationEvent, FALSE);
+
+    if (LowMemoryEvent)
+    {
+        worker->LowMemory = LowMemoryEvent;
+    }
+    else
+    {
+        auto status = details::OpenLowMemoryCondition(&worker->LowMemory);
+        if (!NT_SUCCESS(status))
+        {
+            return status;
+        }
+        worker->Referenced = true;
+    }
+
+    worker->Thread = jxy::thread(&details::TrimWorkerRoutine, worker.get());
+
+    details::g_TrimWorker = worker.release();
+    return STATUS_SUCCESS;
+}
+catch (const std::bad_alloc&)
+{
+    return STATUS_INSUFFICIENT_RESOURCES;
+}
+catch (...)
+{
+    return STATUS_UNSUCCESSFUL;
+}
+
+void jxy::uninitialize_cache_trimming() noexcept
+{
+    jxy::unique_ptr<details::trim_worker,
+                    details::k_TrimPoolType,
+                    details::k_TrimPoolTag> worker(details::g_TrimWorker);
+    details::g_TrimWorker = nullptr;
+
+    if (!worker)
+    {
+        return;
+    }
+
+    KeSetEvent(&worker->Stop, IO_NO_INCREMENT, FALSE);
+
+    try
+    {
+        worker->Thread.join();
+    }
+    catch (...)
+    {
+        NT_ASSERT(false);
+    }
+}
+
+jxy::trim_stats jxy::query_trim_stats() noexcept
+{
+    trim_stats stats{};
+    stats.trims = static_cast<uint64_t>(ReadNoFence64(&details::g_Trims));
+    stats.low_memory_trims = static_cast<uint64_t>(ReadNoFence64(&details::g_LowMemoryTrims));
+    stats.bytes_reclaimed = static_cast<uint64_t>(ReadNoFence64(&details::g_BytesReclaimed));
+    stats.last_bytes_reclaimed = static_cast<uint64_t>(ReadNoFence64(&details::g_LastBytesReclaimed));
+    return stats;
+}
@@ -0,0 +1,30 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     stlkrn/config.hpp
+// Author:   Johnny Shaw
+// Abstract: Build configuration shared by the stlkrn maps
+//
+#pragma once
+
+//
+// The process and thread maps are keyed by IDs, define JXY_ID_TABLE_MAPS as
+// 1 to index them directly with jxy::id_table rather than jxy::map. The
+// thread maps of each process context use it too, a process's threads are
+// scattered over the ID space so those cost about a page per thread.
+//
+#ifndef JXY_ID_TABLE_MAPS
+#define JXY_ID_TABLE_MAPS 0
+#endif
+
+//
+// Define JXY_BTREE_MAPS as 1 to keep them in jxy::btree_map instead, ordered
+// like jxy::map but with many entries to a node.
+//
+#ifndef JXY_BTREE_MAPS
+#define JXY_BTREE_MAPS 0
+#endif
+
+#if JXY_ID_TABLE_MAPS && JXY_BTREE_MAPS
+#error Define one of JXY_ID_TABLE_MAPS and JXY_BTREE_MAPS
+#endif
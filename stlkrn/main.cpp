@@ -24,18 +24,127 @@
 //
 #include <fltKernel.h>
 #include <jxy/scope.hpp>
+#include <jxy/lookaside.hpp>
+#include <jxy/pool_stats.hpp>
+#include <jxy/pool_trace.hpp>
+#include <jxy/trim.hpp>
+#include <jxy/vector.hpp>
+#include <algorithm>
 #include "process_map.hpp"
 #include "process_callbacks.hpp"
 #include "thread_callbacks.hpp"
 #include "module_callbacks.hpp"
 
+//
+// When jxystl is built with JXY_POOL_STATS the per-tag allocation statistics
+// are written to the debugger. Anything still outstanding at this point was
+// leaked.
+//
+void DumpPoolStats() noexcept try
+{
+    auto count = jxy::query_pool_stats(nullptr, 0);
+    if (count == 0)
+    {
+        return;
+    }
+
+    //
+    // Default initialized, the query overwrites the entries.
+    //
+    jxy::vector<jxy::pool_tag_stats,
+                PagedPool,
+                jxy::PoolTags::PoolStats,
+                jxy::default_init_allocator<jxy::pool_tag_stats, PagedPool, jxy::PoolTags::PoolStats>> stats(count);
+    count = jxy::query_pool_stats(stats.data(), stats.size());
+    count = (count < stats.size() ? count : stats.size());
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const auto& entry = stats[i];
+        DbgPrintEx(DPFLTR_IHVDRIVER_ID,
+                   DPFLTR_INFO_LEVEL,
+                   "stlkrn: %.4s allocs %llu frees %llu outstanding %lld peak %lld\n",
+                   reinterpret_cast<const char*>(&entry.tag),
+                   entry.allocations,
+                   entry.frees,
+                   entry.bytes_outstanding,
+                   entry.peak_bytes);
+    }
+}
+catch (...)
+{
+}
+
+//
+// When jxystl is built with JXY_POOL_TRACE the hottest allocation call sites
+// are written to the debugger, resolve the frames with "ln" to find the code
+// path (for example the thread and image load notify routines).
+//
+void DumpPoolTrace() noexcept try
+{
+    constexpr size_t maxSites = 16;
+
+    auto count = jxy::query_pool_trace(nullptr, 0);
+    if (count == 0)
+    {
+        return;
+    }
+
+    jxy::vector<jxy::pool_site_stats,
+                PagedPool,
+                jxy::PoolTags::PoolStats,
+                jxy::default_init_allocator<jxy::pool_site_stats, PagedPool, jxy::PoolTags::PoolStats>> sites(count);
+    count = jxy::query_pool_trace(sites.data(), sites.size());
+    sites.resize(count < sites.size() ? count : sites.size());
+
+    std::sort(sites.begin(),
+              sites.end(),
+              [](const jxy::pool_site_stats& Left, const jxy::pool_site_stats& Right)
+              {
+                  return (Left.bytes > Right.bytes);
+              });
+
+    for (size_t i = 0; (i < sites.size()) && (i < maxSites); i++)
+    {
+        const auto& site = sites[i];
+        DbgPrintEx(DPFLTR_IHVDRIVER_ID,
+                   DPFLTR_INFO_LEVEL,
+                   "stlkrn: %.4s site %08x allocs %llu bytes %llu at %p %p %p %p\n",
+                   reinterpret_cast<const char*>(&site.tag),
+                   site.site,
+                   site.allocations,
+                   site.bytes,
+                   site.frames[0],
+                   site.frames[1],
+                   site.frames[2],
+                   site.frames[3]);
+    }
+}
+catch (...)
+{
+}
+
 void TeardownCallbacksAndTracking()
 {
+    jxy::uninitialize_cache_trimming();
     jxy::nt::UnregisterLoadImageCallback();
     jxy::nt::UnregisterThreadCallback();
     jxy::nt::UnregisterProcessCallback();
     jxy::DeleteProcessMap();
     jxy::DeleteThreadMap();
+
+    //
+    // The maps release their nodes to lookaside lists and Populate releases
+    // its buffer to the large buffer cache, now that they're torn down
+    // return any cached blocks to the pool.
+    //
+    jxy::trim_caches();
+
+    DumpPoolStats();
+    jxy::uninitialize_pool_stats();
+
+    DumpPoolTrace();
+    jxy::uninitialize_pool_trace();
 }
 
 extern "C"
@@ -72,6 +181,22 @@ NTSTATUS DriverEntry(
     //
     DriverObject->DriverUnload = DriverUnload;
 
+    //
+    // Per-tag statistics and call site tracing are optional, these fail when
+    // jxystl is built without JXY_POOL_STATS or JXY_POOL_TRACE.
+    //
+    (void)jxy::initialize_pool_stats();
+    (void)jxy::initialize_pool_trace();
+
+    //
+    // Return cached blocks to the pool when the system is low on memory.
+    //
+    status = jxy::initialize_cache_trimming();
+    if (!NT_SUCCESS(status))
+    {
+        return status;
+    }
+
     //
     // Allocate the global thread and process map singletons.
     //
@@ -7,11 +7,52 @@
 //
 #include "module_callbacks.hpp"
 #include "process_map.hpp"
+#include <jxy/object_pool.hpp>
 
 namespace jxy::nt
 {
 
+//
+// The image name is converted into a pooled scratch string, which keeps its
+// capacity across callbacks. An image loaded again at the same extents is
+// matched without allocating, the context strings are only made for a new
+// module.
+//
+using ScratchNamePool = jxy::object_pool<ModuleContext::FileNameStringType,
+                                         PagedPool,
+                                         PoolTags::ModuleScratchName>;
+
 static bool g_ImageLoadCallbackRegistered = false;
+static ScratchNamePool* g_ScratchNames = nullptr;
+
+static void DeleteScratchNames()
+{
+    if (g_ScratchNames)
+    {
+        jxy::default_delete<ScratchNamePool, PagedPool, PoolTags::ModuleScratchName>()(g_ScratchNames);
+        g_ScratchNames = nullptr;
+    }
+}
+
+//
+// Copies the scratch name into the strings kept by a module context.
+//
+static NTSTATUS MakeModuleNames(
+    const ModuleContext::FileNameStringType& ScratchName,
+    ModuleContext::FileNameStringType& FileName,
+    ModuleContext::FilePartStringType& FilePart)
+{
+    try
+    {
+        FileName.assign(ScratchName.begin(), ScratchName.end());
+    }
+    catch (const std::bad_alloc&)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    return GetFilePart(FileName, FilePart);
+}
 
 void LoadImageNotifyRoutine(
     PUNICODE_STRING FullImageName,
@@ -38,23 +79,17 @@ void LoadImageNotifyRoutine(
     props.MachineTypeMismatch = (ImageInfo->MachineTypeMismatch ? true : false);
     props.SystemModeImage = (ImageInfo->SystemModeImage ? true : false);
 
-    ModuleContext::FileNameStringType fileName;
-    ModuleContext::FilePartStringType filePart;
+    ScratchNamePool::pointer scratchName;
     try
     {
-        fileName = ConvertUnicodeString<decltype(fileName)>(FullImageName);
+        scratchName = g_ScratchNames->acquire();
+        AssignUnicodeString(FullImageName, *scratchName);
     }
     catch (const std::bad_alloc&)
     {
         return;
     }
 
-    auto status = GetFilePart(fileName, filePart);
-    if (!NT_SUCCESS(status))
-    {
-        return;
-    }
-
     ModuleExtents extents;
     extents.Start = reinterpret_cast<uintptr_t>(ImageInfo->ImageBase);
     extents.End = extents.Start + ImageInfo->ImageSize;
@@ -70,6 +105,14 @@ void LoadImageNotifyRoutine(
         // The module doesn't exist, try to make and track it in the
         // process context.
         //
+        ModuleContext::FileNameStringType fileName;
+        ModuleContext::FilePartStringType filePart;
+        auto status = MakeModuleNames(*scratchName, fileName, filePart);
+        if (!NT_SUCCESS(status))
+        {
+            return;
+        }
+
         try
         {
             modl = proc->GetModules().TrackModule(
@@ -94,7 +137,7 @@ void LoadImageNotifyRoutine(
     // different we will replace it.
     // This could be improved but not worth the effort for this example.
     //
-    if (modl->GetFileName() == fileName)
+    if (modl->GetFileName() == *scratchName)
     {
         //
         // Same module was loaded again. Just update who loaded it.
@@ -113,6 +156,14 @@ void LoadImageNotifyRoutine(
 
     proc->GetModules().UntrackModule(modl);
 
+    ModuleContext::FileNameStringType fileName;
+    ModuleContext::FilePartStringType filePart;
+    auto status = MakeModuleNames(*scratchName, fileName, filePart);
+    if (!NT_SUCCESS(status))
+    {
+        return;
+    }
+
     try
     {
         modl = proc->GetModules().TrackModule(
@@ -132,10 +183,22 @@ void LoadImageNotifyRoutine(
 
 NTSTATUS jxy::nt::RegisterLoadImageCallback()
 {
+    NT_ASSERT(g_ScratchNames == nullptr);
+
+    try
+    {
+        g_ScratchNames = new (PagedPool, PoolTags::ModuleScratchName) ScratchNamePool();
+    }
+    catch (const std::bad_alloc&)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
     auto status = PsSetLoadImageNotifyRoutineEx(LoadImageNotifyRoutine,
                                                 PS_IMAGE_NOTIFY_CONFLICTING_ARCHITECTURE);
     if (!NT_SUCCESS(status))
     {
+        DeleteScratchNames();
         return status;
     }
 
@@ -150,4 +213,6 @@ void jxy::nt::UnregisterLoadImageCallback()
         PsRemoveLoadImageNotifyRoutine(LoadImageNotifyRoutine);
         g_ImageLoadCallbackRegistered = false;
     }
+
+    DeleteScratchNames();
 }
@@ -13,6 +13,7 @@
 #include <fltKernel.h>
 #include <jxy/locks.hpp>
 #include <jxy/string.hpp>
+#include <jxy/inplace_string.hpp>
 #include "pool_tags.hpp"
 
 namespace jxy
@@ -42,8 +43,12 @@ class ModuleContext
 {
 public:
 
+    //
+    // Module file parts are rarely over 31 characters and are kept in the
+    // context unless they are.
+    //
     using FileNameStringType = jxy::wstring<PagedPool, PoolTags::ModuleFileName>;
-    using FilePartStringType = jxy::wstring<PagedPool, PoolTags::ModuleFilePart>;
+    using FilePartStringType = jxy::inplace_or_heap_wstring<31, PagedPool, PoolTags::ModuleFilePart>;
 
     ModuleContext(
         const ModuleExtents& Extents,
@@ -14,6 +14,19 @@ jxy::ModuleMap::TrackModule(ModuleContextType ModuleContext) noexcept(false)
 
     auto res = m_Map.try_emplace(ModuleContext->GetExtents(),
                                  ModuleContext);
+    if (res.second)
+    {
+        const auto& extents = ModuleContext->GetExtents();
+        try
+        {
+            m_Ranges.assign(extents.Start, extents.End, ModuleContext);
+        }
+        catch (...)
+        {
+            m_Map.erase(res.first);
+            throw;
+        }
+    }
 
     return res.first->second;
 }
@@ -32,6 +45,24 @@ jxy::ModuleMap::UntrackModule(const ModuleExtents& Extents) noexcept
     auto res = it->second;
     m_Map.erase(it);
 
+    //
+    // Newer modules may have split this module's range, erase each piece.
+    //
+    const auto& extents = res->GetExtents();
+    auto range = m_Ranges.overlapping(extents.Start, extents.End);
+    auto piece = range.first;
+    for (auto count = (range.second - range.first); count > 0; count--)
+    {
+        if (piece->second.second == res)
+        {
+            piece = m_Ranges.erase(piece);
+        }
+        else
+        {
+            ++piece;
+        }
+    }
+
     return res;
 }
 
@@ -54,3 +85,17 @@ jxy::ModuleMap::LookupModule(const ModuleExtents& Extents) noexcept
 
     return it->second;
 }
+
+jxy::ModuleMap::ModuleContextType
+jxy::ModuleMap::LookupModuleByAddress(uintptr_t Address) noexcept
+{
+    jxy::shared_lock<jxy::shared_mutex> lock(m_SharedMutex);
+
+    auto it = m_Ranges.find(Address);
+    if (it == m_Ranges.end())
+    {
+        return nullptr;
+    }
+
+    return it->second.second;
+}
@@ -11,7 +11,9 @@
 //
 #pragma once
 #include <fltKernel.h>
-#include <jxy/map.hpp>
+#include <jxy/flat_map.hpp>
+#include <jxy/interval_map.hpp>
+#include <jxy/intrusive_ptr.hpp>
 #include <jxy/vector.hpp>
 #include <jxy/locks.hpp>
 #include "pool_tags.hpp"
@@ -25,13 +27,25 @@ class ModuleMap
 {
 public:
 
-    using ModuleContextType = jxy::shared_ptr<ModuleContext, 
-                                              PoolTypes::ModuleContext,
-                                              PoolTags::ModuleContext>;
-    using MapType = jxy::map<ModuleExtents, 
-                             ModuleContextType,
-                             PagedPool,
-                             PoolTags::ModuleMap>;
+    using ModuleContextType = jxy::intrusive_ptr<ModuleContext>;
+
+    //
+    // A process loads its modules in a burst and then mostly looks them up,
+    // the sorted vectors of a flat map suit that better than tree nodes.
+    //
+    using MapType = jxy::flat_map<ModuleExtents,
+                                  ModuleContextType,
+                                  PagedPool,
+                                  PoolTags::ModuleMap>;
+
+    //
+    // The address ranges of the tracked modules. Where images overlap the
+    // most recently tracked module owns the overlapped addresses.
+    //
+    using RangeMapType = jxy::interval_map<uintptr_t,
+                                           ModuleContextType,
+                                           PagedPool,
+                                           PoolTags::ModuleMap>;
 
     ~ModuleMap() noexcept = default;
 
@@ -45,21 +59,37 @@ public:
 
     ModuleContextType LookupModule(const ModuleExtents& Extents) noexcept;
 
+    //
+    // Finds the module containing an address, such as a return address.
+    //
+    ModuleContextType LookupModuleByAddress(uintptr_t Address) noexcept;
+
     template <POOL_TYPE t_PoolType, 
               ULONG t_PoolTag, 
               typename TAllocator = jxy::allocator<ModuleContextType, t_PoolType, t_PoolTag>>
     jxy::vector<ModuleContextType, t_PoolType, t_PoolTag, TAllocator>
     Snapshot()  noexcept(false)
     {
-        jxy::vector<ModuleContextType, t_PoolType, t_PoolTag, TAllocator> res;
+        return Snapshot(TAllocator());
+    }
+
+    //
+    // Snapshot using a specific allocator instance, such as a
+    // jxy::arena_allocator for transient snapshots.
+    //
+    template <typename TAllocator>
+    jxy::vector<ModuleContextType, TAllocator::pool_type, TAllocator::pool_tag, TAllocator>
+    Snapshot(const TAllocator& Allocator) noexcept(false)
+    {
+        jxy::vector<ModuleContextType, TAllocator::pool_type, TAllocator::pool_tag, TAllocator> res(Allocator);
 
         jxy::shared_lock<jxy::shared_mutex> lock(m_SharedMutex);
 
-        res.reserve(m_Map.count());
+        res.reserve(m_Map.size());
 
-        for (auto& entry : m_Map)
+        for (const auto& context : m_Map.values())
         {
-            res.push_back(entry.second);
+            res.push_back(context);
         }
 
         return res;
@@ -76,14 +106,15 @@ private:
     template <typename... TArgs>
     ModuleContextType MakeModuleContext(TArgs&&... Args) noexcept(false)
     {
-        return jxy::make_shared<ModuleContext,
-                                PoolTypes::ModuleContext,
-                                PoolTags::ModuleContext>(
-                                    std::forward<TArgs>(Args)...);
+        return jxy::make_intrusive<ModuleContext,
+                                   PoolTypes::ModuleContext,
+                                   PoolTags::ModuleContext>(
+                                       std::forward<TArgs>(Args)...);
     }
 
     jxy::shared_mutex m_SharedMutex;
     MapType m_Map;
+    RangeMapType m_Ranges;
 
 };
 
@@ -13,23 +13,32 @@
 namespace jxy::nt
 {
 
-template <typename T> 
-T ConvertUnicodeString(PCUNICODE_STRING UnicodeString) noexcept(false)
+//
+// Assigns in place, a string which already has the capacity (a pooled
+// scratch string, for example) is not reallocated.
+//
+template <typename T>
+void AssignUnicodeString(PCUNICODE_STRING UnicodeString, T& String) noexcept(false)
 {
-    T res;
-
     if ((UnicodeString == nullptr) ||
         (UnicodeString->Buffer == nullptr) ||
         (UnicodeString->Length == 0))
     {
-        return res;
+        String.clear();
+        return;
     }
 
     auto start = UnicodeString->Buffer;
     auto end = &UnicodeString->Buffer[UnicodeString->Length / sizeof(WCHAR)];
 
-    res.assign(start, end);
+    String.assign(start, end);
+}
 
+template <typename T> 
+T ConvertUnicodeString(PCUNICODE_STRING UnicodeString) noexcept(false)
+{
+    T res;
+    AssignUnicodeString(UnicodeString, res);
     return res;
 }
 
@@ -45,7 +54,7 @@ NTSTATUS GetProcessImageFileName(PEPROCESS Process, T& String) noexcept
 
     try
     {
-        String = ConvertUnicodeString<T>(imageFileName);
+        AssignUnicodeString(imageFileName, String);
     }
     catch (const std::bad_alloc&)
     {
@@ -23,6 +23,8 @@ struct PoolTags
     static constexpr ULONG ProcessFilePart = 'ppXJ';
     static constexpr ULONG ModuleFileName = 'nmXJ';
     static constexpr ULONG ModuleFilePart = 'pmXJ';
+    static constexpr ULONG ModuleScratchName = 'smXJ';
+    static constexpr ULONG PoolStats = 'spXJ';
 };
 
 struct PoolTypes
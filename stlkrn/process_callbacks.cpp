@@ -36,14 +36,14 @@ void CreateProcessNotifyRoutine(
     // New process
     //
     
-    jxy::ProcessContext::FileNameStringType fileName;
+    auto fileName = jxy::ProcessContext::MakeFileName();
     auto status = jxy::nt::GetProcessImageFileName(Process, fileName);
     if (!NT_SUCCESS(status))
     {
         return;
     }
 
-    jxy::ProcessContext::FilePartStringType filePart;
+    auto filePart = jxy::ProcessContext::MakeFilePart();
     status = jxy::nt::GetFilePart(fileName, filePart);
     if (!NT_SUCCESS(status))
     {
@@ -19,6 +19,7 @@ jxy::ProcessContext::ProcessContext(
       m_FileName(std::move(FileName)),
       m_FilePart(std::move(FilePart))
 {
+    NT_ASSERT(m_FileName.get_allocator().pool_tag() == PoolTags::ProcessFileName);
 }
 
 jxy::ProcessContext::ProcessContext(
@@ -37,7 +38,7 @@ jxy::ProcessContext::ProcessContext(
       m_FileName(std::move(FileName)),
       m_FilePart(std::move(FilePart))
 {
-
+    NT_ASSERT(m_FileName.get_allocator().pool_tag() == PoolTags::ProcessFileName);
 }
 
 uint32_t jxy::ProcessContext::GetProcessId() const
@@ -12,6 +12,7 @@
 #pragma once
 #include <fltKernel.h>
 #include <jxy/string.hpp>
+#include <jxy/inplace_string.hpp>
 #include "pool_tags.hpp"
 #include "thread_map.hpp"
 #include "module_map.hpp"
@@ -23,8 +24,23 @@ class ProcessContext
 {
 public:
 
-    using FileNameStringType = jxy::wstring<PagedPool, PoolTags::ProcessFileName>;
-    using FilePartStringType = jxy::wstring<PagedPool, PoolTags::ProcessFilePart>;
+    //
+    // The file name carries its tag at runtime, make it with MakeFileName.
+    // The file part is rarely over 31 characters and is kept in the context
+    // unless it is.
+    //
+    using FileNameStringType = jxy::tagged_wstring<PagedPool>;
+    using FilePartStringType = jxy::inplace_or_heap_wstring<31, PagedPool, PoolTags::ProcessFilePart>;
+
+    static FileNameStringType MakeFileName() noexcept
+    {
+        return FileNameStringType(FileNameStringType::allocator_type(PoolTags::ProcessFileName));
+    }
+
+    static FilePartStringType MakeFilePart() noexcept
+    {
+        return FilePartStringType();
+    }
 
     ~ProcessContext() noexcept = default;
 
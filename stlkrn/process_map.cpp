@@ -7,6 +7,7 @@
 //
 #include "process_map.hpp"
 #include "ntfill.hpp"
+#include <jxy/large_buffer.hpp>
 
 namespace jxy
 {
@@ -65,20 +66,20 @@ NTSTATUS jxy::ProcessMap::Populate() try
 
     jxy::unique_lock<jxy::shared_mutex> lock(m_SharedMutex);
 
-    jxy::vector<uint8_t, PagedPool, 'mpij'> info;
-    ULONG returnLen = 0;
-
     //
-    // FIXME: should handle expected return codes 
+    // The information buffer is several megabytes on a busy system, the
+    // large buffer reuses a cached one and grows until the query fits.
     //
-    ZwQuerySystemInformation(SystemProcessInformation, nullptr, 0, &returnLen);
-
-    info.assign(returnLen, 0);
+    jxy::large_buffer<PagedPool, 'mpij'> info;
 
-    auto status = ZwQuerySystemInformation(SystemProcessInformation,
-                                           &info[0], 
-                                           static_cast<ULONG>(info.size()),
-                                           &returnLen);
+    auto status = info.query(
+        [](void* Buffer, ULONG Length, PULONG ReturnLength)
+        {
+            return ZwQuerySystemInformation(SystemProcessInformation,
+                                            Buffer,
+                                            Length,
+                                            ReturnLength);
+        });
     if (!NT_SUCCESS(status))
     {
         return status;
@@ -87,7 +88,7 @@ NTSTATUS jxy::ProcessMap::Populate() try
     //
     // FIXME: this could be done a bit safer/cleaner
     //
-    for (auto pi = reinterpret_cast<PSYSTEM_PROCESS_INFORMATION>(info.data());
+    for (auto pi = info.as<SYSTEM_PROCESS_INFORMATION>();
          (pi->NextEntryOffset > 0);
          pi = reinterpret_cast<PSYSTEM_PROCESS_INFORMATION>(reinterpret_cast<ULONG_PTR>(pi) + pi->NextEntryOffset))
     {
@@ -120,8 +121,8 @@ NTSTATUS jxy::ProcessMap::Populate() try
             }
         }
 
-        ProcessContext::FileNameStringType fileName;
-        ProcessContext::FilePartStringType filePart;
+        auto fileName = ProcessContext::MakeFileName();
+        auto filePart = ProcessContext::MakeFilePart();
 
         if (pi->UniqueProcessId == 0)
         {
@@ -14,8 +14,13 @@
 #pragma once
 #include <fltKernel.h>
 #include <jxy/map.hpp>
+#include <jxy/lookaside.hpp>
+#include <jxy/id_table.hpp>
+#include <jxy/btree_map.hpp>
+#include <jxy/intrusive_ptr.hpp>
 #include <jxy/vector.hpp>
 #include <jxy/locks.hpp>
+#include "config.hpp"
 #include "pool_tags.hpp"
 #include "process_context.hpp"
 #include "nthelp.hpp"
@@ -29,13 +34,21 @@ public:
 
     using ProcessIdType = uint32_t;
 
-    using ProcessContextType = jxy::shared_ptr<ProcessContext, 
-                                               PoolTypes::ProcessContext,
-                                               PoolTags::ProcessContext>;
+    using ProcessContextType = jxy::intrusive_ptr<ProcessContext>;
+#if JXY_ID_TABLE_MAPS
+    using MapType = jxy::id_table<ProcessContextType, PagedPool, PoolTags::ProcessMap>;
+#elif JXY_BTREE_MAPS
+    using MapType = jxy::btree_map<ProcessIdType, ProcessContextType, PagedPool, PoolTags::ProcessMap>;
+#else
     using MapType = jxy::map<ProcessIdType, 
                              ProcessContextType, 
                              PagedPool, 
-                             PoolTags::ProcessMap>;
+                             PoolTags::ProcessMap,
+                             std::less<ProcessIdType>,
+                             jxy::lookaside_allocator<std::pair<const ProcessIdType, ProcessContextType>,
+                                                      PagedPool,
+                                                      PoolTags::ProcessMap>>;
+#endif
 
     ~ProcessMap() noexcept = default;
 
@@ -57,11 +70,22 @@ public:
     jxy::vector<ProcessContextType, t_PoolType, t_PoolTag, TAllocator>
     Snapshot()  noexcept(false)
     {
-        jxy::vector<ProcessContextType, t_PoolType, t_PoolTag, TAllocator> res;
+        return Snapshot(TAllocator());
+    }
+
+    //
+    // Snapshot using a specific allocator instance, such as a
+    // jxy::arena_allocator for transient snapshots.
+    //
+    template <typename TAllocator>
+    jxy::vector<ProcessContextType, TAllocator::pool_type, TAllocator::pool_tag, TAllocator>
+    Snapshot(const TAllocator& Allocator) noexcept(false)
+    {
+        jxy::vector<ProcessContextType, TAllocator::pool_type, TAllocator::pool_tag, TAllocator> res(Allocator);
 
         jxy::shared_lock<jxy::shared_mutex> lock(m_SharedMutex);
 
-        res.reserve(m_Map.count());
+        res.reserve(m_Map.size());
 
         for (auto& entry : m_Map)
         {
@@ -82,10 +106,10 @@ private:
     template <typename... TArgs>
     ProcessContextType MakeProcessContext(TArgs&&... Args) noexcept(false)
     {
-        return jxy::make_shared<ProcessContext,
-                                PoolTypes::ProcessContext,
-                                PoolTags::ProcessContext>(
-                                    std::forward<TArgs>(Args)...);
+        return jxy::make_intrusive<ProcessContext,
+                                   PoolTypes::ProcessContext,
+                                   PoolTags::ProcessContext>(
+                                       std::forward<TArgs>(Args)...);
     }
 
     jxy::shared_mutex m_SharedMutex;
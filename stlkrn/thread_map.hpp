@@ -18,8 +18,13 @@
 #pragma once
 #include <fltKernel.h>
 #include <jxy/map.hpp>
+#include <jxy/lookaside.hpp>
+#include <jxy/id_table.hpp>
+#include <jxy/btree_map.hpp>
+#include <jxy/intrusive_ptr.hpp>
 #include <jxy/vector.hpp>
 #include <jxy/locks.hpp>
+#include "config.hpp"
 #include "pool_tags.hpp"
 #include "thread_context.hpp"
 #include "nthelp.hpp"
@@ -33,13 +38,21 @@ public:
 
     using ThreadIdType = uint32_t;
 
-    using ThreadContextType = jxy::shared_ptr<ThreadContext, 
-                                              PoolTypes::ThreadContext,
-                                              PoolTags::ThreadContext>;
+    using ThreadContextType = jxy::intrusive_ptr<ThreadContext>;
+#if JXY_ID_TABLE_MAPS
+    using MapType = jxy::id_table<ThreadContextType, PagedPool, PoolTags::ThreadMap>;
+#elif JXY_BTREE_MAPS
+    using MapType = jxy::btree_map<ThreadIdType, ThreadContextType, PagedPool, PoolTags::ThreadMap>;
+#else
     using MapType = jxy::map<ThreadIdType, 
                              ThreadContextType, 
                              PagedPool, 
-                             PoolTags::ThreadMap>;
+                             PoolTags::ThreadMap,
+                             std::less<ThreadIdType>,
+                             jxy::lookaside_allocator<std::pair<const ThreadIdType, ThreadContextType>,
+                                                      PagedPool,
+                                                      PoolTags::ThreadMap>>;
+#endif
 
     ~ThreadMap() noexcept = default;
 
@@ -59,11 +72,22 @@ public:
     jxy::vector<ThreadContextType, t_PoolType, t_PoolTag, TAllocator>
     Snapshot()  noexcept(false)
     {
-        jxy::vector<ThreadContextType, t_PoolType, t_PoolTag, TAllocator> res;
+        return Snapshot(TAllocator());
+    }
+
+    //
+    // Snapshot using a specific allocator instance, such as a
+    // jxy::arena_allocator for transient snapshots.
+    //
+    template <typename TAllocator>
+    jxy::vector<ThreadContextType, TAllocator::pool_type, TAllocator::pool_tag, TAllocator>
+    Snapshot(const TAllocator& Allocator) noexcept(false)
+    {
+        jxy::vector<ThreadContextType, TAllocator::pool_type, TAllocator::pool_tag, TAllocator> res(Allocator);
 
         jxy::shared_lock<jxy::shared_mutex> lock(m_SharedMutex);
 
-        res.reserve(m_Map.count());
+        res.reserve(m_Map.size());
 
         for (auto& entry : m_Map)
         {
@@ -84,10 +108,10 @@ private:
     template <typename... TArgs>
     ThreadContextType MakeThreadContext(TArgs&&... Args) noexcept(false)
     {
-        return jxy::make_shared<ThreadContext,
-                                PoolTypes::ThreadContext,
-                                PoolTags::ThreadContext>(
-                                    std::forward<TArgs>(Args)...);
+        return jxy::make_intrusive<ThreadContext,
+                                   PoolTypes::ThreadContext,
+                                   PoolTags::ThreadContext>(
+                                       std::forward<TArgs>(Args)...);
     }
 
     jxy::shared_mutex m_SharedMutex;
@@ -0,0 +1,169 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     stltest/aligned_tests.cpp
+// Author:   Johnny Shaw
+//
+#include "tests_common.hpp"
+#include <jxy/memory.hpp>
+#include <jxy/lookaside.hpp>
+#include <jxy/vector.hpp>
+#include <jxy/thread.hpp>
+
+namespace jxy::Tests
+{
+
+struct alignas(64) AlignedCounter
+{
+    LONG64 Value = 0;
+};
+
+struct alignas(128) WideAligned
+{
+    int Value = 0;
+};
+
+struct ThrowingAligned
+{
+    ThrowingAligned()
+    {
+        throw std::exception();
+    }
+};
+
+template <typename T>
+static bool IsAligned(const T* Pointer, size_t Alignment)
+{
+    return ((reinterpret_cast<uintptr_t>(Pointer) % Alignment) == 0);
+}
+
+//
+// Two threads increment adjacent counters, then counters on their own cache
+// lines. Only the counts are asserted, the timings depend on the machine.
+//
+static void FalseSharingBenchmark()
+{
+    constexpr LONG64 iterations = 1000000;
+
+    auto run = [](volatile LONG64* First, volatile LONG64* Second) -> LONGLONG
+    {
+        auto start = KeQueryPerformanceCounter(nullptr).QuadPart;
+        jxy::thread first([First]()
+                          {
+                              for (LONG64 i = 0; i < iterations; i++)
+                              {
+                                  InterlockedIncrement64(First);
+                              }
+                          });
+        jxy::thread second([Second]()
+                           {
+                               for (LONG64 i = 0; i < iterations; i++)
+                               {
+                                   InterlockedIncrement64(Second);
+                               }
+                           });
+        first.join();
+        second.join();
+        return (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+    };
+
+    struct packed_counters
+    {
+        LONG64 Value[2];
+    };
+    auto packed = jxy::make_unique_aligned<packed_counters, NonPagedPoolNx, '0GAT'>();
+    packed->Value[0] = 0;
+    packed->Value[1] = 0;
+
+    jxy::vector<jxy::cache_aligned<LONG64>, NonPagedPoolNx, '0GAT'> padded(2);
+    padded[0].value = 0;
+    padded[1].value = 0;
+
+    auto packedTime = run(&packed->Value[0], &packed->Value[1]);
+    auto paddedTime = run(&padded[0].value, &padded[1].value);
+
+    UT_ASSERT(packed->Value[0] == iterations);
+    UT_ASSERT(packed->Value[1] == iterations);
+    UT_ASSERT(padded[0].value == iterations);
+    UT_ASSERT(padded[1].value == iterations);
+
+    DbgPrintEx(DPFLTR_IHVDRIVER_ID,
+               DPFLTR_INFO_LEVEL,
+               "stltest: false sharing packed %lld padded %lld\n",
+               packedTime,
+               paddedTime);
+}
+
+void AlignedTests()
+{
+    {
+        //
+        // Over-aligned types go through the aligned new.
+        //
+        auto ptr = jxy::make_unique<AlignedCounter, NonPagedPoolNx, '0GAT'>();
+        UT_ASSERT(IsAligned(ptr.get(), 64));
+        UT_ASSERT(ptr->Value == 0);
+
+        auto wide = jxy::make_unique<WideAligned, PagedPool, '0GAT'>();
+        UT_ASSERT(IsAligned(wide.get(), 128));
+    }
+    {
+        auto ptr = jxy::make_unique_aligned<LONG64, NonPagedPoolNx, '0GAT'>(5);
+        UT_ASSERT(IsAligned(ptr.get(), SYSTEM_CACHE_ALIGNMENT_SIZE));
+        UT_ASSERT(*ptr == 5);
+        UT_ASSERT(ptr.get_deleter().alignment == SYSTEM_CACHE_ALIGNMENT_SIZE);
+        UT_ASSERT(ptr.get_deleter().pool_tag == '0GAT');
+        UT_ASSERT(ptr.get_deleter().pool_type == NonPagedPoolNx);
+
+        auto ptr2 = jxy::make_unique_aligned<int, PagedPool, '0GAT', 256>(1);
+        UT_ASSERT(IsAligned(ptr2.get(), 256));
+
+        //
+        // The type alignment wins when it is larger than requested.
+        //
+        auto ptr3 = jxy::make_unique_aligned<WideAligned, PagedPool, '0GAT', 16>();
+        UT_ASSERT(IsAligned(ptr3.get(), 128));
+        UT_ASSERT(ptr3.get_deleter().alignment == 128);
+
+        bool caught = false;
+        try
+        {
+            auto ptr4 = jxy::make_unique_aligned<ThrowingAligned, PagedPool, '0GAT'>();
+        }
+        catch (const std::exception&)
+        {
+            caught = true;
+        }
+        UT_ASSERT(caught);
+    }
+    {
+        jxy::allocator<WideAligned, PagedPool, '0GAT'> alloc;
+        auto mem = alloc.allocate(3);
+        UT_ASSERT(IsAligned(mem, 128));
+        alloc.deallocate(mem, 3);
+
+        jxy::lookaside_allocator<WideAligned, PagedPool, '0GAT'> lookaside;
+        auto block = lookaside.allocate(1);
+        UT_ASSERT(IsAligned(block, 128));
+        lookaside.deallocate(block, 1);
+    }
+    {
+        //
+        // Each element on its own cache line.
+        //
+        jxy::vector<jxy::cache_aligned<LONG64>, NonPagedPoolNx, '0GAT'> vec(8);
+        for (const auto& entry : vec)
+        {
+            UT_ASSERT(IsAligned(&entry, SYSTEM_CACHE_ALIGNMENT_SIZE));
+        }
+        UT_ASSERT((reinterpret_cast<uintptr_t>(&vec[1]) -
+                   reinterpret_cast<uintptr_t>(&vec[0])) == SYSTEM_CACHE_ALIGNMENT_SIZE);
+
+        auto shared = jxy::make_shared<AlignedCounter, NonPagedPoolNx, '0GAT'>();
+        UT_ASSERT(IsAligned(shared.get(), 64));
+    }
+
+    FalseSharingBenchmark();
+}
+
+}
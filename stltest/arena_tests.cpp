@@ -0,0 +1,172 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     stltest/arena_tests.cpp
+// Author:   Johnny Shaw
+//
+#include "tests_common.hpp"
+#include <jxy/arena.hpp>
+#include <jxy/vector.hpp>
+#include <jxy/string.hpp>
+#include <jxy/map.hpp>
+
+namespace jxy::Tests
+{
+
+//
+// One pass of transient work shaped like ProcessMap::Populate and the map
+// snapshots, for each process a vector of its thread IDs and its file name
+// are built and dropped.
+//
+template <typename TIdAllocator, typename TStringAllocator>
+static uint64_t PopulateShape(const TIdAllocator& IdAllocator, const TStringAllocator& StringAllocator)
+{
+    constexpr uint32_t processes = 256;
+    constexpr uint32_t threadsPerProcess = 32;
+
+    uint64_t sum = 0;
+    for (uint32_t p = 0; p < processes; p++)
+    {
+        jxy::vector<uint32_t, PagedPool, '0GAT', TIdAllocator> ids(IdAllocator);
+        for (uint32_t t = 0; t < threadsPerProcess; t++)
+        {
+            ids.push_back((p * threadsPerProcess) + t);
+        }
+
+        jxy::wstring<PagedPool, '0GAT', TStringAllocator> fileName(
+            L"\\Device\\HarddiskVolume4\\Windows\\System32\\",
+            StringAllocator);
+        fileName.append(L"svchost.exe");
+
+        for (auto id : ids)
+        {
+            sum += id;
+        }
+        sum += fileName.size();
+    }
+    return sum;
+}
+
+//
+// The same passes with every allocation freed to the pool and with the
+// arena reset once per pass. Only the results are asserted, the timings
+// depend on the machine.
+//
+static void ArenaBenchmark()
+{
+    constexpr uint32_t passes = 200;
+
+    using id_pool_alloc = jxy::allocator<uint32_t, PagedPool, '0GAT'>;
+    using string_pool_alloc = jxy::allocator<wchar_t, PagedPool, '0GAT'>;
+    using id_arena_alloc = jxy::arena_allocator<uint32_t, PagedPool, '0GAT'>;
+    using string_arena_alloc = jxy::arena_allocator<wchar_t, PagedPool, '0GAT'>;
+
+    auto expected = PopulateShape(id_pool_alloc(), string_pool_alloc());
+
+    auto start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    for (uint32_t i = 0; i < passes; i++)
+    {
+        UT_ASSERT(PopulateShape(id_pool_alloc(), string_pool_alloc()) == expected);
+    }
+    auto poolTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+
+    jxy::paged_arena<'0GAT'> arena;
+    start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    for (uint32_t i = 0; i < passes; i++)
+    {
+        UT_ASSERT(PopulateShape(id_arena_alloc(arena), string_arena_alloc(arena)) == expected);
+        arena.reset();
+    }
+    auto arenaTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+
+    DbgPrintEx(DPFLTR_IHVDRIVER_ID,
+               DPFLTR_INFO_LEVEL,
+               "stltest: populate shape allocator %lld arena_allocator %lld\n",
+               poolTime,
+               arenaTime);
+}
+
+void ArenaTests()
+{
+    {
+        jxy::arena<PagedPool, '0GAT'> arena;
+
+        UT_ASSERT(arena.pool_tag == '0GAT');
+        UT_ASSERT(arena.pool_type == PagedPool);
+        UT_ASSERT(arena.bytes_allocated() == 0);
+
+        auto mem = static_cast<uint8_t*>(arena.allocate(10));
+        auto mem2 = static_cast<uint8_t*>(arena.allocate(10));
+        UT_ASSERT((reinterpret_cast<uintptr_t>(mem) % MEMORY_ALLOCATION_ALIGNMENT) == 0);
+        UT_ASSERT((reinterpret_cast<uintptr_t>(mem2) % MEMORY_ALLOCATION_ALIGNMENT) == 0);
+        UT_ASSERT(mem2 == (mem + MEMORY_ALLOCATION_ALIGNMENT));
+        UT_ASSERT(arena.bytes_allocated() == 20);
+
+        auto aligned = arena.allocate(1, 64);
+        UT_ASSERT((reinterpret_cast<uintptr_t>(aligned) % 64) == 0);
+
+        //
+        // Larger than the chunk size gets a dedicated chunk and the current
+        // chunk continues to serve small allocations.
+        //
+        auto big = static_cast<uint8_t*>(arena.allocate(arena.chunk_size() * 2));
+        RtlFillMemory(big, arena.chunk_size() * 2, 0xaa);
+        auto mem3 = static_cast<uint8_t*>(arena.allocate(10));
+        UT_ASSERT(mem3 > mem2);
+        UT_ASSERT((mem3 - mem) < static_cast<ptrdiff_t>(arena.chunk_size()));
+
+        //
+        // Reset rewinds to the retained chunk.
+        //
+        arena.reset();
+        UT_ASSERT(arena.bytes_allocated() == 0);
+        UT_ASSERT(arena.allocate(10) == mem);
+
+        arena.release();
+        UT_ASSERT(arena.bytes_allocated() == 0);
+    }
+    {
+        jxy::paged_arena<'0GAT'> arena;
+        jxy::arena_allocator<int, PagedPool, '0GAT'> alloc(arena);
+
+        jxy::vector<int, PagedPool, '0GAT', decltype(alloc)> vec(alloc);
+        for (int i = 0; i < 1000; i++)
+        {
+            vec.push_back(i);
+        }
+        UT_ASSERT(vec.size() == 1000);
+        UT_ASSERT(vec[999] == 999);
+        UT_ASSERT(vec.get_allocator() == alloc);
+        UT_ASSERT(vec.get_allocator().pool_tag == '0GAT');
+        UT_ASSERT(vec.get_allocator().pool_type == PagedPool);
+        UT_ASSERT(arena.bytes_allocated() >= (sizeof(int) * 1000));
+    }
+    {
+        jxy::paged_arena<'0GAT'> arena;
+
+        using string_alloc = jxy::arena_allocator<wchar_t, PagedPool, '0GAT'>;
+        using string_type = jxy::wstring<PagedPool, '0GAT', string_alloc>;
+
+        string_type str(L"This string is long enough to not fit in the small buffer",
+                        string_alloc(arena));
+        UT_ASSERT(str.get_allocator().get_arena() == &arena);
+        str.append(L" and then some");
+        UT_ASSERT(str.find(L"then") != string_type::npos);
+
+        using map_alloc = jxy::arena_allocator<std::pair<const int, int>, PagedPool, '0GAT'>;
+        jxy::map<int, int, PagedPool, '0GAT', std::less<int>, map_alloc> map{ map_alloc(arena) };
+        for (int i = 0; i < 100; i++)
+        {
+            map.emplace(i, i);
+        }
+        UT_ASSERT(map.size() == 100);
+        UT_ASSERT(map[50] == 50);
+
+        jxy::arena<PagedPool, '0GAT'> other;
+        UT_ASSERT(map_alloc(arena) != map_alloc(other));
+    }
+
+    ArenaBenchmark();
+}
+
+}
@@ -0,0 +1,415 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     stltest/btree_tests.cpp
+// Author:   Johnny Shaw
+//
+#include "tests_common.hpp"
+#include <jxy/btree_map.hpp>
+#include <jxy/btree_set.hpp>
+#include <jxy/map.hpp>
+#include <jxy/string.hpp>
+#include <jxy/vector.hpp>
+
+namespace jxy::Tests
+{
+
+//
+// Shuffles Count keys in place.
+//
+static void ShuffleKeys(uint32_t* Keys, size_t Count, uint32_t Seed)
+{
+    for (size_t i = Count; i > 1; i--)
+    {
+        Seed = (Seed * 1103515245) + 12345;
+        std::swap(Keys[i - 1], Keys[(Seed >> 8) % i]);
+    }
+}
+
+//
+// Inserts Count integer keys, looks up every key and as many absent ones,
+// walks the map in order, then erases every key, each in a random order so
+// neither map visits its nodes in the order they were allocated. Only the
+// results are asserted, the timings depend on the machine.
+//
+template <typename TMap>
+static void IntegerKeyShape(
+    uint32_t Count,
+    LONGLONG& InsertTime,
+    LONGLONG& LookupTime,
+    LONGLONG& EraseTime,
+    LONGLONG& ScanTime)
+{
+    TMap map;
+
+    //
+    // Multiplying by an odd constant is a permutation of the 32 bit
+    // integers, the keys are distinct.
+    //
+    jxy::vector<uint32_t, PagedPool, '0GAT'> keys;
+    keys.reserve(Count * 2);
+    for (uint32_t i = 0; i < (Count * 2); i++)
+    {
+        keys.push_back(i * 2654435761u);
+    }
+    ShuffleKeys(keys.data(), Count, Count);
+
+    uint64_t expected = 0;
+    for (uint32_t i = 0; i < Count; i++)
+    {
+        expected += ~keys[i];
+    }
+    jxy::vector<uint32_t, PagedPool, '0GAT'> present(keys.begin(), (keys.begin() + Count));
+    ShuffleKeys(present.data(), present.size(), (Count + 1));
+
+    auto start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    for (uint32_t i = 0; i < Count; i++)
+    {
+        map.try_emplace(keys[i], ~keys[i]);
+    }
+    InsertTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+    UT_ASSERT(map.size() == Count);
+
+    ShuffleKeys(keys.data(), keys.size(), (Count + 2));
+
+    start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    size_t found = 0;
+    for (auto key : keys)
+    {
+        auto it = map.find(key);
+        if (it != map.end())
+        {
+            found += ((it->second == ~key) ? 1 : 0);
+        }
+    }
+    LookupTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+    UT_ASSERT(found == Count);
+
+    start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    uint64_t sum = 0;
+    uint32_t previous = 0;
+    bool ordered = true;
+    for (const auto& [key, value] : map)
+    {
+        ordered = (ordered && (key >= previous));
+        previous = key;
+        sum += value;
+    }
+    ScanTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+    UT_ASSERT(ordered);
+    UT_ASSERT(sum == expected);
+
+    start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    size_t erased = 0;
+    for (auto key : present)
+    {
+        erased += map.erase(key);
+    }
+    EraseTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+    UT_ASSERT(erased == Count);
+    UT_ASSERT(map.empty());
+}
+
+static void BtreeBenchmark()
+{
+    for (uint32_t count : { 1000u, 10000u, 100000u, 1000000u })
+    {
+        LONGLONG mapInsert, mapLookup, mapErase, mapScan;
+        IntegerKeyShape<jxy::map<uint32_t, uint32_t, PagedPool, '0GAT'>>(
+            count,
+            mapInsert,
+            mapLookup,
+            mapErase,
+            mapScan);
+
+        LONGLONG btreeInsert, btreeLookup, btreeErase, btreeScan;
+        IntegerKeyShape<jxy::btree_map<uint32_t, uint32_t, PagedPool, '0GAT'>>(
+            count,
+            btreeInsert,
+            btreeLookup,
+            btreeErase,
+            btreeScan);
+
+        DbgPrintEx(DPFLTR_IHVDRIVER_ID,
+                   DPFLTR_INFO_LEVEL,
+                   "stltest: %u keys insert/lookup/erase/scan map %lld/%lld/%lld/%lld "
+                   "btree_map %lld/%lld/%lld/%lld\n",
+                   count,
+                   mapInsert,
+                   mapLookup,
+                   mapErase,
+                   mapScan,
+                   btreeInsert,
+                   btreeLookup,
+                   btreeErase,
+                   btreeScan);
+    }
+}
+
+//
+// Random inserts and erases checked against jxy::map after every step, with
+// nodes small enough that the tree is several levels deep and nodes split,
+// merge and rotate often.
+//
+template <typename TBtree>
+static void BtreeModelCheck(uint32_t Seed)
+{
+    using StringType = jxy::wstring<PagedPool, '0GAT'>;
+    using ModelType = jxy::map<int, StringType, PagedPool, '0GAT'>;
+
+    TBtree tree;
+    ModelType model;
+
+    constexpr int keyCount = 512;
+    uint32_t seed = Seed;
+    for (uint32_t step = 0; step < 4000; step++)
+    {
+        seed = (seed * 1103515245) + 12345;
+        int key = static_cast<int>((seed >> 8) % keyCount);
+
+        //
+        // Insert more than erase in the first half and the opposite in the
+        // second, so the tree grows and shrinks through every height.
+        //
+        bool insert = (((seed >> 4) % 8) < ((step < 2000) ? 5u : 3u));
+        if (insert)
+        {
+            StringType value(L"value ");
+            value += static_cast<wchar_t>(L'a' + (key % 26));
+            auto res = tree.try_emplace(key, value);
+            auto modelRes = model.try_emplace(key, value);
+            UT_ASSERT(res.second == modelRes.second);
+            UT_ASSERT(res.first->first == key);
+            UT_ASSERT(res.first->second == modelRes.first->second);
+        }
+        else if ((seed >> 12) & 1)
+        {
+            UT_ASSERT(tree.erase(key) == model.erase(key));
+        }
+        else
+        {
+            auto it = tree.lower_bound(key);
+            auto modelIt = model.lower_bound(key);
+            UT_ASSERT((it == tree.end()) == (modelIt == model.end()));
+            if (it != tree.end())
+            {
+                it = tree.erase(it);
+                modelIt = model.erase(modelIt);
+                UT_ASSERT((it == tree.end()) == (modelIt == model.end()));
+                UT_ASSERT((it == tree.end()) || (it->first == modelIt->first));
+            }
+        }
+
+        UT_ASSERT(tree.size() == model.size());
+        if ((step % 16) == 0)
+        {
+            UT_ASSERT(std::equal(tree.begin(), tree.end(), model.begin(), model.end()));
+            UT_ASSERT(std::equal(tree.rbegin(), tree.rend(), model.rbegin(), model.rend()));
+        }
+    }
+
+    UT_ASSERT(std::equal(tree.begin(), tree.end(), model.begin(), model.end()));
+}
+
+//
+// Throws from its constructor when asked to.
+//
+struct BtreeThrowingValue
+{
+    BtreeThrowingValue(int Value, bool Throw) : Value(Value)
+    {
+        if (Throw)
+        {
+            throw std::runtime_error("BtreeThrowingValue");
+        }
+    }
+
+    int Value;
+};
+
+void BtreeTests()
+{
+    using StringType = jxy::wstring<PagedPool, '0GAT'>;
+
+    {
+        jxy::btree_map<uint32_t, StringType, PagedPool, '0GAT'> map;
+        UT_ASSERT(map.empty());
+        UT_ASSERT(map.begin() == map.end());
+        UT_ASSERT(map.find(4) == map.end());
+        UT_ASSERT(map.node_count() == 0);
+
+        //
+        // The nodes are sized to a few cache lines.
+        //
+        UT_ASSERT(decltype(map)::node_capacity > 4);
+
+        UT_ASSERT(map.try_emplace(8, L"eight").second);
+        UT_ASSERT(map.emplace(4, L"four").second);
+        UT_ASSERT(map.insert({ 12, L"twelve" }).second);
+        UT_ASSERT(!map.try_emplace(8, L"not eight").second);
+        UT_ASSERT(map[8] == L"eight");
+        map[16] = L"sixteen";
+        UT_ASSERT(map.size() == 4);
+        UT_ASSERT(map.at(12) == L"twelve");
+        UT_ASSERT(map.contains(4));
+        UT_ASSERT(map.count(5) == 0);
+
+        bool threw = false;
+        try
+        {
+            (void)map.at(5);
+        }
+        catch (const std::out_of_range&)
+        {
+            threw = true;
+        }
+        UT_ASSERT(threw);
+
+        UT_ASSERT(map.lower_bound(5)->first == 8);
+        UT_ASSERT(map.lower_bound(8)->first == 8);
+        UT_ASSERT(map.upper_bound(8)->first == 12);
+        UT_ASSERT(map.upper_bound(16) == map.end());
+        auto range = map.equal_range(12);
+        UT_ASSERT((range.first->first == 12) && (range.second->first == 16));
+
+        auto res = map.insert_or_assign(4, L"FOUR");
+        UT_ASSERT(!res.second && (res.first->second == L"FOUR"));
+
+        uint32_t previous = 0;
+        for (const auto& [id, name] : map)
+        {
+            UT_ASSERT(id > previous);
+            UT_ASSERT(!name.empty());
+            previous = id;
+        }
+        UT_ASSERT(previous == 16);
+        UT_ASSERT(map.rbegin()->first == 16);
+
+        auto it = map.erase(map.find(8));
+        UT_ASSERT(it->first == 12);
+        it = map.erase(map.find(16));
+        UT_ASSERT(it == map.end());
+        UT_ASSERT(map.size() == 2);
+
+        map.clear();
+        UT_ASSERT(map.empty());
+        UT_ASSERT(map.node_count() == 0);
+    }
+
+    {
+        //
+        // Ascending IDs, as they're mostly handed out, fill the nodes.
+        //
+        jxy::btree_map<uint32_t, uint32_t, PagedPool, '0GAT'> map;
+        constexpr uint32_t count = 10000;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            map.try_emplace((i * 4), i);
+        }
+        UT_ASSERT(map.size() == count);
+        UT_ASSERT(map.height() <= 3);
+        UT_ASSERT(map.node_count() < (((count / decltype(map)::node_capacity) * 11) / 10) + 2);
+
+        uint32_t expected = 0;
+        for (const auto& [id, value] : map)
+        {
+            UT_ASSERT((id == (expected * 4)) && (value == expected));
+            expected++;
+        }
+        UT_ASSERT(expected == count);
+
+        auto copy = map;
+        UT_ASSERT(copy == map);
+        copy[4] = 0;
+        UT_ASSERT(copy != map);
+
+        auto moved = std::move(copy);
+        UT_ASSERT(copy.empty());
+        UT_ASSERT(moved.size() == count);
+        copy = moved;
+        UT_ASSERT(copy == moved);
+        swap(copy, map);
+        UT_ASSERT(map.at(4) == 0);
+        UT_ASSERT(copy.at(4) == 1);
+
+        auto first = map.find(40);
+        auto last = map.find(400);
+        auto it = map.erase(first, last);
+        UT_ASSERT(it->first == 400);
+        UT_ASSERT(map.size() == (count - 90));
+        UT_ASSERT(map.find(396) == map.end());
+        UT_ASSERT(map.find(36) != map.end());
+
+        map.erase(map.begin(), map.end());
+        UT_ASSERT(map.empty());
+    }
+
+    {
+        jxy::btree_set<int, PagedPool, '0GAT'> set{ 5, 3, 9, 1, 7, 3 };
+        UT_ASSERT(set.size() == 5);
+        UT_ASSERT(*set.begin() == 1);
+        UT_ASSERT(*set.rbegin() == 9);
+        UT_ASSERT(!set.insert(5).second);
+        UT_ASSERT(set.insert(4).second);
+        UT_ASSERT(*set.lower_bound(6) == 7);
+        UT_ASSERT(set.erase(3) == 1);
+        UT_ASSERT(set.erase(3) == 0);
+        UT_ASSERT((set == jxy::btree_set<int, PagedPool, '0GAT'>{ 1, 4, 5, 7, 9 }));
+
+        for (int i = 100; i > 10; i--)
+        {
+            set.insert(i);
+        }
+        int previous = 0;
+        for (auto value : set)
+        {
+            UT_ASSERT(value > previous);
+            previous = value;
+        }
+        UT_ASSERT(previous == 100);
+    }
+
+    {
+        //
+        // A throwing constructor leaves the elements as they were, even when
+        // the insert split nodes first.
+        //
+        jxy::btree_map<int, BtreeThrowingValue, PagedPool, '0GAT', std::less<int>, 0> map;
+        for (int i = 0; i < 64; i += 2)
+        {
+            map.try_emplace(i, i, false);
+        }
+
+        for (int i = 1; i < 64; i += 2)
+        {
+            bool threw = false;
+            try
+            {
+                map.try_emplace(i, i, true);
+            }
+            catch (const std::runtime_error&)
+            {
+                threw = true;
+            }
+            UT_ASSERT(threw);
+            UT_ASSERT(map.size() == 32);
+            UT_ASSERT(map.find(i) == map.end());
+        }
+
+        int expected = 0;
+        for (const auto& [key, value] : map)
+        {
+            UT_ASSERT((key == expected) && (value.Value == expected));
+            expected += 2;
+        }
+        UT_ASSERT(expected == 64);
+    }
+
+    BtreeModelCheck<jxy::btree_map<int, StringType, PagedPool, '0GAT', std::less<int>, 0>>(1);
+    BtreeModelCheck<jxy::btree_map<int, StringType, PagedPool, '0GAT', std::less<int>, 256>>(2);
+    BtreeModelCheck<jxy::btree_map<int, StringType, PagedPool, '0GAT'>>(3);
+
+    BtreeBenchmark();
+}
+
+}
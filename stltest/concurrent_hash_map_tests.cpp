@@ -0,0 +1,248 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     stltest/concurrent_hash_map_tests.cpp
+// Author:   Johnny Shaw
+//
+#include "tests_common.hpp"
+#include <jxy/concurrent_hash_map.hpp>
+#include <jxy/map.hpp>
+#include <jxy/vector.hpp>
+#include <jxy/locks.hpp>
+#include <jxy/thread.hpp>
+
+namespace jxy::Tests
+{
+
+//
+// One jxy::map behind one jxy::shared_mutex, as the process and thread maps
+// are, with the members of jxy::concurrent_hash_map the benchmark uses.
+//
+class LockedMap
+{
+public:
+
+    bool find(uint32_t Key, uint64_t& Value) const
+    {
+        jxy::shared_lock<jxy::shared_mutex> lock(m_SharedMutex);
+        auto it = m_Map.find(Key);
+        if (it == m_Map.end())
+        {
+            return false;
+        }
+        Value = it->second;
+        return true;
+    }
+
+    bool try_emplace(uint32_t Key, uint64_t Value)
+    {
+        jxy::unique_lock<jxy::shared_mutex> lock(m_SharedMutex);
+        return m_Map.try_emplace(Key, Value).second;
+    }
+
+    bool erase(uint32_t Key, uint64_t& Erased)
+    {
+        jxy::unique_lock<jxy::shared_mutex> lock(m_SharedMutex);
+        auto it = m_Map.find(Key);
+        if (it == m_Map.end())
+        {
+            return false;
+        }
+        Erased = it->second;
+        m_Map.erase(it);
+        return true;
+    }
+
+    size_t size() const
+    {
+        jxy::shared_lock<jxy::shared_mutex> lock(m_SharedMutex);
+        return m_Map.size();
+    }
+
+private:
+
+    mutable jxy::shared_mutex m_SharedMutex;
+    jxy::map<uint32_t, uint64_t, PagedPool, '0GAT'> m_Map;
+
+};
+
+//
+// Each thread tracks a thread ID of its own, looks up a few of the long
+// lived IDs, and untracks its ID again, as the thread create and exit
+// callbacks do. Only the results are asserted, the timings depend on the
+// machine.
+//
+template <typename TMap>
+static LONGLONG ThreadChurnShape(uint32_t ThreadCount)
+{
+    constexpr uint32_t resident = 4096;
+    constexpr uint32_t iterations = 20000;
+
+    TMap map;
+    for (uint32_t i = 0; i < resident; i++)
+    {
+        UT_ASSERT(map.try_emplace(((i * 4) + 4), i));
+    }
+
+    volatile LONG failures = 0;
+    jxy::vector<jxy::thread, PagedPool, '0GAT'> threads;
+    threads.reserve(ThreadCount);
+
+    auto start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    for (uint32_t t = 0; t < ThreadCount; t++)
+    {
+        threads.emplace_back([&map, &failures, t]()
+                             {
+                                 uint32_t seed = (t + 1);
+                                 for (uint32_t i = 0; i < iterations; i++)
+                                 {
+                                     auto own = (((resident + 1 + (t * iterations) + i)) * 4);
+                                     if (!map.try_emplace(own, i))
+                                     {
+                                         InterlockedIncrement(&failures);
+                                     }
+
+                                     for (uint32_t j = 0; j < 4; j++)
+                                     {
+                                         seed = (seed * 1103515245) + 12345;
+                                         auto index = ((seed >> 8) % resident);
+                                         uint64_t value;
+                                         if (!map.find(((index * 4) + 4), value) || (value != index))
+                                         {
+                                             InterlockedIncrement(&failures);
+                                         }
+                                     }
+
+                                     uint64_t erased;
+                                     if (!map.erase(own, erased) || (erased != i))
+                                     {
+                                         InterlockedIncrement(&failures);
+                                     }
+                                 }
+                             });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    auto elapsed = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+
+    UT_ASSERT(failures == 0);
+    UT_ASSERT(map.size() == resident);
+    return elapsed;
+}
+
+//
+// Threads beyond the active processor count only interleave, the scaling
+// of a run is only meaningful up to the processor count printed with it.
+//
+static void ConcurrentHashMapBenchmark()
+{
+    auto processors = KeQueryActiveProcessorCountEx(ALL_PROCESSOR_GROUPS);
+
+    for (uint32_t threadCount : { 1u, 2u, 4u, 8u, 16u, 32u, 64u })
+    {
+        auto lockedTime = ThreadChurnShape<LockedMap>(threadCount);
+        auto stripedTime = ThreadChurnShape<jxy::concurrent_hash_map<uint32_t, uint64_t, PagedPool, '0GAT'>>(
+            threadCount);
+
+        DbgPrintEx(DPFLTR_IHVDRIVER_ID,
+                   DPFLTR_INFO_LEVEL,
+                   "stltest: %u threads on %u processors churn map+shared_mutex %lld concurrent_hash_map %lld\n",
+                   threadCount,
+                   processors,
+                   lockedTime,
+                   stripedTime);
+    }
+}
+
+void ConcurrentHashMapTests()
+{
+    {
+        jxy::concurrent_hash_map<uint32_t, int, PagedPool, '0GAT', 4> map;
+
+        UT_ASSERT(map.empty());
+        UT_ASSERT(map.stripe_count == 4);
+
+        int value = 0;
+        UT_ASSERT(!map.find(4, value));
+        UT_ASSERT(map.erase(4) == 0);
+
+        UT_ASSERT(map.insert_or_assign(4, 40));
+        UT_ASSERT(!map.insert_or_assign(4, 41));
+        UT_ASSERT(map.find(4, value));
+        UT_ASSERT(value == 41);
+
+        UT_ASSERT(map.try_emplace(8, 80));
+        UT_ASSERT(!map.try_emplace(8, 81));
+        UT_ASSERT(map.contains(8));
+        UT_ASSERT(map.visit(8, [](const int& Found) { UT_ASSERT(Found == 80); }));
+        UT_ASSERT(!map.visit(12, [](const int&) { UT_ASSERT(false); }));
+
+        for (uint32_t i = 3; i <= 100; i++)
+        {
+            map.insert_or_assign((i * 4), static_cast<int>(i * 10));
+        }
+        UT_ASSERT(map.size() == 100);
+
+        uint32_t keySum = 0;
+        map.for_each([&keySum](const uint32_t& Key, const int&) { keySum += Key; });
+        UT_ASSERT(keySum == (4 * 5050));
+
+        int erased = 0;
+        UT_ASSERT(map.erase(8, erased));
+        UT_ASSERT(erased == 80);
+        UT_ASSERT(!map.erase(8, erased));
+        UT_ASSERT(map.erase(12) == 1);
+        UT_ASSERT(map.size() == 98);
+
+        map.clear();
+        UT_ASSERT(map.empty());
+    }
+
+    {
+        //
+        // Concurrent writers of disjoint keys and readers of shared keys.
+        //
+        jxy::concurrent_hash_map<uint32_t, uint32_t, PagedPool, '0GAT'> map;
+        map.reserve(1024);
+        for (uint32_t i = 0; i < 1024; i++)
+        {
+            map.try_emplace(i, i);
+        }
+
+        volatile LONG failures = 0;
+        jxy::vector<jxy::thread, PagedPool, '0GAT'> threads;
+        for (uint32_t t = 0; t < 8; t++)
+        {
+            threads.emplace_back([&map, &failures, t]()
+                                 {
+                                     for (uint32_t i = 0; i < 2000; i++)
+                                     {
+                                         auto key = (0x10000 + (t * 2000) + i);
+                                         map.insert_or_assign(key, t);
+                                         uint32_t value;
+                                         if (!map.find((i % 1024), value) || (value != (i % 1024)))
+                                         {
+                                             InterlockedIncrement(&failures);
+                                         }
+                                         if ((i % 2) && (map.erase(key) != 1))
+                                         {
+                                             InterlockedIncrement(&failures);
+                                         }
+                                     }
+                                 });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        UT_ASSERT(failures == 0);
+        UT_ASSERT(map.size() == (1024 + (8 * 1000)));
+    }
+
+    ConcurrentHashMapBenchmark();
+}
+
+}
@@ -0,0 +1,435 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     stltest/flat_hash_map_tests.cpp
+// Author:   Johnny Shaw
+//
+#include "tests_common.hpp"
+#include <jxy/flat_hash_map.hpp>
+#include <jxy/flat_hash_set.hpp>
+#include <jxy/map.hpp>
+#include <jxy/string.hpp>
+#include <jxy/vector.hpp>
+#include <jxy/locks.hpp>
+#include <jxy/intrusive_ptr.hpp>
+#include <stdexcept>
+
+namespace jxy::Tests
+{
+
+struct FlatThreadContext
+{
+    uint32_t ThreadId;
+};
+
+//
+// The thread map operations (see stlkrn/thread_map.cpp) over a map type.
+//
+template <typename TMap>
+class FlatThreadMap
+{
+public:
+
+    using ContextType = jxy::intrusive_ptr<FlatThreadContext>;
+
+    void TrackThread(ContextType Context)
+    {
+        jxy::unique_lock<jxy::shared_mutex> lock(m_SharedMutex);
+        m_Map.try_emplace(Context->ThreadId, Context);
+    }
+
+    ContextType UntrackThread(uint32_t ThreadId) noexcept
+    {
+        jxy::unique_lock<jxy::shared_mutex> lock(m_SharedMutex);
+
+        auto it = m_Map.find(ThreadId);
+        if (it == m_Map.end())
+        {
+            return nullptr;
+        }
+
+        auto res = it->second;
+        m_Map.erase(it);
+
+        return res;
+    }
+
+    ContextType LookupThread(uint32_t ThreadId) noexcept
+    {
+        jxy::shared_lock<jxy::shared_mutex> lock(m_SharedMutex);
+
+        auto it = m_Map.find(ThreadId);
+        if (it == m_Map.end())
+        {
+            return nullptr;
+        }
+
+        return it->second;
+    }
+
+private:
+
+    jxy::shared_mutex m_SharedMutex;
+    TMap m_Map;
+
+};
+
+//
+// Tracks Count threads with IDs spaced like the system hands them out, looks
+// up every tracked and an untracked ID, then untracks and tracks half of
+// them again, as threads come and go. Only the results are asserted, the
+// timings depend on the machine.
+//
+template <typename TMap>
+static void ThreadMapShape(
+    uint32_t Count,
+    LONGLONG& TrackTime,
+    LONGLONG& LookupTime,
+    LONGLONG& UntrackTime)
+{
+    FlatThreadMap<TMap> map;
+
+    jxy::vector<jxy::intrusive_ptr<FlatThreadContext>, PagedPool, '0GAT'> contexts;
+    contexts.reserve(Count);
+    for (uint32_t i = 0; i < Count; i++)
+    {
+        contexts.push_back(jxy::make_intrusive<FlatThreadContext, PagedPool, '0GAT'>(
+            FlatThreadContext{ (i * 4) + 4 }));
+    }
+
+    auto start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    for (const auto& context : contexts)
+    {
+        map.TrackThread(context);
+    }
+    TrackTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+
+    start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    size_t found = 0;
+    for (uint32_t round = 0; round < 4; round++)
+    {
+        for (uint32_t i = 0; i < (Count + 1); i++)
+        {
+            if (map.LookupThread((i * 4) + 4))
+            {
+                found++;
+            }
+        }
+    }
+    LookupTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+    UT_ASSERT(found == (Count * 4));
+
+    start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    for (uint32_t i = 0; i < Count; i += 2)
+    {
+        UT_ASSERT(map.UntrackThread((i * 4) + 4));
+    }
+    for (uint32_t i = 0; i < Count; i += 2)
+    {
+        map.TrackThread(contexts[i]);
+    }
+    for (uint32_t i = 0; i < Count; i++)
+    {
+        UT_ASSERT(map.UntrackThread((i * 4) + 4));
+    }
+    UntrackTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+
+    UT_ASSERT(!map.LookupThread(4));
+}
+
+static void FlatHashMapBenchmark()
+{
+    using ValueType = jxy::intrusive_ptr<FlatThreadContext>;
+
+    for (uint32_t count : { 1000u, 10000u, 100000u })
+    {
+        LONGLONG mapTrack, mapLookup, mapUntrack;
+        ThreadMapShape<jxy::map<uint32_t, ValueType, PagedPool, '0GAT'>>(
+            count,
+            mapTrack,
+            mapLookup,
+            mapUntrack);
+
+        LONGLONG flatTrack, flatLookup, flatUntrack;
+        ThreadMapShape<jxy::flat_hash_map<uint32_t, ValueType, PagedPool, '0GAT'>>(
+            count,
+            flatTrack,
+            flatLookup,
+            flatUntrack);
+
+        DbgPrintEx(DPFLTR_IHVDRIVER_ID,
+                   DPFLTR_INFO_LEVEL,
+                   "stltest: %u threads track/lookup/untrack map %lld/%lld/%lld flat_hash_map %lld/%lld/%lld\n",
+                   count,
+                   mapTrack,
+                   mapLookup,
+                   mapUntrack,
+                   flatTrack,
+                   flatLookup,
+                   flatUntrack);
+    }
+}
+
+struct FlatThrowingCopy
+{
+    FlatThrowingCopy(int Value) : Value(Value)
+    {
+    }
+
+    FlatThrowingCopy(const FlatThrowingCopy& Other) : Value(Other.Value)
+    {
+        if (Value == ThrowOn)
+        {
+            throw std::runtime_error("FlatThrowingCopy");
+        }
+    }
+
+    int Value;
+
+    static inline int ThrowOn = -1;
+};
+
+struct FlatCountingHash
+{
+    size_t operator()(int Key) const noexcept
+    {
+        (*Calls)++;
+        return std::hash<int>()(Key);
+    }
+
+    size_t* Calls;
+};
+
+void FlatHashMapTests()
+{
+    {
+        jxy::flat_hash_map<int, int, PagedPool, '0GAT'> map;
+
+        UT_ASSERT(map.get_allocator().pool_tag == '0GAT');
+        UT_ASSERT(map.get_allocator().pool_type == PagedPool);
+        UT_ASSERT(map.capacity() == 0);
+        UT_ASSERT(map.begin() == map.end());
+        UT_ASSERT(map.find(1) == map.end());
+        UT_ASSERT(map.erase(1) == 0);
+
+        map.insert({ { 1, 10 }, { 2, 20 }, { 3, 30 } });
+        UT_ASSERT(map.size() == 3);
+        UT_ASSERT(map.capacity() == 16);
+
+        auto result = map.emplace(1, 11);
+        UT_ASSERT(result.second == false);
+        UT_ASSERT(result.first->second == 10);
+
+        UT_ASSERT(map.try_emplace(4, 40).second);
+        UT_ASSERT(map.try_emplace(4, 41).second == false);
+        UT_ASSERT(map.insert_or_assign(4, 42).second == false);
+        UT_ASSERT(map.at(4) == 42);
+
+        map[5] = 50;
+        UT_ASSERT(map[5] == 50);
+        UT_ASSERT(map.size() == 5);
+        UT_ASSERT(map.contains(5));
+        UT_ASSERT(map.count(6) == 0);
+
+        bool threw = false;
+        try
+        {
+            map.at(6);
+        }
+        catch (const std::out_of_range&)
+        {
+            threw = true;
+        }
+        UT_ASSERT(threw);
+
+        int sum = 0;
+        for (const auto& [key, value] : map)
+        {
+            UT_ASSERT(value >= (key * 10));
+            sum += key;
+        }
+        UT_ASSERT(sum == 15);
+
+        UT_ASSERT(map.erase(3) == 1);
+        UT_ASSERT(map.erase(3) == 0);
+        UT_ASSERT(map.find(3) == map.end());
+
+        auto it = map.erase(map.find(1));
+        UT_ASSERT(map.size() == 3);
+        UT_ASSERT(std::distance(it, map.end()) <= 3);
+
+        map.erase(map.begin(), map.end());
+        UT_ASSERT(map.empty());
+        UT_ASSERT(map.begin() == map.end());
+    }
+
+    {
+        //
+        // Growth keeps the table at most 7/8 full, reserve sizes it up front.
+        //
+        jxy::flat_hash_map<uint32_t, uint32_t, PagedPool, '0GAT'> map;
+        for (uint32_t i = 0; i < 10000; i++)
+        {
+            map.emplace((i * 4), i);
+            UT_ASSERT((map.size() * 8) <= (map.capacity() * 7));
+        }
+        UT_ASSERT(map.capacity() == 16384);
+
+        for (uint32_t i = 0; i < 10000; i++)
+        {
+            UT_ASSERT(map.at(i * 4) == i);
+            UT_ASSERT(!map.contains((i * 4) + 1));
+        }
+
+        size_t iterated = 0;
+        for (const auto& entry : map)
+        {
+            UT_ASSERT(entry.first == (entry.second * 4));
+            iterated++;
+        }
+        UT_ASSERT(iterated == 10000);
+
+        jxy::flat_hash_map<uint32_t, uint32_t, PagedPool, '0GAT'> reserved;
+        reserved.reserve(1000);
+        auto capacity = reserved.capacity();
+        UT_ASSERT(capacity == 2048);
+        for (uint32_t i = 0; i < 1000; i++)
+        {
+            reserved.emplace(i, i);
+        }
+        UT_ASSERT(reserved.capacity() == capacity);
+
+        //
+        // Erasing and inserting different keys reuses the room left by
+        // tombstones rather than growing.
+        //
+        for (uint32_t round = 0; round < 100; round++)
+        {
+            for (uint32_t i = 0; i < 1000; i++)
+            {
+                UT_ASSERT(reserved.erase((round * 1000) + i) == 1);
+                reserved.emplace(((round + 1) * 1000) + i, i);
+            }
+        }
+        UT_ASSERT(reserved.size() == 1000);
+        UT_ASSERT(reserved.capacity() == capacity);
+        UT_ASSERT(reserved.at(100999) == 999);
+
+        reserved.clear();
+        UT_ASSERT(reserved.empty());
+        UT_ASSERT(reserved.capacity() == capacity);
+        reserved.rehash(0);
+        UT_ASSERT(reserved.capacity() == 0);
+    }
+
+    {
+        //
+        // Copies, moves, and comparisons.
+        //
+        using MapType = jxy::flat_hash_map<jxy::wstring<PagedPool, '0GAT'>,
+                                           int,
+                                           PagedPool,
+                                           '0GAT',
+                                           std::hash<std::wstring_view>>;
+
+        MapType map{ { L"ntdll.dll", 1 }, { L"kernel32.dll", 2 }, { L"user32.dll", 3 } };
+        UT_ASSERT(map.at(L"kernel32.dll") == 2);
+
+        MapType copy(map);
+        UT_ASSERT(copy == map);
+        copy[L"user32.dll"] = 4;
+        UT_ASSERT(copy != map);
+
+        copy = map;
+        UT_ASSERT(copy == map);
+
+        MapType moved(std::move(copy));
+        UT_ASSERT(copy.empty());
+        UT_ASSERT(moved == map);
+
+        copy = std::move(moved);
+        UT_ASSERT(moved.empty());
+        UT_ASSERT(moved.capacity() == 0);
+        UT_ASSERT(copy == map);
+
+        moved.swap(copy);
+        UT_ASSERT(copy.empty());
+        UT_ASSERT(moved.size() == 3);
+
+        moved = { { L"ntdll.dll", 1 } };
+        UT_ASSERT(moved.size() == 1);
+    }
+
+    {
+        //
+        // Aligned pointers spread over the groups, few probes go past the
+        // first group.
+        //
+        jxy::flat_hash_set<uintptr_t, NonPagedPoolNx, '0GAT'> set;
+        for (uintptr_t i = 1; i <= 4096; i++)
+        {
+            UT_ASSERT(set.insert(i * 0x1000).second);
+        }
+        UT_ASSERT(set.insert(0x1000).second == false);
+        UT_ASSERT(set.size() == 4096);
+
+        for (uintptr_t i = 1; i <= 4096; i++)
+        {
+            UT_ASSERT(set.contains(i * 0x1000));
+            UT_ASSERT(!set.contains((i * 0x1000) + 8));
+        }
+
+        for (auto it = set.begin(); it != set.end();)
+        {
+            it = ((*it % 0x2000) ? set.erase(it) : std::next(it));
+        }
+        UT_ASSERT(set.size() == 2048);
+    }
+    {
+        //
+        // A throwing element copy frees the slots already copied.
+        //
+        jxy::flat_hash_map<int, FlatThrowingCopy, PagedPool, '0GAT'> map;
+        for (int i = 0; i < 100; i++)
+        {
+            map.emplace(i, i);
+        }
+
+        FlatThrowingCopy::ThrowOn = 50;
+        bool threw = false;
+        try
+        {
+            auto copy = map;
+        }
+        catch (const std::runtime_error&)
+        {
+            threw = true;
+        }
+        FlatThrowingCopy::ThrowOn = -1;
+        UT_ASSERT(threw);
+
+        auto copy = map;
+        UT_ASSERT(copy.size() == 100);
+    }
+    {
+        //
+        // An insert hashes the key once, whether or not it's found.
+        //
+        size_t calls = 0;
+        jxy::flat_hash_map<int, int, PagedPool, '0GAT', FlatCountingHash> map(0, FlatCountingHash{ &calls });
+        map.reserve(16);
+
+        UT_ASSERT(map.emplace(1, 1).second);
+        UT_ASSERT(calls == 1);
+        UT_ASSERT(!map.emplace(1, 2).second);
+        UT_ASSERT(calls == 2);
+        UT_ASSERT(map.try_emplace(2, 2).second);
+        UT_ASSERT(calls == 3);
+        map[2] = 3;
+        UT_ASSERT(calls == 4);
+    }
+
+    FlatHashMapBenchmark();
+}
+
+}
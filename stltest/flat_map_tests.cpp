@@ -0,0 +1,399 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     stltest/flat_map_tests.cpp
+// Author:   Johnny Shaw
+//
+#include "tests_common.hpp"
+#include <jxy/flat_map.hpp>
+#include <jxy/flat_set.hpp>
+#include <jxy/map.hpp>
+#include <jxy/string.hpp>
+#include <jxy/vector.hpp>
+#include <stdexcept>
+
+namespace jxy::Tests
+{
+
+struct FlatModuleExtents
+{
+    uintptr_t Start;
+    uintptr_t End;
+
+    bool operator<(const FlatModuleExtents& Other) const
+    {
+        return (Start < Other.Start);
+    }
+};
+
+//
+// Builds a module map of Count images at 64K aligned bases, in the order a
+// process maps them rather than address order, looks every image up a few
+// times, and walks the map as a snapshot does. Only the results are
+// asserted, the timings depend on the machine.
+//
+template <typename TMap>
+static void ModuleMapShape(
+    uint32_t Count,
+    LONGLONG& BuildTime,
+    LONGLONG& LookupTime,
+    LONGLONG& IterateTime)
+{
+    jxy::vector<FlatModuleExtents, PagedPool, '0GAT'> extents;
+    extents.reserve(Count);
+    for (uint32_t i = 0; i < Count; i++)
+    {
+        //
+        // Scatters the bases, 97 is coprime with the counts used.
+        //
+        auto slot = static_cast<uintptr_t>((i * 97) % Count);
+        auto start = (0x7ff800000000ull + (slot * 0x100000));
+        extents.push_back({ start, (start + 0x10000 + ((i % 16) * 0x1000)) });
+    }
+
+    auto start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    TMap map;
+    for (uint32_t i = 0; i < Count; i++)
+    {
+        map.try_emplace(extents[i], i);
+    }
+    BuildTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+    UT_ASSERT(map.size() == Count);
+
+    start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    size_t found = 0;
+    for (uint32_t round = 0; round < 16; round++)
+    {
+        for (const auto& extent : extents)
+        {
+            if (map.find(extent) != map.end())
+            {
+                found++;
+            }
+        }
+    }
+    LookupTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+    UT_ASSERT(found == (Count * 16));
+
+    start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    uint64_t sum = 0;
+    for (uint32_t round = 0; round < 16; round++)
+    {
+        for (const auto& entry : map)
+        {
+            sum += entry.second;
+        }
+    }
+    IterateTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+    UT_ASSERT(sum == ((static_cast<uint64_t>(Count) * (Count - 1) / 2) * 16));
+}
+
+static void FlatMapBenchmark()
+{
+    for (uint32_t count : { 32u, 128u, 512u })
+    {
+        LONGLONG mapBuild, mapLookup, mapIterate;
+        ModuleMapShape<jxy::map<FlatModuleExtents, uint32_t, PagedPool, '0GAT'>>(
+            count,
+            mapBuild,
+            mapLookup,
+            mapIterate);
+
+        LONGLONG flatBuild, flatLookup, flatIterate;
+        ModuleMapShape<jxy::flat_map<FlatModuleExtents, uint32_t, PagedPool, '0GAT'>>(
+            count,
+            flatBuild,
+            flatLookup,
+            flatIterate);
+
+        DbgPrintEx(DPFLTR_IHVDRIVER_ID,
+                   DPFLTR_INFO_LEVEL,
+                   "stltest: %u modules build/lookup/iterate map %lld/%lld/%lld flat_map %lld/%lld/%lld\n",
+                   count,
+                   mapBuild,
+                   mapLookup,
+                   mapIterate,
+                   flatBuild,
+                   flatLookup,
+                   flatIterate);
+    }
+}
+
+//
+// Copying throws once the count of copies reaches ThrowAfter. There is no
+// move constructor so the flat map copies it when growing and reordering.
+//
+struct FlatCountedCopy
+{
+    FlatCountedCopy(int Value) : Value(Value)
+    {
+    }
+
+    FlatCountedCopy(const FlatCountedCopy& Other) : Value(Other.Value)
+    {
+        if ((ThrowAfter >= 0) && (Copies++ >= ThrowAfter))
+        {
+            throw std::runtime_error("FlatCountedCopy");
+        }
+    }
+
+    FlatCountedCopy& operator=(const FlatCountedCopy&) = default;
+
+    int Value;
+
+    static inline int Copies = 0;
+    static inline int ThrowAfter = -1;
+};
+
+void FlatMapTests()
+{
+    {
+        jxy::flat_map<int, int, PagedPool, '0GAT'> map;
+
+        UT_ASSERT(map.keys().get_allocator().pool_tag == '0GAT');
+        UT_ASSERT(map.values().get_allocator().pool_type == PagedPool);
+        UT_ASSERT(map.begin() == map.end());
+        UT_ASSERT(map.find(1) == map.end());
+        UT_ASSERT(map.erase(1) == 0);
+
+        map.insert({ { 3, 30 }, { 1, 10 }, { 2, 20 }, { 1, 11 } });
+        UT_ASSERT(map.size() == 3);
+        UT_ASSERT(map.at(1) == 10);
+
+        auto result = map.emplace(2, 21);
+        UT_ASSERT(result.second == false);
+        UT_ASSERT(result.first->second == 20);
+
+        UT_ASSERT(map.try_emplace(5, 50).second);
+        UT_ASSERT(map.try_emplace(5, 51).second == false);
+        UT_ASSERT(map.insert_or_assign(5, 52).second == false);
+        UT_ASSERT(map.at(5) == 52);
+
+        map[4] = 40;
+        UT_ASSERT(map[4] == 40);
+        UT_ASSERT(map.size() == 5);
+        UT_ASSERT(map.contains(4));
+        UT_ASSERT(map.count(6) == 0);
+
+        bool threw = false;
+        try
+        {
+            map.at(6);
+        }
+        catch (const std::out_of_range&)
+        {
+            threw = true;
+        }
+        UT_ASSERT(threw);
+
+        int expected = 1;
+        for (const auto& [key, value] : map)
+        {
+            UT_ASSERT(key == expected++);
+            UT_ASSERT(value >= (key * 10));
+        }
+
+        for (auto entry : map)
+        {
+            entry.second = (entry.first * 100);
+        }
+        UT_ASSERT(map.at(3) == 300);
+
+        UT_ASSERT(map.lower_bound(3)->first == 3);
+        UT_ASSERT(map.upper_bound(3)->first == 4);
+        UT_ASSERT((map.end() - map.begin()) == 5);
+        UT_ASSERT(map.rbegin()->first == 5);
+
+        auto it = map.erase(map.find(2));
+        UT_ASSERT(it->first == 3);
+        UT_ASSERT(map.erase(3) == 1);
+        UT_ASSERT(map.size() == 3);
+
+        map.erase(map.begin(), map.find(5));
+        UT_ASSERT(map.size() == 1);
+        UT_ASSERT(map.begin()->first == 5);
+    }
+
+    {
+        //
+        // Bulk inserts merge with the existing elements, the first of
+        // equivalent keys is kept.
+        //
+        jxy::flat_map<uint32_t, uint32_t, PagedPool, '0GAT'> map;
+        map.reserve(2000);
+        UT_ASSERT(map.capacity() >= 2000);
+
+        jxy::vector<std::pair<uint32_t, uint32_t>, PagedPool, '0GAT'> values;
+        for (uint32_t i = 0; i < 1000; i++)
+        {
+            values.emplace_back(((i * 7) % 1000) * 2, i);
+        }
+        map.insert(values.begin(), values.end());
+        UT_ASSERT(map.size() == 1000);
+
+        values.clear();
+        for (uint32_t i = 0; i < 1000; i++)
+        {
+            values.emplace_back(i, i + 5000);
+        }
+        map.insert(values.begin(), values.end());
+        UT_ASSERT(map.size() == 1500);
+
+        uint32_t previous = 0;
+        for (auto it = map.begin(); it != map.end(); ++it)
+        {
+            UT_ASSERT((it == map.begin()) || (previous < it->first));
+            previous = it->first;
+            if (it->first % 2)
+            {
+                UT_ASSERT(it->second == (it->first + 5000));
+            }
+            else
+            {
+                UT_ASSERT(it->second < 1000);
+            }
+        }
+
+        //
+        // Sorted data is taken as is.
+        //
+        values.clear();
+        for (uint32_t i = 0; i < 100; i++)
+        {
+            values.emplace_back(i + 10000, i);
+        }
+        map.insert(jxy::sorted_unique, values.begin(), values.end());
+        UT_ASSERT(map.size() == 1600);
+        UT_ASSERT(map.rbegin()->first == 10099);
+
+        auto containers = std::move(map).extract();
+        UT_ASSERT(containers.keys.size() == 1600);
+        UT_ASSERT(containers.values.size() == 1600);
+
+        jxy::flat_map<uint32_t, uint32_t, PagedPool, '0GAT'> replaced;
+        replaced.replace(std::move(containers.keys), std::move(containers.values));
+        UT_ASSERT(replaced.size() == 1600);
+        UT_ASSERT(replaced.at(10000) == 0);
+
+        jxy::flat_map<uint32_t, uint32_t, PagedPool, '0GAT'> copy(replaced);
+        UT_ASSERT(copy == replaced);
+        copy[1] = 0;
+        UT_ASSERT(copy != replaced);
+
+        replaced.clear();
+        UT_ASSERT(replaced.empty());
+        replaced.swap(copy);
+        UT_ASSERT(copy.empty());
+        UT_ASSERT(replaced.size() == 1600);
+    }
+
+    {
+        //
+        // Equivalent keys keep their insertion order.
+        //
+        jxy::flat_multimap<jxy::wstring<PagedPool, '0GAT'>, int, PagedPool, '0GAT'> map{
+            { L"ntdll.dll", 1 },
+            { L"kernel32.dll", 2 },
+            { L"ntdll.dll", 3 } };
+        map.insert({ { L"ntdll.dll", 4 }, { L"advapi32.dll", 5 } });
+        map.emplace(L"ntdll.dll", 6);
+        UT_ASSERT(map.size() == 6);
+        UT_ASSERT(map.count(L"ntdll.dll") == 4);
+
+        int expected[] = { 1, 3, 4, 6 };
+        auto range = map.equal_range(L"ntdll.dll");
+        UT_ASSERT((range.second - range.first) == 4);
+        for (int i = 0; i < 4; i++)
+        {
+            UT_ASSERT(range.first[i].second == expected[i]);
+        }
+
+        UT_ASSERT(map.begin()->second == 5);
+        UT_ASSERT(map.erase(L"ntdll.dll") == 4);
+        UT_ASSERT(map.size() == 2);
+    }
+
+    {
+        jxy::flat_set<int, PagedPool, '0GAT'> set{ 5, 3, 1, 3, 4 };
+        UT_ASSERT(set.size() == 4);
+        UT_ASSERT(*set.begin() == 1);
+        UT_ASSERT(set.insert(2).second);
+        UT_ASSERT(set.insert(2).second == false);
+        UT_ASSERT(set.contains(2));
+
+        set.insert({ 9, 0, 7 });
+        int expected = 0;
+        for (auto value : set)
+        {
+            UT_ASSERT(value >= expected);
+            expected = value + 1;
+        }
+        UT_ASSERT(set.size() == 8);
+
+        set.insert(jxy::sorted_unique, { 10, 11 });
+        UT_ASSERT(*set.rbegin() == 11);
+
+        auto container = std::move(set).extract();
+        UT_ASSERT(container.size() == 10);
+
+        jxy::flat_multiset<int, PagedPool, '0GAT'> multi(container);
+        multi.insert({ 1, 1, 11 });
+        UT_ASSERT(multi.size() == 13);
+        UT_ASSERT(multi.count(1) == 3);
+        UT_ASSERT(multi.erase(1) == 3);
+        UT_ASSERT(multi.find(1) == multi.end());
+    }
+    {
+        //
+        // A copy throwing at any point of the insert, including while the
+        // elements are reordered, leaves the existing elements as they were.
+        //
+        using KeyType = jxy::wstring<PagedPool, '0GAT'>;
+        using MapType = jxy::flat_map<KeyType, FlatCountedCopy, PagedPool, '0GAT'>;
+
+        const std::pair<const KeyType, FlatCountedCopy> values[] =
+        {
+            { KeyType(L"c - long enough to be on the heap"), 3 },
+            { KeyType(L"a - long enough to be on the heap"), 1 },
+        };
+
+        bool threw = true;
+        for (int throwAfter = 0; threw; throwAfter++)
+        {
+            MapType map;
+            map.try_emplace(KeyType(L"b - long enough to be on the heap"), 2);
+            map.try_emplace(KeyType(L"d - long enough to be on the heap"), 4);
+
+            FlatCountedCopy::Copies = 0;
+            FlatCountedCopy::ThrowAfter = throwAfter;
+            threw = false;
+            try
+            {
+                map.insert(std::begin(values), std::end(values));
+            }
+            catch (const std::runtime_error&)
+            {
+                threw = true;
+            }
+            FlatCountedCopy::ThrowAfter = -1;
+
+            if (!threw)
+            {
+                UT_ASSERT(map.size() == 4);
+                UT_ASSERT(map.begin()->first == L"a - long enough to be on the heap");
+                UT_ASSERT(map.rbegin()->second.Value == 4);
+                break;
+            }
+
+            UT_ASSERT(map.size() == 2);
+            UT_ASSERT(map.begin()->first == L"b - long enough to be on the heap");
+            UT_ASSERT(map.begin()->second.Value == 2);
+            UT_ASSERT(map.rbegin()->first == L"d - long enough to be on the heap");
+            UT_ASSERT(map.rbegin()->second.Value == 4);
+        }
+    }
+
+    FlatMapBenchmark();
+}
+
+}
@@ -0,0 +1,277 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     stltest/id_table_tests.cpp
+// Author:   Johnny Shaw
+//
+#include "tests_common.hpp"
+#include <jxy/id_table.hpp>
+#include <jxy/map.hpp>
+#include <jxy/vector.hpp>
+#include <jxy/intrusive_ptr.hpp>
+#include <stdexcept>
+
+namespace jxy::Tests
+{
+
+struct IdTableContext
+{
+    uint32_t Id;
+};
+
+using IdTableContextType = jxy::intrusive_ptr<IdTableContext>;
+
+//
+// Inserts Count contexts in a burst as ProcessMap::Populate does, with IDs
+// scattered over the handle table, then looks each of them and an absent ID
+// up. Only the results are asserted, the timings depend on the machine.
+//
+template <typename TMap>
+static void PopulateShape(
+    const jxy::vector<IdTableContextType, PagedPool, '0GAT'>& Contexts,
+    LONGLONG& PopulateTime,
+    LONGLONG& LookupTime)
+{
+    TMap map;
+
+    auto start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    for (const auto& context : Contexts)
+    {
+        map.try_emplace(context->Id, context);
+    }
+    PopulateTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+    UT_ASSERT(map.size() == Contexts.size());
+
+    start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    size_t found = 0;
+    for (uint32_t round = 0; round < 4; round++)
+    {
+        for (const auto& context : Contexts)
+        {
+            auto it = map.find(context->Id);
+            found += (((it != map.end()) && (it->second == context)) ? 1 : 0);
+            found += ((map.find(context->Id + 0x100000) != map.end()) ? 1 : 0);
+        }
+    }
+    LookupTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+    UT_ASSERT(found == (Contexts.size() * 4));
+}
+
+//
+// Steady state callbacks, each step a thread exits and another is created,
+// reusing a recently freed ID as the handle table does, and the callbacks
+// look the live threads up.
+//
+template <typename TMap>
+static void ChurnShape(
+    const jxy::vector<IdTableContextType, PagedPool, '0GAT'>& Contexts,
+    LONGLONG& ChurnTime)
+{
+    TMap map;
+    auto live = (Contexts.size() / 2);
+    for (size_t i = 0; i < live; i++)
+    {
+        map.try_emplace(Contexts[i]->Id, Contexts[i]);
+    }
+
+    auto start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    size_t found = 0;
+    uint32_t seed = 0x2468ace;
+    for (uint32_t step = 0; step < 100000; step++)
+    {
+        seed = (seed * 1103515245) + 12345;
+        auto exiting = ((seed >> 8) % Contexts.size());
+        auto creating = ((exiting + live) % Contexts.size());
+
+        auto it = map.find(Contexts[exiting]->Id);
+        if (it != map.end())
+        {
+            map.erase(it);
+        }
+        map.try_emplace(Contexts[creating]->Id, Contexts[creating]);
+
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            found += ((map.find(Contexts[(creating + i) % Contexts.size()]->Id) != map.end()) ? 1 : 0);
+        }
+    }
+    ChurnTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+    UT_ASSERT(found > 0);
+}
+
+static void IdTableBenchmark()
+{
+    using MapType = jxy::map<uint32_t, IdTableContextType, PagedPool, '0GAT'>;
+    using TableType = jxy::id_table<IdTableContextType, PagedPool, '0GAT'>;
+
+    for (uint32_t count : { 300u, 3000u, 30000u })
+    {
+        //
+        // IDs are handed out from across the handle table, roughly a few
+        // IDs in use for every dozen.
+        //
+        jxy::vector<IdTableContextType, PagedPool, '0GAT'> contexts;
+        contexts.reserve(count);
+        uint32_t seed = 0x13579bd;
+        uint32_t id = 4;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            seed = (seed * 1103515245) + 12345;
+            id += (4 * (1 + ((seed >> 16) % 6)));
+            contexts.push_back(jxy::make_intrusive<IdTableContext, PagedPool, '0GAT'>(IdTableContext{ id }));
+        }
+
+        //
+        // Creation order isn't ID order.
+        //
+        for (uint32_t i = 0; i < count; i++)
+        {
+            seed = (seed * 1103515245) + 12345;
+            std::swap(contexts[i], contexts[(seed >> 8) % count]);
+        }
+
+        LONGLONG mapPopulate, mapLookup, mapChurn;
+        PopulateShape<MapType>(contexts, mapPopulate, mapLookup);
+        ChurnShape<MapType>(contexts, mapChurn);
+
+        LONGLONG tablePopulate, tableLookup, tableChurn;
+        PopulateShape<TableType>(contexts, tablePopulate, tableLookup);
+        ChurnShape<TableType>(contexts, tableChurn);
+
+        DbgPrintEx(DPFLTR_IHVDRIVER_ID,
+                   DPFLTR_INFO_LEVEL,
+                   "stltest: %u IDs populate/lookup/churn map %lld/%lld/%lld id_table %lld/%lld/%lld\n",
+                   count,
+                   mapPopulate,
+                   mapLookup,
+                   mapChurn,
+                   tablePopulate,
+                   tableLookup,
+                   tableChurn);
+    }
+}
+
+void IdTableTests()
+{
+    {
+        jxy::id_table<int, PagedPool, '0GAT'> table;
+
+        UT_ASSERT(table.empty());
+        UT_ASSERT(table.begin() == table.end());
+        UT_ASSERT(table.find(4) == table.end());
+        UT_ASSERT(table.erase(4) == 0);
+        UT_ASSERT(table.page_count() == 0);
+
+        UT_ASSERT(table.try_emplace(8, 80).second);
+        UT_ASSERT(table.try_emplace(8, 81).second == false);
+        UT_ASSERT(table.try_emplace(4, 40).second);
+        UT_ASSERT(table.insert({ 0, 0 }).second);
+        UT_ASSERT(table.insert_or_assign(8, 82).second == false);
+        table[12] = 120;
+        UT_ASSERT(table.size() == 4);
+        UT_ASSERT(table.page_count() == 1);
+
+        UT_ASSERT(table.find(8)->second == 82);
+        UT_ASSERT(table.contains(12));
+        UT_ASSERT(table.count(16) == 0);
+
+        //
+        // An ID which isn't a multiple of 4 isn't confused with its slot.
+        //
+        UT_ASSERT(table.find(9) == table.end());
+
+        //
+        // Nor can one be inserted.
+        //
+        bool threw = false;
+        try
+        {
+            table.try_emplace(9, 90);
+        }
+        catch (const std::invalid_argument&)
+        {
+            threw = true;
+        }
+        UT_ASSERT(threw);
+        UT_ASSERT(table.size() == 4);
+        UT_ASSERT(table.find(8)->second == 82);
+
+        //
+        // Iteration is in ID order.
+        //
+        uint32_t expected = 0;
+        for (const auto& [id, value] : table)
+        {
+            UT_ASSERT(id == expected);
+            UT_ASSERT(value >= static_cast<int>(id * 10));
+            expected += 4;
+        }
+        UT_ASSERT(expected == 16);
+
+        auto it = table.erase(table.find(4));
+        UT_ASSERT(it->first == 8);
+        UT_ASSERT(table.erase(12) == 1);
+        UT_ASSERT(table.size() == 2);
+
+        table.clear();
+        UT_ASSERT(table.empty());
+        UT_ASSERT(table.page_count() == 0);
+    }
+
+    {
+        //
+        // Pages are allocated for the ranges in use and freed when they
+        // empty.
+        //
+        jxy::id_table<IdTableContextType, PagedPool, '0GAT'> table;
+
+        for (uint32_t id = 4; id <= 40000; id += 400)
+        {
+            table.try_emplace(id, jxy::make_intrusive<IdTableContext, PagedPool, '0GAT'>(IdTableContext{ id }));
+        }
+        UT_ASSERT(table.size() == 100);
+        UT_ASSERT(table.page_count() == 78);
+
+        size_t iterated = 0;
+        uint32_t previous = 0;
+        for (const auto& entry : table)
+        {
+            UT_ASSERT(entry.first == entry.second->Id);
+            UT_ASSERT(entry.first > previous);
+            previous = entry.first;
+            iterated++;
+        }
+        UT_ASSERT(iterated == 100);
+
+        for (auto it = table.begin(); it != table.end();)
+        {
+            it = ((it->first < 20000) ? table.erase(it) : std::next(it));
+        }
+        UT_ASSERT(table.size() == 50);
+        UT_ASSERT(table.page_count() == 39);
+        UT_ASSERT(table.begin()->first == 20004);
+
+        jxy::id_table<IdTableContextType, PagedPool, '0GAT'> copy(table);
+        UT_ASSERT(copy.size() == 50);
+        UT_ASSERT(copy.find(20004)->second == table.find(20004)->second);
+
+        jxy::id_table<IdTableContextType, PagedPool, '0GAT'> moved(std::move(copy));
+        UT_ASSERT(copy.empty());
+        UT_ASSERT(copy.begin() == copy.end());
+        UT_ASSERT(moved.size() == 50);
+
+        copy = std::move(moved);
+        UT_ASSERT(copy.size() == 50);
+        moved = copy;
+        UT_ASSERT(moved.size() == 50);
+
+        table.clear();
+        table.shrink_to_fit();
+        UT_ASSERT(table.begin() == table.end());
+        UT_ASSERT(table.page_count() == 0);
+    }
+
+    IdTableBenchmark();
+}
+
+}
@@ -0,0 +1,243 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     stltest/inplace_string_tests.cpp
+// Author:   Johnny Shaw
+//
+#include "tests_common.hpp"
+#include <jxy/inplace_string.hpp>
+#include <jxy/string.hpp>
+#include <jxy/vector.hpp>
+
+namespace jxy::Tests
+{
+
+static const wchar_t* const g_ImageNames[] =
+{
+    L"\\Device\\HarddiskVolume3\\Windows\\System32\\cmd.exe",
+    L"\\Device\\HarddiskVolume3\\Windows\\System32\\ntdll.dll",
+    L"\\Device\\HarddiskVolume3\\Windows\\System32\\kernel32.dll",
+    L"\\Device\\HarddiskVolume3\\Windows\\System32\\KernelBase.dll",
+    L"\\Device\\HarddiskVolume3\\Windows\\System32\\ucrtbase.dll",
+    L"\\Device\\HarddiskVolume3\\Windows\\System32\\msvcp_win.dll",
+    L"\\Device\\HarddiskVolume3\\Windows\\System32\\combase.dll",
+    L"\\Device\\HarddiskVolume3\\Windows\\System32\\RuntimeBroker.exe",
+    L"\\Device\\HarddiskVolume3\\Windows\\System32\\svchost.exe",
+    L"\\Device\\HarddiskVolume3\\Windows\\explorer.exe",
+    L"\\Device\\HarddiskVolume3\\Program Files\\Contoso\\ContosoUpdateService.exe",
+    L"\\Device\\HarddiskVolume3\\Windows\\WinSxS\\amd64_microsoft.windows.common-controls_6595b64144ccf1df\\comctl32.dll",
+    L"\\Device\\HarddiskVolume3\\Windows\\System32\\Windows.StateRepositoryClient.dll",
+};
+
+//
+// True if the characters of String are outside of the object, in a pool
+// allocation.
+//
+template <typename TString>
+static bool IsAllocated(const TString& String)
+{
+    auto chars = reinterpret_cast<const char*>(String.data());
+    auto object = reinterpret_cast<const char*>(&String);
+    return ((chars < object) || (chars >= (object + sizeof(TString))));
+}
+
+//
+// Makes the file part of every image name for Count contexts, as the
+// process and image load callbacks do, and keeps them for the lifetime of
+// the contexts. Reports the allocations made and the bytes each context
+// spends on its file part. Only the results are asserted, the timings
+// depend on the machine.
+//
+template <typename TString>
+static LONGLONG FilePartShape(uint32_t Count, size_t& Allocations, size_t& BytesPerContext)
+{
+    using NameType = jxy::wstring<PagedPool, '0GAT'>;
+
+    jxy::vector<NameType, PagedPool, '0GAT'> names;
+    for (auto name : g_ImageNames)
+    {
+        names.emplace_back(name);
+    }
+
+    jxy::vector<TString, PagedPool, '0GAT'> parts;
+    parts.reserve(Count);
+
+    auto start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    for (uint32_t i = 0; i < Count; i++)
+    {
+        const auto& name = names[i % names.size()];
+        TString part;
+        auto pos = name.rfind(L'\\');
+        part.assign((name.begin() + pos + 1), name.end());
+        parts.push_back(std::move(part));
+    }
+    auto elapsed = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+
+    Allocations = 0;
+    size_t bytes = 0;
+    for (const auto& part : parts)
+    {
+        bytes += sizeof(TString);
+        if (IsAllocated(part))
+        {
+            //
+            // A small pool block is rounded to 16 bytes and has a 16 byte
+            // header.
+            //
+            Allocations++;
+            bytes += ((((part.capacity() + 1) * sizeof(wchar_t)) + 15) & ~size_t(15)) + 16;
+        }
+    }
+    BytesPerContext = (bytes / Count);
+
+    UT_ASSERT(parts[0] == std::wstring_view(L"cmd.exe"));
+    UT_ASSERT(parts[names.size() - 1] == std::wstring_view(L"Windows.StateRepositoryClient.dll"));
+    return elapsed;
+}
+
+static void InplaceStringBenchmark()
+{
+    for (uint32_t count : { 100u, 1000u, 10000u })
+    {
+        size_t stringAllocations, stringBytes;
+        auto stringTime = FilePartShape<jxy::wstring<PagedPool, '0GAT'>>(count, stringAllocations, stringBytes);
+
+        size_t hybridAllocations, hybridBytes;
+        auto hybridTime = FilePartShape<jxy::inplace_or_heap_wstring<31, PagedPool, '0GAT'>>(
+            count, hybridAllocations, hybridBytes);
+
+        size_t inplaceAllocations, inplaceBytes;
+        auto inplaceTime = FilePartShape<jxy::inplace_wstring<39>>(count, inplaceAllocations, inplaceBytes);
+
+        UT_ASSERT(hybridAllocations < stringAllocations);
+        UT_ASSERT(inplaceAllocations == 0);
+
+        DbgPrintEx(DPFLTR_IHVDRIVER_ID,
+                   DPFLTR_INFO_LEVEL,
+                   "stltest: %u file parts time/allocations/bytes per context wstring %lld/%zu/%zu "
+                   "inplace_or_heap_wstring<31> %lld/%zu/%zu inplace_wstring<39> %lld/%zu/%zu\n",
+                   count,
+                   stringTime,
+                   stringAllocations,
+                   stringBytes,
+                   hybridTime,
+                   hybridAllocations,
+                   hybridBytes,
+                   inplaceTime,
+                   inplaceAllocations,
+                   inplaceBytes);
+    }
+}
+
+void InplaceStringTests()
+{
+    {
+        jxy::inplace_wstring<8> str;
+        UT_ASSERT(str.empty());
+        UT_ASSERT(str.c_str()[0] == L'\0');
+        UT_ASSERT(str.capacity() == 8);
+
+        str = L"cmd.exe";
+        UT_ASSERT(str.size() == 7);
+        UT_ASSERT(str == L"cmd.exe");
+        UT_ASSERT(str.c_str()[7] == L'\0');
+        UT_ASSERT(str.find(L'.') == 3);
+        UT_ASSERT(str.rfind(L"e") == 6);
+        UT_ASSERT(str.substr(4) == L"exe");
+        UT_ASSERT(str.compare(L"cmd.exf") < 0);
+        UT_ASSERT(!IsAllocated(str));
+
+        str.push_back(L'!');
+        UT_ASSERT(str == L"cmd.exe!");
+
+        bool threw = false;
+        try
+        {
+            str.push_back(L'!');
+        }
+        catch (const std::length_error&)
+        {
+            threw = true;
+        }
+        UT_ASSERT(threw);
+        UT_ASSERT(str == L"cmd.exe!");
+
+        str.pop_back();
+        str.erase(0, 4);
+        UT_ASSERT(str == L"exe");
+
+        jxy::inplace_wstring<8> copy(str);
+        copy += L'x';
+        UT_ASSERT(copy == L"exex");
+        UT_ASSERT(str < copy);
+
+        //
+        // Assigning and appending part of the string itself.
+        //
+        copy.assign(copy.data() + 1, 2);
+        UT_ASSERT(copy == L"xe");
+        copy.append(copy.data(), 2);
+        UT_ASSERT(copy == L"xexe");
+        copy.resize(6, L'-');
+        UT_ASSERT(copy == L"xexe--");
+        copy.resize(1);
+        UT_ASSERT(copy == L"x");
+
+        //
+        // Pointers to another character type are widened one at a time.
+        //
+        const char narrow[] = "ntdll";
+        copy.assign(std::begin(narrow), (std::end(narrow) - 1));
+        UT_ASSERT(copy == L"ntdll");
+    }
+
+    {
+        using StringType = jxy::inplace_or_heap_wstring<8, PagedPool, '0GAT'>;
+
+        StringType str(L"ntdll.dll");
+        UT_ASSERT(!str.is_inline());
+        UT_ASSERT(str == L"ntdll.dll");
+
+        str = L"ntdll";
+        str.shrink_to_fit();
+        UT_ASSERT(str.is_inline());
+        UT_ASSERT(!IsAllocated(str));
+
+        //
+        // Appending part of the string itself when it spills.
+        //
+        str.append(str.data(), str.size());
+        UT_ASSERT(!str.is_inline());
+        UT_ASSERT(str == L"ntdllntdll");
+        UT_ASSERT(str.c_str()[10] == L'\0');
+
+        StringType moved(std::move(str));
+        UT_ASSERT(moved == L"ntdllntdll");
+        UT_ASSERT(str.empty());
+        UT_ASSERT(str.c_str()[0] == L'\0');
+
+        str = moved;
+        UT_ASSERT(str == moved);
+        str.clear();
+        str = std::move(moved);
+        UT_ASSERT(str == L"ntdllntdll");
+        UT_ASSERT(moved.empty());
+
+        jxy::inplace_wstring<16> other(str.begin(), str.end());
+        UT_ASSERT(other == str);
+
+        //
+        // The file part of an image name, as the callbacks make it.
+        //
+        jxy::wstring<PagedPool, '0GAT'> fileName(L"\\Device\\HarddiskVolume3\\Windows\\System32\\cmd.exe");
+        StringType filePart;
+        auto pos = fileName.rfind(L'\\');
+        filePart.assign((fileName.begin() + pos + 1), fileName.end());
+        UT_ASSERT(filePart == L"cmd.exe");
+        UT_ASSERT(filePart.is_inline());
+    }
+
+    InplaceStringBenchmark();
+}
+
+}
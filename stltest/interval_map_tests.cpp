@@ -0,0 +1,252 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     stltest/interval_map_tests.cpp
+// Author:   Johnny Shaw
+//
+#include "tests_common.hpp"
+#include <jxy/interval_map.hpp>
+#include <jxy/map.hpp>
+#include <jxy/vector.hpp>
+
+namespace jxy::Tests
+{
+
+struct IntervalModule
+{
+    uintptr_t Start;
+    uintptr_t End;
+    uint32_t Id;
+};
+
+//
+// Lays out Count images like a process address space, the executable low,
+// then DLLs packed down from the top of the user address space with sizes
+// from 64K to a few MB, 64K aligned with gaps between some of them.
+//
+static void MakeModuleLayout(
+    uint32_t Count,
+    jxy::vector<IntervalModule, PagedPool, '0GAT'>& Modules)
+{
+    Modules.reserve(Count);
+    Modules.push_back({ 0x7ff600000000ull, 0x7ff600000000ull + 0x2a0000, 0 });
+
+    uint32_t seed = 0x1234567;
+    uintptr_t next = 0x7fffe0000000ull;
+    for (uint32_t i = 1; i < Count; i++)
+    {
+        seed = (seed * 1103515245) + 12345;
+        uintptr_t size = (0x10000 + ((seed >> 8) % 0x400000)) & ~uintptr_t(0xffff);
+        if (seed & 0x10)
+        {
+            next -= 0x10000;
+        }
+        next -= size;
+        Modules.push_back({ next, next + size, i });
+    }
+}
+
+//
+// Attributes Count return addresses in the modules, and some which are in no
+// module, using the interval map, a tree keyed by start, and a scan of the
+// modules. Only the results are asserted, the timings depend on the machine.
+//
+static void IntervalMapBenchmark()
+{
+    for (uint32_t moduleCount : { 64u, 256u, 1024u })
+    {
+        jxy::vector<IntervalModule, PagedPool, '0GAT'> modules;
+        MakeModuleLayout(moduleCount, modules);
+
+        jxy::interval_map<uintptr_t, uint32_t, PagedPool, '0GAT'> ranges;
+        jxy::map<uintptr_t, IntervalModule, PagedPool, '0GAT'> tree;
+        for (const auto& modl : modules)
+        {
+            ranges.assign(modl.Start, modl.End, modl.Id);
+            tree.emplace(modl.Start, modl);
+        }
+        UT_ASSERT(ranges.size() == moduleCount);
+
+        constexpr uint32_t addressCount = 10000;
+        jxy::vector<uintptr_t, PagedPool, '0GAT'> addresses;
+        addresses.reserve(addressCount);
+        uint32_t seed = 0x89abcdef;
+        for (uint32_t i = 0; i < addressCount; i++)
+        {
+            seed = (seed * 1103515245) + 12345;
+            const auto& modl = modules[(seed >> 4) % moduleCount];
+            auto address = modl.Start + ((seed >> 2) % (modl.End - modl.Start));
+            addresses.push_back((i % 16) ? address : (address & 0xffffffff));
+        }
+
+        auto start = KeQueryPerformanceCounter(nullptr).QuadPart;
+        uint64_t rangeSum = 0;
+        for (auto address : addresses)
+        {
+            auto it = ranges.find(address);
+            rangeSum += ((it != ranges.end()) ? (it->second.second + 1) : 0);
+        }
+        auto rangeTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+
+        start = KeQueryPerformanceCounter(nullptr).QuadPart;
+        uint64_t treeSum = 0;
+        for (auto address : addresses)
+        {
+            auto it = tree.upper_bound(address);
+            if (it != tree.begin())
+            {
+                --it;
+                treeSum += ((address < it->second.End) ? (it->second.Id + 1) : 0);
+            }
+        }
+        auto treeTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+
+        start = KeQueryPerformanceCounter(nullptr).QuadPart;
+        uint64_t scanSum = 0;
+        for (auto address : addresses)
+        {
+            for (const auto& modl : modules)
+            {
+                if ((address >= modl.Start) && (address < modl.End))
+                {
+                    scanSum += (modl.Id + 1);
+                    break;
+                }
+            }
+        }
+        auto scanTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+
+        UT_ASSERT(rangeSum == treeSum);
+        UT_ASSERT(rangeSum == scanSum);
+
+        DbgPrintEx(DPFLTR_IHVDRIVER_ID,
+                   DPFLTR_INFO_LEVEL,
+                   "stltest: %u addresses in %u modules interval_map %lld map %lld scan %lld\n",
+                   addressCount,
+                   moduleCount,
+                   rangeTime,
+                   treeTime,
+                   scanTime);
+    }
+}
+
+void IntervalMapTests()
+{
+    {
+        jxy::interval_map<uintptr_t, int, PagedPool, '0GAT'> map;
+
+        UT_ASSERT(map.empty());
+        UT_ASSERT(map.find(0) == map.end());
+
+        map.assign(0x1000, 0x2000, 1);
+        map.assign(0x3000, 0x4000, 2);
+        UT_ASSERT(map.assign(0x5000, 0x5000, 3) == map.end());
+        UT_ASSERT(map.size() == 2);
+
+        UT_ASSERT(map.find(0xfff) == map.end());
+        UT_ASSERT(map.find(0x1000)->second.second == 1);
+        UT_ASSERT(map.find(0x1fff)->second.second == 1);
+        UT_ASSERT(map.find(0x2000) == map.end());
+        UT_ASSERT(map.find(0x3800)->second.second == 2);
+        UT_ASSERT(!map.contains(0x4000));
+
+        //
+        // An image mapped over the end of one and the start of another
+        // trims both.
+        //
+        map.assign(0x1800, 0x3800, 3);
+        UT_ASSERT(map.size() == 3);
+        UT_ASSERT(map.find(0x17ff)->second.second == 1);
+        UT_ASSERT(map.find(0x1800)->second.second == 3);
+        UT_ASSERT(map.find(0x2800)->second.second == 3);
+        UT_ASSERT(map.find(0x3800)->second.second == 2);
+        UT_ASSERT(map.find(0x3800)->first == 0x3800);
+
+        //
+        // Mapped inside another splits it.
+        //
+        map.assign(0x2000, 0x2800, 4);
+        UT_ASSERT(map.size() == 5);
+        UT_ASSERT(map.find(0x1fff)->second.second == 3);
+        UT_ASSERT(map.find(0x2000)->second.second == 4);
+        UT_ASSERT(map.find(0x2800)->second.second == 3);
+
+        auto range = map.overlapping(0x1900, 0x3000);
+        UT_ASSERT((range.second - range.first) == 3);
+        UT_ASSERT(range.first->first == 0x1800);
+
+        //
+        // Covering ranges replaces them.
+        //
+        map.assign(0x1000, 0x4000, 5);
+        UT_ASSERT(map.size() == 1);
+        UT_ASSERT(map.begin()->first == 0x1000);
+        UT_ASSERT(map.begin()->second.first == 0x4000);
+
+        map.erase(0x2000, 0x3000);
+        UT_ASSERT(map.size() == 2);
+        UT_ASSERT(map.find(0x2000) == map.end());
+        UT_ASSERT(map.find(0x1fff)->second.second == 5);
+        UT_ASSERT(map.find(0x3000)->second.second == 5);
+
+        map.erase(map.find(0x3000));
+        UT_ASSERT(map.size() == 1);
+
+        map.clear();
+        UT_ASSERT(map.empty());
+    }
+
+    {
+        //
+        // Random assignments and erasures over a small key space checked
+        // against the latest value written to each key.
+        //
+        constexpr uint32_t keyCount = 256;
+        int expected[keyCount] = {};
+        jxy::interval_map<uint32_t, int, PagedPool, '0GAT'> map;
+
+        uint32_t seed = 1;
+        for (int i = 1; i <= 2000; i++)
+        {
+            seed = (seed * 1103515245) + 12345;
+            auto start = ((seed >> 8) % keyCount);
+            auto end = (start + ((seed >> 20) % 32));
+            end = ((end > keyCount) ? keyCount : end);
+
+            if ((seed & 0x7) == 0)
+            {
+                map.erase(start, end);
+                for (auto key = start; key < end; key++)
+                {
+                    expected[key] = 0;
+                }
+            }
+            else
+            {
+                map.assign(start, end, i);
+                for (auto key = start; key < end; key++)
+                {
+                    expected[key] = i;
+                }
+            }
+
+            for (uint32_t key = 0; key < keyCount; key++)
+            {
+                auto it = map.find(key);
+                UT_ASSERT((it == map.end()) ? (expected[key] == 0) : (expected[key] == it->second.second));
+            }
+        }
+
+        uint32_t previousEnd = 0;
+        for (const auto& entry : map)
+        {
+            UT_ASSERT(previousEnd <= entry.first);
+            UT_ASSERT(entry.first < entry.second.first);
+            previousEnd = entry.second.first;
+        }
+    }
+
+    IntervalMapBenchmark();
+}
+
+}
@@ -0,0 +1,174 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     stltest/intrusive_ptr_tests.cpp
+// Author:   Johnny Shaw
+//
+#include "tests_common.hpp"
+#include <jxy/intrusive_ptr.hpp>
+#include <jxy/locks.hpp>
+#include <jxy/map.hpp>
+
+namespace jxy::Tests
+{
+
+struct IntrusiveObject
+{
+    IntrusiveObject(int Value, int& Destroyed) : Value(Value), Destroyed(Destroyed)
+    {
+    }
+
+    ~IntrusiveObject()
+    {
+        Destroyed++;
+    }
+
+    int Value;
+    int& Destroyed;
+};
+
+struct alignas(64) IntrusiveAligned
+{
+    int Value = 0;
+};
+
+struct IntrusiveThrowing
+{
+    IntrusiveThrowing()
+    {
+        throw std::exception();
+    }
+};
+
+//
+// Mirrors the ProcessMap/ThreadMap lookup, a shared lock and copy out of the
+// context pointer, for shared_ptr and intrusive_ptr contexts. Only the counts
+// are asserted, the timings depend on the machine.
+//
+template <typename TPointer, typename TMake>
+static LONGLONG LookupAndReleaseBenchmark(TMake Make)
+{
+    constexpr uint32_t entries = 1024;
+    constexpr uint32_t iterations = 100000;
+
+    jxy::shared_mutex lock;
+    jxy::map<uint32_t, TPointer, PagedPool, '0GAT'> map;
+    for (uint32_t i = 0; i < entries; i++)
+    {
+        map.emplace(i, Make(i));
+    }
+
+    uint64_t found = 0;
+    auto start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        TPointer ptr;
+        {
+            jxy::shared_lock<jxy::shared_mutex> guard(lock);
+            auto it = map.find(i % entries);
+            if (it != map.end())
+            {
+                ptr = it->second;
+            }
+        }
+        if (ptr != nullptr)
+        {
+            found += (ptr->Value == static_cast<int>(i % entries));
+        }
+    }
+    auto elapsed = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+
+    UT_ASSERT(found == iterations);
+    return elapsed;
+}
+
+void IntrusivePtrTests()
+{
+    UT_ASSERT(sizeof(jxy::intrusive_ptr<IntrusiveObject>) == sizeof(void*));
+    UT_ASSERT(sizeof(jxy::intrusive_weak_ptr<IntrusiveObject>) == sizeof(void*));
+
+    {
+        int destroyed = 0;
+        {
+            auto ptr = jxy::make_intrusive<IntrusiveObject, PagedPool, '0GAT'>(1, destroyed);
+            UT_ASSERT(ptr != nullptr);
+            UT_ASSERT(ptr->Value == 1);
+            UT_ASSERT(ptr.use_count() == 1);
+
+            auto copy = ptr;
+            UT_ASSERT(copy == ptr);
+            UT_ASSERT(ptr.use_count() == 2);
+
+            auto moved = std::move(copy);
+            UT_ASSERT(copy == nullptr);
+            UT_ASSERT(moved.get() == ptr.get());
+            UT_ASSERT(ptr.use_count() == 2);
+
+            moved.reset();
+            UT_ASSERT(ptr.use_count() == 1);
+            UT_ASSERT(destroyed == 0);
+        }
+        UT_ASSERT(destroyed == 1);
+    }
+    {
+        //
+        // Weak references keep the memory but not the object.
+        //
+        int destroyed = 0;
+        jxy::intrusive_weak_ptr<IntrusiveObject> weak;
+        {
+            auto ptr = jxy::make_intrusive<IntrusiveObject, NonPagedPoolNx, '0GAT'>(2, destroyed);
+            weak = ptr;
+            UT_ASSERT(!weak.expired());
+
+            auto locked = weak.lock();
+            UT_ASSERT(locked == ptr);
+            UT_ASSERT(ptr.use_count() == 2);
+        }
+        UT_ASSERT(destroyed == 1);
+        UT_ASSERT(weak.expired());
+        UT_ASSERT(weak.lock() == nullptr);
+        weak.reset();
+    }
+    {
+        auto ptr = jxy::make_intrusive<IntrusiveAligned, NonPagedPoolNx, '0GAT'>();
+        UT_ASSERT((reinterpret_cast<uintptr_t>(ptr.get()) % 64) == 0);
+
+        bool caught = false;
+        try
+        {
+            auto ptr2 = jxy::make_intrusive<IntrusiveThrowing, PagedPool, '0GAT'>();
+        }
+        catch (const std::exception&)
+        {
+            caught = true;
+        }
+        UT_ASSERT(caught);
+    }
+    {
+        struct Context
+        {
+            int Value;
+        };
+
+        auto sharedTime = LookupAndReleaseBenchmark<jxy::shared_ptr<Context, PagedPool, '0GAT'>>(
+            [](uint32_t Value)
+            {
+                return jxy::make_shared<Context, PagedPool, '0GAT'>(Context{ static_cast<int>(Value) });
+            });
+
+        auto intrusiveTime = LookupAndReleaseBenchmark<jxy::intrusive_ptr<Context>>(
+            [](uint32_t Value)
+            {
+                return jxy::make_intrusive<Context, PagedPool, '0GAT'>(Context{ static_cast<int>(Value) });
+            });
+
+        DbgPrintEx(DPFLTR_IHVDRIVER_ID,
+                   DPFLTR_INFO_LEVEL,
+                   "stltest: lookup and release shared_ptr %lld intrusive_ptr %lld\n",
+                   sharedTime,
+                   intrusiveTime);
+    }
+}
+
+}
@@ -0,0 +1,228 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     stltest/large_buffer_tests.cpp
+// Author:   Johnny Shaw
+//
+#include "tests_common.hpp"
+#include <jxy/large_buffer.hpp>
+#include <jxy/vector.hpp>
+#include <jxy/trim.hpp>
+
+namespace jxy::Tests
+{
+
+//
+// Stands in for a system information query which needs Required bytes.
+//
+static NTSTATUS FakeQuery(
+    void* Buffer,
+    ULONG Length,
+    PULONG ReturnLength,
+    ULONG Required,
+    bool ReportLength)
+{
+    if (Length < Required)
+    {
+        *ReturnLength = (ReportLength ? Required : 0);
+        return STATUS_INFO_LENGTH_MISMATCH;
+    }
+
+    RtlFillMemory(Buffer, Required, 0x5a);
+    *ReturnLength = Required;
+    return STATUS_SUCCESS;
+}
+
+//
+// Repeats an enumeration sized buffer fill with a zero filled vector, as
+// Populate used to, and with a reused large buffer. Only the contents are
+// asserted, the timings depend on the machine.
+//
+static void EnumerationBenchmark()
+{
+    constexpr ULONG required = (4 * 1024 * 1024);
+    constexpr size_t iterations = 32;
+
+    auto start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        jxy::vector<uint8_t, PagedPool, '0GAT'> info;
+        info.assign(required, 0);
+        ULONG returnLength = 0;
+        UT_ASSERT(NT_SUCCESS(FakeQuery(info.data(), required, &returnLength, required, true)));
+        UT_ASSERT(info[required - 1] == 0x5a);
+    }
+    auto vectorTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+
+    start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        jxy::large_buffer<PagedPool, '0GAT'> info;
+        auto status = info.query(
+            [](void* Buffer, ULONG Length, PULONG ReturnLength)
+            {
+                return FakeQuery(Buffer, Length, ReturnLength, required, true);
+            });
+        UT_ASSERT(NT_SUCCESS(status));
+        UT_ASSERT(info.as<uint8_t>()[required - 1] == 0x5a);
+    }
+    auto largeBufferTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+
+    jxy::flush_large_buffer_cache();
+
+    DbgPrintEx(DPFLTR_IHVDRIVER_ID,
+               DPFLTR_INFO_LEVEL,
+               "stltest: %lu byte enumeration x %zu vector %lld large_buffer %lld\n",
+               required,
+               iterations,
+               vectorTime,
+               largeBufferTime);
+}
+
+void LargeBufferTests()
+{
+    jxy::flush_large_buffer_cache();
+
+    {
+        jxy::large_buffer<PagedPool, '0GAT'> buffer;
+        UT_ASSERT(buffer.data() == nullptr);
+        UT_ASSERT(buffer.empty());
+        UT_ASSERT(buffer.capacity() == 0);
+    }
+
+    {
+        jxy::paged_large_buffer<'0GAT'> buffer((3 * PAGE_SIZE) + 1);
+        UT_ASSERT(buffer.data() != nullptr);
+        UT_ASSERT(buffer.size() == ((3 * PAGE_SIZE) + 1));
+        UT_ASSERT(buffer.capacity() == (4 * PAGE_SIZE));
+
+        //
+        // Within the capacity nothing is reallocated.
+        //
+        auto memory = buffer.data();
+        buffer.resize_discard(4 * PAGE_SIZE);
+        UT_ASSERT(buffer.data() == memory);
+        UT_ASSERT(buffer.size() == (4 * PAGE_SIZE));
+
+        jxy::paged_large_buffer<'0GAT'> moved(std::move(buffer));
+        UT_ASSERT(buffer.data() == nullptr);
+        UT_ASSERT(moved.data() == memory);
+    }
+
+    {
+        //
+        // A freed buffer is reused for a similar request with the same pool
+        // type and tag only.
+        //
+        jxy::flush_large_buffer_cache();
+
+        void* memory;
+        {
+            jxy::large_buffer<PagedPool, '0GAT'> buffer(8 * PAGE_SIZE);
+            memory = buffer.data();
+        }
+        UT_ASSERT(jxy::query_large_buffer_cache_stats().cached_bytes == (8 * PAGE_SIZE));
+
+        {
+            jxy::large_buffer<PagedPool, '1GAT'> buffer(8 * PAGE_SIZE);
+            UT_ASSERT(buffer.data() != memory);
+        }
+        {
+            jxy::large_buffer<NonPagedPoolNx, '0GAT'> buffer(8 * PAGE_SIZE);
+            UT_ASSERT(buffer.data() != memory);
+        }
+        {
+            //
+            // Much smaller requests don't take the large buffer.
+            //
+            jxy::large_buffer<PagedPool, '0GAT'> buffer(PAGE_SIZE);
+            UT_ASSERT(buffer.data() != memory);
+        }
+
+        auto stats = jxy::query_large_buffer_cache_stats();
+        {
+            jxy::large_buffer<PagedPool, '0GAT'> buffer((6 * PAGE_SIZE) + 100);
+            UT_ASSERT(buffer.data() == memory);
+            UT_ASSERT(buffer.capacity() == (8 * PAGE_SIZE));
+        }
+        UT_ASSERT(jxy::query_large_buffer_cache_stats().hits == (stats.hits + 1));
+
+        UT_ASSERT(jxy::flush_large_buffer_cache() > 0);
+        UT_ASSERT(jxy::query_large_buffer_cache_stats().cached_bytes == 0);
+        UT_ASSERT(jxy::flush_large_buffer_cache() == 0);
+    }
+
+    {
+        //
+        // More buffers than cache entries.
+        //
+        jxy::vector<jxy::large_buffer<PagedPool, '0GAT'>, PagedPool, '0GAT'> buffers;
+        for (size_t i = 0; i < (jxy::large_buffer_cache_entries * 2); i++)
+        {
+            buffers.emplace_back(PAGE_SIZE * (i + 1));
+        }
+        buffers.clear();
+
+        auto stats = jxy::query_large_buffer_cache_stats();
+        UT_ASSERT(stats.cached_bytes > 0);
+        UT_ASSERT(jxy::trim_caches() >= stats.cached_bytes);
+        UT_ASSERT(jxy::query_large_buffer_cache_stats().cached_bytes == 0);
+    }
+
+    {
+        //
+        // The query grows to the returned length.
+        //
+        jxy::large_buffer<PagedPool, '0GAT'> buffer;
+        ULONG calls = 0;
+        auto status = buffer.query(
+            [&calls](void* Buffer, ULONG Length, PULONG ReturnLength)
+            {
+                calls++;
+                return FakeQuery(Buffer, Length, ReturnLength, 100000, true);
+            });
+        UT_ASSERT(NT_SUCCESS(status));
+        UT_ASSERT(calls == 2);
+        UT_ASSERT(buffer.size() == 100000);
+        UT_ASSERT(buffer.capacity() >= 100000);
+        UT_ASSERT(buffer.as<uint8_t>()[99999] == 0x5a);
+    }
+
+    {
+        //
+        // Without a returned length the query grows geometrically.
+        //
+        jxy::flush_large_buffer_cache();
+
+        jxy::large_buffer<PagedPool, '0GAT'> buffer;
+        ULONG calls = 0;
+        auto status = buffer.query(
+            [&calls](void* Buffer, ULONG Length, PULONG ReturnLength)
+            {
+                calls++;
+                return FakeQuery(Buffer, Length, ReturnLength, (64 * PAGE_SIZE), false);
+            });
+        UT_ASSERT(NT_SUCCESS(status));
+        UT_ASSERT(calls == 7);
+        UT_ASSERT(buffer.capacity() == (64 * PAGE_SIZE));
+    }
+
+    {
+        //
+        // Other failures are returned as is.
+        //
+        jxy::large_buffer<PagedPool, '0GAT'> buffer;
+        auto status = buffer.query(
+            [](void*, ULONG, PULONG)
+            {
+                return STATUS_INVALID_PARAMETER;
+            });
+        UT_ASSERT(status == STATUS_INVALID_PARAMETER);
+    }
+
+    jxy::flush_large_buffer_cache();
+
+    EnumerationBenchmark();
+}
+
+}
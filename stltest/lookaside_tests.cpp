@@ -0,0 +1,154 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     stltest/lookaside_tests.cpp
+// Author:   Johnny Shaw
+//
+#include "tests_common.hpp"
+#include <jxy/lookaside.hpp>
+#include <jxy/map.hpp>
+#include <jxy/set.hpp>
+#include <jxy/list.hpp>
+
+namespace jxy::Tests
+{
+
+//
+// Tracks and untracks IDs against a resident map, as the process and thread
+// maps do for every create and exit, so each iteration allocates and frees
+// one node. Only the contents are asserted, the timings depend on the
+// machine.
+//
+template <typename TAllocator>
+static LONGLONG NodeChurnShape()
+{
+    constexpr uint32_t resident = 1024;
+    constexpr uint32_t iterations = 200000;
+
+    jxy::map<uint32_t, uint64_t, PagedPool, '0GAT', std::less<uint32_t>, TAllocator> map;
+    for (uint32_t i = 0; i < resident; i++)
+    {
+        map.emplace((i * 4), i);
+    }
+
+    auto start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        auto own = ((resident + (i % resident)) * 4);
+        UT_ASSERT(map.emplace(own, i).second);
+        UT_ASSERT(map.erase(own) == 1);
+    }
+    auto elapsed = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+
+    UT_ASSERT(map.size() == resident);
+    return elapsed;
+}
+
+static void LookasideBenchmark()
+{
+    using value_type = std::pair<const uint32_t, uint64_t>;
+
+    auto poolTime = NodeChurnShape<jxy::allocator<value_type, PagedPool, '0GAT'>>();
+    auto lookasideTime = NodeChurnShape<jxy::lookaside_allocator<value_type, PagedPool, '0GAT'>>();
+
+    DbgPrintEx(DPFLTR_IHVDRIVER_ID,
+               DPFLTR_INFO_LEVEL,
+               "stltest: map node churn allocator %lld lookaside_allocator %lld\n",
+               poolTime,
+               lookasideTime);
+}
+
+void LookasideTests()
+{
+    {
+        using alloc_type = jxy::lookaside_allocator<int, PagedPool, '0GAT', 4>;
+        alloc_type alloc;
+
+        UT_ASSERT(alloc.pool_tag == '0GAT');
+        UT_ASSERT(alloc.pool_type == PagedPool);
+        UT_ASSERT(alloc.depth == 4);
+        UT_ASSERT(alloc_type::list().depth() == 4);
+        UT_ASSERT(alloc_type::list().block_size() >= sizeof(int));
+
+        //
+        // Single object allocations recycle through the list.
+        //
+        auto mem = alloc.allocate(1);
+        alloc.deallocate(mem, 1);
+        UT_ASSERT(alloc_type::list().cached() == 1);
+        auto mem2 = alloc.allocate(1);
+        UT_ASSERT(mem == mem2);
+        UT_ASSERT(alloc_type::list().cached() == 0);
+        alloc.deallocate(mem2, 1);
+
+        //
+        // Arrays go to the pool and never touch the list.
+        //
+        auto allocs = alloc_type::list().total_allocates();
+        auto arr = alloc.allocate(10);
+        alloc.deallocate(arr, 10);
+        UT_ASSERT(alloc_type::list().total_allocates() == allocs);
+        UT_ASSERT(alloc_type::list().cached() == 1);
+
+        //
+        // The list doesn't grow beyond its depth.
+        //
+        int* mems[8];
+        for (auto& m : mems)
+        {
+            m = alloc.allocate(1);
+        }
+        for (auto& m : mems)
+        {
+            alloc.deallocate(m, 1);
+        }
+        UT_ASSERT(alloc_type::list().cached() == 4);
+        UT_ASSERT(alloc_type::list().free_misses() == 4);
+
+        UT_ASSERT(jxy::flush_lookaside_caches() >= (4 * sizeof(int)));
+        UT_ASSERT(alloc_type::list().cached() == 0);
+    }
+    {
+        using alloc_type = jxy::lookaside_allocator<std::pair<const int, int>, PagedPool, '0GAT'>;
+        jxy::map<int, int, PagedPool, '0GAT', std::less<int>, alloc_type> map;
+
+        for (int i = 0; i < 100; i++)
+        {
+            map.emplace(i, i);
+        }
+        UT_ASSERT(map.size() == 100);
+        UT_ASSERT(map.get_allocator().pool_tag == '0GAT');
+
+        map.clear();
+        for (int i = 0; i < 100; i++)
+        {
+            map.emplace(i, i);
+        }
+        UT_ASSERT(map.size() == 100);
+        UT_ASSERT(map[50] == 50);
+    }
+    {
+        jxy::set<int,
+                 NonPagedPoolNx,
+                 '0GAT',
+                 std::less<int>,
+                 jxy::non_paged_lookaside_allocator<int, '0GAT'>> set{ 1, 2, 3 };
+        UT_ASSERT(set.size() == 3);
+        set.erase(2);
+        set.insert(4);
+        UT_ASSERT(set.count(4) == 1);
+    }
+    {
+        jxy::list<int, PagedPool, '0GAT', jxy::paged_lookaside_allocator<int, '0GAT'>> list;
+        list.push_back(1);
+        list.push_back(2);
+        list.pop_front();
+        UT_ASSERT(list.front() == 2);
+    }
+
+    LookasideBenchmark();
+
+    jxy::flush_lookaside_caches();
+}
+
+}
@@ -0,0 +1,242 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     stltest/magazine_tests.cpp
+// Author:   Johnny Shaw
+//
+#include "tests_common.hpp"
+#include <jxy/magazine.hpp>
+#include <jxy/memory.hpp>
+#include <jxy/vector.hpp>
+#include <jxy/thread.hpp>
+
+namespace jxy::Tests
+{
+
+//
+// Each thread allocates a handful of small blocks of different size classes
+// and frees them again, as short lived container nodes and strings do. Only
+// the contents are asserted, the timings depend on the machine.
+//
+static LONGLONG AllocateFreeShape(uint32_t ThreadCount)
+{
+    constexpr uint32_t iterations = 10000;
+    constexpr size_t blockCount = 6;
+
+    volatile LONG failures = 0;
+    jxy::vector<jxy::thread, PagedPool, '0GAT'> threads;
+    threads.reserve(ThreadCount);
+
+    auto start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    for (uint32_t t = 0; t < ThreadCount; t++)
+    {
+        threads.emplace_back([&failures]()
+                             {
+                                 void* blocks[blockCount];
+                                 for (uint32_t i = 0; i < iterations; i++)
+                                 {
+                                     for (size_t j = 0; j < blockCount; j++)
+                                     {
+                                         blocks[j] = ::operator new((16 + (j * 48)), NonPagedPoolNx, '4GAT');
+                                         *static_cast<uint32_t*>(blocks[j]) = i;
+                                     }
+                                     for (size_t j = 0; j < blockCount; j++)
+                                     {
+                                         if (*static_cast<uint32_t*>(blocks[j]) != i)
+                                         {
+                                             InterlockedIncrement(&failures);
+                                         }
+                                         ::operator delete(blocks[j], (16 + (j * 48)), NonPagedPoolNx, '4GAT');
+                                     }
+                                 }
+                             });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    auto elapsed = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+
+    UT_ASSERT(failures == 0);
+    return elapsed;
+}
+
+//
+// Threads beyond the active processor count only interleave, the scaling
+// of a run is only meaningful up to the processor count printed with it.
+//
+static void MagazineBenchmark()
+{
+    auto processors = KeQueryActiveProcessorCountEx(ALL_PROCESSOR_GROUPS);
+
+    for (uint32_t threadCount : { 1u, 2u, 4u, 8u, 16u, 32u, 64u })
+    {
+        auto poolTime = AllocateFreeShape(threadCount);
+
+        UT_ASSERT(NT_SUCCESS(jxy::initialize_magazine_cache()));
+        auto cacheTime = AllocateFreeShape(threadCount);
+        auto stats = jxy::query_magazine_cache_stats();
+        jxy::uninitialize_magazine_cache();
+
+        DbgPrintEx(DPFLTR_IHVDRIVER_ID,
+                   DPFLTR_INFO_LEVEL,
+                   "stltest: %u threads on %u processors alloc/free pool %lld magazine %lld (hits %llu misses %llu)\n",
+                   threadCount,
+                   processors,
+                   poolTime,
+                   cacheTime,
+                   stats.hits,
+                   stats.misses);
+    }
+}
+
+void MagazineTests()
+{
+    {
+        //
+        // Disabled, nothing is counted.
+        //
+        auto ptr = jxy::make_unique<int, PagedPool, '0GAT'>(1);
+        ptr.reset();
+        auto stats = jxy::query_magazine_cache_stats();
+        UT_ASSERT(stats.hits == 0);
+        UT_ASSERT(stats.misses == 0);
+        UT_ASSERT(jxy::flush_magazine_cache() == 0);
+        UT_ASSERT(jxy::details::magazine_round_size(260) == 260);
+    }
+
+    //
+    // Allocated before the cache is enabled, so not rounded up to its class.
+    //
+    auto early = ::operator new(260, NonPagedPoolNx, '2GAT');
+
+    UT_ASSERT(NT_SUCCESS(jxy::initialize_magazine_cache()));
+
+    {
+        //
+        // Only blocks the pool reports as large enough for the class are
+        // cached.
+        //
+        UT_ASSERT(jxy::details::magazine_round_size(260) == 320);
+        jxy::flush_magazine_cache();
+
+        BOOLEAN quotaCharged;
+        auto cacheable = (ExQueryPoolBlockSize(early, &quotaCharged) >= 320);
+        ::operator delete(early, 260, NonPagedPoolNx, '2GAT');
+        UT_ASSERT(jxy::flush_magazine_cache() == (cacheable ? 320 : 0));
+
+        auto mem = ::operator new(260, NonPagedPoolNx, '2GAT');
+        UT_ASSERT(ExQueryPoolBlockSize(mem, &quotaCharged) >= 320);
+        ::operator delete(mem, 260, NonPagedPoolNx, '2GAT');
+        UT_ASSERT(jxy::flush_magazine_cache() == 320);
+    }
+
+    {
+        //
+        // Raise to dispatch so we stay on this CPU, the cached block is
+        // handed back out for the same pool type, tag, and size.
+        //
+        KIRQL oldIrql;
+        KeRaiseIrql(DISPATCH_LEVEL, &oldIrql);
+
+        auto ptr = jxy::make_unique<uint64_t, NonPagedPoolNx, '0GAT'>(1);
+        auto mem = ptr.get();
+        ptr.reset();
+
+        auto stats = jxy::query_magazine_cache_stats();
+
+        auto ptr2 = jxy::make_unique<uint64_t, NonPagedPoolNx, '0GAT'>(2);
+        UT_ASSERT(ptr2.get() == mem);
+        UT_ASSERT(*ptr2 == 2);
+
+        //
+        // Different tag never receives the cached block.
+        //
+        ptr2.reset();
+        auto ptr3 = jxy::make_unique<uint64_t, NonPagedPoolNx, '1GAT'>(3);
+        UT_ASSERT(ptr3.get() != mem);
+        ptr3.reset();
+
+        KeLowerIrql(oldIrql);
+
+        auto stats2 = jxy::query_magazine_cache_stats();
+        UT_ASSERT(stats2.hits == (stats.hits + 1));
+        UT_ASSERT(stats2.misses == (stats.misses + 1));
+    }
+    {
+        //
+        // Overflow the magazines to force flushes to the pool. The frees
+        // must all land on one CPU's magazines.
+        //
+        jxy::unique_ptr<uint32_t, NonPagedPoolNx, '0GAT'> ptrs[64];
+
+        KIRQL oldIrql;
+        KeRaiseIrql(DISPATCH_LEVEL, &oldIrql);
+
+        for (auto& ptr : ptrs)
+        {
+            ptr = jxy::make_unique<uint32_t, NonPagedPoolNx, '0GAT'>(1);
+        }
+
+        auto stats = jxy::query_magazine_cache_stats();
+        for (auto& ptr : ptrs)
+        {
+            ptr.reset();
+        }
+        auto flushes = jxy::query_magazine_cache_stats().flushes;
+
+        KeLowerIrql(oldIrql);
+
+        UT_ASSERT(flushes > stats.flushes);
+    }
+    {
+        //
+        // A derived object freed through its base isn't cached under the
+        // size class of the base.
+        //
+        struct base
+        {
+            virtual ~base() = default;
+            uint64_t value = 0;
+        };
+        struct derived : base
+        {
+            uint64_t more[8] = {};
+        };
+
+        KIRQL oldIrql;
+        KeRaiseIrql(DISPATCH_LEVEL, &oldIrql);
+
+        jxy::unique_ptr<base, NonPagedPoolNx, '0GAT'> ptr = jxy::make_unique<derived, NonPagedPoolNx, '0GAT'>();
+        auto mem = ptr.get();
+        ptr.reset();
+
+        auto ptr2 = jxy::make_unique<base, NonPagedPoolNx, '0GAT'>();
+        UT_ASSERT(ptr2.get() != mem);
+        ptr2.reset();
+
+        KeLowerIrql(oldIrql);
+    }
+    {
+        //
+        // Larger than the biggest size class goes straight to the pool.
+        //
+        struct big
+        {
+            char data[4096];
+        };
+        auto stats = jxy::query_magazine_cache_stats();
+        auto ptr = jxy::make_unique<big, PagedPool, '0GAT'>();
+        ptr.reset();
+        UT_ASSERT(jxy::query_magazine_cache_stats().misses == stats.misses);
+    }
+
+    UT_ASSERT(jxy::flush_magazine_cache() > 0);
+    UT_ASSERT(jxy::flush_magazine_cache() == 0);
+
+    jxy::uninitialize_magazine_cache();
+
+    MagazineBenchmark();
+}
+
+}
@@ -0,0 +1,102 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     stltest/memory_resource_tests.cpp
+// Author:   Johnny Shaw
+//
+#include "tests_common.hpp"
+#include <jxy/memory_resource.hpp>
+#include <jxy/vector.hpp>
+#include <jxy/string.hpp>
+#include <jxy/map.hpp>
+
+namespace jxy::Tests
+{
+
+void MemoryResourceTests()
+{
+    {
+        jxy::pmr::tagged_resource resource(PagedPool, '0GAT');
+        UT_ASSERT(resource.pool_type() == PagedPool);
+        UT_ASSERT(resource.pool_tag() == '0GAT');
+
+        auto mem = resource.allocate(10);
+        UT_ASSERT(mem != nullptr);
+        resource.deallocate(mem, 10);
+
+        auto aligned = resource.allocate(10, 256);
+        UT_ASSERT((reinterpret_cast<uintptr_t>(aligned) % 256) == 0);
+        RtlFillMemory(aligned, 10, 0xaa);
+        resource.deallocate(aligned, 10, 256);
+
+        //
+        // Only the same resource is equal, even for the same pool type and
+        // tag.
+        //
+        jxy::pmr::tagged_resource same(PagedPool, '0GAT');
+        jxy::pmr::tagged_resource otherTag(PagedPool, '1GAT');
+        UT_ASSERT(resource == resource);
+        UT_ASSERT(resource != same);
+        UT_ASSERT(resource != otherTag);
+    }
+    {
+        //
+        // Containers of the same element type are the same type regardless
+        // of the resource behind them.
+        //
+        jxy::pmr::tagged_resource tagged(PagedPool, '0GAT');
+        jxy::pmr::unsynchronized_pool_resource pool(PagedPool, '1GAT');
+        UT_ASSERT(pool.pool_tag() == '1GAT');
+
+        jxy::pmr::vector<int> vec1(&tagged);
+        jxy::pmr::vector<int> vec2(&pool);
+        for (int i = 0; i < 100; i++)
+        {
+            vec1.push_back(i);
+            vec2.push_back(i * 2);
+        }
+        UT_ASSERT(vec1.size() == 100);
+        UT_ASSERT(vec2[99] == 198);
+        UT_ASSERT(vec1.get_allocator().resource() == &tagged);
+        UT_ASSERT(vec2.get_allocator().resource() == &pool);
+
+        vec1 = vec2;
+        UT_ASSERT(vec1[99] == 198);
+        UT_ASSERT(vec1.get_allocator().resource() == &tagged);
+    }
+    {
+        jxy::pmr::synchronized_pool_resource pool(NonPagedPoolNx, '0GAT');
+        UT_ASSERT(pool.pool_type() == NonPagedPoolNx);
+        UT_ASSERT(pool.pool_tag() == '0GAT');
+
+        jxy::pmr::map<int, jxy::pmr::wstring> map(&pool);
+        for (int i = 0; i < 100; i++)
+        {
+            map.emplace(i, L"This string is long enough to not fit in the small buffer");
+        }
+        UT_ASSERT(map.size() == 100);
+        UT_ASSERT(map[50].get_allocator().resource() == &pool);
+        map.clear();
+        pool.release();
+    }
+    {
+        uint8_t buffer[128];
+        jxy::pmr::monotonic_buffer_resource monotonic(PagedPool, '0GAT', buffer, sizeof(buffer));
+        UT_ASSERT(monotonic.pool_tag() == '0GAT');
+
+        auto mem = static_cast<uint8_t*>(monotonic.allocate(16));
+        UT_ASSERT((mem >= buffer) && (mem < (buffer + sizeof(buffer))));
+
+        //
+        // Exhausting the initial buffer goes upstream to the pool.
+        //
+        jxy::pmr::wstring str(&monotonic);
+        str.assign(1000, L'a');
+        UT_ASSERT(str.size() == 1000);
+        auto upstream = static_cast<jxy::pmr::tagged_resource*>(monotonic.upstream_resource());
+        UT_ASSERT(upstream->pool_type() == PagedPool);
+        UT_ASSERT(upstream->pool_tag() == '0GAT');
+    }
+}
+
+}
@@ -6,10 +6,80 @@
 //
 #include "tests_common.hpp"
 #include <jxy/memory.hpp>
+#include <jxy/vector.hpp>
 
 namespace jxy::Tests
 {
 
+struct DefaultInitCounted
+{
+    static inline int Constructed = 0;
+
+    DefaultInitCounted()
+    {
+        Constructed++;
+    }
+
+    int Value = 5;
+};
+
+//
+// Stands in for a query which overwrites the whole buffer.
+//
+static void FillQueryBuffer(uint8_t* Buffer, size_t Length)
+{
+    RtlFillMemory(Buffer, Length, 0x5a);
+}
+
+//
+// Sizes a multi-megabyte query buffer value-initialized, as a jxy::vector
+// does by default, and default-initialized. Only the contents are asserted,
+// the timings depend on the machine.
+//
+static void ForOverwriteBenchmark()
+{
+    constexpr size_t length = (8 * 1024 * 1024);
+    constexpr size_t iterations = 16;
+
+    auto start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        jxy::vector<uint8_t, PagedPool, '0GAT'> buffer;
+        buffer.resize(length);
+        FillQueryBuffer(buffer.data(), buffer.size());
+        UT_ASSERT(buffer[length - 1] == 0x5a);
+    }
+    auto valueInitTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+
+    start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        jxy::vector<uint8_t, PagedPool, '0GAT', jxy::default_init_allocator<uint8_t, PagedPool, '0GAT'>> buffer;
+        buffer.resize(length);
+        FillQueryBuffer(buffer.data(), buffer.size());
+        UT_ASSERT(buffer[length - 1] == 0x5a);
+    }
+    auto defaultInitTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+
+    start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        auto buffer = jxy::make_unique_for_overwrite<uint8_t[], PagedPool, '0GAT'>(length);
+        FillQueryBuffer(buffer.get(), length);
+        UT_ASSERT(buffer[length - 1] == 0x5a);
+    }
+    auto forOverwriteTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+
+    DbgPrintEx(DPFLTR_IHVDRIVER_ID,
+               DPFLTR_INFO_LEVEL,
+               "stltest: %zu byte buffer x %zu value-init %lld default-init %lld for_overwrite %lld\n",
+               length,
+               iterations,
+               valueInitTime,
+               defaultInitTime,
+               forOverwriteTime);
+}
+
 void MemoryTests()
 {
     {
@@ -70,6 +140,74 @@ void MemoryTests()
         auto ptr = jxy::make_shared<int, NonPagedPoolNx, '0GAT'>(1);
         UT_ASSERT(*ptr == 1);
     }
+    {
+        auto ptr = jxy::make_unique<uint32_t[], PagedPool, '0GAT'>(100);
+        for (size_t i = 0; i < 100; i++)
+        {
+            UT_ASSERT(ptr[i] == 0);
+        }
+        UT_ASSERT(ptr.get_deleter().pool_tag == '0GAT');
+    }
+    {
+        auto ptr = jxy::make_unique_for_overwrite<uint32_t[], NonPagedPoolNx, '0GAT'>(100);
+        for (uint32_t i = 0; i < 100; i++)
+        {
+            ptr[i] = i;
+        }
+        UT_ASSERT(ptr[99] == 99);
+        UT_ASSERT(ptr.get_deleter().pool_type == NonPagedPoolNx);
+    }
+    {
+        auto ptr = jxy::make_unique_for_overwrite<cache_aligned<uint64_t>[], PagedPool, '0GAT'>(4);
+        UT_ASSERT((reinterpret_cast<ULONG_PTR>(ptr.get()) % SYSTEM_CACHE_ALIGNMENT_SIZE) == 0);
+    }
+    {
+        auto ptr = jxy::make_unique_for_overwrite<uint64_t, PagedPool, '0GAT'>();
+        *ptr = 1;
+        UT_ASSERT(*ptr == 1);
+    }
+    {
+        //
+        // Default-initialization still runs constructors.
+        //
+        DefaultInitCounted::Constructed = 0;
+        auto unique = jxy::make_unique_for_overwrite<DefaultInitCounted, PagedPool, '0GAT'>();
+        auto shared = jxy::make_shared_for_overwrite<DefaultInitCounted, PagedPool, '0GAT'>();
+        UT_ASSERT(DefaultInitCounted::Constructed == 2);
+        UT_ASSERT(unique->Value == 5);
+        UT_ASSERT(shared->Value == 5);
+    }
+    {
+        auto ptr = jxy::make_shared_for_overwrite<uint64_t, NonPagedPoolNx, '0GAT'>();
+        *ptr = 1;
+        UT_ASSERT(*ptr == 1);
+    }
+    {
+        jxy::vector<int, PagedPool, '0GAT', jxy::default_init_allocator<int, PagedPool, '0GAT'>> vec;
+        vec.resize(10);
+        UT_ASSERT(vec.size() == 10);
+
+        //
+        // Construction with a value is passed through.
+        //
+        vec.resize(20, 7);
+        UT_ASSERT(vec[19] == 7);
+        vec.push_back(8);
+        vec.emplace_back(9);
+        UT_ASSERT(vec.size() == 22);
+        UT_ASSERT(vec[21] == 9);
+        UT_ASSERT(vec.get_allocator().pool_tag == '0GAT');
+
+        DefaultInitCounted::Constructed = 0;
+        jxy::vector<DefaultInitCounted,
+                    PagedPool,
+                    '0GAT',
+                    jxy::default_init_allocator<DefaultInitCounted, PagedPool, '0GAT'>> counted(3);
+        UT_ASSERT(DefaultInitCounted::Constructed == 3);
+        UT_ASSERT(counted[2].Value == 5);
+    }
+
+    ForOverwriteBenchmark();
 }
 
 }
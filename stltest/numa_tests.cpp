@@ -0,0 +1,132 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     stltest/numa_tests.cpp
+// Author:   Johnny Shaw
+//
+#include "tests_common.hpp"
+#include <jxy/numa.hpp>
+#include <jxy/vector.hpp>
+#include <jxy/map.hpp>
+
+namespace jxy::Tests
+{
+
+//
+// Scans a buffer placed on the current node and one placed on another node
+// (the same node on single node systems) from this processor. Only the sums
+// are asserted, the timings depend on the topology.
+//
+static void NumaPlacementBenchmark()
+{
+    constexpr size_t count = (1024 * 1024 / sizeof(uint64_t));
+
+    KIRQL oldIrql;
+    KeRaiseIrql(DISPATCH_LEVEL, &oldIrql);
+
+    auto local = KeGetCurrentNodeNumber();
+    auto remote = static_cast<USHORT>((local + 1) % (KeQueryHighestNodeNumber() + 1));
+
+    KeLowerIrql(oldIrql);
+
+    jxy::vector<uint64_t, NonPagedPoolNx, '0GAT', jxy::numa_allocator<uint64_t, NonPagedPoolNx, '0GAT'>>
+        localBuffer(count, 1, jxy::numa_allocator<uint64_t, NonPagedPoolNx, '0GAT'>(local));
+    jxy::vector<uint64_t, NonPagedPoolNx, '0GAT', jxy::numa_allocator<uint64_t, NonPagedPoolNx, '0GAT'>>
+        remoteBuffer(count, 1, jxy::numa_allocator<uint64_t, NonPagedPoolNx, '0GAT'>(remote));
+
+    auto scan = [](const uint64_t* Buffer) -> uint64_t
+    {
+        uint64_t sum = 0;
+        for (size_t pass = 0; pass < 8; pass++)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                sum += Buffer[i];
+            }
+        }
+        return sum;
+    };
+
+    KeRaiseIrql(DISPATCH_LEVEL, &oldIrql);
+
+    auto start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    auto localSum = scan(localBuffer.data());
+    auto localTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+
+    start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    auto remoteSum = scan(remoteBuffer.data());
+    auto remoteTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+
+    KeLowerIrql(oldIrql);
+
+    UT_ASSERT(localSum == (count * 8));
+    UT_ASSERT(remoteSum == (count * 8));
+
+    DbgPrintEx(DPFLTR_IHVDRIVER_ID,
+               DPFLTR_INFO_LEVEL,
+               "stltest: numa node %u local %lld node %u remote %lld\n",
+               local,
+               localTime,
+               remote,
+               remoteTime);
+}
+
+void NumaTests()
+{
+    {
+        jxy::numa_allocator<int, PagedPool, '0GAT'> alloc;
+        UT_ASSERT(alloc.pool_tag == '0GAT');
+        UT_ASSERT(alloc.pool_type == PagedPool);
+        UT_ASSERT(alloc.node() == jxy::numa_current_node);
+
+        auto mem = alloc.allocate(10);
+        UT_ASSERT(mem != nullptr);
+        alloc.deallocate(mem, 10);
+
+        //
+        // Every node may be requested explicitly.
+        //
+        for (ULONG node = 0; node <= KeQueryHighestNodeNumber(); node++)
+        {
+            jxy::non_paged_numa_allocator<int, '0GAT'> nodeAlloc(node);
+            UT_ASSERT(nodeAlloc.node() == node);
+            UT_ASSERT((nodeAlloc == jxy::non_paged_numa_allocator<int, '0GAT'>(node)));
+            UT_ASSERT((nodeAlloc != jxy::non_paged_numa_allocator<int, '0GAT'>()));
+
+            mem = nodeAlloc.allocate(10);
+            UT_ASSERT(mem != nullptr);
+            nodeAlloc.deallocate(mem, 10);
+        }
+    }
+    {
+        //
+        // The node carries through rebinding into node based containers.
+        //
+        using map_alloc = jxy::paged_numa_allocator<std::pair<const int, int>, '0GAT'>;
+        jxy::map<int, int, PagedPool, '0GAT', std::less<int>, map_alloc> map{ map_alloc(0) };
+        for (int i = 0; i < 100; i++)
+        {
+            map.emplace(i, i);
+        }
+        UT_ASSERT(map.size() == 100);
+        UT_ASSERT(map.get_allocator().node() == 0);
+    }
+    {
+        struct object
+        {
+            uint64_t Value;
+        };
+
+        auto ptr = new (NonPagedPoolNx, '0GAT', jxy::numa_node{}) object{ 1 };
+        UT_ASSERT(ptr->Value == 1);
+        jxy::default_delete<object, NonPagedPoolNx, '0GAT'>()(ptr);
+
+        ptr = new (NonPagedPoolNx, '0GAT', jxy::numa_node{ KeQueryHighestNodeNumber() }) object{ 2 };
+        UT_ASSERT(ptr->Value == 2);
+        jxy::default_delete<object, NonPagedPoolNx, '0GAT'>()(ptr);
+    }
+
+    NumaPlacementBenchmark();
+}
+
+}
@@ -0,0 +1,187 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     stltest/object_pool_tests.cpp
+// Author:   Johnny Shaw
+//
+#include "tests_common.hpp"
+#include <jxy/object_pool.hpp>
+#include <jxy/string.hpp>
+#include <jxy/trim.hpp>
+
+namespace jxy::Tests
+{
+
+struct PooledCounted
+{
+    static inline int Constructed = 0;
+    static inline int Destroyed = 0;
+
+    PooledCounted()
+    {
+        Constructed++;
+    }
+
+    ~PooledCounted()
+    {
+        Destroyed++;
+    }
+
+    int Value = 0;
+};
+
+using PooledString = jxy::wstring<PagedPool, '0GAT'>;
+
+//
+// The work of an image load notify routine, converts the image name, splits
+// the file part, and compares the name to a tracked module.
+//
+static bool ImageLoadShape(
+    PCUNICODE_STRING ImageName,
+    PooledString& FileName,
+    PooledString& FilePart,
+    const PooledString& Tracked)
+{
+    FileName.assign(ImageName->Buffer, (ImageName->Length / sizeof(WCHAR)));
+
+    auto pos = FileName.rfind(L'\\');
+    FilePart.assign(FileName.begin() + (pos == PooledString::npos ? 0 : (pos + 1)), FileName.end());
+
+    return (FileName == Tracked);
+}
+
+//
+// Repeats the image load shaped work with fresh strings and with strings
+// from a pool. Only the results are asserted, the timings depend on the
+// machine.
+//
+static void CallbackBenchmark()
+{
+    constexpr size_t iterations = 10000;
+
+    UNICODE_STRING imageName = RTL_CONSTANT_STRING(
+        L"\\Device\\HarddiskVolume3\\Windows\\System32\\DriverStore\\FileRepository\\"
+        L"example.inf_amd64_0123456789abcdef\\example_user_mode_component64.dll");
+    PooledString tracked(imageName.Buffer, (imageName.Length / sizeof(WCHAR)));
+
+    auto start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        PooledString fileName;
+        PooledString filePart;
+        UT_ASSERT(ImageLoadShape(&imageName, fileName, filePart, tracked));
+    }
+    auto freshTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+
+    jxy::object_pool<PooledString, PagedPool, '0GAT'> pool;
+
+    start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        auto fileName = pool.acquire();
+        auto filePart = pool.acquire();
+        UT_ASSERT(ImageLoadShape(&imageName, *fileName, *filePart, tracked));
+    }
+    auto pooledTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+
+    UT_ASSERT(pool.acquire_misses() == 2);
+
+    DbgPrintEx(DPFLTR_IHVDRIVER_ID,
+               DPFLTR_INFO_LEVEL,
+               "stltest: image load callback x %zu fresh %lld pooled %lld\n",
+               iterations,
+               freshTime,
+               pooledTime);
+}
+
+void ObjectPoolTests()
+{
+    {
+        PooledCounted::Constructed = 0;
+        PooledCounted::Destroyed = 0;
+
+        jxy::object_pool<PooledCounted, PagedPool, '0GAT', 2> pool;
+        UT_ASSERT(pool.cached() == 0);
+
+        PooledCounted* first;
+        {
+            auto object = pool.acquire();
+            UT_ASSERT(object->Value == 0);
+            object->Value = 10;
+            first = object.get();
+        }
+
+        //
+        // Released without being destroyed and handed out again as is.
+        //
+        UT_ASSERT(PooledCounted::Constructed == 1);
+        UT_ASSERT(PooledCounted::Destroyed == 0);
+        UT_ASSERT(pool.cached() == 1);
+        {
+            auto object = pool.acquire();
+            UT_ASSERT(object.get() == first);
+            UT_ASSERT(object->Value == 10);
+        }
+        UT_ASSERT(pool.total_acquires() == 2);
+        UT_ASSERT(pool.acquire_misses() == 1);
+
+        //
+        // Beyond the depth objects are destroyed.
+        //
+        {
+            auto one = pool.acquire();
+            auto two = pool.acquire();
+            auto three = pool.acquire();
+        }
+        UT_ASSERT(PooledCounted::Constructed == 3);
+        UT_ASSERT(PooledCounted::Destroyed == 1);
+        UT_ASSERT(pool.cached() == 2);
+
+        UT_ASSERT(pool.flush() > 0);
+        UT_ASSERT(pool.cached() == 0);
+        UT_ASSERT(PooledCounted::Destroyed == 3);
+    }
+
+    {
+        //
+        // A pooled string keeps its capacity.
+        //
+        jxy::paged_object_pool<PooledString, '0GAT'> pool;
+        const wchar_t* buffer;
+        {
+            auto string = pool.acquire();
+            string->assign(200, L'a');
+            buffer = string->data();
+        }
+        {
+            auto string = pool.acquire();
+            UT_ASSERT(string->size() == 200);
+            string->clear();
+            string->assign(100, L'b');
+            UT_ASSERT(string->data() == buffer);
+        }
+    }
+
+    {
+        //
+        // Cached objects are destroyed by a trim, the pool may be destroyed
+        // with objects cached.
+        //
+        PooledCounted::Constructed = 0;
+        PooledCounted::Destroyed = 0;
+
+        jxy::non_paged_object_pool<PooledCounted, '0GAT'> pool;
+        pool.acquire().reset();
+        UT_ASSERT(pool.cached() == 1);
+        UT_ASSERT(jxy::trim_caches() >= sizeof(PooledCounted));
+        UT_ASSERT(pool.cached() == 0);
+        UT_ASSERT(PooledCounted::Destroyed == 1);
+
+        pool.acquire().reset();
+    }
+    UT_ASSERT(PooledCounted::Destroyed == 2);
+
+    CallbackBenchmark();
+}
+
+}
@@ -0,0 +1,127 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     stltest/pool_backend_tests.cpp
+// Author:   Johnny Shaw
+//
+#include "tests_common.hpp"
+#include <jxy/pool_backend.hpp>
+#include <jxy/memory.hpp>
+#include <jxy/locks.hpp>
+
+namespace jxy::Tests
+{
+
+static bool IsZero(const uint8_t* Buffer, size_t Size)
+{
+    for (size_t i = 0; i < Size; i++)
+    {
+        if (Buffer[i] != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//
+// Allocates, fills, and frees large buffers with and without zeroing them
+// first. The fill stands in for a query that overwrites the whole buffer.
+// Only the contents are asserted, the timings depend on the machine.
+//
+static void ZeroingBenchmark()
+{
+    constexpr size_t size = (4 * 1024 * 1024);
+    constexpr size_t iterations = 32;
+
+    auto run = [](auto Allocate) -> LONGLONG
+    {
+        auto start = KeQueryPerformanceCounter(nullptr).QuadPart;
+        for (size_t i = 0; i < iterations; i++)
+        {
+            auto buffer = static_cast<uint8_t*>(Allocate());
+            UT_ASSERT(buffer != nullptr);
+            if (!buffer)
+            {
+                continue;
+            }
+            RtlFillMemory(buffer, size, 0xa5);
+            UT_ASSERT(buffer[0] == 0xa5);
+            UT_ASSERT(buffer[size - 1] == 0xa5);
+            ExFreePoolWithTag(buffer, '0GAT');
+        }
+        return (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+    };
+
+    auto uninitializedTime = run([]()
+                                 {
+                                     return jxy::details::pool_allocate(PagedPool, size, '0GAT');
+                                 });
+    auto zeroTime = run([]()
+                        {
+                            return jxy::details::pool_allocate_zero(PagedPool, size, '0GAT');
+                        });
+
+    DbgPrintEx(DPFLTR_IHVDRIVER_ID,
+               DPFLTR_INFO_LEVEL,
+               "stltest: pool backend %d, %zu bytes x %zu uninitialized %lld zeroed %lld\n",
+               JXY_POOL_BACKEND,
+               size,
+               iterations,
+               uninitializedTime,
+               zeroTime);
+}
+
+void PoolBackendTests()
+{
+    {
+        auto flags = jxy::details::pool_type_to_flags(PagedPool);
+        UT_ASSERT(flags == (POOL_FLAG_PAGED | POOL_FLAG_UNINITIALIZED));
+
+        flags = jxy::details::pool_type_to_flags(NonPagedPoolNx);
+        UT_ASSERT(flags == (POOL_FLAG_NON_PAGED | POOL_FLAG_UNINITIALIZED));
+
+        flags = jxy::details::pool_type_to_flags(NonPagedPoolNxCacheAligned);
+        UT_ASSERT(flags == (POOL_FLAG_NON_PAGED | POOL_FLAG_CACHE_ALIGNED | POOL_FLAG_UNINITIALIZED));
+    }
+
+    {
+        auto memory = static_cast<uint8_t*>(
+            jxy::details::pool_allocate(NonPagedPoolNx, 100, '0GAT'));
+        UT_ASSERT(memory != nullptr);
+        if (memory)
+        {
+            RtlFillMemory(memory, 100, 0xff);
+            ExFreePoolWithTag(memory, '0GAT');
+        }
+    }
+
+    {
+        auto memory = static_cast<uint8_t*>(
+            jxy::details::pool_allocate_zero(PagedPool, 3000, '0GAT'));
+        UT_ASSERT(memory != nullptr);
+        if (memory)
+        {
+            UT_ASSERT(IsZero(memory, 3000));
+            ExFreePoolWithTag(memory, '0GAT');
+        }
+    }
+
+    {
+        jxy::mutex<'0GAT'> mutex;
+        mutex.lock();
+        mutex.unlock();
+    }
+
+    {
+        jxy::allocator<uint64_t, PagedPool, '0GAT'> alloc;
+        auto memory = alloc.allocate(1000);
+        UT_ASSERT(memory != nullptr);
+        memory[999] = 1;
+        alloc.deallocate(memory, 1000);
+    }
+
+    ZeroingBenchmark();
+}
+
+}
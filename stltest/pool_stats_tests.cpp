@@ -0,0 +1,125 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     stltest/pool_stats_tests.cpp
+// Author:   Johnny Shaw
+//
+#include "tests_common.hpp"
+#include <jxy/pool_stats.hpp>
+#include <jxy/memory.hpp>
+#include <jxy/vector.hpp>
+
+namespace jxy::Tests
+{
+
+void PoolStatsTests()
+{
+    auto status = jxy::initialize_pool_stats();
+    if (!JXY_POOL_STATS)
+    {
+        //
+        // Instrumentation is compiled out, nothing is collected.
+        //
+        UT_ASSERT(status == STATUS_NOT_SUPPORTED);
+        auto ptr = jxy::make_unique<int, PagedPool, '0GAT'>(1);
+        pool_tag_stats stats;
+        UT_ASSERT(jxy::query_pool_stats(&stats, 1) == 0);
+        UT_ASSERT(!jxy::query_pool_tag_stats('0GAT', stats));
+        return;
+    }
+
+    UT_ASSERT(NT_SUCCESS(status));
+
+    {
+        pool_tag_stats stats;
+        UT_ASSERT(!jxy::query_pool_tag_stats('0GAT', stats));
+
+        {
+            auto ptr = jxy::make_unique<uint64_t, PagedPool, '0GAT'>(1);
+            UT_ASSERT(jxy::query_pool_tag_stats('0GAT', stats));
+            UT_ASSERT(stats.tag == '0GAT');
+            UT_ASSERT(stats.allocations == 1);
+            UT_ASSERT(stats.frees == 0);
+            UT_ASSERT(stats.bytes_outstanding == sizeof(uint64_t));
+            UT_ASSERT(stats.histogram[0] == 1);
+        }
+
+        UT_ASSERT(jxy::query_pool_tag_stats('0GAT', stats));
+        UT_ASSERT(stats.allocations == 1);
+        UT_ASSERT(stats.frees == 1);
+        UT_ASSERT(stats.bytes_outstanding == 0);
+        UT_ASSERT(stats.peak_bytes == sizeof(uint64_t));
+    }
+    {
+        //
+        // Counted against the tag of the allocator, bucketed by size.
+        //
+        {
+            jxy::vector<uint8_t, NonPagedPoolNx, '1GAT'> vec;
+            vec.resize(PAGE_SIZE * 4);
+        }
+
+        pool_tag_stats stats;
+        UT_ASSERT(jxy::query_pool_tag_stats('1GAT', stats));
+        UT_ASSERT(stats.allocations == 1);
+        UT_ASSERT(stats.frees == 1);
+        UT_ASSERT(stats.bytes_outstanding == 0);
+        UT_ASSERT(stats.peak_bytes == (PAGE_SIZE * 4));
+        UT_ASSERT(stats.histogram[10] == 1);
+    }
+    {
+        //
+        // The sized array delete returns the bytes, an unsized delete only
+        // counts the free.
+        //
+        auto mem = ::operator new[](48, PagedPool, '2GAT');
+        ::operator delete[](mem, 48, PagedPool, '2GAT');
+
+        pool_tag_stats stats;
+        UT_ASSERT(jxy::query_pool_tag_stats('2GAT', stats));
+        UT_ASSERT(stats.frees == 1);
+        UT_ASSERT(stats.bytes_outstanding == 0);
+
+        mem = ::operator new(48, PagedPool, '2GAT');
+        ::operator delete(mem, PagedPool, '2GAT');
+
+        UT_ASSERT(jxy::query_pool_tag_stats('2GAT', stats));
+        UT_ASSERT(stats.frees == 2);
+        UT_ASSERT(stats.bytes_outstanding == 48);
+    }
+    {
+        //
+        // The array deleter frees sized from the count in the array cookie.
+        //
+        {
+            auto ptr = jxy::make_unique<uint32_t[], PagedPool, '3GAT'>(10);
+            auto aligned = jxy::make_unique_for_overwrite<cache_aligned<uint64_t>[], PagedPool, '3GAT'>(3);
+        }
+
+        pool_tag_stats stats;
+        UT_ASSERT(jxy::query_pool_tag_stats('3GAT', stats));
+        UT_ASSERT(stats.allocations == 2);
+        UT_ASSERT(stats.frees == 2);
+        UT_ASSERT(stats.bytes_outstanding == 0);
+    }
+    {
+        pool_tag_stats all[jxy::pool_stats_max_tags];
+        auto count = jxy::query_pool_stats(all, RTL_NUMBER_OF(all));
+        UT_ASSERT(count >= 2);
+        UT_ASSERT(jxy::query_pool_stats(nullptr, 0) == count);
+
+        bool found = false;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (all[i].tag == '1GAT')
+            {
+                found = true;
+            }
+        }
+        UT_ASSERT(found);
+    }
+
+    jxy::uninitialize_pool_stats();
+}
+
+}
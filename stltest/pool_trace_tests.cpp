@@ -0,0 +1,114 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     stltest/pool_trace_tests.cpp
+// Author:   Johnny Shaw
+//
+#include "tests_common.hpp"
+#include <jxy/pool_trace.hpp>
+#include <jxy/memory.hpp>
+#include <jxy/vector.hpp>
+
+namespace jxy::Tests
+{
+
+DECLSPEC_NOINLINE
+static void TraceSiteOne()
+{
+    jxy::make_unique<uint64_t, PagedPool, '1GAT'>(1).reset();
+}
+
+DECLSPEC_NOINLINE
+static void TraceSiteTwo()
+{
+    jxy::allocator<uint32_t, PagedPool, '1GAT'> alloc;
+    alloc.deallocate(alloc.allocate(10), 10);
+}
+
+//
+// Copies out the sites recorded for a tag.
+//
+static jxy::vector<jxy::pool_site_stats, PagedPool, '0GAT'> QueryTagSites(ULONG PoolTag)
+{
+    jxy::vector<jxy::pool_site_stats, PagedPool, '0GAT'> sites(jxy::pool_trace_max_sites);
+    auto count = jxy::query_pool_trace(sites.data(), sites.size());
+    sites.resize(count < sites.size() ? count : sites.size());
+
+    jxy::vector<jxy::pool_site_stats, PagedPool, '0GAT'> result;
+    for (const auto& site : sites)
+    {
+        if (site.tag == PoolTag)
+        {
+            result.push_back(site);
+        }
+    }
+    return result;
+}
+
+void PoolTraceTests()
+{
+    auto status = jxy::initialize_pool_trace();
+
+#if JXY_POOL_TRACE
+
+    UT_ASSERT(NT_SUCCESS(status));
+
+    for (int i = 0; i < 3; i++)
+    {
+        TraceSiteOne();
+    }
+
+    for (int i = 0; i < 5; i++)
+    {
+        TraceSiteTwo();
+    }
+
+    {
+        auto sites = QueryTagSites('1GAT');
+        UT_ASSERT(sites.size() == 2);
+
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+        bool sawOne = false;
+        bool sawTwo = false;
+        for (const auto& site : sites)
+        {
+            UT_ASSERT(site.site != 0);
+            UT_ASSERT(site.frames[0] != nullptr);
+            allocations += site.allocations;
+            bytes += site.bytes;
+            sawOne = (sawOne || ((site.allocations == 3) && (site.bytes == (3 * sizeof(uint64_t)))));
+            sawTwo = (sawTwo || ((site.allocations == 5) && (site.bytes == (5 * 10 * sizeof(uint32_t)))));
+        }
+        UT_ASSERT(sawOne);
+        UT_ASSERT(sawTwo);
+        UT_ASSERT(allocations == 8);
+        UT_ASSERT(bytes == ((3 * sizeof(uint64_t)) + (5 * 10 * sizeof(uint32_t))));
+    }
+
+    {
+        //
+        // Sites are separated by tag.
+        //
+        auto ptr = jxy::make_unique<uint64_t, PagedPool, '2GAT'>(1);
+        auto sites = QueryTagSites('2GAT');
+        UT_ASSERT(sites.size() == 1);
+        UT_ASSERT(sites[0].allocations == 1);
+    }
+
+    jxy::uninitialize_pool_trace();
+
+    UT_ASSERT(jxy::query_pool_trace(nullptr, 0) == 0);
+
+#else
+
+    UT_ASSERT(status == STATUS_NOT_SUPPORTED);
+    UT_ASSERT(jxy::query_pool_trace(nullptr, 0) == 0);
+
+    TraceSiteOne();
+    TraceSiteTwo();
+
+#endif
+}
+
+}
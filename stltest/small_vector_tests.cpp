@@ -0,0 +1,247 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     stltest/small_vector_tests.cpp
+// Author:   Johnny Shaw
+//
+#include "tests_common.hpp"
+#include <jxy/small_vector.hpp>
+#include <jxy/vector.hpp>
+#include <jxy/string.hpp>
+
+namespace jxy::Tests
+{
+
+//
+// A scratch list built and torn down per callback, Count entries pushed,
+// walked, and a few erased. Only the results are asserted, the timings
+// depend on the machine.
+//
+template <typename TVector>
+static LONGLONG ScratchListShape(uint32_t Count, bool Reserve)
+{
+    constexpr uint32_t iterations = 100000;
+
+    uint64_t sum = 0;
+    auto start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        TVector list;
+        if (Reserve)
+        {
+            list.reserve(Count);
+        }
+
+        for (uint32_t j = 0; j < Count; j++)
+        {
+            list.push_back(static_cast<uintptr_t>(i + j));
+        }
+
+        list.erase(list.begin());
+        for (auto value : list)
+        {
+            sum += value;
+        }
+    }
+    auto elapsed = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+
+    uint64_t expected = 0;
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        for (uint64_t j = 1; j < Count; j++)
+        {
+            expected += (i + j);
+        }
+    }
+    UT_ASSERT(sum == expected);
+    return elapsed;
+}
+
+static void SmallVectorBenchmark()
+{
+    using VectorType = jxy::vector<uintptr_t, PagedPool, '0GAT'>;
+    using SmallVectorType = jxy::small_vector<uintptr_t, 8, PagedPool, '0GAT'>;
+
+    for (uint32_t count : { 2u, 4u, 8u, 16u })
+    {
+        auto vectorTime = ScratchListShape<VectorType>(count, false);
+        auto reservedTime = ScratchListShape<VectorType>(count, true);
+        auto smallTime = ScratchListShape<SmallVectorType>(count, false);
+
+        DbgPrintEx(DPFLTR_IHVDRIVER_ID,
+                   DPFLTR_INFO_LEVEL,
+                   "stltest: %u element scratch lists vector %lld reserved vector %lld small_vector<8> %lld\n",
+                   count,
+                   vectorTime,
+                   reservedTime,
+                   smallTime);
+    }
+}
+
+void SmallVectorTests()
+{
+    using StringType = jxy::wstring<PagedPool, '0GAT'>;
+    using VectorType = jxy::small_vector<int, 4, PagedPool, '0GAT'>;
+
+    {
+        VectorType vec;
+        UT_ASSERT(vec.empty());
+        UT_ASSERT(vec.is_inline());
+        UT_ASSERT(vec.capacity() == 4);
+
+        for (int i = 0; i < 4; i++)
+        {
+            vec.push_back(i);
+        }
+        UT_ASSERT(vec.is_inline());
+        UT_ASSERT(vec.size() == 4);
+
+        //
+        // Growing past the inline capacity spills to the pool.
+        //
+        vec.emplace_back(4);
+        UT_ASSERT(!vec.is_inline());
+        UT_ASSERT(vec.capacity() >= 5);
+        UT_ASSERT(vec.size() == 5);
+        for (int i = 0; i < 5; i++)
+        {
+            UT_ASSERT(vec[i] == i);
+        }
+        UT_ASSERT(vec.front() == 0);
+        UT_ASSERT(vec.back() == 4);
+        UT_ASSERT(vec.at(2) == 2);
+
+        bool threw = false;
+        try
+        {
+            (void)vec.at(5);
+        }
+        catch (const std::out_of_range&)
+        {
+            threw = true;
+        }
+        UT_ASSERT(threw);
+
+        vec.pop_back();
+        vec.pop_back();
+        vec.shrink_to_fit();
+        UT_ASSERT(vec.is_inline());
+        UT_ASSERT((vec == VectorType{ 0, 1, 2 }));
+
+        vec.clear();
+        UT_ASSERT(vec.empty());
+    }
+
+    {
+        VectorType vec{ 1, 2, 3 };
+
+        vec.insert(vec.begin(), 0);
+        vec.insert(vec.end(), 2, 4);
+        UT_ASSERT((vec == VectorType{ 0, 1, 2, 3, 4, 4 }));
+
+        int more[] = { 7, 8 };
+        auto it = vec.insert((vec.begin() + 1), std::begin(more), std::end(more));
+        UT_ASSERT(*it == 7);
+        UT_ASSERT((vec == VectorType{ 0, 7, 8, 1, 2, 3, 4, 4 }));
+
+        it = vec.erase((vec.begin() + 1), (vec.begin() + 3));
+        UT_ASSERT(*it == 1);
+        it = vec.erase(vec.end() - 1);
+        UT_ASSERT(it == vec.end());
+        UT_ASSERT((vec == VectorType{ 0, 1, 2, 3, 4 }));
+
+        it = vec.emplace((vec.begin() + 2), 9);
+        UT_ASSERT(*it == 9);
+        vec.insert(vec.begin(), { -2, -1 });
+        UT_ASSERT((vec == VectorType{ -2, -1, 0, 1, 9, 2, 3, 4 }));
+
+        //
+        // An element of the vector itself may be inserted, even when the
+        // insert reallocates.
+        //
+        vec.shrink_to_fit();
+        UT_ASSERT(vec.size() == vec.capacity());
+        vec.push_back(vec[0]);
+        UT_ASSERT(vec.back() == -2);
+        vec.shrink_to_fit();
+        vec.insert(vec.begin(), vec[4]);
+        UT_ASSERT(vec.front() == 9);
+        vec.shrink_to_fit();
+        vec.insert(vec.begin(), 2, vec.back());
+        UT_ASSERT((vec[0] == -2) && (vec[1] == -2));
+
+        vec.resize(2);
+        UT_ASSERT(vec.is_inline() == false);
+        vec.resize(3, 5);
+        UT_ASSERT((vec == VectorType{ -2, -2, 5 }));
+        vec.resize(6);
+        UT_ASSERT((vec == VectorType{ -2, -2, 5, 0, 0, 0 }));
+        vec.resize_for_overwrite(8);
+        vec[6] = 6;
+        vec[7] = 7;
+        UT_ASSERT((vec == VectorType{ -2, -2, 5, 0, 0, 0, 6, 7 }));
+        vec.resize_for_overwrite(3);
+        UT_ASSERT((vec == VectorType{ -2, -2, 5 }));
+
+        vec.assign(3, 1);
+        UT_ASSERT((vec == VectorType{ 1, 1, 1 }));
+        vec.assign({ 5, 4, 3, 2, 1, 0 });
+        UT_ASSERT((vec == VectorType{ 5, 4, 3, 2, 1, 0 }));
+        UT_ASSERT((VectorType{ 1, 2 } < VectorType{ 1, 3 }));
+        UT_ASSERT((VectorType{ 1, 2 } != VectorType{ 1, 2, 3 }));
+    }
+
+    {
+        //
+        // Copies and moves, with the elements inline and spilled.
+        //
+        using StringVectorType = jxy::small_vector<StringType, 2, PagedPool, '0GAT'>;
+
+        StringVectorType inlined{ L"first string long enough to allocate", L"second" };
+        StringVectorType spilled{ L"a", L"b", L"c", L"d" };
+
+        StringVectorType copy(inlined);
+        UT_ASSERT(copy.is_inline());
+        UT_ASSERT(copy == inlined);
+
+        StringVectorType moved(std::move(copy));
+        UT_ASSERT(moved == inlined);
+        UT_ASSERT(copy.empty());
+
+        copy = spilled;
+        UT_ASSERT(!copy.is_inline());
+        UT_ASSERT(copy == spilled);
+
+        auto data = copy.data();
+        moved = std::move(copy);
+        UT_ASSERT(moved.data() == data);
+        UT_ASSERT(moved == spilled);
+        UT_ASSERT(copy.empty() && copy.is_inline());
+
+        //
+        // Move assigning inline elements to a spilled vector keeps its
+        // buffer.
+        //
+        copy = inlined;
+        moved = std::move(copy);
+        UT_ASSERT(!moved.is_inline());
+        UT_ASSERT(moved == inlined);
+
+        copy = inlined;
+        copy.swap(spilled);
+        UT_ASSERT((copy.size() == 4) && !copy.is_inline());
+        UT_ASSERT(spilled == inlined);
+        UT_ASSERT(spilled.is_inline());
+
+        StringVectorType other{ L"x", L"y", L"z" };
+        data = other.data();
+        swap(copy, other);
+        UT_ASSERT(copy.data() == data);
+        UT_ASSERT(copy.front() == L"x");
+        UT_ASSERT(other.back() == L"d");
+    }
+
+    SmallVectorBenchmark();
+}
+
+}
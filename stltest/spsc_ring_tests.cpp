@@ -0,0 +1,335 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     stltest/spsc_ring_tests.cpp
+// Author:   Johnny Shaw
+//
+#include "tests_common.hpp"
+#include <jxy/spsc_ring.hpp>
+#include <jxy/per_cpu_rings.hpp>
+#include <jxy/deque.hpp>
+#include <jxy/vector.hpp>
+#include <jxy/thread.hpp>
+
+namespace jxy::Tests
+{
+
+//
+// A jxy::deque behind a spin lock, the usual hand off from a callback to a
+// worker, with the members of jxy::spsc_ring the benchmark uses.
+//
+class LockedQueue
+{
+public:
+
+    LockedQueue()
+    {
+        KeInitializeSpinLock(&m_Lock);
+    }
+
+    bool try_push(LONGLONG Value)
+    {
+        KIRQL oldIrql;
+        KeAcquireSpinLock(&m_Lock, &oldIrql);
+        m_Queue.push_back(Value);
+        KeReleaseSpinLock(&m_Lock, oldIrql);
+        return true;
+    }
+
+    template <typename TFunction>
+    size_t pop_batch(TFunction&& Function, size_t Max)
+    {
+        size_t popped = 0;
+        KIRQL oldIrql;
+        KeAcquireSpinLock(&m_Lock, &oldIrql);
+        while (!m_Queue.empty() && (popped < Max))
+        {
+            Function(m_Queue.front());
+            m_Queue.pop_front();
+            popped++;
+        }
+        KeReleaseSpinLock(&m_Lock, oldIrql);
+        return popped;
+    }
+
+private:
+
+    KSPIN_LOCK m_Lock;
+    jxy::deque<LONGLONG, NonPagedPoolNx, '0GAT'> m_Queue;
+
+};
+
+//
+// One thread pushes Count performance counter stamps, retrying while the
+// queue is full, and another pops them in batches of up to Batch. Returns
+// the total time, and the average and maximum time from push to pop. Only
+// the results are asserted, the timings depend on the machine.
+//
+template <typename TQueue>
+static LONGLONG HandOffShape(uint32_t Count, size_t Batch, LONGLONG& AverageLatency, LONGLONG& MaxLatency)
+{
+    TQueue queue;
+    volatile LONG failures = 0;
+    LONGLONG latencySum = 0;
+    LONGLONG latencyMax = 0;
+
+    auto start = KeQueryPerformanceCounter(nullptr).QuadPart;
+
+    jxy::thread consumer([&queue, &failures, &latencySum, &latencyMax, Count, Batch]()
+                         {
+                             uint32_t received = 0;
+                             LONGLONG previous = 0;
+                             while (received < Count)
+                             {
+                                 queue.pop_batch([&](LONGLONG& Stamp)
+                                                 {
+                                                     auto now = KeQueryPerformanceCounter(nullptr).QuadPart;
+                                                     if (Stamp < previous)
+                                                     {
+                                                         InterlockedIncrement(&failures);
+                                                     }
+                                                     previous = Stamp;
+                                                     latencySum += (now - Stamp);
+                                                     latencyMax = ((now - Stamp) > latencyMax) ? (now - Stamp) : latencyMax;
+                                                     received++;
+                                                 },
+                                                 Batch);
+                             }
+                         });
+
+    for (uint32_t i = 0; i < Count; i++)
+    {
+        while (!queue.try_push(KeQueryPerformanceCounter(nullptr).QuadPart))
+        {
+            YieldProcessor();
+        }
+    }
+    consumer.join();
+
+    auto elapsed = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+
+    UT_ASSERT(failures == 0);
+    AverageLatency = (latencySum / Count);
+    MaxLatency = latencyMax;
+    return elapsed;
+}
+
+static void SpscRingBenchmark()
+{
+    constexpr uint32_t count = 200000;
+    using RingType = jxy::spsc_ring<LONGLONG, 1024, NonPagedPoolNx, '0GAT'>;
+
+    for (size_t batch : { 1ull, 32ull, 1024ull })
+    {
+        LONGLONG lockedAverage, lockedMax;
+        auto lockedTime = HandOffShape<LockedQueue>(count, batch, lockedAverage, lockedMax);
+
+        LONGLONG ringAverage, ringMax;
+        auto ringTime = HandOffShape<RingType>(count, batch, ringAverage, ringMax);
+
+        DbgPrintEx(DPFLTR_IHVDRIVER_ID,
+                   DPFLTR_INFO_LEVEL,
+                   "stltest: %u hand offs batch %zu total/avg latency/max latency "
+                   "deque+spin lock %lld/%lld/%lld spsc_ring %lld/%lld/%lld\n",
+                   count,
+                   batch,
+                   lockedTime,
+                   lockedAverage,
+                   lockedMax,
+                   ringTime,
+                   ringAverage,
+                   ringMax);
+    }
+}
+
+struct RingEntry
+{
+    uint32_t Producer;
+    uint32_t Sequence;
+};
+
+//
+// Producers push numbered entries from every processor while one consumer
+// drains. Entries of a producer arrive in order within each processor's
+// ring, and every entry which wasn't dropped arrives exactly once.
+//
+static void PerCpuRingsStress()
+{
+    constexpr uint32_t producerCount = 8;
+    constexpr uint32_t attempts = 50000;
+
+    jxy::per_cpu_rings<RingEntry, 256, NonPagedPoolNx, '0GAT'> rings;
+    UT_ASSERT(rings.ring_count() == KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS));
+
+    volatile LONG running = producerCount;
+    volatile LONG producerDrops = 0;
+    volatile LONG failures = 0;
+
+    //
+    // The next sequence expected of each producer in each ring, and the
+    // count received from each producer.
+    //
+    jxy::vector<uint32_t, NonPagedPoolNx, '0GAT'> lastSequence(rings.ring_count() * producerCount, 0);
+    jxy::vector<uint32_t, NonPagedPoolNx, '0GAT'> received(producerCount, 0);
+
+    jxy::thread consumer([&]()
+                         {
+                             for (;;)
+                             {
+                                 auto done = (ReadAcquire(&running) == 0);
+
+                                 size_t popped = 0;
+                                 for (size_t i = 0; i < rings.ring_count(); i++)
+                                 {
+                                     popped += rings.ring(i).pop_batch([&](RingEntry& Entry)
+                                                                       {
+                                                                           auto& last = lastSequence[(i * producerCount) + Entry.Producer];
+                                                                           if (Entry.Sequence < last)
+                                                                           {
+                                                                               InterlockedIncrement(&failures);
+                                                                           }
+                                                                           last = (Entry.Sequence + 1);
+                                                                           received[Entry.Producer]++;
+                                                                       },
+                                                                       32);
+                                 }
+
+                                 if (done && (popped == 0))
+                                 {
+                                     break;
+                                 }
+                             }
+                         });
+
+    jxy::vector<jxy::thread, NonPagedPoolNx, '0GAT'> producers;
+    jxy::vector<uint32_t, NonPagedPoolNx, '0GAT'> pushed(producerCount, 0);
+    for (uint32_t p = 0; p < producerCount; p++)
+    {
+        producers.emplace_back([&rings, &running, &producerDrops, &pushed, p]()
+                               {
+                                   for (uint32_t i = 0; i < attempts; i++)
+                                   {
+                                       if (rings.try_push(RingEntry{ p, i }))
+                                       {
+                                           pushed[p]++;
+                                       }
+                                       else
+                                       {
+                                           InterlockedIncrement(&producerDrops);
+                                       }
+                                   }
+                                   InterlockedDecrement(&running);
+                               });
+    }
+    for (auto& producer : producers)
+    {
+        producer.join();
+    }
+    consumer.join();
+
+    UT_ASSERT(failures == 0);
+    UT_ASSERT(rings.empty());
+    UT_ASSERT(rings.dropped() == static_cast<size_t>(producerDrops));
+
+    size_t totalPushed = 0;
+    for (uint32_t p = 0; p < producerCount; p++)
+    {
+        UT_ASSERT(received[p] == pushed[p]);
+        totalPushed += pushed[p];
+    }
+    UT_ASSERT((totalPushed + producerDrops) == (producerCount * attempts));
+
+    DbgPrintEx(DPFLTR_IHVDRIVER_ID,
+               DPFLTR_INFO_LEVEL,
+               "stltest: per_cpu_rings %u producers pushed %zu dropped %ld\n",
+               producerCount,
+               totalPushed,
+               producerDrops);
+}
+
+void SpscRingTests()
+{
+    {
+        jxy::spsc_ring<int, 4, PagedPool, '0GAT'> ring;
+
+        UT_ASSERT(ring.empty());
+        UT_ASSERT(ring.capacity() == 4);
+
+        int value = 0;
+        UT_ASSERT(!ring.try_pop(value));
+
+        UT_ASSERT(ring.try_push(1));
+        UT_ASSERT(ring.try_push(2));
+        UT_ASSERT(ring.try_emplace(3));
+        UT_ASSERT(ring.try_push(4));
+        UT_ASSERT(!ring.try_push(5));
+        UT_ASSERT(ring.size() == 4);
+
+        UT_ASSERT(ring.try_pop(value));
+        UT_ASSERT(value == 1);
+        UT_ASSERT(ring.try_push(5));
+
+        //
+        // The indices wrap around the slots.
+        //
+        for (int i = 6; i < 100; i++)
+        {
+            UT_ASSERT(ring.try_pop(value));
+            UT_ASSERT(value == (i - 4));
+            UT_ASSERT(ring.try_push(i));
+        }
+
+        int expected = 96;
+        UT_ASSERT(ring.pop_batch([&expected](int& Popped) { UT_ASSERT(Popped == expected++); }, 3) == 3);
+        UT_ASSERT(ring.size() == 1);
+        UT_ASSERT(ring.pop_batch([&expected](int& Popped) { UT_ASSERT(Popped == expected++); }) == 1);
+        UT_ASSERT(ring.pop_batch([](int&) { UT_ASSERT(false); }) == 0);
+        UT_ASSERT(ring.empty());
+    }
+
+    {
+        //
+        // Elements left in the ring are destroyed with it.
+        //
+        jxy::spsc_ring<jxy::vector<int, PagedPool, '0GAT'>, 8, PagedPool, '0GAT'> ring;
+        for (int i = 0; i < 8; i++)
+        {
+            UT_ASSERT(ring.try_emplace(static_cast<size_t>(i + 1), i));
+        }
+
+        jxy::vector<int, PagedPool, '0GAT'> value;
+        UT_ASSERT(ring.try_pop(value));
+        UT_ASSERT((value.size() == 1) && (value[0] == 0));
+        UT_ASSERT(ring.try_pop(value));
+        UT_ASSERT((value.size() == 2) && (value[1] == 1));
+    }
+
+    {
+        jxy::per_cpu_rings<int, 2, NonPagedPoolNx, '0GAT'> rings;
+
+        //
+        // Stay on one processor, so the pushes go to the same ring.
+        //
+        auto oldIrql = KeRaiseIrqlToDpcLevel();
+        auto pushedFirst = rings.try_push(1);
+        auto pushedSecond = rings.try_push(2);
+        auto pushedThird = rings.try_push(3);
+        KeLowerIrql(oldIrql);
+
+        UT_ASSERT(pushedFirst && pushedSecond && !pushedThird);
+        UT_ASSERT(rings.dropped() == 1);
+        UT_ASSERT(rings.size() == 2);
+
+        int sum = 0;
+        UT_ASSERT(rings.drain([&sum](int& Popped) { sum += Popped; }, 1) == 1);
+        UT_ASSERT(rings.drain([&sum](int& Popped) { sum += Popped; }) == 1);
+        UT_ASSERT(rings.drain([&sum](int& Popped) { sum += Popped; }) == 0);
+        UT_ASSERT(sum == 3);
+        UT_ASSERT(rings.empty());
+    }
+
+    PerCpuRingsStress();
+    SpscRingBenchmark();
+}
+
+}
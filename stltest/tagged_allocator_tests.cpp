@@ -0,0 +1,220 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     stltest/tagged_allocator_tests.cpp
+// Author:   Johnny Shaw
+//
+#include "tests_common.hpp"
+#include <jxy/memory.hpp>
+#include <jxy/pool_stats.hpp>
+#include <jxy/vector.hpp>
+#include <jxy/string.hpp>
+#include <jxy/map.hpp>
+#include <jxy/set.hpp>
+
+namespace jxy::Tests
+{
+
+//
+// The work of a notify routine over strings and a map keyed by them, run
+// with the compile time tag containers and the runtime tag containers.
+//
+template <typename TName, typename TPart, typename TMap>
+static size_t TagHotPath(TName& Name, TPart& Part, TMap& Map, size_t Iterations)
+{
+    static constexpr wchar_t path[] = L"\\Device\\HarddiskVolume3\\Windows\\System32\\ntdll.dll";
+
+    size_t found = 0;
+    for (size_t i = 0; i < Iterations; i++)
+    {
+        Name.assign(path);
+        Part.assign(Name.begin() + Name.rfind(L'\\') + 1, Name.end());
+        Map.insert_or_assign(static_cast<int>(i % 64), i);
+        if ((Map.find(static_cast<int>(i % 32)) != Map.end()) &&
+            (Name.compare(Name.size() - Part.size(), Part.size(), Part.c_str()) == 0))
+        {
+            found++;
+        }
+    }
+    return found;
+}
+
+static void TagBenchmark()
+{
+    constexpr size_t iterations = 20000;
+
+    auto start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    size_t staticFound;
+    {
+        jxy::wstring<PagedPool, '0GAT'> name;
+        jxy::wstring<PagedPool, '1GAT'> part;
+        jxy::map<int, size_t, PagedPool, '2GAT'> map;
+        staticFound = TagHotPath(name, part, map, iterations);
+    }
+    auto staticTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+
+    start = KeQueryPerformanceCounter(nullptr).QuadPart;
+    size_t runtimeFound;
+    {
+        jxy::tagged_wstring<PagedPool> name(jxy::tagged_allocator<wchar_t, PagedPool>('0GAT'));
+        jxy::tagged_wstring<PagedPool> part(jxy::tagged_allocator<wchar_t, PagedPool>('1GAT'));
+        jxy::tagged_map<int, size_t, PagedPool> map(jxy::tagged_allocator<int, PagedPool>('2GAT'));
+        runtimeFound = TagHotPath(name, part, map, iterations);
+    }
+    auto runtimeTime = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+
+    UT_ASSERT(staticFound == runtimeFound);
+
+    DbgPrintEx(DPFLTR_IHVDRIVER_ID,
+               DPFLTR_INFO_LEVEL,
+               "stltest: tag hot path x %zu compile time %lld runtime %lld, wstring %zu vs %zu bytes\n",
+               iterations,
+               staticTime,
+               runtimeTime,
+               sizeof(jxy::wstring<PagedPool, '0GAT'>),
+               sizeof(jxy::tagged_wstring<PagedPool>));
+}
+
+void TaggedAllocatorTests()
+{
+    {
+        jxy::tagged_allocator<int, PagedPool> alloc('0GAT');
+        UT_ASSERT(alloc.pool_tag() == '0GAT');
+        UT_ASSERT(alloc.pool_type == PagedPool);
+        auto mem = alloc.allocate(10);
+        alloc.deallocate(mem, 10);
+
+        //
+        // Rebinding keeps the tag, allocators are equal by tag.
+        //
+        jxy::tagged_allocator<uint64_t, PagedPool> rebound(alloc);
+        UT_ASSERT(rebound.pool_tag() == '0GAT');
+        UT_ASSERT(rebound == alloc);
+        UT_ASSERT(jxy::paged_tagged_allocator<int>('1GAT') != alloc);
+        UT_ASSERT(jxy::non_paged_tagged_allocator<int>('0GAT').pool_type == NonPagedPoolNx);
+    }
+
+    {
+        jxy::tagged_vector<int, PagedPool> vec(jxy::tagged_allocator<int, PagedPool>('0GAT'));
+        for (int i = 0; i < 100; i++)
+        {
+            vec.push_back(i);
+        }
+        UT_ASSERT(vec[99] == 99);
+        UT_ASSERT(vec.get_allocator().pool_tag() == '0GAT');
+
+        jxy::tagged_map<int, int, PagedPool> map(jxy::tagged_allocator<int, PagedPool>('0GAT'));
+        map.emplace(1, 2);
+        UT_ASSERT(map[1] == 2);
+        UT_ASSERT(map.get_allocator().pool_tag() == '0GAT');
+
+        jxy::tagged_multimap<int, int, PagedPool> multimap(jxy::tagged_allocator<int, PagedPool>('0GAT'));
+        multimap.emplace(1, 2);
+        multimap.emplace(1, 3);
+        UT_ASSERT(multimap.count(1) == 2);
+
+        jxy::tagged_set<int, NonPagedPoolNx> set(jxy::tagged_allocator<int, NonPagedPoolNx>('0GAT'));
+        set.insert(1);
+        UT_ASSERT(set.count(1) == 1);
+
+        jxy::tagged_multiset<int, NonPagedPoolNx> multiset(jxy::tagged_allocator<int, NonPagedPoolNx>('0GAT'));
+        multiset.insert(1);
+        multiset.insert(1);
+        UT_ASSERT(multiset.count(1) == 2);
+
+        jxy::tagged_string<PagedPool> string(jxy::tagged_allocator<char, PagedPool>('0GAT'));
+        string.assign(100, 'a');
+        UT_ASSERT(string.size() == 100);
+    }
+
+    {
+        //
+        // A container keeps its tag. Assigning from another tag copies into
+        // a buffer of the destination tag, the same tag takes the buffer.
+        //
+        jxy::tagged_allocator<wchar_t, PagedPool> tag0('0GAT');
+        jxy::tagged_allocator<wchar_t, PagedPool> tag1('1GAT');
+
+        jxy::tagged_wstring<PagedPool> source(200, L'a', tag0);
+        jxy::tagged_wstring<PagedPool> other(tag1);
+        auto buffer = source.data();
+
+        other = std::move(source);
+        UT_ASSERT(other.get_allocator().pool_tag() == '1GAT');
+        UT_ASSERT(other.size() == 200);
+        UT_ASSERT(other.data() != buffer);
+
+        jxy::tagged_wstring<PagedPool> same(tag1);
+        buffer = other.data();
+        same = std::move(other);
+        UT_ASSERT(same.get_allocator().pool_tag() == '1GAT');
+        UT_ASSERT(same.data() == buffer);
+
+        jxy::tagged_wstring<PagedPool> copy(tag0);
+        copy = same;
+        UT_ASSERT(copy.get_allocator().pool_tag() == '0GAT');
+        UT_ASSERT(copy == same);
+
+        //
+        // Construction takes the tag of the source.
+        //
+        jxy::tagged_wstring<PagedPool> constructed(std::move(copy));
+        UT_ASSERT(constructed.get_allocator().pool_tag() == '0GAT');
+
+        jxy::tagged_vector<int, PagedPool> vec0(100, 1, jxy::tagged_allocator<int, PagedPool>('0GAT'));
+        jxy::tagged_vector<int, PagedPool> vec1(jxy::tagged_allocator<int, PagedPool>('1GAT'));
+        vec1 = std::move(vec0);
+        UT_ASSERT(vec1.get_allocator().pool_tag() == '1GAT');
+        UT_ASSERT(vec1.size() == 100);
+    }
+
+    {
+        //
+        // Swapping takes the tags along with the memory.
+        //
+        jxy::tagged_vector<int, PagedPool> vec0(100, 1, jxy::tagged_allocator<int, PagedPool>('0GAT'));
+        jxy::tagged_vector<int, PagedPool> vec1(10, 2, jxy::tagged_allocator<int, PagedPool>('1GAT'));
+        auto buffer = vec0.data();
+
+        vec0.swap(vec1);
+        UT_ASSERT(vec1.data() == buffer);
+        UT_ASSERT(vec1.get_allocator().pool_tag() == '0GAT');
+        UT_ASSERT(vec0.get_allocator().pool_tag() == '1GAT');
+        UT_ASSERT((vec0.size() == 10) && (vec1.size() == 100));
+
+        jxy::tagged_map<int, int, PagedPool> map0(jxy::tagged_allocator<int, PagedPool>('0GAT'));
+        jxy::tagged_map<int, int, PagedPool> map1(jxy::tagged_allocator<int, PagedPool>('1GAT'));
+        map0[1] = 1;
+        std::swap(map0, map1);
+        UT_ASSERT(map1.get_allocator().pool_tag() == '0GAT');
+        UT_ASSERT(map1.at(1) == 1);
+        UT_ASSERT(map0.empty());
+    }
+
+#if JXY_POOL_STATS
+    if (NT_SUCCESS(jxy::initialize_pool_stats()))
+    {
+        //
+        // The bytes are charged to the runtime tag.
+        //
+        {
+            jxy::tagged_vector<uint8_t, PagedPool> vec(jxy::tagged_allocator<uint8_t, PagedPool>('3GAT'));
+            vec.reserve(1000);
+
+            pool_tag_stats stats;
+            UT_ASSERT(jxy::query_pool_tag_stats('3GAT', stats));
+            UT_ASSERT(stats.bytes_outstanding == 1000);
+        }
+
+        pool_tag_stats stats;
+        UT_ASSERT(jxy::query_pool_tag_stats('3GAT', stats));
+        UT_ASSERT(stats.bytes_outstanding == 0);
+
+        jxy::uninitialize_pool_stats();
+    }
+#endif
+
+    TagBenchmark();
+}
+
+}
@@ -23,6 +23,31 @@ extern void QueueTests();
 extern void ListTests();
 extern void StackTests();
 extern void SetTests();
+extern void LookasideTests();
+extern void MagazineTests();
+extern void ArenaTests();
+extern void MemoryResourceTests();
+extern void PoolStatsTests();
+extern void AlignedTests();
+extern void IntrusivePtrTests();
+extern void NumaTests();
+extern void PoolBackendTests();
+extern void TrimTests();
+extern void PoolTraceTests();
+extern void LargeBufferTests();
+extern void ObjectPoolTests();
+extern void TaggedAllocatorTests();
+extern void UnorderedMapTests();
+extern void UnorderedSetTests();
+extern void FlatHashMapTests();
+extern void FlatMapTests();
+extern void IntervalMapTests();
+extern void IdTableTests();
+extern void ConcurrentHashMapTests();
+extern void SpscRingTests();
+extern void SmallVectorTests();
+extern void InplaceStringTests();
+extern void BtreeTests();
 
 bool RunTests() try
 {
@@ -39,6 +64,31 @@ bool RunTests() try
     ListTests();
     StackTests();
     SetTests();
+    LookasideTests();
+    MagazineTests();
+    ArenaTests();
+    MemoryResourceTests();
+    PoolStatsTests();
+    AlignedTests();
+    IntrusivePtrTests();
+    NumaTests();
+    PoolBackendTests();
+    TrimTests();
+    PoolTraceTests();
+    LargeBufferTests();
+    ObjectPoolTests();
+    TaggedAllocatorTests();
+    UnorderedMapTests();
+    UnorderedSetTests();
+    FlatHashMapTests();
+    FlatMapTests();
+    IntervalMapTests();
+    IdTableTests();
+    ConcurrentHashMapTests();
+    SpscRingTests();
+    SmallVectorTests();
+    InplaceStringTests();
+    BtreeTests();
 
     return true;
 }
@@ -0,0 +1,132 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     stltest/trim_tests.cpp
+// Author:   Johnny Shaw
+//
+#include "tests_common.hpp"
+#include <jxy/trim.hpp>
+#include <jxy/magazine.hpp>
+#include <jxy/lookaside.hpp>
+#include <jxy/map.hpp>
+
+namespace jxy::Tests
+{
+
+static size_t CountingTrim(void* Context) noexcept
+{
+    InterlockedIncrement(static_cast<volatile LONG*>(Context));
+    return 100;
+}
+
+//
+// Leaves blocks in the magazine cache and a lookaside list.
+//
+static void FillCaches()
+{
+    jxy::map<int, int, PagedPool, '0GAT', std::less<int>,
+             jxy::lookaside_allocator<std::pair<const int, int>, PagedPool, '0GAT'>> map;
+    for (int i = 0; i < 32; i++)
+    {
+        map.emplace(i, i);
+    }
+
+    auto ptr = jxy::make_unique<uint64_t, PagedPool, '0GAT'>(1);
+}
+
+void TrimTests()
+{
+    UT_ASSERT(NT_SUCCESS(jxy::initialize_magazine_cache()));
+
+    {
+        jxy::trim_caches();
+        auto stats = jxy::query_trim_stats();
+
+        FillCaches();
+
+        auto bytes = jxy::trim_caches();
+        UT_ASSERT(bytes > 0);
+
+        auto stats2 = jxy::query_trim_stats();
+        UT_ASSERT(stats2.trims == (stats.trims + 1));
+        UT_ASSERT(stats2.bytes_reclaimed == (stats.bytes_reclaimed + bytes));
+        UT_ASSERT(stats2.last_bytes_reclaimed == bytes);
+
+        //
+        // Nothing is left to reclaim.
+        //
+        UT_ASSERT(jxy::trim_caches() == 0);
+        UT_ASSERT(jxy::query_trim_stats().last_bytes_reclaimed == 0);
+    }
+
+    {
+        volatile LONG calls = 0;
+        jxy::details::trim_callback callback(&CountingTrim, const_cast<LONG*>(&calls));
+        callback.register_callback();
+
+        UT_ASSERT(jxy::trim_caches() == 100);
+        UT_ASSERT(calls == 1);
+
+        callback.unregister_callback();
+
+        UT_ASSERT(jxy::trim_caches() == 0);
+        UT_ASSERT(calls == 1);
+
+        //
+        // Unregistering twice is harmless.
+        //
+        callback.unregister_callback();
+    }
+
+    {
+        //
+        // Simulate memory pressure with our own event.
+        //
+        KEVENT lowMemory;
+        KeInitializeEvent(&lowMemory, NotificationEvent, FALSE);
+
+        UT_ASSERT(NT_SUCCESS(jxy::initialize_cache_trimming(&lowMemory)));
+
+        FillCaches();
+
+        auto stats = jxy::query_trim_stats();
+
+        KeSetEvent(&lowMemory, IO_NO_INCREMENT, FALSE);
+
+        LARGE_INTEGER interval;
+        interval.QuadPart = -(10 * 10000);
+        for (int i = 0; i < 500; i++)
+        {
+            if (jxy::query_trim_stats().low_memory_trims > stats.low_memory_trims)
+            {
+                break;
+            }
+            KeDelayExecutionThread(KernelMode, FALSE, &interval);
+        }
+
+        KeClearEvent(&lowMemory);
+
+        auto stats2 = jxy::query_trim_stats();
+        UT_ASSERT(stats2.low_memory_trims > stats.low_memory_trims);
+        UT_ASSERT(stats2.bytes_reclaimed > stats.bytes_reclaimed);
+
+        jxy::uninitialize_cache_trimming();
+    }
+
+    {
+        //
+        // The system low memory condition.
+        //
+        UT_ASSERT(NT_SUCCESS(jxy::initialize_cache_trimming()));
+        jxy::uninitialize_cache_trimming();
+
+        //
+        // Uninitializing again is harmless.
+        //
+        jxy::uninitialize_cache_trimming();
+    }
+
+    jxy::uninitialize_magazine_cache();
+}
+
+}
@@ -0,0 +1,349 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     stltest/unordered_map_tests.cpp
+// Author:   Johnny Shaw
+//
+#include "tests_common.hpp"
+#include <jxy/unordered_map.hpp>
+#include <jxy/map.hpp>
+#include <jxy/string.hpp>
+#include <stdexcept>
+
+namespace jxy::Tests
+{
+
+//
+// Inserts, finds, and erases Count keys spread like process and thread IDs.
+// Only the results are asserted, the timings depend on the machine.
+//
+template <typename TMap>
+static LONGLONG MapChurn(TMap& Map, uint32_t Count)
+{
+    auto start = KeQueryPerformanceCounter(nullptr).QuadPart;
+
+    for (uint32_t i = 0; i < Count; i++)
+    {
+        Map.emplace((i * 4), i);
+    }
+
+    size_t found = 0;
+    for (uint32_t i = 0; i < (Count * 2); i++)
+    {
+        if (Map.find(i * 2) != Map.end())
+        {
+            found++;
+        }
+    }
+
+    for (uint32_t i = 0; i < Count; i += 2)
+    {
+        Map.erase(i * 4);
+    }
+
+    auto elapsed = (KeQueryPerformanceCounter(nullptr).QuadPart - start);
+
+    UT_ASSERT(found == Count);
+    UT_ASSERT(Map.size() == (Count / 2));
+    return elapsed;
+}
+
+static void UnorderedMapBenchmark()
+{
+    for (uint32_t count : { 10000u, 100000u, 1000000u })
+    {
+        LONGLONG mapTime;
+        {
+            jxy::map<uint32_t, uint32_t, PagedPool, '0GAT'> map;
+            mapTime = MapChurn(map, count);
+        }
+
+        LONGLONG hashTime;
+        {
+            jxy::unordered_map<uint32_t, uint32_t, PagedPool, '0GAT'> map;
+            hashTime = MapChurn(map, count);
+        }
+
+        LONGLONG reservedTime;
+        {
+            jxy::unordered_map<uint32_t, uint32_t, PagedPool, '0GAT'> map;
+            map.reserve(count);
+            reservedTime = MapChurn(map, count);
+        }
+
+        DbgPrintEx(DPFLTR_IHVDRIVER_ID,
+                   DPFLTR_INFO_LEVEL,
+                   "stltest: %u key churn map %lld unordered_map %lld reserved %lld\n",
+                   count,
+                   mapTime,
+                   hashTime,
+                   reservedTime);
+    }
+}
+
+struct UnorderedThrowingCopy
+{
+    UnorderedThrowingCopy(int Value) : Value(Value)
+    {
+    }
+
+    UnorderedThrowingCopy(const UnorderedThrowingCopy& Other) : Value(Other.Value)
+    {
+        if (Value == ThrowOn)
+        {
+            throw std::runtime_error("UnorderedThrowingCopy");
+        }
+    }
+
+    int Value;
+
+    static inline int ThrowOn = -1;
+};
+
+void UnorderedMapTests()
+{
+    {
+        jxy::unordered_map<int, int, PagedPool, '0GAT'> map;
+
+        UT_ASSERT(map.get_allocator().pool_tag == '0GAT');
+        UT_ASSERT(map.get_allocator().pool_type == PagedPool);
+        UT_ASSERT(map.bucket_count() == 0);
+        UT_ASSERT(map.begin() == map.end());
+        UT_ASSERT(map.find(1) == map.end());
+
+        map.insert({ { 1, 10 }, { 2, 20 }, { 3, 30 } });
+        UT_ASSERT(map.size() == 3);
+        UT_ASSERT(map.empty() == false);
+        UT_ASSERT(map.bucket_count() >= 8);
+
+        auto result = map.emplace(1, 11);
+        UT_ASSERT(result.second == false);
+        UT_ASSERT(result.first->second == 10);
+
+        UT_ASSERT(map.try_emplace(4, 40).second);
+        UT_ASSERT(map.try_emplace(4, 41).second == false);
+        UT_ASSERT(map.insert_or_assign(4, 42).second == false);
+        UT_ASSERT(map.at(4) == 42);
+
+        map[5] = 50;
+        UT_ASSERT(map[5] == 50);
+        UT_ASSERT(map.size() == 5);
+        UT_ASSERT(map.contains(5));
+        UT_ASSERT(map.count(6) == 0);
+
+        bool threw = false;
+        try
+        {
+            map.at(6);
+        }
+        catch (const std::out_of_range&)
+        {
+            threw = true;
+        }
+        UT_ASSERT(threw);
+
+        int sum = 0;
+        for (const auto& [key, value] : map)
+        {
+            UT_ASSERT(value >= (key * 10));
+            sum += key;
+        }
+        UT_ASSERT(sum == 15);
+
+        UT_ASSERT(map.erase(3) == 1);
+        UT_ASSERT(map.erase(3) == 0);
+        UT_ASSERT(map.find(3) == map.end());
+
+        auto it = map.erase(map.find(1));
+        UT_ASSERT(map.size() == 3);
+        UT_ASSERT(std::distance(it, map.end()) <= 3);
+
+        map.erase(map.begin(), map.end());
+        UT_ASSERT(map.empty());
+
+        map.clear();
+        UT_ASSERT(map.empty());
+    }
+
+    {
+        //
+        // The load factor is an integer percentage.
+        //
+        jxy::unordered_map<uint32_t, uint32_t, PagedPool, '0GAT'> map;
+        UT_ASSERT(map.max_load_factor() == jxy::hash_default_max_load_factor);
+
+        for (uint32_t i = 0; i < 1000; i++)
+        {
+            map.emplace(i, i);
+            UT_ASSERT(map.load_factor() <= map.max_load_factor());
+        }
+        UT_ASSERT(map.bucket_count() == 1024);
+        UT_ASSERT(map.load_factor() == 97);
+
+        map.max_load_factor(50);
+        UT_ASSERT(map.bucket_count() == 2048);
+        UT_ASSERT(map.load_factor() <= 50);
+
+        map.max_load_factor(400);
+        map.rehash(0);
+        UT_ASSERT(map.bucket_count() == 256);
+        UT_ASSERT(map.load_factor() == 390);
+
+        size_t bucketed = 0;
+        for (size_t i = 0; i < map.bucket_count(); i++)
+        {
+            bucketed += map.bucket_size(i);
+        }
+        UT_ASSERT(bucketed == 1000);
+
+        for (uint32_t i = 0; i < 1000; i++)
+        {
+            UT_ASSERT(map.at(i) == i);
+            UT_ASSERT(map.bucket_size(map.bucket(i)) > 0);
+        }
+
+        //
+        // Reserving makes room for the elements up front.
+        //
+        jxy::unordered_map<uint32_t, uint32_t, PagedPool, '0GAT'> reserved;
+        reserved.reserve(1000);
+        auto buckets = reserved.bucket_count();
+        UT_ASSERT(buckets == 1024);
+        for (uint32_t i = 0; i < 1000; i++)
+        {
+            reserved.emplace(i, i);
+        }
+        UT_ASSERT(reserved.bucket_count() == buckets);
+
+        jxy::unordered_map<uint32_t, uint32_t, PagedPool, '0GAT'> sized(100);
+        UT_ASSERT(sized.bucket_count() == 128);
+    }
+
+    {
+        //
+        // Copies, moves, and comparisons.
+        //
+        using MapType = jxy::unordered_map<jxy::wstring<PagedPool, '0GAT'>,
+                                           int,
+                                           PagedPool,
+                                           '0GAT',
+                                           std::hash<std::wstring_view>>;
+
+        MapType map{ { L"ntdll.dll", 1 }, { L"kernel32.dll", 2 }, { L"user32.dll", 3 } };
+        UT_ASSERT(map.at(L"kernel32.dll") == 2);
+
+        MapType copy(map);
+        UT_ASSERT(copy == map);
+        copy[L"user32.dll"] = 4;
+        UT_ASSERT(copy != map);
+
+        copy = map;
+        UT_ASSERT(copy == map);
+
+        MapType moved(std::move(copy));
+        UT_ASSERT(copy.empty());
+        UT_ASSERT(moved == map);
+
+        copy = std::move(moved);
+        UT_ASSERT(moved.empty());
+        UT_ASSERT(moved.bucket_count() == 0);
+        UT_ASSERT(copy == map);
+
+        moved.swap(copy);
+        UT_ASSERT(copy.empty());
+        UT_ASSERT(moved.size() == 3);
+
+        moved = { { L"ntdll.dll", 1 } };
+        UT_ASSERT(moved.size() == 1);
+    }
+
+    {
+        //
+        // Equivalent keys are kept together and in order, also across a
+        // rehash.
+        //
+        jxy::unordered_multimap<int, int, PagedPool, '0GAT'> multimap;
+        for (int i = 0; i < 100; i++)
+        {
+            multimap.emplace(i % 10, i);
+        }
+        UT_ASSERT(multimap.size() == 100);
+        UT_ASSERT(multimap.count(3) == 10);
+
+        multimap.rehash(1024);
+
+        for (int key = 0; key < 10; key++)
+        {
+            auto range = multimap.equal_range(key);
+            UT_ASSERT(std::distance(range.first, range.second) == 10);
+
+            int expected = key;
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                UT_ASSERT(it->first == key);
+                UT_ASSERT(it->second == expected);
+                expected += 10;
+            }
+        }
+
+        auto copy = multimap;
+        UT_ASSERT(copy == multimap);
+
+        UT_ASSERT(multimap.erase(3) == 10);
+        UT_ASSERT(multimap.count(3) == 0);
+        UT_ASSERT(multimap.size() == 90);
+        UT_ASSERT(copy != multimap);
+
+        auto range = multimap.equal_range(3);
+        UT_ASSERT(range.first == range.second);
+    }
+
+    {
+        //
+        // A throwing element copy frees the nodes and buckets already
+        // copied.
+        //
+        jxy::unordered_map<int, UnorderedThrowingCopy, PagedPool, '0GAT'> map;
+        for (int i = 0; i < 100; i++)
+        {
+            map.emplace(i, i);
+        }
+
+        UnorderedThrowingCopy::ThrowOn = 50;
+        bool threw = false;
+        try
+        {
+            auto copy = map;
+        }
+        catch (const std::runtime_error&)
+        {
+            threw = true;
+        }
+        UnorderedThrowingCopy::ThrowOn = -1;
+        UT_ASSERT(threw);
+
+        auto copy = map;
+        UT_ASSERT(copy.size() == 100);
+    }
+
+    {
+        //
+        // The tag may be given at runtime.
+        //
+        jxy::unordered_map<int,
+                           int,
+                           PagedPool,
+                           0,
+                           std::hash<int>,
+                           std::equal_to<int>,
+                           jxy::tagged_allocator<std::pair<const int, int>, PagedPool>>
+            map(jxy::tagged_allocator<std::pair<const int, int>, PagedPool>('1GAT'));
+
+        map[1] = 1;
+        UT_ASSERT(map.get_allocator().pool_tag() == '1GAT');
+    }
+
+    UnorderedMapBenchmark();
+}
+
+}
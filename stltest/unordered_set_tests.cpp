@@ -0,0 +1,87 @@
+//
+// Copyright (c) Johnny Shaw. All rights reserved.
+// 
+// File:     stltest/unordered_set_tests.cpp
+// Author:   Johnny Shaw
+//
+#include "tests_common.hpp"
+#include <jxy/unordered_set.hpp>
+
+namespace jxy::Tests
+{
+
+void UnorderedSetTests()
+{
+    {
+        jxy::unordered_set<int, PagedPool, '0GAT'> set;
+
+        UT_ASSERT(set.get_allocator().pool_tag == '0GAT');
+        UT_ASSERT(set.get_allocator().pool_type == PagedPool);
+
+        set.insert({ 1, 2, 3 });
+
+        UT_ASSERT(set.size() == 3);
+        UT_ASSERT(set.empty() == false);
+
+        UT_ASSERT(set.emplace(4).second);
+        UT_ASSERT(set.insert(4).second == false);
+
+        UT_ASSERT(set.size() == 4);
+
+        set.erase(set.begin(), set.end());
+
+        UT_ASSERT(set.empty() == true);
+
+        set.insert({ 1, 2, 3 });
+
+        UT_ASSERT(set.find(1) != set.end());
+        UT_ASSERT(set.find(4) == set.end());
+
+        jxy::unordered_set<int, PagedPool, '0GAT'> set2;
+
+        set.swap(set2);
+
+        UT_ASSERT(set.empty() == true);
+        UT_ASSERT(set2.empty() == false);
+
+        set2.clear();
+        UT_ASSERT(set2.empty() == true);
+    }
+
+    {
+        //
+        // Aligned pointers are spread over the buckets.
+        //
+        jxy::unordered_set<uintptr_t, NonPagedPoolNx, '0GAT'> set;
+        for (uintptr_t i = 1; i <= 4096; i++)
+        {
+            set.insert(i * 0x1000);
+        }
+
+        size_t longest = 0;
+        for (size_t i = 0; i < set.bucket_count(); i++)
+        {
+            longest = std::max(longest, set.bucket_size(i));
+        }
+        UT_ASSERT(longest < 16);
+    }
+
+    {
+        jxy::unordered_multiset<int, PagedPool, '0GAT'> multiset;
+        for (int i = 0; i < 64; i++)
+        {
+            multiset.insert(i % 4);
+        }
+        UT_ASSERT(multiset.count(2) == 16);
+
+        auto range = multiset.equal_range(2);
+        UT_ASSERT(std::distance(range.first, range.second) == 16);
+
+        multiset.erase(range.first);
+        UT_ASSERT(multiset.count(2) == 15);
+        UT_ASSERT(multiset.erase(2) == 15);
+        UT_ASSERT(multiset.size() == 48);
+    }
+}
+
+}